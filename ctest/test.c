@@ -65,12 +65,16 @@ static bool test_cipher_str(void) {
     }
     char message[] = "Three pigeons on a roof";
     
-    purecipher_encipher_str(cipher, message);
+    if (strlen(message) != purecipher_encipher_str(cipher, message)) {
+        pass = false;
+    }
     if (0 != strcmp("Uisff!qjhfpot!po!b!sppg", message)) {
         pass = false;
     }
     
-    purecipher_decipher_str(cipher, message);
+    if (strlen(message) != purecipher_decipher_str(cipher, message)) {
+        pass = false;
+    }
     if (0 != strcmp("Three pigeons on a roof", message)) {
         pass = false;
     }
@@ -161,6 +165,574 @@ static bool test_builder_swap(void) {
     return pass;
 }
 
+static bool test_cipher_batch(void) {
+    bool pass = true;
+    const purecipher_obj_t caesar = purecipher_cipher_caesar();
+    const purecipher_obj_t rot13 = purecipher_cipher_rot13();
+
+    // Records from two "tenants" interleaved in a single arena.
+    const purecipher_obj_t ciphers[4] = {caesar, rot13, caesar, rot13};
+    const size_t offsets[5] = {0, 6, 12, 18, 24};
+    uint8_t arena[] = "attackattackattackattack";
+
+    purecipher_encipher_batch(ciphers, arena, offsets, 4);
+    if (0 != memcmp("dwwdfnnggnpxdwwdfnnggnpx", arena, 24)) {
+        pass = false;
+    }
+
+    purecipher_decipher_batch(ciphers, arena, offsets, 4);
+    if (0 != memcmp("attackattackattackattack", arena, 24)) {
+        pass = false;
+    }
+
+    purecipher_free(caesar);
+    purecipher_free(rot13);
+    return pass;
+}
+
+static bool test_cipher_fields(void) {
+    bool pass = true;
+    const purecipher_obj_t rot13 = purecipher_cipher_rot13();
+
+    // A 2-byte key and a 3-byte value in each 8-byte record.
+    uint8_t records[] = "k1:abc;\nk2:def;\nk3:ghi;\n";
+    purecipher_encipher_strided(rot13, records + 3, 3, 8, 3);
+    if (0 != memcmp("k1:nop;\nk2:qrs;\nk3:tuv;\n", records, 24)) {
+        pass = false;
+    }
+
+    const purecipher_field_t fields[] = {{3, 3}, {0, 1}};
+    purecipher_decipher_fields(rot13, records, 8, 3, fields, 2);
+    if (0 != memcmp("x1:abc;\nx2:def;\nx3:ghi;\n", records, 24)) {
+        pass = false;
+    }
+
+    // Overlapping fields must leave the records unchanged.
+    const purecipher_field_t overlapping[] = {{0, 4}, {3, 3}};
+    purecipher_encipher_fields(rot13, records, 8, 3, overlapping, 2);
+    if (0 != memcmp("x1:abc;\nx2:def;\nx3:ghi;\n", records, 24)) {
+        pass = false;
+    }
+
+    purecipher_free(rot13);
+    return pass;
+}
+
+static bool test_field_selector(void) {
+    bool pass = true;
+    const purecipher_obj_t rot13 = purecipher_cipher_rot13();
+    purecipher_selector_t *selector = purecipher_selector_new(' ');
+    purecipher_selector_key(selector, "user");
+
+    char log[] = "ts=1 user=alice op=read\nts=2 op=write user=bob\n";
+    purecipher_selector_encipher(selector, rot13, (uint8_t *) log, strlen(log));
+    if (0 != strcmp("ts=1 user=nyvpr op=read\nts=2 op=write user=obo\n", log)) {
+        pass = false;
+    }
+    purecipher_selector_decipher(selector, rot13, (uint8_t *) log, strlen(log));
+    if (0 != strcmp("ts=1 user=alice op=read\nts=2 op=write user=bob\n", log)) {
+        pass = false;
+    }
+
+    purecipher_selector_free(selector);
+    purecipher_free(rot13);
+    return pass;
+}
+
+static bool test_histogram(void) {
+    bool pass = true;
+    const purecipher_obj_t caesar = purecipher_cipher_caesar();
+    const uint8_t cipher_text[] = "Zh dwwdfn dw gdzq.";
+    uint64_t counts[256];
+
+    purecipher_histogram(cipher_text, sizeof(cipher_text) - 1, counts);
+    if (counts['d'] != 4 || counts['a'] != 0 || counts['.'] != 1) {
+        pass = false;
+    }
+
+    purecipher_histogram_plaintext(caesar, cipher_text, sizeof(cipher_text) - 1, counts);
+    if (counts['a'] != 4 || counts['d'] != 1 || counts['.'] != 1) {
+        pass = false;
+    }
+    // The ciphertext itself must not be modified.
+    if (0 != memcmp("Zh dwwdfn dw gdzq.", cipher_text, sizeof(cipher_text))) {
+        pass = false;
+    }
+
+    // Two equally likely byte values carry exactly one bit of entropy.
+    const uint8_t coin[] = "HTHTTH";
+    double expected[256] = {0};
+    expected['H'] = 0.5;
+    expected['T'] = 0.5;
+    purecipher_histogram(coin, sizeof(coin) - 1, counts);
+    if (purecipher_histogram_entropy(counts) != 1.0) {
+        pass = false;
+    }
+    if (purecipher_histogram_chi_square(counts, expected) != 0.0) {
+        pass = false;
+    }
+
+    purecipher_free(caesar);
+    return pass;
+}
+
+static bool test_crc32c(void) {
+    bool pass = true;
+    const purecipher_obj_t caesar = purecipher_cipher_caesar();
+    const uint8_t check[] = "123456789";
+    uint8_t message[] = "Attack at dawn";
+    const size_t length = sizeof(message) - 1;
+
+    pass &= 0xe3069283 == purecipher_crc32c(0, check, 9);
+    pass &= 0xe3069283 == purecipher_crc32c(purecipher_crc32c(0, check, 4), check + 4, 5);
+    pass &= 0xe3069283 == purecipher_crc32c_combine(purecipher_crc32c(0, check, 4), purecipher_crc32c(0, check + 4, 5), 5);
+
+    // Checksum the plaintext while enciphering, then the ciphertext while
+    // deciphering, as the sender and receiver of a message would.
+    const uint32_t plaintext_crc = purecipher_crc32c(0, message, length);
+    pass &= plaintext_crc == purecipher_encipher_buffer_crc32c(caesar, message, length, 0, 0);
+    pass &= 0 == memcmp(message, "Dwwdfn dw gdzq", length);
+    const uint32_t ciphertext_crc = purecipher_crc32c(0, message, length);
+    pass &= ciphertext_crc == purecipher_decipher_buffer_crc32c(caesar, message, length, 0, 1);
+    pass &= 0 == memcmp(message, "Attack at dawn", length);
+
+    purecipher_free(caesar);
+    return pass;
+}
+
+static bool test_encode(void) {
+    bool pass = true;
+    const purecipher_obj_t caesar = purecipher_cipher_caesar();
+    const uint8_t message[] = "Attack at dawn";
+    const size_t length = sizeof(message) - 1;
+    char text[32];
+    uint8_t decoded[16];
+
+    pass &= 28 == purecipher_encoded_length(PURECIPHER_ENCODING_HEX, length);
+    pass &= 28 == purecipher_encipher_encode(caesar, PURECIPHER_ENCODING_HEX, message, length, text, sizeof(text));
+    pass &= 0 == memcmp(text, "44777764666e2064772067647a71", 28);
+    pass &= 14 == purecipher_decode_decipher(caesar, PURECIPHER_ENCODING_HEX, text, 28, decoded, sizeof(decoded));
+    pass &= 0 == memcmp(decoded, message, length);
+
+    pass &= 20 == purecipher_encipher_encode(caesar, PURECIPHER_ENCODING_BASE64, message, length, text, sizeof(text));
+    pass &= 0 == memcmp(text, "RHd3ZGZuIGR3IGdkenE=", 20);
+    pass &= 14 == purecipher_decoded_length(PURECIPHER_ENCODING_BASE64, text, 20);
+    pass &= 14 == purecipher_decode_decipher(caesar, PURECIPHER_ENCODING_BASE64, text, 20, decoded, sizeof(decoded));
+    pass &= 0 == memcmp(decoded, message, length);
+
+    // Too little room for the text, and text that is not base64.
+    pass &= 0 == purecipher_encipher_encode(caesar, PURECIPHER_ENCODING_BASE64, message, length, text, 19);
+    pass &= -1 == purecipher_decode_decipher(caesar, PURECIPHER_ENCODING_BASE64, "RHd3*GZu", 8, decoded, sizeof(decoded));
+
+    purecipher_free(caesar);
+    return pass;
+}
+
+static bool test_cipher_algebra(void) {
+    bool pass = true;
+    const purecipher_obj_t rot13 = purecipher_cipher_rot13();
+    const purecipher_obj_t squared = purecipher_cipher_pow(rot13, 2);
+    const purecipher_obj_t inverse = purecipher_cipher_inverse(rot13);
+
+    uint8_t buffer[] = "Lovely plumage";
+    purecipher_encipher_buffer(squared, buffer, sizeof(buffer));
+    if (0 != memcmp("Lovely plumage", buffer, sizeof(buffer))) {
+        pass = false;
+    }
+    purecipher_encipher_buffer(inverse, buffer, sizeof(buffer));
+    if (0 != memcmp("Ybiryl cyhzntr", buffer, sizeof(buffer))) {
+        pass = false;
+    }
+
+    if (purecipher_cipher_order(rot13) != 2 || purecipher_cipher_order(squared) != 1) {
+        pass = false;
+    }
+
+    uint8_t elements[256];
+    uint16_t lengths[128];
+    if (purecipher_cipher_cycles(rot13, elements, lengths) != 26) {
+        pass = false;
+    } else if (lengths[0] != 2 || elements[0] != 'A' || elements[1] != 'N') {
+        pass = false;
+    }
+
+    purecipher_free(rot13);
+    purecipher_free(squared);
+    purecipher_free(inverse);
+    return pass;
+}
+
+static bool test_cipher_tables(void) {
+    bool pass = true;
+    const purecipher_obj_t caesar = purecipher_cipher_caesar();
+
+    uint8_t map[256];
+    purecipher_cipher_table(caesar, map);
+    const purecipher_obj_t copy = purecipher_cipher_from_table(map);
+
+    uint8_t tables[PURECIPHER_SHARED_TABLES_LEN];
+    purecipher_shared_write(caesar, tables);
+    const purecipher_obj_t shared = purecipher_cipher_shared(tables);
+
+    uint8_t buffer[] = "Hello";
+    purecipher_encipher_buffer(copy, buffer, sizeof(buffer));
+    if (0 != memcmp("Khoor", buffer, sizeof(buffer))) {
+        pass = false;
+    }
+    purecipher_decipher_buffer(shared, buffer, sizeof(buffer));
+    if (0 != memcmp("Hello", buffer, sizeof(buffer))) {
+        pass = false;
+    }
+
+    map['a'] = map['b'];
+    if (purecipher_cipher_from_table(map)._data != NULL) {
+        pass = false;
+    }
+
+    purecipher_free(caesar);
+    purecipher_free(copy);
+    purecipher_free(shared);
+    return pass;
+}
+
+static bool test_periodic(void) {
+    bool pass = true;
+    const uint8_t key[] = {0, 1, 2};
+    purecipher_periodic_t *vigenere = purecipher_periodic_new_shifts(key, sizeof(key));
+
+    uint8_t buffer[] = "aaaaaaaa";
+    // Cipher the buffer as two chunks of the same stream, in reverse order.
+    purecipher_periodic_encipher(vigenere, buffer + 5, 3, 5);
+    purecipher_periodic_encipher(vigenere, buffer, 5, 0);
+    if (0 != memcmp("abcabcab", buffer, 8)) {
+        pass = false;
+    }
+    purecipher_periodic_decipher(vigenere, buffer, 8, 0);
+    if (0 != memcmp("aaaaaaaa", buffer, 8)) {
+        pass = false;
+    }
+    purecipher_periodic_free(vigenere);
+
+    const purecipher_obj_t ciphers[2] = {purecipher_cipher_null(), purecipher_cipher_rot13()};
+    purecipher_periodic_t *periodic = purecipher_periodic_new(ciphers, 2);
+    purecipher_free(ciphers[0]);
+    purecipher_free(ciphers[1]);
+
+    if (purecipher_periodic_period(periodic) != 2) {
+        pass = false;
+    }
+    purecipher_periodic_encipher(periodic, buffer, 8, 0);
+    if (0 != memcmp("anananan", buffer, 8)) {
+        pass = false;
+    }
+    purecipher_periodic_free(periodic);
+    return pass;
+}
+
+static bool test_pool(void) {
+    bool pass = true;
+    purecipher_pool_t *pool = purecipher_pool_new(0);
+    const purecipher_obj_t caesar = purecipher_cipher_caesar();
+    const purecipher_obj_t rot13 = purecipher_cipher_rot13();
+
+    uint8_t messages[64][4];
+    purecipher_job_t jobs[64];
+    for (size_t i = 0; i < 64; ++i) {
+        memcpy(messages[i], "abc", 4);
+        jobs[i].cipher = i % 2 ? rot13 : caesar;
+        jobs[i].buffer = messages[i];
+        jobs[i].length = 3;
+    }
+
+    purecipher_batch_t *batch = purecipher_pool_encipher(pool, jobs, 64);
+    purecipher_batch_wait(batch);
+    if (!purecipher_batch_done(batch)) {
+        pass = false;
+    }
+    purecipher_batch_free(batch);
+    for (size_t i = 0; i < 64; ++i) {
+        if (0 != strcmp(i % 2 ? "nop" : "def", (const char *) messages[i])) {
+            pass = false;
+        }
+    }
+
+    // Freeing a batch waits for it to complete.
+    purecipher_batch_free(purecipher_pool_decipher(pool, jobs, 64));
+    for (size_t i = 0; i < 64; ++i) {
+        if (0 != strcmp("abc", (const char *) messages[i])) {
+            pass = false;
+        }
+    }
+
+    purecipher_pool_free(pool);
+    purecipher_free(caesar);
+    purecipher_free(rot13);
+    return pass;
+}
+
+static bool test_context(void) {
+    bool pass = true;
+    purecipher_context_t *context = purecipher_context_new(2, 8);
+    const purecipher_obj_t rot13 = purecipher_cipher_rot13();
+
+    uint8_t messages[4][4];
+    purecipher_submission_t submissions[4];
+    for (size_t i = 0; i < 4; ++i) {
+        memcpy(messages[i], "abc", 4);
+        submissions[i] = (purecipher_submission_t) {rot13, messages[i], 3, 0, i, NULL};
+    }
+    if (purecipher_context_submit(context, submissions, 4) != 4) {
+        pass = false;
+    }
+
+    // Reap until every submission has completed. An event loop would instead
+    // poll purecipher_context_eventfd.
+    uint64_t reaped = 0;
+    purecipher_completion_t completions[4];
+    for (size_t count = 0; count < 4;) {
+        const size_t n = purecipher_context_reap(context, completions, 4);
+        for (size_t i = 0; i < n; ++i) {
+            reaped |= 1u << completions[i].user_data;
+        }
+        count += n;
+    }
+    if (reaped != 0xf) {
+        pass = false;
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        if (0 != strcmp("nop", (const char *) messages[i])) {
+            pass = false;
+        }
+    }
+
+    purecipher_context_free(context);
+    purecipher_free(rot13);
+    return pass;
+}
+
+static bool test_arena(void) {
+    bool pass = true;
+    purecipher_arena_t *arena = purecipher_arena_new();
+    const purecipher_obj_t caesar = purecipher_cipher_caesar();
+
+    // Intern the same cipher for many users.
+    purecipher_obj_t user_ciphers[100];
+    for (size_t i = 0; i < 100; ++i) {
+        user_ciphers[i] = purecipher_arena_intern(arena, caesar);
+    }
+    purecipher_free(caesar);
+    if (purecipher_arena_len(arena) != 1 || user_ciphers[0]._data != user_ciphers[99]._data) {
+        pass = false;
+    }
+
+    char message[] = "We attack at dawn.";
+    purecipher_encipher_str(user_ciphers[42], message);
+    if (0 != strcmp("Zh dwwdfn dw gdzq.", message)) {
+        pass = false;
+    }
+    purecipher_decipher_str(user_ciphers[7], message);
+    if (0 != strcmp("We attack at dawn.", message)) {
+        pass = false;
+    }
+
+    const uint8_t not_a_permutation[256] = {0};
+    if (purecipher_arena_intern_table(arena, not_a_permutation)._data != NULL) {
+        pass = false;
+    }
+
+    purecipher_arena_free(arena);
+    return pass;
+}
+
+static bool test_wide(void) {
+    bool pass = true;
+    purecipher_wide_builder_t *builder = purecipher_wide_builder_new();
+    // Shift hiragana one ahead.
+    purecipher_wide_builder_rotate(builder, 0x3041, 0x3096, 1);
+    purecipher_wide_t *cipher = purecipher_wide_builder_into_cipher(builder);
+
+    // "konnichiwa" in hiragana, long enough for the vectorized kernel.
+    uint16_t text[40];
+    const uint16_t word[] = {0x3053, 0x3093, 0x306b, 0x3061, 0x306f};
+    for (size_t i = 0; i < 40; ++i) {
+        text[i] = word[i % 5];
+    }
+    purecipher_wide_encipher(cipher, text, 40);
+    for (size_t i = 0; i < 40; ++i) {
+        if (text[i] != (word[i % 5] == 0x3096 ? 0x3041 : word[i % 5] + 1)) {
+            pass = false;
+        }
+    }
+    purecipher_wide_decipher(cipher, text, 40);
+    for (size_t i = 0; i < 40; ++i) {
+        if (text[i] != word[i % 5]) {
+            pass = false;
+        }
+    }
+    purecipher_wide_free(cipher);
+
+    static uint16_t not_a_permutation[1 << 16];
+    if (purecipher_wide_from_table(not_a_permutation) != NULL) {
+        pass = false;
+    }
+    return pass;
+}
+
+static bool test_swap(void) {
+    bool pass = true;
+    purecipher_swap_t *swap = purecipher_swap_new(purecipher_cipher_caesar());
+    const purecipher_obj_t cipher = purecipher_swap_cipher(swap);
+
+    uint8_t buffer[] = "abc";
+    purecipher_encipher_buffer(cipher, buffer, 3);
+    pass &= 0 == memcmp(buffer, "def", 3);
+
+    // The same cipher object picks up the new cipher.
+    pass &= 0 == purecipher_swap_store(swap, purecipher_cipher_rot13());
+    purecipher_decipher_buffer(cipher, buffer, 3);
+    pass &= 0 == memcmp(buffer, "qrs", 3);
+
+    const purecipher_obj_t invalid = {NULL, NULL};
+    pass &= -1 == purecipher_swap_store(swap, invalid);
+    pass &= NULL == purecipher_swap_new(invalid);
+
+    purecipher_swap_free(swap);
+    return pass;
+}
+
+static bool test_solver(void) {
+    bool pass = true;
+    const char *sentence = "the quick brown fox jumps over the lazy dog. ";
+    uint8_t corpus[45 * 100];
+    for (size_t i = 0; i < 100; ++i) {
+        memcpy(corpus + 45 * i, sentence, 45);
+    }
+    purecipher_model_t *model = purecipher_model_new(corpus, sizeof(corpus));
+    purecipher_solver_t *solver = purecipher_solver_new(model);
+    purecipher_solver_set_threads(solver, 2);
+    purecipher_solver_set_time_limit(solver, 5000);
+    pass &= 0 == purecipher_solver_add_crib(solver, 4, (const uint8_t *) "quick brown", 11);
+
+    const purecipher_obj_t caesar = purecipher_cipher_caesar();
+    uint8_t buffer[] = "the quick brown fox jumps over the lazy dog.";
+    const size_t length = sizeof(buffer) - 1;
+    const double expected = purecipher_model_score(model, buffer, length);
+    purecipher_encipher_buffer(caesar, buffer, length);
+
+    // The corpus repeats a single sentence, so other plaintext may score as
+    // well as the original, but none better.
+    double score = 0.0;
+    const purecipher_obj_t solved = purecipher_solver_solve(solver, buffer, length, &score);
+    if (solved._data == NULL) {
+        pass = false;
+    } else {
+        purecipher_decipher_buffer(solved, buffer, length);
+        pass &= 0 == memcmp(buffer + 4, "quick brown", 11);
+        // The solver's score is accumulated in single precision.
+        pass &= score > expected - 1e-3;
+        pass &= score - purecipher_model_score(model, buffer, length) < 1e-3;
+        purecipher_free(solved);
+    }
+    pass &= 0 == purecipher_solver_add_crib(solver, 40, (const uint8_t *) "foxes", 5);
+    pass &= NULL == purecipher_solver_solve(solver, buffer, length, NULL)._data;
+
+    purecipher_free(caesar);
+    purecipher_solver_free(solver);
+    purecipher_model_free(model);
+    return pass;
+}
+
+static bool test_find(void) {
+    bool pass = true;
+    const purecipher_obj_t caesar = purecipher_cipher_caesar();
+    uint8_t buffer[] = "ok\nERROR disk\nWARN disk\nERROR net";
+    const size_t length = sizeof(buffer) - 1;
+    purecipher_encipher_buffer(caesar, buffer, length);
+
+    pass &= 3 == purecipher_find(caesar, (const uint8_t *) "ERROR", 5, buffer, length);
+    pass &= -1 == purecipher_find(caesar, (const uint8_t *) "FATAL", 5, buffer, length);
+
+    size_t offsets[4];
+    pass &= 2 == purecipher_find_all(caesar, (const uint8_t *) "disk", 4, buffer, length, offsets, 4);
+    pass &= offsets[0] == 9 && offsets[1] == 19;
+
+    const uint8_t *patterns[] = {(const uint8_t *) "WARN", (const uint8_t *) "ERROR"};
+    const size_t lengths[] = {4, 5};
+    purecipher_multi_finder_t *finder = purecipher_multi_finder_new(caesar, patterns, lengths, 2);
+    purecipher_match_t matches[2];
+    pass &= 3 == purecipher_multi_finder_find_all(finder, buffer, length, matches, 2);
+    pass &= matches[0].offset == 3 && matches[0].pattern == 1;
+    pass &= matches[1].offset == 14 && matches[1].pattern == 0;
+    purecipher_multi_finder_free(finder);
+
+    purecipher_free(caesar);
+    return pass;
+}
+
+static bool test_order(void) {
+    bool pass = true;
+    const purecipher_obj_t caesar = purecipher_cipher_caesar();
+    purecipher_order_t *order = purecipher_order_new(caesar);
+
+    // "xray", "apple" and "melon" under caesar.
+    const uint8_t *keys[] = {(const uint8_t *) "audb", (const uint8_t *) "dssoh", (const uint8_t *) "phorq"};
+    const size_t lengths[] = {4, 5, 5};
+    pass &= purecipher_order_compare(order, keys[1], lengths[1], keys[0], lengths[0]) < 0;
+    pass &= purecipher_order_compare(order, keys[0], lengths[0], keys[2], lengths[2]) > 0;
+
+    size_t indices[3];
+    pass &= 0 == purecipher_order_argsort(order, keys, lengths, 3, indices);
+    pass &= indices[0] == 1 && indices[1] == 2 && indices[2] == 0;
+
+    const uint8_t *sorted[] = {keys[1], keys[2], keys[0]};
+    const size_t sorted_lengths[] = {5, 5, 4};
+    pass &= 1 == purecipher_order_search(order, sorted, sorted_lengths, 3, keys[2], lengths[2]);
+
+    purecipher_order_free(order);
+    purecipher_free(caesar);
+    return pass;
+}
+
+static bool test_service(void) {
+    bool pass = true;
+    const char *path = "/tmp/purecipher-ctest.sock";
+    // Remove the socket of an earlier run that did not exit cleanly.
+    remove(path);
+
+    purecipher_service_t *service = purecipher_service_bind(path, 2);
+    if (service == NULL) {
+        return false;
+    }
+    const purecipher_obj_t rot13 = purecipher_cipher_rot13();
+    const int64_t registered = purecipher_service_register(service, "rot13", rot13);
+    purecipher_free(rot13);
+
+    purecipher_client_t *client = purecipher_client_connect(path, 4, 64);
+    const int64_t id = purecipher_client_lookup(client, "rot13");
+    if (client == NULL || registered < 0 || id != registered || purecipher_client_lookup(client, "vigenere") != -1) {
+        pass = false;
+        goto done;
+    }
+
+    for (size_t slot = 0; slot < 4; ++slot) {
+        memcpy(purecipher_client_buffer(client, slot), "Hello", 5);
+        pass &= 0 == purecipher_client_submit(client, slot, (uint32_t) id, 5, slot % 2);
+    }
+    // Slots in flight can be neither accessed nor submitted again.
+    pass &= NULL == purecipher_client_buffer(client, 0);
+    pass &= -1 == purecipher_client_submit(client, 0, (uint32_t) id, 5, 0);
+    for (size_t slot = 0; slot < 4; ++slot) {
+        pass &= 0 == purecipher_client_wait(client, slot);
+        pass &= 0 == memcmp(purecipher_client_buffer(client, slot), "Uryyb", 5);
+    }
+    pass &= -1 == purecipher_client_submit(client, 0, (uint32_t) id, purecipher_client_slot_size(client) + 1, 0);
+
+done:
+    purecipher_client_free(client);
+    purecipher_service_free(service);
+    return pass;
+}
+
 static bool test_caesar(void) {
     bool pass;
     const purecipher_obj_t caesar = purecipher_cipher_caesar();
@@ -206,6 +778,37 @@ static bool test_leet(void) {
     return pass;
 }
 
+static bool test_affine(void) {
+    bool pass = true;
+    // Rotate the bits of each byte left by one.
+    const uint8_t rows[8] = {0x80, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40};
+    const purecipher_obj_t rotate = purecipher_cipher_affine(rows, 0);
+
+    uint8_t buffer[100];
+    for (size_t i = 0; i < sizeof(buffer); ++i) {
+        buffer[i] = (uint8_t) i;
+    }
+    purecipher_encipher_buffer(rotate, buffer, sizeof(buffer));
+    for (size_t i = 0; i < sizeof(buffer); ++i) {
+        if (buffer[i] != (uint8_t) (i << 1u | i >> 7u)) {
+            pass = false;
+        }
+    }
+    purecipher_decipher_buffer(rotate, buffer, sizeof(buffer));
+    for (size_t i = 0; i < sizeof(buffer); ++i) {
+        if (buffer[i] != i) {
+            pass = false;
+        }
+    }
+    purecipher_free(rotate);
+
+    const uint8_t singular[8] = {0};
+    if (purecipher_cipher_affine(singular, 0)._data != NULL) {
+        pass = false;
+    }
+    return pass;
+}
+
 static bool test_null(void) {
     bool pass;
     const purecipher_obj_t cipher_null = purecipher_cipher_null();
@@ -244,9 +847,28 @@ int main(void) {
     run_test(test_builder_rotate_forward, "test_builder_rotate_forward", &pass_flag);
     run_test(test_builder_rotate_backward, "test_builder_rotate_backward", &pass_flag);
     run_test(test_builder_swap, "test_builder_swap", &pass_flag);
+    run_test(test_cipher_batch, "test_cipher_batch", &pass_flag);
+    run_test(test_cipher_fields, "test_cipher_fields", &pass_flag);
+    run_test(test_field_selector, "test_field_selector", &pass_flag);
+    run_test(test_histogram, "test_histogram", &pass_flag);
+    run_test(test_crc32c, "test_crc32c", &pass_flag);
+    run_test(test_encode, "test_encode", &pass_flag);
+    run_test(test_cipher_algebra, "test_cipher_algebra", &pass_flag);
+    run_test(test_cipher_tables, "test_cipher_tables", &pass_flag);
+    run_test(test_periodic, "test_periodic", &pass_flag);
+    run_test(test_pool, "test_pool", &pass_flag);
+    run_test(test_context, "test_context", &pass_flag);
+    run_test(test_arena, "test_arena", &pass_flag);
+    run_test(test_wide, "test_wide", &pass_flag);
+    run_test(test_swap, "test_swap", &pass_flag);
+    run_test(test_solver, "test_solver", &pass_flag);
+    run_test(test_find, "test_find", &pass_flag);
+    run_test(test_order, "test_order", &pass_flag);
+    run_test(test_service, "test_service", &pass_flag);
     run_test(test_caesar, "test_caesar", &pass_flag);
     run_test(test_rot13, "test_rot13", &pass_flag);
     run_test(test_leet, "test_leet", &pass_flag);
+    run_test(test_affine, "test_affine", &pass_flag);
     run_test(test_null, "test_null", &pass_flag);
 
     if (!pass_flag) {
@@ -52,12 +52,239 @@ typedef struct {
  */
 typedef struct purecipher_builder_t purecipher_builder_t;
 
+/*
+ * Polyalphabetic cipher that selects a substitution by stream position.
+ *
+ * The byte at stream position i is ciphered with the substitution at index
+ * i % period. Like purecipher_obj_t, a periodic cipher holds no state between
+ * ciphering operations: each call is given the stream position of the first
+ * byte of its buffer, so chunks of a stream may be ciphered independently and
+ * from multiple threads.
+ *
+ * This structure must be freed via purecipher_periodic_free.
+ */
+typedef struct purecipher_periodic_t purecipher_periodic_t;
+
+/*
+ * Pool of worker threads that cipher large numbers of buffers.
+ *
+ * Each worker owns a deque of tasks and idle workers steal tasks from the
+ * deques of busy ones, so there is no central queue for workers to contend
+ * on. Small buffers are grouped into tasks of roughly 64 KiB and large buffers
+ * are split, so batches of tiny messages are processed as efficiently as a few
+ * large ones.
+ *
+ * This structure must be freed via purecipher_pool_free.
+ */
+typedef struct purecipher_pool_t purecipher_pool_t;
+
+/*
+ * Handle on the completion of a batch of jobs submitted to a pool.
+ *
+ * This structure must be freed via purecipher_batch_free.
+ */
+typedef struct purecipher_batch_t purecipher_batch_t;
+
+/*
+ * A buffer to be ciphered inplace by a pool.
+ */
+typedef struct {
+    purecipher_obj_t cipher;
+    uint8_t *buffer;
+    size_t length;
+} purecipher_job_t;
+
+/*
+ * Context that ciphers buffers asynchronously on its own worker threads.
+ *
+ * Buffers are submitted to a bounded lock-free submission ring and the user
+ * data of completed submissions is reaped from a completion ring, so a caller
+ * such as an event loop never blocks on ciphering. Completions are announced
+ * through an eventfd, which may be polled alongside other descriptors, or by
+ * invoking a per-submission callback.
+ *
+ * This structure must be freed via purecipher_context_free.
+ */
+typedef struct purecipher_context_t purecipher_context_t;
+
+/*
+ * A buffer to be ciphered inplace by a context.
+ *
+ * The buffer is deciphered if decipher is nonzero and enciphered otherwise.
+ * If callback is not NULL, it is called with user_data on a worker thread once
+ * the buffer has been ciphered, and no completion is queued for the
+ * submission. Callbacks must not block.
+ */
+typedef struct {
+    purecipher_obj_t cipher;
+    uint8_t *buffer;
+    size_t length;
+    int decipher;
+    uint64_t user_data;
+    void (*callback)(uint64_t user_data);
+} purecipher_submission_t;
+
+/*
+ * A completed submission reaped from a context.
+ */
+typedef struct {
+    uint64_t user_data;
+} purecipher_completion_t;
+
+/*
+ * Selection of fields within delimited text records, such as CSV rows or
+ * key=value log lines, to be ciphered in place.
+ *
+ * Records are separated by newlines and fields by a delimiter byte. Fields are
+ * selected by zero-based column, or by key for fields of the form key=value,
+ * in which case only the value is ciphered. Text can only be deciphered by a
+ * selector if the cipher maps delimiter, quote and newline bytes to themselves
+ * and no other byte onto them.
+ *
+ * This structure must be freed via purecipher_selector_free.
+ */
+typedef struct purecipher_selector_t purecipher_selector_t;
+
+/*
+ * A range of bytes at the same position within every fixed-size record.
+ *
+ * The field spans length bytes starting offset bytes into its record.
+ */
+typedef struct {
+    size_t offset;
+    size_t length;
+} purecipher_field_t;
+
+/*
+ * Arena that deduplicates substitution ciphers by their lookup tables.
+ *
+ * Ciphers interned in an arena are stored once per distinct lookup table, in
+ * 64-byte aligned slabs, so handles to identical ciphers share their tables
+ * and creating a cipher does not allocate memory of its own. The table used to
+ * decipher bytes is only built when a cipher first deciphers.
+ *
+ * Ciphers returned by an arena are owned by the arena: they remain valid until
+ * the arena is freed and must NOT be passed to purecipher_free.
+ *
+ * This structure must be freed via purecipher_arena_free.
+ */
+typedef struct purecipher_arena_t purecipher_arena_t;
+
+/*
+ * Builder for substitution ciphers over 16-bit tokens.
+ *
+ * This structure must be freed by either converting it into a cipher via
+ * purecipher_wide_builder_into_cipher or freeing it via
+ * purecipher_wide_builder_discard.
+ */
+typedef struct purecipher_wide_builder_t purecipher_wide_builder_t;
+
+/*
+ * Substitution cipher over 16-bit tokens, such as UTF-16 code units.
+ *
+ * The table used to encipher tokens occupies 128 KiB. The table used to
+ * decipher tokens, another 128 KiB, is only built when the cipher first
+ * deciphers. Unlike purecipher_obj_t, these ciphers are passed by pointer.
+ *
+ * This structure must be freed via purecipher_wide_free.
+ */
+typedef struct purecipher_wide_t purecipher_wide_t;
+
+/*
+ * Handle to a cipher that may be replaced while other threads cipher with it.
+ *
+ * Threads cipher through the handle's cipher object, obtained from
+ * purecipher_swap_cipher, without taking any locks. Each call that ciphers a
+ * buffer uses a single cipher throughout, even if the cipher is replaced
+ * during the call. Replacing the cipher waits until no call uses the old
+ * cipher any more, and then frees it.
+ *
+ * This structure must be freed via purecipher_swap_free.
+ */
+typedef struct purecipher_swap_t purecipher_swap_t;
+
+/*
+ * Bigram statistics of a corpus of plaintext, used to score candidate
+ * plaintext when solving substitution ciphers.
+ *
+ * This structure must be freed via purecipher_model_free.
+ */
+typedef struct purecipher_model_t purecipher_model_t;
+
+/*
+ * Solver that recovers substitution ciphers from ciphertext by hill climbing
+ * on the statistics of a model.
+ *
+ * Independent climbs run in parallel, each scoring swaps incrementally from
+ * the bigram counts of the ciphertext, and the best key found is returned.
+ * The model must outlive the solver.
+ *
+ * This structure must be freed via purecipher_solver_free.
+ */
+typedef struct purecipher_solver_t purecipher_solver_t;
+
+/*
+ * Finder for the occurrences of several plaintext patterns in ciphertext.
+ *
+ * The patterns are enciphered once, and the ciphertext is searched without
+ * being deciphered, in a single pass over it.
+ *
+ * This structure must be freed via purecipher_multi_finder_free.
+ */
+typedef struct purecipher_multi_finder_t purecipher_multi_finder_t;
+
+/*
+ * An occurrence of one of the patterns of a multi-pattern finder.
+ *
+ * The pattern with the given index starts offset bytes into the ciphertext.
+ */
+typedef struct {
+    size_t offset;
+    size_t pattern;
+} purecipher_match_t;
+
+/*
+ * Order of ciphertext keys by their plaintext under some cipher.
+ *
+ * Keys are compared, sorted and searched in the lexicographic order of their
+ * plaintext through a table of the rank of each ciphertext byte, without any
+ * plaintext being materialized.
+ *
+ * This structure must be freed via purecipher_order_free.
+ */
+typedef struct purecipher_order_t purecipher_order_t;
+
+/*
+ * Cipher service shared by the processes on a host. Linux only.
+ *
+ * The service listens on a Unix domain socket. Every cipher registered with it
+ * is interned in a single table cache and every client's buffers are ciphered
+ * by a single thread pool, so ciphers are built once per host and the service
+ * alone decides how many cores ciphering uses.
+ *
+ * This structure must be freed via purecipher_service_free.
+ */
+typedef struct purecipher_service_t purecipher_service_t;
+
+/*
+ * Client of a cipher service. Linux only.
+ *
+ * Each client shares a ring of fixed-size slots with the service. A slot's
+ * buffer is filled in place, submitted, ciphered in place by the service, and
+ * read back in place once waited on, so the bytes are never copied between the
+ * processes. Slots are identified by their index; any number of them may be in
+ * flight at once. A client must only be used by one thread at a time.
+ *
+ * This structure must be freed via purecipher_client_free.
+ */
+typedef struct purecipher_client_t purecipher_client_t;
+
 /*
  * Frees the given purecipher_obj_t. This function must be called once for every
  * pure cipher instance created.
  *
  * Note that this function takes a purecipher_obj_t directly, NOT a pointer to
- * one.
+ * one. Freeing a null cipher object (one whose _data is NULL) has no effect.
  */
 void purecipher_free(purecipher_obj_t cipher);
 
@@ -88,16 +315,395 @@ void purecipher_decipher_buffer(purecipher_obj_t cipher, uint8_t *buffer, size_t
  *
  * The buffer DOES NOT need to contain valid UTF-8, but it MUST NOT contain
  * intermittent NULLs.
+ *
+ * The terminator is found and the string encoded in a single pass. Returns the
+ * length of the string, excluding its terminator, so that callers need not call
+ * strlen on it again. On x86_64, like strlen, this function reads the whole
+ * aligned 64-byte blocks holding the string, including bytes before its start
+ * and past its terminator, but never writes them.
  */
-void purecipher_encipher_str(purecipher_obj_t cipher, char *string);
+size_t purecipher_encipher_str(purecipher_obj_t cipher, char *string);
 
 /*
  * Decodes the provided null-terminated string with the given cipher.
  *
  * The buffer DOES NOT need to contain valid UTF-8, but it MUST NOT contain
  * intermittent NULLs.
+ *
+ * Returns the length of the string. See purecipher_encipher_str.
+ */
+size_t purecipher_decipher_str(purecipher_obj_t cipher, char *string);
+
+/*
+ * Encodes a batch of records stored contiguously in the given arena, each with
+ * its own cipher.
+ *
+ * Record i spans the bytes [offsets[i], offsets[i + 1]) of the arena and is
+ * enciphered with ciphers[i]. The offsets array must therefore contain
+ * count + 1 ascending entries; its last entry is taken to be the length of the
+ * arena. The same cipher may be given for any number of records. Records are
+ * processed grouped by cipher so that each cipher's tables stay hot in cache.
+ *
+ * If an error occurs, such as an invalid cipher or descending offsets being
+ * provided, the arena will be left unchanged.
+ */
+void purecipher_encipher_batch(const purecipher_obj_t *ciphers, uint8_t *arena, const size_t *offsets, size_t count);
+
+/*
+ * Decodes a batch of records stored contiguously in the given arena, each with
+ * its own cipher.
+ *
+ * See purecipher_encipher_batch for a description of the arguments.
+ *
+ * If an error occurs, such as an invalid cipher or descending offsets being
+ * provided, the arena will be left unchanged.
  */
-void purecipher_decipher_str(purecipher_obj_t cipher, char *string);
+void purecipher_decipher_batch(const purecipher_obj_t *ciphers, uint8_t *arena, const size_t *offsets, size_t count);
+
+/*
+ * Encodes count fields of field_len bytes that lie stride bytes apart, the
+ * first starting at base.
+ *
+ * This is equivalent to calling purecipher_encipher_fields on records starting
+ * at base with the single field {0, field_len}.
+ */
+void purecipher_encipher_strided(purecipher_obj_t cipher, uint8_t *base, size_t field_len, size_t stride, size_t count);
+
+/*
+ * Decodes count fields of field_len bytes that lie stride bytes apart, the
+ * first starting at base.
+ *
+ * See purecipher_encipher_strided for a description of the arguments.
+ */
+void purecipher_decipher_strided(purecipher_obj_t cipher, uint8_t *base, size_t field_len, size_t stride, size_t count);
+
+/*
+ * Encodes the given fields of count fixed-size records inplace.
+ *
+ * Record i starts stride * i bytes after records. Bytes outside of the fields
+ * are left unchanged, and the last record only needs to extend to the end of
+ * its last field. Records are ciphered in a single pass that prefetches
+ * records ahead of the one being ciphered, so ciphering a column of a large
+ * record file runs close to memory bandwidth.
+ *
+ * If an error occurs, such as an invalid cipher being provided or fields that
+ * overlap or extend past stride, the records will be left unchanged.
+ */
+void purecipher_encipher_fields(
+    purecipher_obj_t cipher,
+    uint8_t *records,
+    size_t stride,
+    size_t count,
+    const purecipher_field_t *fields,
+    size_t field_count
+);
+
+/*
+ * Decodes the given fields of count fixed-size records inplace.
+ *
+ * See purecipher_encipher_fields for a description of the arguments.
+ */
+void purecipher_decipher_fields(
+    purecipher_obj_t cipher,
+    uint8_t *records,
+    size_t stride,
+    size_t count,
+    const purecipher_field_t *fields,
+    size_t field_count
+);
+
+/*
+ * Creates a new field selector for fields separated by the given delimiter.
+ * The selector initially selects no fields.
+ */
+purecipher_selector_t *purecipher_selector_new(uint8_t delimiter);
+
+/*
+ * Frees the given field selector. Freeing NULL has no effect.
+ */
+void purecipher_selector_free(purecipher_selector_t *selector);
+
+/*
+ * Sets the byte that quotes fields. Delimiters and newlines between quotes do
+ * not separate fields, and the quotes surrounding a selected field or value
+ * are not ciphered.
+ */
+void purecipher_selector_quote(purecipher_selector_t *selector, uint8_t quote);
+
+/*
+ * Selects the field in the given zero-based column of every record.
+ */
+void purecipher_selector_column(purecipher_selector_t *selector, size_t column);
+
+/*
+ * Selects the value of every field of the form key=value for the given
+ * null-terminated key.
+ */
+void purecipher_selector_key(purecipher_selector_t *selector, const char *key);
+
+/*
+ * Encodes the selected fields of the provided text inplace with the given
+ * cipher, in a single pass over the text.
+ *
+ * If an error occurs, such as an invalid cipher being provided, the text will
+ * be left unchanged.
+ */
+void purecipher_selector_encipher(
+    const purecipher_selector_t *selector,
+    purecipher_obj_t cipher,
+    uint8_t *text,
+    size_t length
+);
+
+/*
+ * Decodes the selected fields of the provided text inplace with the given
+ * cipher, in a single pass over the text.
+ *
+ * If an error occurs, such as an invalid cipher being provided, the text will
+ * be left unchanged.
+ */
+void purecipher_selector_decipher(
+    const purecipher_selector_t *selector,
+    purecipher_obj_t cipher,
+    uint8_t *text,
+    size_t length
+);
+
+/*
+ * Counts the occurrences of each byte value in the provided buffer.
+ *
+ * The counts array must have room for 256 entries. Its previous contents are
+ * overwritten, with counts[b] receiving the number of occurrences of byte b.
+ * Large buffers are counted on multiple threads.
+ */
+void purecipher_histogram(const uint8_t *buffer, size_t length, uint64_t counts[256]);
+
+/*
+ * Counts the occurrences of each byte value in the plaintext of the provided
+ * ciphertext buffer.
+ *
+ * This is equivalent to calling purecipher_histogram on the deciphered buffer,
+ * but the buffer is neither modified nor deciphered: the ciphertext counts are
+ * simply mapped through the inverse of the given cipher.
+ *
+ * If an error occurs, such as an invalid cipher being provided, the counts
+ * will be left unchanged.
+ */
+void purecipher_histogram_plaintext(purecipher_obj_t cipher, const uint8_t *buffer, size_t length, uint64_t counts[256]);
+
+/*
+ * Computes the Shannon entropy, in bits per byte, of the given byte counts.
+ *
+ * The result lies between 0 (a single byte value) and 8 (uniformly
+ * distributed bytes).
+ */
+double purecipher_histogram_entropy(const uint64_t counts[256]);
+
+/*
+ * Computes Pearson's chi-square statistic of the given byte counts against a
+ * reference distribution.
+ *
+ * The expected array holds the relative frequency of each byte value in the
+ * reference distribution. It is normalized before use, so probabilities and
+ * raw counts are both accepted. The statistic is infinite if a byte value
+ * with an expected frequency of zero was observed.
+ */
+double purecipher_histogram_chi_square(const uint64_t counts[256], const double expected[256]);
+
+/*
+ * Computes the CRC32C (Castagnoli) checksum of the provided buffer, continuing
+ * from the checksum crc of the bytes that preceded it. Pass 0 as crc for the
+ * first buffer of a stream.
+ *
+ * The SSE4.2 or ARMv8 CRC instructions are used where available.
+ */
+uint32_t purecipher_crc32c(uint32_t crc, const uint8_t *buffer, size_t length);
+
+/*
+ * Combines the checksum crc1 of some bytes with the checksum crc2 of the
+ * length2 bytes that follow them into the checksum of both.
+ *
+ * This allows the chunks of a buffer to be checksummed separately, such as on
+ * multiple threads, and then joined.
+ */
+uint32_t purecipher_crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t length2);
+
+/*
+ * Enciphers the buffer inplace while computing its CRC32C checksum in the same
+ * pass, continuing from the checksum crc as purecipher_crc32c does.
+ *
+ * The ciphertext is checksummed if checksum_ciphertext is nonzero, and the
+ * plaintext otherwise. Returns crc unchanged if an invalid cipher is provided.
+ */
+uint32_t purecipher_encipher_buffer_crc32c(
+    purecipher_obj_t cipher,
+    uint8_t *buffer,
+    size_t length,
+    uint32_t crc,
+    int checksum_ciphertext
+);
+
+/*
+ * Deciphers the buffer inplace while computing its CRC32C checksum in the same
+ * pass, continuing from the checksum crc as purecipher_crc32c does.
+ *
+ * The ciphertext is checksummed if checksum_ciphertext is nonzero, and the
+ * plaintext otherwise. Returns crc unchanged if an invalid cipher is provided.
+ */
+uint32_t purecipher_decipher_buffer_crc32c(
+    purecipher_obj_t cipher,
+    uint8_t *buffer,
+    size_t length,
+    uint32_t crc,
+    int checksum_ciphertext
+);
+
+/*
+ * Text encodings accepted by purecipher_encipher_encode and
+ * purecipher_decode_decipher: two lowercase hexadecimal digits per byte, or
+ * standard base64 with padding. Uppercase hexadecimal digits are also accepted
+ * when decoding.
+ */
+#define PURECIPHER_ENCODING_HEX 0
+#define PURECIPHER_ENCODING_BASE64 1
+
+/*
+ * Returns the number of characters in the given encoding of length bytes, or
+ * 0 if an invalid encoding is provided.
+ */
+size_t purecipher_encoded_length(int encoding, size_t length);
+
+/*
+ * Returns the number of bytes encoded by the given text, or -1 if an invalid
+ * encoding is provided or no bytes have an encoding of this length. The
+ * characters of the text are not checked.
+ */
+int64_t purecipher_decoded_length(int encoding, const char *text, size_t length);
+
+/*
+ * Enciphers the buffer with the given cipher and writes the ciphertext in the
+ * given encoding to text, in a single pass over the buffer. Neither the buffer
+ * nor any intermediate ciphertext is allocated or modified.
+ *
+ * Returns the number of characters written, which is given by
+ * purecipher_encoded_length. The text is not null-terminated. If capacity is
+ * less than this length or invalid arguments are provided, nothing is written
+ * and 0 is returned.
+ */
+size_t purecipher_encipher_encode(
+    purecipher_obj_t cipher,
+    int encoding,
+    const uint8_t *buffer,
+    size_t length,
+    char *text,
+    size_t capacity
+);
+
+/*
+ * Decodes the text in the given encoding and deciphers the result with the
+ * given cipher into buffer, in a single pass over the text.
+ *
+ * Returns the number of bytes written, which is given by
+ * purecipher_decoded_length, or -1 if the text is not valid in the encoding,
+ * capacity is less than the number of bytes or invalid arguments are
+ * provided. The contents of buffer are unspecified on failure.
+ */
+int64_t purecipher_decode_decipher(
+    purecipher_obj_t cipher,
+    int encoding,
+    const char *text,
+    size_t length,
+    uint8_t *buffer,
+    size_t capacity
+);
+
+/*
+ * Builds a substitution cipher equivalent to applying the given cipher
+ * exponent times in succession.
+ *
+ * A negative exponent applies the inverse of the cipher instead. The result is
+ * computed by repeated squaring of the cipher's lookup table, so enciphering a
+ * buffer with the returned cipher costs a single pass regardless of exponent.
+ *
+ * The returned cipher must be freed with purecipher_free. If an invalid cipher
+ * is provided, a null cipher object whose _data is NULL is returned.
+ */
+purecipher_obj_t purecipher_cipher_pow(purecipher_obj_t cipher, int64_t exponent);
+
+/*
+ * Builds a substitution cipher that enciphers bytes the way the given cipher
+ * deciphers them.
+ *
+ * The returned cipher must be freed with purecipher_free. If an invalid cipher
+ * is provided, a null cipher object whose _data is NULL is returned.
+ */
+purecipher_obj_t purecipher_cipher_inverse(purecipher_obj_t cipher);
+
+/*
+ * Computes the order of the given cipher: the smallest positive number of times
+ * it can be applied in succession to leave every byte unchanged.
+ *
+ * Returns 0 if an invalid cipher is provided.
+ */
+uint64_t purecipher_cipher_order(purecipher_obj_t cipher);
+
+/*
+ * Decomposes the permutation performed by the given cipher into disjoint
+ * cycles, omitting bytes that are mapped to themselves.
+ *
+ * The bytes of each cycle are written consecutively to elements, in the order
+ * in which the cipher maps them, and the length of each cycle is written to
+ * lengths. Each cycle starts with its smallest byte, and cycles are ordered by
+ * their first byte. The number of cycles, at most 128, is returned.
+ */
+size_t purecipher_cipher_cycles(purecipher_obj_t cipher, uint8_t elements[256], uint16_t lengths[128]);
+
+/*
+ * Writes the lookup table of the given cipher to map, such that map[b] is the
+ * byte that b is enciphered to.
+ *
+ * These 256 bytes are a complete description of any cipher, and may be passed
+ * to purecipher_cipher_from_table to rebuild it, for instance in another
+ * process.
+ */
+void purecipher_cipher_table(purecipher_obj_t cipher, uint8_t map[256]);
+
+/*
+ * Builds a substitution cipher from the given lookup table, such that map[b]
+ * is the byte that b is enciphered to. The table is copied.
+ *
+ * The returned cipher must be freed with purecipher_free. If map is not a
+ * permutation of all 256 bytes, a null cipher object whose _data is NULL is
+ * returned.
+ */
+purecipher_obj_t purecipher_cipher_from_table(const uint8_t map[256]);
+
+/*
+ * Number of bytes written by purecipher_shared_write: the lookup table used to
+ * encipher bytes, followed by the table used to decipher them.
+ */
+#define PURECIPHER_SHARED_TABLES_LEN 512
+
+/*
+ * Writes the lookup tables of the given cipher to tables, in the layout
+ * expected by purecipher_cipher_shared.
+ */
+void purecipher_shared_write(purecipher_obj_t cipher, uint8_t tables[PURECIPHER_SHARED_TABLES_LEN]);
+
+/*
+ * Builds a cipher that ciphers bytes through the given lookup tables, as
+ * written by purecipher_shared_write, without copying them.
+ *
+ * The tables may live in memory shared between processes, such as a POSIX
+ * shared memory segment, so that ciphers in any number of processes use one
+ * physical copy of them. The tables must outlive the cipher and must not be
+ * modified while it is in use.
+ *
+ * The returned cipher must be freed with purecipher_free. If the second table
+ * is not the inverse of the first, a null cipher object whose _data is NULL is
+ * returned.
+ */
+purecipher_obj_t purecipher_cipher_shared(const uint8_t tables[PURECIPHER_SHARED_TABLES_LEN]);
 
 /*
  * Creates a new substituion cipher builder.
@@ -132,6 +738,570 @@ void purecipher_builder_discard(purecipher_builder_t *builder);
  */
 purecipher_obj_t purecipher_builder_into_cipher(purecipher_builder_t *builder);
 
+/*
+ * Creates a periodic cipher from the cipher used at each position within the
+ * period.
+ *
+ * The lookup tables of the given ciphers are copied, so the ciphers may be
+ * freed once this function returns. Returns NULL if period is zero or if an
+ * invalid cipher is provided.
+ */
+purecipher_periodic_t *purecipher_periodic_new(const purecipher_obj_t *ciphers, size_t period);
+
+/*
+ * Creates a byte-wise Vigenere cipher, which adds key[i % period] modulo 256 to
+ * the byte at stream position i.
+ *
+ * Ciphers built this way are ciphered with vectorized additions rather than
+ * table lookups. Returns NULL if period is zero.
+ */
+purecipher_periodic_t *purecipher_periodic_new_shifts(const uint8_t *key, size_t period);
+
+/*
+ * Frees the given periodic cipher.
+ */
+void purecipher_periodic_free(purecipher_periodic_t *cipher);
+
+/*
+ * Returns the number of positions after which the given periodic cipher's
+ * substitutions repeat.
+ */
+size_t purecipher_periodic_period(const purecipher_periodic_t *cipher);
+
+/*
+ * Encodes the provided buffer with the given periodic cipher, where offset is
+ * the stream position of the first byte of the buffer.
+ *
+ * If an error occurs, such as an invalid cipher being provided, the buffer will
+ * be left unchanged.
+ */
+void purecipher_periodic_encipher(const purecipher_periodic_t *cipher, uint8_t *buffer, size_t length, uint64_t offset);
+
+/*
+ * Decodes the provided buffer with the given periodic cipher, where offset is
+ * the stream position of the first byte of the buffer.
+ *
+ * If an error occurs, such as an invalid cipher being provided, the buffer will
+ * be left unchanged.
+ */
+void purecipher_periodic_decipher(const purecipher_periodic_t *cipher, uint8_t *buffer, size_t length, uint64_t offset);
+
+/*
+ * Starts a pool with the given number of worker threads, or with one worker per
+ * available core if threads is zero.
+ */
+purecipher_pool_t *purecipher_pool_new(size_t threads);
+
+/*
+ * Stops and frees the given pool.
+ *
+ * This function blocks until every batch submitted to the pool has completed.
+ */
+void purecipher_pool_free(purecipher_pool_t *pool);
+
+/*
+ * Returns the number of worker threads in the given pool.
+ */
+size_t purecipher_pool_threads(const purecipher_pool_t *pool);
+
+/*
+ * Submits a batch of buffers to be enciphered by the given pool, returning
+ * without waiting for them to be ciphered.
+ *
+ * The jobs array is copied and may be freed once this function returns, but
+ * every cipher and buffer that it references must remain valid, and the
+ * buffers must not be accessed, until the batch completes. The same cipher may
+ * be used by any number of jobs.
+ *
+ * Returns NULL without ciphering any buffer if an invalid cipher or a NULL
+ * buffer is provided.
+ */
+purecipher_batch_t *purecipher_pool_encipher(purecipher_pool_t *pool, const purecipher_job_t *jobs, size_t count);
+
+/*
+ * Submits a batch of buffers to be deciphered by the given pool, returning
+ * without waiting for them to be ciphered.
+ *
+ * See purecipher_pool_encipher for the requirements on the jobs.
+ */
+purecipher_batch_t *purecipher_pool_decipher(purecipher_pool_t *pool, const purecipher_job_t *jobs, size_t count);
+
+/*
+ * Returns nonzero if every buffer of the given batch has been ciphered.
+ */
+int purecipher_batch_done(const purecipher_batch_t *batch);
+
+/*
+ * Blocks until every buffer of the given batch has been ciphered.
+ */
+void purecipher_batch_wait(const purecipher_batch_t *batch);
+
+/*
+ * Frees the given batch handle.
+ *
+ * This function blocks until every buffer of the batch has been ciphered.
+ */
+void purecipher_batch_free(purecipher_batch_t *batch);
+
+/*
+ * Starts a context with the given number of worker threads, or with one worker
+ * per available core if threads is zero.
+ *
+ * At most entries submissions, rounded up to a power of two, may be in flight
+ * at once. A submission is in flight from when it is accepted until it is
+ * reaped or its callback returns. Returns NULL if entries is zero.
+ */
+purecipher_context_t *purecipher_context_new(size_t threads, size_t entries);
+
+/*
+ * Stops and frees the given context.
+ *
+ * This function blocks until every accepted submission has been ciphered.
+ * Completions that have not been reaped are discarded.
+ */
+void purecipher_context_free(purecipher_context_t *context);
+
+/*
+ * Returns a nonblocking eventfd that becomes readable when completions are
+ * ready to be reaped, or -1 if eventfds are not supported on this platform.
+ *
+ * The descriptor is owned by the context and is reset by
+ * purecipher_context_reap; callers should not read from it.
+ */
+int purecipher_context_eventfd(const purecipher_context_t *context);
+
+/*
+ * Submits buffers to be ciphered by the given context, returning without
+ * waiting for them to be ciphered.
+ *
+ * Submissions are accepted in order until one is invalid, such as one with an
+ * invalid cipher, or until the maximum number of submissions are in flight.
+ * The number of accepted submissions is returned. The submissions array may
+ * be freed once this function returns, but every cipher and buffer that an
+ * accepted submission references must remain valid, and the buffers must not
+ * be accessed, until the submission completes.
+ *
+ * This function is intended to be called from a single thread.
+ */
+size_t purecipher_context_submit(purecipher_context_t *context, const purecipher_submission_t *submissions, size_t count);
+
+/*
+ * Writes up to max completed submissions without a callback to completions,
+ * returning the number written. This function never blocks.
+ *
+ * The context's eventfd is reset before completions are collected, so it is
+ * signalled again for any submission that completes during this call.
+ */
+size_t purecipher_context_reap(purecipher_context_t *context, purecipher_completion_t *completions, size_t max);
+
+/*
+ * Creates a new, empty cipher arena.
+ */
+purecipher_arena_t *purecipher_arena_new(void);
+
+/*
+ * Frees the given arena along with every cipher interned in it.
+ */
+void purecipher_arena_free(purecipher_arena_t *arena);
+
+/*
+ * Interns a cipher that ciphers bytes identically to the given cipher.
+ *
+ * If a cipher with the same lookup table is already in the arena, that cipher
+ * is returned. The given cipher is not consumed and may be freed once this
+ * function returns. If an invalid cipher is provided, a null cipher object
+ * whose _data is NULL is returned.
+ */
+purecipher_obj_t purecipher_arena_intern(const purecipher_arena_t *arena, purecipher_obj_t cipher);
+
+/*
+ * Interns a cipher that enciphers each byte b to map[b].
+ *
+ * If a cipher with the same lookup table is already in the arena, that cipher
+ * is returned. If map is not a permutation of all 256 byte values, a null
+ * cipher object whose _data is NULL is returned.
+ */
+purecipher_obj_t purecipher_arena_intern_table(const purecipher_arena_t *arena, const uint8_t map[256]);
+
+/*
+ * Returns the number of distinct ciphers interned in the given arena.
+ */
+size_t purecipher_arena_len(const purecipher_arena_t *arena);
+
+/*
+ * Creates a swappable handle that initially ciphers with the given cipher.
+ *
+ * The handle takes ownership of the cipher, which must NOT be passed to
+ * purecipher_free afterwards. Returns NULL if an invalid cipher is provided.
+ */
+purecipher_swap_t *purecipher_swap_new(purecipher_obj_t cipher);
+
+/*
+ * Frees the given handle along with its current cipher.
+ *
+ * No thread may be ciphering through the handle when it is freed.
+ */
+void purecipher_swap_free(purecipher_swap_t *swap);
+
+/*
+ * Returns a cipher object that ciphers with whichever cipher the handle holds
+ * at the time of each call.
+ *
+ * The cipher object is owned by the handle: it remains valid until the handle
+ * is freed and must NOT be passed to purecipher_free.
+ */
+purecipher_obj_t purecipher_swap_cipher(const purecipher_swap_t *swap);
+
+/*
+ * Replaces the cipher of the given handle, taking ownership of the new cipher.
+ *
+ * Calls that begin after this function returns use the new cipher. This
+ * function blocks until every call using the old cipher has returned, then
+ * frees the old cipher. Threads ciphering through the handle never block.
+ * Returns 0 on success, or -1 if an invalid handle or cipher is provided, in
+ * which case the cipher is not consumed.
+ */
+int purecipher_swap_store(const purecipher_swap_t *swap, purecipher_obj_t cipher);
+
+/*
+ * Builds a model from the bigram frequencies of the given corpus.
+ *
+ * The corpus should be plaintext of the kind expected to be recovered, and the
+ * larger it is the better. Returns NULL if corpus is NULL and length nonzero.
+ */
+purecipher_model_t *purecipher_model_new(const uint8_t *corpus, size_t length);
+
+/*
+ * Frees the given model.
+ */
+void purecipher_model_free(purecipher_model_t *model);
+
+/*
+ * Returns the mean log frequency of the bigrams of the given text under the
+ * model. Higher scores indicate text that is more like the corpus.
+ */
+double purecipher_model_score(const purecipher_model_t *model, const uint8_t *text, size_t length);
+
+/*
+ * Creates a solver that scores candidate plaintext with the given model.
+ *
+ * The solver runs one thread per core and 64 climbs per solve, with no time
+ * limit, until configured otherwise. Returns NULL if model is NULL.
+ */
+purecipher_solver_t *purecipher_solver_new(const purecipher_model_t *model);
+
+/*
+ * Frees the given solver.
+ */
+void purecipher_solver_free(purecipher_solver_t *solver);
+
+/*
+ * Sets the number of threads that climb in parallel. Zero uses one thread per
+ * core.
+ */
+void purecipher_solver_set_threads(purecipher_solver_t *solver, size_t threads);
+
+/*
+ * Stops each solve once the given number of milliseconds has elapsed.
+ */
+void purecipher_solver_set_time_limit(purecipher_solver_t *solver, uint64_t milliseconds);
+
+/*
+ * Sets the total number of climbs run by each solve. UINT64_MAX leaves solves
+ * bounded only by the time limit.
+ */
+void purecipher_solver_set_max_restarts(purecipher_solver_t *solver, uint64_t restarts);
+
+/*
+ * Seeds the random perturbations of restarted climbs.
+ */
+void purecipher_solver_set_seed(purecipher_solver_t *solver, uint64_t seed);
+
+/*
+ * Declares that the ciphertext starting at offset deciphers to the given
+ * plaintext. The bytes it determines are held fixed while climbing.
+ *
+ * Returns 0 on success, or -1 if an invalid solver or plaintext is provided.
+ */
+int purecipher_solver_add_crib(purecipher_solver_t *solver, size_t offset, const uint8_t *plaintext, size_t length);
+
+/*
+ * Recovers the most likely cipher that enciphers some plaintext to the given
+ * ciphertext, writing the score of that plaintext to score unless it is NULL.
+ *
+ * The returned cipher must be freed via purecipher_free. Returns a null cipher
+ * object if a crib extends past the end of the ciphertext or contradicts
+ * another crib.
+ */
+purecipher_obj_t purecipher_solver_solve(
+    const purecipher_solver_t *solver,
+    const uint8_t *ciphertext,
+    size_t length,
+    double *score
+);
+
+/*
+ * Returns the offset of the first occurrence of the given plaintext within the
+ * given ciphertext, or -1 if it does not occur or invalid arguments are given.
+ *
+ * The plaintext is enciphered with the given cipher and the ciphertext is
+ * searched without being deciphered. An empty plaintext occurs at offset 0.
+ */
+int64_t purecipher_find(
+    purecipher_obj_t cipher,
+    const uint8_t *plaintext,
+    size_t plaintext_length,
+    const uint8_t *ciphertext,
+    size_t length
+);
+
+/*
+ * Finds every occurrence of the given plaintext within the given ciphertext,
+ * including occurrences that overlap, and returns the number found.
+ *
+ * The offsets of the first capacity occurrences are written to offsets in
+ * increasing order. If the returned count exceeds capacity, the remaining
+ * offsets are dropped and the call may be repeated with a larger array.
+ * Ciphertext of several megabytes or more is searched on all cores.
+ */
+size_t purecipher_find_all(
+    purecipher_obj_t cipher,
+    const uint8_t *plaintext,
+    size_t plaintext_length,
+    const uint8_t *ciphertext,
+    size_t length,
+    size_t *offsets,
+    size_t capacity
+);
+
+/*
+ * Creates a finder for count plaintext patterns, enciphered with the given
+ * cipher. Pattern i is the lengths[i] bytes at patterns[i].
+ *
+ * Returns NULL if any pattern is empty or invalid arguments are given.
+ */
+purecipher_multi_finder_t *purecipher_multi_finder_new(
+    purecipher_obj_t cipher,
+    const uint8_t *const *patterns,
+    const size_t *lengths,
+    size_t count
+);
+
+/*
+ * Frees the given finder.
+ */
+void purecipher_multi_finder_free(purecipher_multi_finder_t *finder);
+
+/*
+ * Finds every occurrence of the finder's patterns within the given ciphertext,
+ * including occurrences that overlap, and returns the number found.
+ *
+ * The first capacity occurrences, ordered by offset and then by pattern, are
+ * written to matches. If the returned count exceeds capacity, the remaining
+ * occurrences are dropped and the call may be repeated with a larger array.
+ * Ciphertext of several megabytes or more is searched on all cores.
+ */
+size_t purecipher_multi_finder_find_all(
+    const purecipher_multi_finder_t *finder,
+    const uint8_t *ciphertext,
+    size_t length,
+    purecipher_match_t *matches,
+    size_t capacity
+);
+
+/*
+ * Creates the order of ciphertext enciphered with the given cipher. Returns
+ * NULL if an invalid cipher is provided.
+ */
+purecipher_order_t *purecipher_order_new(purecipher_obj_t cipher);
+
+/*
+ * Frees the given order.
+ */
+void purecipher_order_free(purecipher_order_t *order);
+
+/*
+ * Compares two ciphertexts in the lexicographic order of their plaintext.
+ *
+ * Returns a negative value, zero or a positive value if the plaintext of left
+ * is less than, equal to or greater than that of right, like memcmp.
+ */
+int purecipher_order_compare(
+    const purecipher_order_t *order,
+    const uint8_t *left,
+    size_t left_length,
+    const uint8_t *right,
+    size_t right_length
+);
+
+/*
+ * Sorts count ciphertext keys in the lexicographic order of their plaintext,
+ * where key i is the lengths[i] bytes at keys[i].
+ *
+ * The keys are not moved. Instead, the index of the key at each position of
+ * the sorted order is written to indices, which must have room for count
+ * elements. Equal keys keep their relative order. Keys are sorted by radix on
+ * the ranks of their bytes. Returns 0 on success, or -1 if invalid arguments
+ * are provided.
+ */
+int purecipher_order_argsort(
+    const purecipher_order_t *order,
+    const uint8_t *const *keys,
+    const size_t *lengths,
+    size_t count,
+    size_t *indices
+);
+
+/*
+ * Searches count ciphertext keys, sorted in the lexicographic order of their
+ * plaintext, for the given ciphertext key.
+ *
+ * Returns the index of the first key that is not less than the given key, or
+ * count if there is none.
+ */
+size_t purecipher_order_search(
+    const purecipher_order_t *order,
+    const uint8_t *const *keys,
+    const size_t *lengths,
+    size_t count,
+    const uint8_t *key,
+    size_t length
+);
+
+/*
+ * Creates a new 16-bit substitution cipher builder that maps each token to
+ * itself.
+ *
+ * The pointer returned must be freed by either calling
+ * purecipher_wide_builder_into_cipher or purecipher_wide_builder_discard.
+ */
+purecipher_wide_builder_t *purecipher_wide_builder_new(void);
+
+/*
+ * Swaps the mappings of left and right in the cipher that the builder will
+ * produce.
+ */
+void purecipher_wide_builder_swap(purecipher_wide_builder_t *builder, uint16_t left, uint16_t right);
+
+/*
+ * Rotates each token in the given inclusive range in the cipher that the
+ * builder will produce. The range must not end before it starts.
+ */
+void purecipher_wide_builder_rotate(purecipher_wide_builder_t *builder, uint16_t from, uint16_t to, int32_t offset);
+
+/*
+ * Frees the given builder without converting it into a cipher.
+ */
+void purecipher_wide_builder_discard(purecipher_wide_builder_t *builder);
+
+/*
+ * Converts the given builder into a 16-bit substitution cipher.
+ *
+ * This function frees the builder and invalidates any existing pointers.
+ */
+purecipher_wide_t *purecipher_wide_builder_into_cipher(purecipher_wide_builder_t *builder);
+
+/*
+ * Creates a 16-bit substitution cipher that enciphers each token t to map[t].
+ *
+ * The map must hold 65536 tokens. If it is not a permutation of all 16-bit
+ * tokens, NULL is returned.
+ */
+purecipher_wide_t *purecipher_wide_from_table(const uint16_t *map);
+
+/*
+ * Frees the given 16-bit substitution cipher. Freeing NULL has no effect.
+ */
+void purecipher_wide_free(purecipher_wide_t *cipher);
+
+/*
+ * Encodes length tokens of the provided buffer inplace with the given cipher.
+ *
+ * If an invalid cipher is provided, the buffer will be left unchanged.
+ */
+void purecipher_wide_encipher(const purecipher_wide_t *cipher, uint16_t *tokens, size_t length);
+
+/*
+ * Decodes length tokens of the provided buffer inplace with the given cipher.
+ *
+ * If an invalid cipher is provided, the buffer will be left unchanged.
+ */
+void purecipher_wide_decipher(const purecipher_wide_t *cipher, uint16_t *tokens, size_t length);
+
+/*
+ * Starts a cipher service listening on the Unix domain socket at path, with the
+ * given number of worker threads, or one per available core if threads is zero.
+ *
+ * Returns NULL if the socket cannot be bound, such as when path already exists.
+ */
+purecipher_service_t *purecipher_service_bind(const char *path, size_t threads);
+
+/*
+ * Stops serving every client of the given service, removes its socket and
+ * frees it.
+ */
+void purecipher_service_free(purecipher_service_t *service);
+
+/*
+ * Registers a cipher with the given service under name, returning the
+ * identifier that clients use to submit buffers to it, or -1 on failure.
+ *
+ * The cipher is copied into the service's table cache; it is not consumed and
+ * may be freed once this function returns. Names are at most 64 bytes long.
+ * Registering a name again makes it refer to the new cipher.
+ */
+int64_t purecipher_service_register(const purecipher_service_t *service, const char *name, purecipher_obj_t cipher);
+
+/*
+ * Connects to the service listening at path, sharing with it a ring of slots
+ * buffers of slot_size bytes each. Returns NULL on failure.
+ */
+purecipher_client_t *purecipher_client_connect(const char *path, size_t slots, size_t slot_size);
+
+/*
+ * Disconnects and frees the given client. Slots still in flight are abandoned.
+ */
+void purecipher_client_free(purecipher_client_t *client);
+
+/*
+ * Returns the identifier of the cipher registered under name with the client's
+ * service, or -1 if there is none.
+ */
+int64_t purecipher_client_lookup(const purecipher_client_t *client, const char *name);
+
+/*
+ * Returns the size in bytes of each of the client's slot buffers.
+ */
+size_t purecipher_client_slot_size(const purecipher_client_t *client);
+
+/*
+ * Returns the buffer of the given slot, to be filled before submitting it and
+ * read after waiting on it.
+ *
+ * Returns NULL if the slot does not exist or is in flight. The buffer must not
+ * be accessed while the slot is in flight.
+ */
+uint8_t *purecipher_client_buffer(purecipher_client_t *client, size_t slot);
+
+/*
+ * Submits the first length bytes of the given slot to be deciphered if
+ * decipher is nonzero, or enciphered otherwise, with the cipher identified by
+ * cipher. This function does not wait for the slot to be ciphered.
+ *
+ * Returns 0 on success, or -1 if the slot does not exist or is already in
+ * flight, or if length exceeds the slot size.
+ */
+int purecipher_client_submit(purecipher_client_t *client, size_t slot, uint32_t cipher, size_t length, int decipher);
+
+/*
+ * Blocks until the service has ciphered the given slot, returning 0 on success.
+ *
+ * Returns immediately if the slot is not in flight. Returns -1 if the service
+ * rejected the submission, such as for an unknown cipher, in which case the
+ * buffer is unchanged, or if the service stopped.
+ */
+int purecipher_client_wait(purecipher_client_t *client, size_t slot);
+
 /*
  * Builds a pure cipher that shifts ASCII letters three ahead.
  */
@@ -147,6 +1317,17 @@ purecipher_obj_t purecipher_cipher_rot13(void);
  */
 purecipher_obj_t purecipher_cipher_leet(void);
 
+/*
+ * Builds a pure cipher that enciphers each byte x as Ax + constant over GF(2),
+ * where bit k of rows[i] is the entry of the 8x8 bit matrix A in row i and
+ * column k.
+ *
+ * Such ciphers are evaluated without lookup tables, using GFNI instructions
+ * where available. If A is not invertible, a null cipher object whose _data is
+ * NULL is returned.
+ */
+purecipher_obj_t purecipher_cipher_affine(const uint8_t rows[8], uint8_t constant);
+
 /*
  * Builds a cipher that performs no ciphering.
  *
@@ -0,0 +1,332 @@
+//! Ciphers that transform bytes by affine maps over GF(2).
+
+use super::PureCipher;
+use super::substitution::ALL_U8;
+
+/// Every byte of a 64-bit word set to one.
+const LANES: u64 = 0x0101_0101_0101_0101;
+
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+/// Affine map `x -> Ax + c` on bytes viewed as vectors over GF(2).
+struct AffineMap {
+    /// Image of each basis byte `1 << k` under the linear part.
+    columns: [u8; 8],
+    /// Byte added after the linear part is applied.
+    constant: u8,
+}
+
+impl AffineMap {
+    /// Applies this map to a single byte.
+    const fn apply_byte(&self, token: u8) -> u8 {
+        let mut acc = self.constant;
+        let mut k = 0;
+        while k < 8 {
+            if token & (1 << k) != 0 {
+                acc ^= self.columns[k];
+            }
+            k += 1;
+        }
+        acc
+    }
+
+    /// Returns the linear part in the layout expected by `GF2P8AFFINEQB`,
+    /// where byte `7 - i` of the matrix selects the input bits that are summed
+    /// into output bit `i`.
+    #[cfg(target_arch = "x86_64")]
+    fn gfni_matrix(&self) -> i64 {
+        let mut matrix = 0u64;
+        for i in 0..8 {
+            let row = self.columns.iter()
+                .enumerate()
+                .fold(0u8, |row, (k, &column)| row | ((column >> i) & 1) << k);
+            matrix |= (row as u64) << (8 * (7 - i));
+        }
+        matrix as i64
+    }
+
+    /// Returns the inverse of this map, or `None` if its linear part is
+    /// singular.
+    ///
+    /// Like the other constructors of affine maps, this is a `const fn` so
+    /// that substitution ciphers built at compile time are checked for an
+    /// affine equivalent at compile time too.
+    const fn inverse(&self) -> Option<Self> {
+        // Gauss-Jordan elimination on the columns, tracking in `inverse` the
+        // combination of basis bytes that produced each column.
+        let mut columns = self.columns;
+        let mut inverse = [0u8; 8];
+        let mut k = 0;
+        while k < 8 {
+            inverse[k] = 1 << k;
+            k += 1;
+        }
+        let mut bit = 0;
+        while bit < 8 {
+            let mut pivot = bit;
+            while columns[pivot] & (1 << bit) == 0 {
+                pivot += 1;
+                if pivot == 8 {
+                    return None;
+                }
+            }
+            columns.swap(bit, pivot);
+            inverse.swap(bit, pivot);
+            let mut k = 0;
+            while k < 8 {
+                if k != bit && columns[k] & (1 << bit) != 0 {
+                    columns[k] ^= columns[bit];
+                    inverse[k] ^= inverse[bit];
+                }
+                k += 1;
+            }
+            bit += 1;
+        }
+        let linear = AffineMap { columns: inverse, constant: 0 };
+        Some(AffineMap { columns: inverse, constant: linear.apply_byte(self.constant) })
+    }
+
+    /// Applies this map to each byte of `bytes` inplace.
+    fn apply(&self, bytes: &mut [u8]) {
+        #[cfg(target_arch = "x86_64")]
+        {
+            if is_x86_feature_detected!("gfni") {
+                if is_x86_feature_detected!("avx512f") {
+                    return unsafe { self.apply_gfni_avx512(bytes) };
+                }
+                if is_x86_feature_detected!("avx") {
+                    return unsafe { self.apply_gfni_avx(bytes) };
+                }
+            }
+        }
+        self.apply_bitsliced(bytes)
+    }
+
+    /// Applies this map to eight bytes at a time in a 64-bit word.
+    ///
+    /// For each input bit `k`, the bytes with that bit set are masked into
+    /// lanes holding one, which multiplication widens into the `k`th column.
+    fn apply_bitsliced(&self, bytes: &mut [u8]) {
+        let constant = self.constant as u64 * LANES;
+        let mut words = bytes.chunks_exact_mut(8);
+        for word in words.by_ref() {
+            let mut lanes = [0; 8];
+            lanes.copy_from_slice(word);
+            let x = u64::from_le_bytes(lanes);
+            let y = self.columns.iter()
+                .enumerate()
+                .fold(constant, |acc, (k, &column)| acc ^ ((x >> k) & LANES) * column as u64);
+            word.copy_from_slice(&y.to_le_bytes());
+        }
+        for b in words.into_remainder() {
+            *b = self.apply_byte(*b);
+        }
+    }
+
+    #[cfg(target_arch = "x86_64")]
+    #[target_feature(enable = "gfni,avx512f")]
+    unsafe fn apply_gfni_avx512(&self, bytes: &mut [u8]) {
+        use std::arch::x86_64::*;
+
+        let matrix = _mm512_set1_epi64(self.gfni_matrix());
+        let constant = _mm512_set1_epi8(self.constant as i8);
+        let mut blocks = bytes.chunks_exact_mut(64);
+        for block in blocks.by_ref() {
+            let x = _mm512_loadu_si512(block.as_ptr() as *const _);
+            let y = _mm512_xor_si512(_mm512_gf2p8affine_epi64_epi8::<0>(x, matrix), constant);
+            _mm512_storeu_si512(block.as_mut_ptr() as *mut _, y);
+        }
+        self.apply_gfni_avx(blocks.into_remainder())
+    }
+
+    #[cfg(target_arch = "x86_64")]
+    #[target_feature(enable = "gfni,avx")]
+    unsafe fn apply_gfni_avx(&self, bytes: &mut [u8]) {
+        use std::arch::x86_64::*;
+
+        let matrix = _mm256_set1_epi64x(self.gfni_matrix());
+        let constant = _mm256_set1_epi8(self.constant as i8);
+        let mut blocks = bytes.chunks_exact_mut(32);
+        for block in blocks.by_ref() {
+            let x = _mm256_loadu_si256(block.as_ptr() as *const __m256i);
+            let y = _mm256_xor_si256(_mm256_gf2p8affine_epi64_epi8::<0>(x, matrix), constant);
+            _mm256_storeu_si256(block.as_mut_ptr() as *mut __m256i, y);
+        }
+        self.apply_bitsliced(blocks.into_remainder())
+    }
+}
+
+/// Returns whether the running CPU can evaluate affine maps with GFNI.
+pub(crate) fn has_gfni() -> bool {
+    #[cfg(target_arch = "x86_64")]
+    {
+        is_x86_feature_detected!("gfni") && is_x86_feature_detected!("avx")
+    }
+    #[cfg(not(target_arch = "x86_64"))]
+    {
+        false
+    }
+}
+
+#[derive(Clone, Debug, Eq, PartialEq)]
+/// Cipher that enciphers bytes by an invertible affine map over GF(2).
+///
+/// Each byte `x` is treated as a vector of eight bits and enciphered as
+/// `Ax + c`, where `A` is an invertible 8x8 bit matrix and `c` a constant
+/// byte. Ciphers such as XOR with a key byte, bit rotations and bit
+/// permutations are all affine.
+///
+/// Buffers are ciphered with the `GF2P8AFFINEQB` instruction where GFNI is
+/// available, and with a bit-sliced kernel that ciphers eight bytes at a time
+/// otherwise. Neither uses a lookup table.
+pub struct AffineCipher {
+    /// Map used to encipher bytes.
+    forward: AffineMap,
+    /// Map used to decipher bytes.
+    backward: AffineMap,
+}
+
+impl AffineCipher {
+    /// Builds the cipher `x -> Ax + constant`, where bit `k` of `rows[i]` is
+    /// the entry of `A` in row `i` and column `k`.
+    ///
+    /// Returns `None` if `A` is not invertible.
+    ///
+    /// # Examples
+    /// ```
+    /// use purecipher::{AffineCipher, PureCipher};
+    ///
+    /// // Rotate the bits of each byte left by one, then flip the lowest bit.
+    /// let rows = [0x80, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40];
+    /// let cipher = AffineCipher::new(rows, 0x01).unwrap();
+    ///
+    /// assert_eq!(0b0000_0011, cipher.encipher(0b0000_0001));
+    /// assert_eq!(0b0000_0001, cipher.decipher(0b0000_0011));
+    /// assert!(AffineCipher::new([0; 8], 0).is_none());
+    /// ```
+    pub const fn new(rows: [u8; 8], constant: u8) -> Option<Self> {
+        let mut columns = [0u8; 8];
+        let mut k = 0;
+        while k < 8 {
+            let mut i = 0;
+            while i < 8 {
+                columns[k] |= ((rows[i] >> k) & 1) << i;
+                i += 1;
+            }
+            k += 1;
+        }
+        Self::from_map(AffineMap { columns, constant })
+    }
+
+    /// Builds the cipher that enciphers each byte `b` to `map[b]`, or returns
+    /// `None` if that mapping is not an invertible affine map.
+    pub(crate) const fn from_table(map: &[u8; ALL_U8]) -> Option<Self> {
+        let constant = map[0];
+        let mut columns = [0u8; 8];
+        let mut k = 0;
+        while k < 8 {
+            columns[k] = map[1 << k] ^ constant;
+            k += 1;
+        }
+        let forward = AffineMap { columns, constant };
+        let mut b = 0;
+        while b < ALL_U8 {
+            if forward.apply_byte(b as u8) != map[b] {
+                return None;
+            }
+            b += 1;
+        }
+        Self::from_map(forward)
+    }
+
+    const fn from_map(forward: AffineMap) -> Option<Self> {
+        match forward.inverse() {
+            Some(backward) => Some(Self { forward, backward }),
+            None => None,
+        }
+    }
+
+    /// Returns the cipher that enciphers bytes the way this cipher deciphers
+    /// them.
+    pub const fn inverse(&self) -> Self {
+        Self { forward: self.backward, backward: self.forward }
+    }
+}
+
+impl PureCipher for AffineCipher {
+    fn encipher(&self, token: u8) -> u8 {
+        self.forward.apply_byte(token)
+    }
+
+    fn decipher(&self, token: u8) -> u8 {
+        self.backward.apply_byte(token)
+    }
+
+    fn encipher_inplace(&self, bytes: &mut [u8]) {
+        self.forward.apply(bytes)
+    }
+
+    fn decipher_inplace(&self, bytes: &mut [u8]) {
+        self.backward.apply(bytes)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Rows of an invertible matrix that mixes every bit.
+    const MIXING_ROWS: [u8; 8] = [0xf1, 0xe3, 0xc7, 0x8f, 0x1f, 0x3e, 0x7c, 0xf8];
+
+    #[test]
+    fn affine_xor_key() {
+        let identity = [0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80];
+        let cipher = AffineCipher::new(identity, 0x5a).unwrap();
+        for b in 0..=u8::MAX {
+            assert_eq!(b ^ 0x5a, cipher.encipher(b));
+            assert_eq!(b ^ 0x5a, cipher.decipher(b));
+        }
+    }
+
+    #[test]
+    fn affine_inverse() {
+        let cipher = AffineCipher::new(MIXING_ROWS, 0x63).unwrap();
+        for b in 0..=u8::MAX {
+            assert_eq!(b, cipher.decipher(cipher.encipher(b)));
+        }
+        assert_eq!(cipher.encipher(0x42), cipher.inverse().decipher(0x42));
+
+        let singular = [0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x40];
+        assert!(AffineCipher::new(singular, 0).is_none());
+    }
+
+    #[test]
+    fn affine_kernels_agree() {
+        let cipher = AffineCipher::new(MIXING_ROWS, 0x63).unwrap();
+        let bytes: Vec<u8> = (0..1000u32).map(|i| (i.wrapping_mul(2654435761) >> 24) as u8).collect();
+        let expected: Vec<u8> = bytes.iter().map(|&b| cipher.encipher(b)).collect();
+
+        let mut bitsliced = bytes.clone();
+        cipher.forward.apply_bitsliced(&mut bitsliced);
+        assert_eq!(expected, bitsliced);
+
+        let mut actual = bytes.clone();
+        cipher.encipher_inplace(&mut actual);
+        assert_eq!(expected, actual);
+
+        cipher.decipher_inplace(&mut actual);
+        assert_eq!(bytes, actual);
+    }
+
+    #[test]
+    fn affine_from_table() {
+        let cipher = AffineCipher::new(MIXING_ROWS, 0x63).unwrap();
+        let mut map = [0u8; ALL_U8];
+        for b in 0..=u8::MAX {
+            map[b as usize] = cipher.encipher(b);
+        }
+        assert_eq!(Some(cipher), AffineCipher::from_table(&map));
+
+        map.swap(3, 4);
+        assert!(AffineCipher::from_table(&map).is_none());
+    }
+}
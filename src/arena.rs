@@ -0,0 +1,381 @@
+//! Interning arena for deduplicated substitution ciphers.
+
+use std::alloc::{self, Layout};
+use std::convert::TryInto;
+use std::ptr;
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicPtr, Ordering};
+use std::u32;
+
+use super::PureCipher;
+use super::substitution::ALL_U8;
+
+/// Number of tables allocated together in a single slab.
+const SLAB_TABLES: usize = 64;
+
+/// Number of ciphers allocated together in a single chunk.
+const ENTRY_CHUNK: usize = 1024;
+
+/// Marks an empty slot of the arena's hash index.
+const NO_ENTRY: u32 = u32::MAX;
+
+/// Lookup table aligned to the start of a cache line.
+///
+/// A 256 byte table then spans exactly four cache lines instead of straddling
+/// a fifth.
+#[repr(C, align(64))]
+#[derive(Copy, Clone)]
+struct Table([u8; ALL_U8]);
+
+/// Arena that deduplicates substitution ciphers by their lookup tables.
+///
+/// Interning a cipher whose table is byte-for-byte identical to one already in
+/// the arena returns the existing cipher, so any number of handles to the same
+/// cipher share a single 256 byte table. Tables are carved out of 64-byte
+/// aligned slabs rather than allocated individually, and the table used to
+/// decipher is only built when a cipher first deciphers, so ciphers that are
+/// only ever used to encipher cost a single table.
+///
+/// Interned ciphers live as long as the arena and are never freed
+/// individually.
+///
+/// # Example
+/// ```
+/// use purecipher::{CipherArena, PureCipher};
+///
+/// let arena = CipherArena::new();
+/// let first = arena.intern(&purecipher::rot13_alpha());
+/// let second = arena.intern(&purecipher::rot13_alpha());
+///
+/// assert!(std::ptr::eq(first, second));
+/// assert_eq!(1, arena.len());
+/// assert_eq!(b'n', first.encipher(b'a'));
+/// ```
+pub struct CipherArena {
+    /// Boxed so that interned ciphers may refer to it after the arena moves.
+    state: Box<Mutex<ArenaState>>,
+}
+
+impl CipherArena {
+    /// Builds an empty arena.
+    pub fn new() -> Self {
+        let state = ArenaState {
+            slabs: Vec::new(),
+            slab_used: SLAB_TABLES,
+            chunks: Vec::new(),
+            index: vec![NO_ENTRY; 64],
+            len: 0,
+        };
+        Self { state: Box::new(Mutex::new(state)) }
+    }
+
+    /// Interns a cipher with the given table, in which `map[b]` is the byte
+    /// that `b` is enciphered to.
+    ///
+    /// Returns `None` if `map` is not a permutation of all 256 bytes.
+    pub fn intern_table(&self, map: &[u8; ALL_U8]) -> Option<&ArenaCipher> {
+        let mut seen = [false; ALL_U8];
+        for &b in map.iter() {
+            if seen[b as usize] {
+                return None;
+            }
+            seen[b as usize] = true;
+        }
+        let mut state = self.state.lock().unwrap();
+        let cipher = state.intern(map, &*self.state);
+        // Interned ciphers are never moved or freed while the arena lives.
+        Some(unsafe { &*cipher })
+    }
+
+    /// Interns a cipher that ciphers bytes identically to the given cipher.
+    ///
+    /// The table is built by enciphering every byte value once, so `cipher`
+    /// is expected to uphold the `PureCipher` contract of being a bijection
+    /// on bytes.
+    pub fn intern(&self, cipher: &dyn PureCipher) -> &ArenaCipher {
+        let mut map = [0; ALL_U8];
+        for (b, mapped) in map.iter_mut().enumerate() {
+            *mapped = cipher.encipher(b as u8);
+        }
+        let mut state = self.state.lock().unwrap();
+        let cipher = state.intern(&map, &*self.state);
+        unsafe { &*cipher }
+    }
+
+    /// Returns the number of distinct ciphers in this arena.
+    pub fn len(&self) -> usize {
+        self.state.lock().unwrap().len
+    }
+}
+
+impl Default for CipherArena {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// Substitution cipher interned in a `CipherArena`.
+pub struct ArenaCipher {
+    /// Table used to encipher bytes.
+    map: *const Table,
+    /// Table used to decipher bytes, or null until it is first needed.
+    inverse: AtomicPtr<Table>,
+    /// State of the arena that owns this cipher's tables.
+    state: *const Mutex<ArenaState>,
+}
+
+unsafe impl Send for ArenaCipher {}
+
+unsafe impl Sync for ArenaCipher {}
+
+impl ArenaCipher {
+    fn map(&self) -> &[u8; ALL_U8] {
+        unsafe { &(*self.map).0 }
+    }
+
+    /// Returns the table used to decipher bytes, building it if necessary.
+    fn inverse(&self) -> &[u8; ALL_U8] {
+        let inverse = self.inverse.load(Ordering::Acquire);
+        if !inverse.is_null() {
+            return unsafe { &(*inverse).0 };
+        }
+        self.build_inverse()
+    }
+
+    #[cold]
+    fn build_inverse(&self) -> &[u8; ALL_U8] {
+        let mut state = unsafe { &*self.state }.lock().unwrap();
+        // Another thread may have built the table while this one waited.
+        let mut inverse = self.inverse.load(Ordering::Acquire);
+        if inverse.is_null() {
+            let mut table = [0; ALL_U8];
+            for (i, &b) in self.map().iter().enumerate() {
+                table[b as usize] = i as u8;
+            }
+            // Involutions such as rot13 are their own inverse, and other
+            // ciphers may be the inverse of one already in the arena.
+            let existing = state.find(&table).map(|cipher| cipher.map as *mut Table);
+            inverse = match existing {
+                Some(existing) => existing,
+                None => state.alloc_table(&table),
+            };
+            self.inverse.store(inverse, Ordering::Release);
+        }
+        unsafe { &(*inverse).0 }
+    }
+}
+
+impl PureCipher for ArenaCipher {
+    fn encipher(&self, token: u8) -> u8 {
+        self.map()[token as usize]
+    }
+
+    fn decipher(&self, token: u8) -> u8 {
+        self.inverse()[token as usize]
+    }
+
+    fn encipher_inplace(&self, bytes: &mut [u8]) {
+        let map = self.map();
+        for b in bytes.iter_mut() {
+            *b = map[*b as usize];
+        }
+    }
+
+    fn decipher_inplace(&self, bytes: &mut [u8]) {
+        let inverse = self.inverse();
+        for b in bytes.iter_mut() {
+            *b = inverse[*b as usize];
+        }
+    }
+}
+
+/// Storage of an arena, guarded by the arena's lock.
+struct ArenaState {
+    /// Slabs from which tables are allocated. Slabs are never reallocated.
+    ///
+    /// Slabs are held as raw pointers because other threads read the tables
+    /// already handed out from a slab, without the lock, while new tables are
+    /// written into it. No reference to a whole slab is ever formed.
+    slabs: Vec<*mut Table>,
+    /// Number of tables allocated from the last slab.
+    slab_used: usize,
+    /// Interned ciphers. Each chunk is allocated with a fixed capacity and is
+    /// never reallocated, so ciphers keep their addresses.
+    chunks: Vec<Vec<ArenaCipher>>,
+    /// Open-addressed hash index from tables to cipher ids.
+    index: Vec<u32>,
+    /// Number of interned ciphers.
+    len: usize,
+}
+
+// The slabs are only written under the arena's lock, and the tables handed out
+// from them are never written again.
+unsafe impl Send for ArenaState {}
+
+impl Drop for ArenaState {
+    fn drop(&mut self) {
+        for &slab in self.slabs.iter() {
+            unsafe { alloc::dealloc(slab as *mut u8, slab_layout()) };
+        }
+    }
+}
+
+impl ArenaState {
+    fn entry(&self, id: u32) -> &ArenaCipher {
+        let id = id as usize;
+        &self.chunks[id / ENTRY_CHUNK][id % ENTRY_CHUNK]
+    }
+
+    /// Returns the interned cipher with the given table, if any.
+    fn find(&self, map: &[u8; ALL_U8]) -> Option<&ArenaCipher> {
+        let mask = self.index.len() - 1;
+        let mut slot = hash_table(map) as usize & mask;
+        loop {
+            match self.index[slot] {
+                NO_ENTRY => return None,
+                id if self.entry(id).map() == map => return Some(self.entry(id)),
+                _ => slot = (slot + 1) & mask,
+            }
+        }
+    }
+
+    /// Returns the interned cipher with the given table, interning it first
+    /// if necessary.
+    fn intern(&mut self, map: &[u8; ALL_U8], owner: *const Mutex<ArenaState>) -> *const ArenaCipher {
+        if let Some(existing) = self.find(map).map(|cipher| cipher as *const ArenaCipher) {
+            return existing;
+        }
+        if (self.len + 1) * 4 > self.index.len() * 3 {
+            self.grow_index();
+        }
+
+        let table = self.alloc_table(map);
+        if self.chunks.last().map_or(true, |chunk| chunk.len() == ENTRY_CHUNK) {
+            self.chunks.push(Vec::with_capacity(ENTRY_CHUNK));
+        }
+        let chunk = self.chunks.last_mut().unwrap();
+        chunk.push(ArenaCipher { map: table, inverse: AtomicPtr::new(ptr::null_mut()), state: owner });
+        let cipher = chunk.last().unwrap() as *const ArenaCipher;
+
+        let id = self.len as u32;
+        self.len += 1;
+        self.insert_index(map, id);
+        cipher
+    }
+
+    /// Copies the given table into the next free slot of the current slab.
+    fn alloc_table(&mut self, table: &[u8; ALL_U8]) -> *mut Table {
+        if self.slab_used == SLAB_TABLES {
+            let slab = unsafe { alloc::alloc(slab_layout()) } as *mut Table;
+            if slab.is_null() {
+                alloc::handle_alloc_error(slab_layout());
+            }
+            self.slabs.push(slab);
+            self.slab_used = 0;
+        }
+        let slot = unsafe { self.slabs[self.slabs.len() - 1].add(self.slab_used) };
+        self.slab_used += 1;
+        unsafe { slot.write(Table(*table)) };
+        slot
+    }
+
+    fn insert_index(&mut self, map: &[u8; ALL_U8], id: u32) {
+        let mask = self.index.len() - 1;
+        let mut slot = hash_table(map) as usize & mask;
+        while self.index[slot] != NO_ENTRY {
+            slot = (slot + 1) & mask;
+        }
+        self.index[slot] = id;
+    }
+
+    /// Doubles the capacity of the hash index.
+    fn grow_index(&mut self) {
+        self.index = vec![NO_ENTRY; self.index.len() * 2];
+        for id in 0..self.len as u32 {
+            let map = *self.entry(id).map();
+            self.insert_index(&map, id);
+        }
+    }
+}
+
+/// Returns the layout of a slab of tables.
+fn slab_layout() -> Layout {
+    Layout::new::<[Table; SLAB_TABLES]>()
+}
+
+/// Hashes a table one 64-bit word at a time.
+fn hash_table(table: &[u8; ALL_U8]) -> u64 {
+    table.chunks_exact(8).fold(0u64, |hash, word| {
+        let word = u64::from_le_bytes(word.try_into().unwrap());
+        (hash.rotate_left(5) ^ word).wrapping_mul(0x51_7c_c1_b7_27_22_0a_95)
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::{caesar, rot13_alpha, SubstitutionBuilder, encipher_bytes, decipher_bytes};
+
+    #[test]
+    fn arena_deduplicates_tables() {
+        let arena = CipherArena::new();
+        let rot13 = arena.intern(&rot13_alpha());
+        let caesar = arena.intern(&caesar());
+        assert!(!ptr::eq(rot13, caesar));
+        assert!(ptr::eq(rot13, arena.intern(&rot13_alpha())));
+        assert_eq!(2, arena.len());
+
+        let text = b"The quick brown fox";
+        assert_eq!(encipher_bytes(&rot13_alpha(), &text[..]), encipher_bytes(rot13, &text[..]));
+    }
+
+    #[test]
+    fn arena_many_ciphers() {
+        // Builds one of 1000 distinct ciphers.
+        let build = |id: usize| {
+            let mut builder = SubstitutionBuilder::new();
+            builder.rotate_range(0, 255, (id % 256) as isize);
+            builder.swap(1, 2 + (id / 256) as u8);
+            builder.into_cipher()
+        };
+
+        let arena = CipherArena::new();
+        let ciphers: Vec<&ArenaCipher> = (0..3000).map(|i| arena.intern(&build(i % 1000))).collect();
+        assert_eq!(1000, arena.len());
+
+        for (i, cipher) in ciphers.iter().enumerate() {
+            assert!(ptr::eq(*cipher, ciphers[i % 1000]));
+            assert_eq!(build(i % 1000).encipher(1), cipher.encipher(1));
+            // Tables are aligned to cache lines.
+            assert_eq!(0, cipher.map as usize % 64);
+        }
+    }
+
+    #[test]
+    fn arena_builds_inverse_lazily() {
+        let arena = CipherArena::new();
+        let caesar = arena.intern(&caesar());
+        let rot13 = arena.intern(&rot13_alpha());
+        assert!(caesar.inverse.load(Ordering::Acquire).is_null());
+
+        let cipher_text = encipher_bytes(caesar, b"attack at dawn");
+        assert_eq!(b"attack at dawn".to_vec(), decipher_bytes(caesar, &cipher_text));
+        assert!(!caesar.inverse.load(Ordering::Acquire).is_null());
+
+        // Involutions reuse their own table as their inverse.
+        assert_eq!(b'a', rot13.decipher(b'n'));
+        assert_eq!(rot13.map as *mut Table, rot13.inverse.load(Ordering::Acquire));
+    }
+
+    #[test]
+    fn arena_rejects_non_permutations() {
+        let arena = CipherArena::new();
+        assert!(arena.intern_table(&[0; ALL_U8]).is_none());
+
+        let mut identity = [0; ALL_U8];
+        for (i, b) in identity.iter_mut().enumerate() {
+            *b = i as u8;
+        }
+        assert_eq!(b'x', arena.intern_table(&identity).unwrap().encipher(b'x'));
+    }
+}
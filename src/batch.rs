@@ -0,0 +1,123 @@
+//! Batched ciphering of records that each select their own cipher.
+
+use super::PureCipher;
+
+/// Enciphers every record in `arena` inplace with the cipher selected for it.
+///
+/// Record `i` spans `arena[offsets[i]..offsets[i + 1]]` and is enciphered
+/// with `ciphers[i]`. Records are processed grouped by cipher so that each
+/// cipher's lookup tables stay resident in cache while its records are
+/// ciphered, regardless of how the records are interleaved in the arena.
+///
+/// # Panics
+/// This function will panic if `offsets` does not contain exactly one more
+/// entry than `ciphers`, or if the offsets are not ascending and within the
+/// bounds of `arena`. See `check_offsets`.
+///
+/// # Example
+/// ```
+/// use purecipher::PureCipher;
+///
+/// let caesar = purecipher::caesar();
+/// let rot13 = purecipher::rot13_alpha();
+/// let ciphers: [&dyn PureCipher; 3] = [&caesar, &rot13, &caesar];
+///
+/// let mut arena = b"abcabcabc".to_vec();
+/// purecipher::encipher_batch(&ciphers, &mut arena, &[0, 3, 6, 9]);
+///
+/// assert_eq!(b"defnopdef", &arena[..]);
+/// ```
+pub fn encipher_batch(ciphers: &[&dyn PureCipher], arena: &mut [u8], offsets: &[usize]) {
+    assert!(check_offsets(ciphers.len(), arena.len(), offsets), "invalid batch offsets");
+    for_each_grouped(ciphers, arena, offsets, |cipher, record| cipher.encipher_inplace(record));
+}
+
+/// Deciphers every record in `arena` inplace with the cipher selected for it.
+///
+/// This function is the inverse of `encipher_batch`, and accepts the same
+/// arguments.
+///
+/// # Panics
+/// This function will panic under the same conditions as `encipher_batch`.
+pub fn decipher_batch(ciphers: &[&dyn PureCipher], arena: &mut [u8], offsets: &[usize]) {
+    assert!(check_offsets(ciphers.len(), arena.len(), offsets), "invalid batch offsets");
+    for_each_grouped(ciphers, arena, offsets, |cipher, record| cipher.decipher_inplace(record));
+}
+
+/// Checks whether `offsets` describes `count` records lying within an arena
+/// of `arena_len` bytes.
+///
+/// Valid offsets contain exactly `count + 1` ascending entries, the last of
+/// which does not exceed `arena_len`.
+pub fn check_offsets(count: usize, arena_len: usize, offsets: &[usize]) -> bool {
+    offsets.len() == count + 1
+        && offsets.windows(2).all(|w| w[0] <= w[1])
+        && offsets.last().map_or(false, |&end| end <= arena_len)
+}
+
+/// Applies `op` to each record, visiting all records that share a cipher
+/// consecutively.
+fn for_each_grouped<F>(ciphers: &[&dyn PureCipher], arena: &mut [u8], offsets: &[usize], op: F)
+    where F: Fn(&dyn PureCipher, &mut [u8])
+{
+    // Sort record indices by the address of their cipher. The sort is stable,
+    // so records sharing a cipher are still visited in arena order.
+    let mut order: Vec<usize> = (0..ciphers.len()).collect();
+    order.sort_by_key(|&i| ciphers[i] as *const dyn PureCipher as *const u8 as usize);
+
+    for i in order {
+        op(ciphers[i], &mut arena[offsets[i]..offsets[i + 1]]);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::{caesar, rot13_alpha, NullCipher};
+
+    #[test]
+    fn batch_round_trip() {
+        let caesar = caesar();
+        let rot13 = rot13_alpha();
+        let ciphers: [&dyn PureCipher; 4] = [&rot13, &caesar, &NullCipher, &rot13];
+
+        let text = b"Tenant oneTenant twoNo cipherTenant one";
+        let offsets = [0, 10, 20, 29, 39];
+        let mut arena = text.to_vec();
+
+        encipher_batch(&ciphers, &mut arena, &offsets);
+        assert_eq!(&b"Granag barWhqdqw wzrNo cipherGranag bar"[..], &arena[..]);
+
+        decipher_batch(&ciphers, &mut arena, &offsets);
+        assert_eq!(&text[..], &arena[..]);
+    }
+
+    #[test]
+    fn batch_empty_records() {
+        let rot13 = rot13_alpha();
+        let ciphers: [&dyn PureCipher; 3] = [&rot13, &rot13, &rot13];
+        let mut arena = b"ab".to_vec();
+
+        encipher_batch(&ciphers, &mut arena, &[0, 0, 1, 1]);
+        assert_eq!(b"nb", &arena[..]);
+    }
+
+    #[test]
+    fn batch_check_offsets() {
+        assert!(check_offsets(0, 0, &[0]));
+        assert!(check_offsets(2, 4, &[0, 2, 4]));
+        assert!(check_offsets(2, 8, &[1, 1, 3]));
+
+        assert!(!check_offsets(0, 0, &[]));
+        assert!(!check_offsets(2, 4, &[0, 4]));
+        assert!(!check_offsets(2, 4, &[0, 3, 2]));
+        assert!(!check_offsets(2, 4, &[0, 2, 5]));
+    }
+
+    #[test]
+    #[should_panic]
+    fn batch_panics_on_invalid_offsets() {
+        let ciphers: [&dyn PureCipher; 1] = [&NullCipher];
+        encipher_batch(&ciphers, &mut [0; 4], &[0, 8]);
+    }
+}
@@ -0,0 +1,62 @@
+//! Daemon serving the classic ciphers to the processes on a host.
+//!
+//! Usage: `purecipherd <socket path> [threads]`
+//!
+//! The ciphers are registered as `caesar`, `rot13` and `leet`. The daemon runs
+//! until it receives SIGINT or SIGTERM, and then removes its socket.
+
+extern crate libc;
+extern crate purecipher;
+
+#[cfg(target_os = "linux")]
+use std::{env, mem, process, ptr};
+
+#[cfg(target_os = "linux")]
+use purecipher::{CipherService, CAESAR, LEET_SPEAK, ROT13_ALPHA};
+
+#[cfg(not(target_os = "linux"))]
+fn main() {
+    eprintln!("purecipherd is only supported on Linux");
+    std::process::exit(1);
+}
+
+#[cfg(target_os = "linux")]
+fn main() {
+    let args: Vec<String> = env::args().collect();
+    let threads = match args.get(2).map(|threads| threads.parse()) {
+        None => Ok(0),
+        Some(threads) => threads,
+    };
+    let (path, threads) = match (args.get(1), threads) {
+        (Some(path), Ok(threads)) if args.len() <= 3 => (path, threads),
+        _ => {
+            eprintln!("usage: {} <socket path> [threads]", args[0]);
+            process::exit(2);
+        }
+    };
+
+    // Block the signals before any thread starts, so that every thread
+    // inherits the mask and only sigwait below receives them.
+    let mut signals: libc::sigset_t = unsafe { mem::zeroed() };
+    unsafe {
+        libc::sigemptyset(&mut signals);
+        libc::sigaddset(&mut signals, libc::SIGINT);
+        libc::sigaddset(&mut signals, libc::SIGTERM);
+        libc::pthread_sigmask(libc::SIG_BLOCK, &signals, ptr::null_mut());
+    }
+
+    let service = match CipherService::bind(path, threads) {
+        Ok(service) => service,
+        Err(err) => {
+            eprintln!("{}: cannot bind {}: {}", args[0], path, err);
+            process::exit(1);
+        }
+    };
+    service.register("caesar", &CAESAR);
+    service.register("rot13", &ROT13_ALPHA);
+    service.register("leet", &LEET_SPEAK);
+
+    let mut signal = 0;
+    unsafe { libc::sigwait(&signals, &mut signal) };
+    drop(service);
+}
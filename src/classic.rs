@@ -1,51 +1,49 @@
 //! A collection of classic pure ciphers.
+//!
+//! Each cipher is built at compile time and stored in a static, so its tables
+//! live in read-only data and using it costs no setup.
 
 use super::{SubstitutionBuilder, SubstitutionCipher};
 
-/// Builds the classic caesar cipher.
+/// The classic caesar cipher.
 ///
 /// # Example
 /// ```
-/// let caesar = purecipher::caesar();
-/// let message = "We attack at dawn.";
+/// use purecipher::PureCipher;
 ///
-/// let cipher_text = purecipher::encipher_bytes(&caesar, &message);
-/// assert_eq!("Zh dwwdfn dw gdzq.".as_bytes(), &cipher_text[..]);
+/// assert_eq!(b'D', purecipher::CAESAR.encipher(b'A'));
 /// ```
-pub fn caesar() -> SubstitutionCipher {
+pub static CAESAR: SubstitutionCipher = {
     let mut builder = SubstitutionBuilder::new();
     builder.rotate_range(b'A', b'Z', 3);
     builder.rotate_range(b'a', b'z', 3);
     builder.into_cipher()
-}
+};
 
-/// Builds the rot13 substitution cipher.
+/// The rot13 substitution cipher.
 ///
 /// # Example
 /// ```
-/// let rot13 = purecipher::rot13_alpha();
-/// let message = "Lovely plumage, the Norwegian Blue.";
+/// use purecipher::PureCipher;
 ///
-/// let cipher_text = purecipher::encipher_bytes(&rot13, &message);
-/// assert_eq!("Ybiryl cyhzntr, gur Abejrtvna Oyhr.".as_bytes(), &cipher_text[..]);
-pub fn rot13_alpha() -> SubstitutionCipher {
+/// assert_eq!(b'N', purecipher::ROT13_ALPHA.encipher(b'A'));
+/// ```
+pub static ROT13_ALPHA: SubstitutionCipher = {
     let mut builder = SubstitutionBuilder::new();
     builder.rotate_range(b'A', b'Z', 13);
     builder.rotate_range(b'a', b'z', 13);
     builder.into_cipher()
-}
+};
 
-/// Builds a rough cipher to stereotypical "leet" speak.
+/// A rough cipher to stereotypical "leet" speak.
 ///
 /// # Example
 /// ```
-/// let leet = purecipher::leet_speak();
-/// let message = "Pure ciphers are the BEST!";
+/// use purecipher::PureCipher;
 ///
-/// let cipher_text = purecipher::encipher_bytes(&leet, &message);
-/// assert_eq!("Pur3 c!ph3rs @r3 1h3 BE5Ti".as_bytes(), &cipher_text[..]);
+/// assert_eq!(b'3', purecipher::LEET_SPEAK.encipher(b'e'));
 /// ```
-pub fn leet_speak() -> SubstitutionCipher {
+pub static LEET_SPEAK: SubstitutionCipher = {
     let substitutions = [
         (b'a', b'@'),
         (b'e', b'3'),
@@ -56,9 +54,53 @@ pub fn leet_speak() -> SubstitutionCipher {
     ];
 
     let mut builder = SubstitutionBuilder::new();
-    for (token, target) in substitutions.iter() {
-        builder.swap(*token, *target);
+    let mut i = 0;
+    while i < substitutions.len() {
+        builder.swap(substitutions[i].0, substitutions[i].1);
+        i += 1;
     }
 
     builder.into_cipher()
-}
\ No newline at end of file
+};
+
+/// Builds the classic caesar cipher.
+///
+/// # Example
+/// ```
+/// let caesar = purecipher::caesar();
+/// let message = "We attack at dawn.";
+///
+/// let cipher_text = purecipher::encipher_bytes(&caesar, &message);
+/// assert_eq!("Zh dwwdfn dw gdzq.".as_bytes(), &cipher_text[..]);
+/// ```
+pub fn caesar() -> SubstitutionCipher {
+    CAESAR.clone()
+}
+
+/// Builds the rot13 substitution cipher.
+///
+/// # Example
+/// ```
+/// let rot13 = purecipher::rot13_alpha();
+/// let message = "Lovely plumage, the Norwegian Blue.";
+///
+/// let cipher_text = purecipher::encipher_bytes(&rot13, &message);
+/// assert_eq!("Ybiryl cyhzntr, gur Abejrtvna Oyhr.".as_bytes(), &cipher_text[..]);
+/// ```
+pub fn rot13_alpha() -> SubstitutionCipher {
+    ROT13_ALPHA.clone()
+}
+
+/// Builds a rough cipher to stereotypical "leet" speak.
+///
+/// # Example
+/// ```
+/// let leet = purecipher::leet_speak();
+/// let message = "Pure ciphers are the BEST!";
+///
+/// let cipher_text = purecipher::encipher_bytes(&leet, &message);
+/// assert_eq!("Pur3 c!ph3rs @r3 1h3 BE5Ti".as_bytes(), &cipher_text[..]);
+/// ```
+pub fn leet_speak() -> SubstitutionCipher {
+    LEET_SPEAK.clone()
+}
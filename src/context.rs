@@ -0,0 +1,473 @@
+//! Asynchronous ciphering through submission and completion rings.
+
+use std::cell::UnsafeCell;
+use std::mem::MaybeUninit;
+use std::slice;
+use std::sync::{Arc, Condvar, Mutex};
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::thread::{self, JoinHandle};
+
+use libc::c_int;
+
+use super::PureCipher;
+
+/// Callback invoked on a worker thread when a submission is complete.
+pub type Callback = extern "C" fn(user_data: u64);
+
+/// A buffer to be ciphered asynchronously.
+///
+/// The submitter guarantees that the cipher and buffer stay valid, and that
+/// the buffer is not otherwise accessed, until the submission is complete.
+#[derive(Copy, Clone)]
+pub(crate) struct Submission {
+    pub cipher: *const dyn PureCipher,
+    pub buffer: *mut u8,
+    pub length: usize,
+    pub decipher: bool,
+    pub user_data: u64,
+    pub callback: Option<Callback>,
+}
+
+unsafe impl Send for Submission {}
+
+/// Context that ciphers submitted buffers on its own worker threads.
+///
+/// Callers, typically event loops that must never block, push submissions
+/// onto a bounded lock-free ring and later reap the user data of completed
+/// submissions from a second ring. A completion is announced by signalling
+/// an eventfd, which the caller may poll alongside its other descriptors, or
+/// by invoking the submission's callback on the worker that ciphered it.
+///
+/// At most `entries` submissions may be in flight at once: a submission stays
+/// in flight until it is reaped, or until its callback returns. This bounds
+/// the completion ring, so workers never wait for the caller to reap.
+pub struct CipherContext {
+    shared: Arc<Shared>,
+    workers: Vec<JoinHandle<()>>,
+}
+
+impl CipherContext {
+    /// Starts a context with the given number of workers and room for at
+    /// least `entries` submissions in flight.
+    ///
+    /// If `threads` is zero, one worker is started per available core.
+    ///
+    /// # Panics
+    /// This function will panic if `entries` is zero.
+    pub(crate) fn new(threads: usize, entries: usize) -> Self {
+        assert!(entries > 0, "context requires at least one ring entry");
+        let threads = if threads == 0 {
+            thread::available_parallelism().map_or(1, |n| n.get())
+        } else {
+            threads
+        };
+        let capacity = entries.next_power_of_two();
+        let shared = Arc::new(Shared {
+            submissions: Ring::new(capacity),
+            completions: Ring::new(capacity),
+            capacity,
+            in_flight: AtomicUsize::new(0),
+            queued: AtomicUsize::new(0),
+            sleepers: AtomicUsize::new(0),
+            shutdown: AtomicBool::new(false),
+            sleep: Mutex::new(()),
+            wake: Condvar::new(),
+            event_fd: event_fd_new(),
+        });
+        let workers = (0..threads)
+            .map(|_| {
+                let shared = Arc::clone(&shared);
+                thread::spawn(move || shared.run_worker())
+            })
+            .collect();
+        Self { shared, workers }
+    }
+
+    /// Returns the eventfd signalled when completions are ready to be reaped,
+    /// or -1 if eventfds are not supported on this platform.
+    pub(crate) fn event_fd(&self) -> c_int {
+        self.shared.event_fd
+    }
+
+    /// Queues a submission to be ciphered by the workers.
+    ///
+    /// Returns false if the maximum number of submissions are in flight.
+    pub(crate) unsafe fn submit(&self, submission: Submission) -> bool {
+        let shared = &self.shared;
+        if shared.in_flight.fetch_add(1, Ordering::AcqRel) >= shared.capacity {
+            shared.in_flight.fetch_sub(1, Ordering::AcqRel);
+            return false;
+        }
+        // The ring holds at least as many entries as may be in flight.
+        let pushed = shared.submissions.push(submission).is_ok();
+        debug_assert!(pushed);
+
+        shared.queued.fetch_add(1, Ordering::SeqCst);
+        if shared.sleepers.load(Ordering::SeqCst) > 0 {
+            let _guard = shared.sleep.lock().unwrap();
+            shared.wake.notify_one();
+        }
+        true
+    }
+
+    /// Collects the user data of completed submissions into `user_data`,
+    /// returning the number collected.
+    ///
+    /// The eventfd is reset before the completion ring is drained, so a
+    /// submission that completes during this call signals it again.
+    pub(crate) fn reap(&self, user_data: &mut [u64]) -> usize {
+        event_fd_clear(self.shared.event_fd);
+        let mut count = 0;
+        for slot in user_data.iter_mut() {
+            match self.shared.completions.pop() {
+                Some(data) => *slot = data,
+                None => break,
+            }
+            count += 1;
+        }
+        self.shared.in_flight.fetch_sub(count, Ordering::AcqRel);
+        count
+    }
+}
+
+impl Drop for CipherContext {
+    /// Stops the context once every queued submission has been ciphered.
+    fn drop(&mut self) {
+        self.shared.shutdown.store(true, Ordering::SeqCst);
+        {
+            let _guard = self.shared.sleep.lock().unwrap();
+            self.shared.wake.notify_all();
+        }
+        for worker in self.workers.drain(..) {
+            let _ = worker.join();
+        }
+        event_fd_close(self.shared.event_fd);
+    }
+}
+
+/// State shared between a context and its workers.
+struct Shared {
+    submissions: Ring<Submission>,
+    /// User data of completed submissions without a callback.
+    completions: Ring<u64>,
+    /// Capacity of each ring.
+    capacity: usize,
+    /// Number of submissions that have been accepted but not yet reaped.
+    in_flight: AtomicUsize,
+    /// Number of submissions waiting in the submission ring.
+    queued: AtomicUsize,
+    /// Number of workers waiting, or about to wait, on `wake`.
+    sleepers: AtomicUsize,
+    shutdown: AtomicBool,
+    sleep: Mutex<()>,
+    wake: Condvar,
+    event_fd: c_int,
+}
+
+impl Shared {
+    fn run_worker(&self) {
+        loop {
+            if let Some(submission) = self.submissions.pop() {
+                self.queued.fetch_sub(1, Ordering::SeqCst);
+                self.complete(submission);
+                continue;
+            }
+
+            // A submitter increments `queued` before checking for sleepers,
+            // and a worker registers as a sleeper before checking `queued`,
+            // so at least one of them observes the other.
+            let mut guard = self.sleep.lock().unwrap();
+            self.sleepers.fetch_add(1, Ordering::SeqCst);
+            while self.queued.load(Ordering::SeqCst) == 0 {
+                if self.shutdown.load(Ordering::SeqCst) {
+                    self.sleepers.fetch_sub(1, Ordering::SeqCst);
+                    return;
+                }
+                guard = self.wake.wait(guard).unwrap();
+            }
+            self.sleepers.fetch_sub(1, Ordering::SeqCst);
+        }
+    }
+
+    fn complete(&self, submission: Submission) {
+        let cipher = unsafe { &*submission.cipher };
+        let buffer = unsafe { slice::from_raw_parts_mut(submission.buffer, submission.length) };
+        if submission.decipher {
+            cipher.decipher_inplace(buffer);
+        } else {
+            cipher.encipher_inplace(buffer);
+        }
+
+        match submission.callback {
+            Some(callback) => {
+                callback(submission.user_data);
+                self.in_flight.fetch_sub(1, Ordering::AcqRel);
+            }
+            None => {
+                // Cannot fail: the ring has room for every submission in flight.
+                let _ = self.completions.push(submission.user_data);
+                event_fd_signal(self.event_fd);
+            }
+        }
+    }
+}
+
+/// Bounded lock-free multi-producer multi-consumer queue.
+///
+/// Each slot carries a sequence number recording whether it is ready to be
+/// written or read for a given lap of the ring, so producers and consumers
+/// only contend on the index they advance.
+struct Ring<T: Copy> {
+    slots: Box<[Slot<T>]>,
+    mask: usize,
+    head: CachePadded<AtomicUsize>,
+    tail: CachePadded<AtomicUsize>,
+}
+
+struct Slot<T> {
+    sequence: AtomicUsize,
+    value: UnsafeCell<MaybeUninit<T>>,
+}
+
+/// Aligns a value to its own cache line to avoid false sharing.
+#[repr(align(64))]
+struct CachePadded<T>(T);
+
+unsafe impl<T: Copy + Send> Send for Ring<T> {}
+
+unsafe impl<T: Copy + Send> Sync for Ring<T> {}
+
+impl<T: Copy> Ring<T> {
+    /// Builds a ring with the given capacity, which must be a power of two.
+    fn new(capacity: usize) -> Self {
+        debug_assert!(capacity.is_power_of_two());
+        let slots = (0..capacity)
+            .map(|i| Slot { sequence: AtomicUsize::new(i), value: UnsafeCell::new(MaybeUninit::uninit()) })
+            .collect();
+        Self {
+            slots,
+            mask: capacity - 1,
+            head: CachePadded(AtomicUsize::new(0)),
+            tail: CachePadded(AtomicUsize::new(0)),
+        }
+    }
+
+    /// Appends a value to the ring, or returns it if the ring is full.
+    fn push(&self, value: T) -> Result<(), T> {
+        let mut pos = self.tail.0.load(Ordering::Relaxed);
+        loop {
+            let slot = &self.slots[pos & self.mask];
+            let sequence = slot.sequence.load(Ordering::Acquire);
+            let lap = sequence.wrapping_sub(pos) as isize;
+            if lap == 0 {
+                match self.tail.0.compare_exchange_weak(pos, pos.wrapping_add(1), Ordering::Relaxed, Ordering::Relaxed) {
+                    Ok(_) => {
+                        unsafe { (*slot.value.get()).as_mut_ptr().write(value) };
+                        slot.sequence.store(pos.wrapping_add(1), Ordering::Release);
+                        return Ok(());
+                    }
+                    Err(current) => pos = current,
+                }
+            } else if lap < 0 {
+                return Err(value);
+            } else {
+                pos = self.tail.0.load(Ordering::Relaxed);
+            }
+        }
+    }
+
+    /// Removes the oldest value from the ring, if any.
+    fn pop(&self) -> Option<T> {
+        let mut pos = self.head.0.load(Ordering::Relaxed);
+        loop {
+            let slot = &self.slots[pos & self.mask];
+            let sequence = slot.sequence.load(Ordering::Acquire);
+            let lap = sequence.wrapping_sub(pos.wrapping_add(1)) as isize;
+            if lap == 0 {
+                match self.head.0.compare_exchange_weak(pos, pos.wrapping_add(1), Ordering::Relaxed, Ordering::Relaxed) {
+                    Ok(_) => {
+                        let value = unsafe { (*slot.value.get()).as_ptr().read() };
+                        slot.sequence.store(pos.wrapping_add(self.mask + 1), Ordering::Release);
+                        return Some(value);
+                    }
+                    Err(current) => pos = current,
+                }
+            } else if lap < 0 {
+                return None;
+            } else {
+                pos = self.head.0.load(Ordering::Relaxed);
+            }
+        }
+    }
+}
+
+#[cfg(target_os = "linux")]
+fn event_fd_new() -> c_int {
+    unsafe { libc::eventfd(0, libc::EFD_NONBLOCK | libc::EFD_CLOEXEC) }
+}
+
+#[cfg(target_os = "linux")]
+fn event_fd_signal(fd: c_int) {
+    let one: u64 = 1;
+    unsafe { libc::write(fd, &one as *const u64 as *const libc::c_void, 8) };
+}
+
+#[cfg(target_os = "linux")]
+fn event_fd_clear(fd: c_int) {
+    let mut count: u64 = 0;
+    unsafe { libc::read(fd, &mut count as *mut u64 as *mut libc::c_void, 8) };
+}
+
+#[cfg(target_os = "linux")]
+fn event_fd_close(fd: c_int) {
+    if fd >= 0 {
+        unsafe { libc::close(fd) };
+    }
+}
+
+#[cfg(not(target_os = "linux"))]
+fn event_fd_new() -> c_int { -1 }
+
+#[cfg(not(target_os = "linux"))]
+fn event_fd_signal(_fd: c_int) {}
+
+#[cfg(not(target_os = "linux"))]
+fn event_fd_clear(_fd: c_int) {}
+
+#[cfg(not(target_os = "linux"))]
+fn event_fd_close(_fd: c_int) {}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::rot13_alpha;
+
+    use std::sync::atomic::AtomicU64;
+
+    #[test]
+    fn ring_fifo_and_capacity() {
+        let ring = Ring::new(4);
+        for i in 0..4 {
+            assert!(ring.push(i).is_ok());
+        }
+        assert_eq!(Err(4), ring.push(4));
+        for lap in 0..3 {
+            assert_eq!(Some(lap), ring.pop());
+            assert!(ring.push(lap + 4).is_ok());
+        }
+        assert_eq!(vec![3, 4, 5, 6], (0..4).filter_map(|_| ring.pop()).collect::<Vec<_>>());
+        assert_eq!(None, ring.pop());
+    }
+
+    #[test]
+    fn ring_concurrent() {
+        let ring = Arc::new(Ring::new(64));
+        let producers: Vec<_> = (0..4u64)
+            .map(|p| {
+                let ring = Arc::clone(&ring);
+                thread::spawn(move || {
+                    for i in 0..1000 {
+                        while ring.push(p * 1000 + i).is_err() {
+                            thread::yield_now();
+                        }
+                    }
+                })
+            })
+            .collect();
+
+        let mut seen = vec![false; 4000];
+        let mut count = 0;
+        while count < 4000 {
+            if let Some(value) = ring.pop() {
+                assert!(!seen[value as usize]);
+                seen[value as usize] = true;
+                count += 1;
+            }
+        }
+        for producer in producers {
+            producer.join().unwrap();
+        }
+    }
+
+    #[test]
+    fn context_reaps_completions() {
+        let rot13 = rot13_alpha();
+        let context = CipherContext::new(2, 3);
+        let mut buffers: Vec<Vec<u8>> = (0..4).map(|_| b"abc".to_vec()).collect();
+
+        for (i, buffer) in buffers.iter_mut().enumerate() {
+            let submitted = unsafe {
+                context.submit(Submission {
+                    cipher: &rot13 as &dyn PureCipher as *const dyn PureCipher,
+                    buffer: buffer.as_mut_ptr(),
+                    length: buffer.len(),
+                    decipher: false,
+                    user_data: i as u64,
+                    callback: None,
+                })
+            };
+            assert!(submitted);
+        }
+
+        let mut reaped = Vec::new();
+        let mut user_data = [0; 4];
+        while reaped.len() < 4 {
+            let count = context.reap(&mut user_data);
+            reaped.extend_from_slice(&user_data[..count]);
+        }
+        reaped.sort();
+        assert_eq!(vec![0, 1, 2, 3], reaped);
+        assert!(buffers.iter().all(|b| b == b"nop"));
+    }
+
+    #[test]
+    fn context_rejects_when_full() {
+        let rot13 = rot13_alpha();
+        let context = CipherContext::new(1, 1);
+        let mut buffer = *b"abc";
+        let submission = Submission {
+            cipher: &rot13 as &dyn PureCipher as *const dyn PureCipher,
+            buffer: buffer.as_mut_ptr(),
+            length: buffer.len(),
+            decipher: false,
+            user_data: 7,
+            callback: None,
+        };
+        assert!(unsafe { context.submit(submission) });
+        assert!(!unsafe { context.submit(submission) });
+
+        let mut user_data = [0];
+        while context.reap(&mut user_data) == 0 {
+            thread::yield_now();
+        }
+        assert_eq!(7, user_data[0]);
+        assert!(unsafe { context.submit(Submission { decipher: true, ..submission }) });
+        drop(context);
+        assert_eq!(b"abc", &buffer);
+    }
+
+    #[test]
+    fn context_invokes_callbacks() {
+        static COMPLETED: AtomicU64 = AtomicU64::new(0);
+        extern "C" fn on_complete(user_data: u64) {
+            COMPLETED.fetch_add(user_data, Ordering::SeqCst);
+        }
+
+        let rot13 = rot13_alpha();
+        let mut buffer = *b"abc";
+        {
+            let context = CipherContext::new(1, 8);
+            let submission = Submission {
+                cipher: &rot13 as &dyn PureCipher as *const dyn PureCipher,
+                buffer: buffer.as_mut_ptr(),
+                length: buffer.len(),
+                decipher: false,
+                user_data: 5,
+                callback: Some(on_complete),
+            };
+            assert!(unsafe { context.submit(submission) });
+        }
+        assert_eq!(5, COMPLETED.load(Ordering::SeqCst));
+        assert_eq!(b"nop", &buffer);
+    }
+}
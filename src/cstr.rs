@@ -0,0 +1,177 @@
+//! Ciphering of null-terminated strings.
+
+use super::PureCipher;
+
+/// Number of bytes checked for the terminator at once on x86_64.
+///
+/// Blocks are aligned to their size, so a block never crosses a page
+/// boundary and the hardware can load all of it whenever any of its bytes is
+/// readable.
+#[cfg(target_arch = "x86_64")]
+const BLOCK: usize = 64;
+
+/// Number of bytes scanned before they are ciphered, small enough that they are
+/// still in the L1 cache when the cipher reads them back.
+const RUN: usize = 4096;
+
+/// Enciphers the null-terminated string at `s` inplace, returning its length.
+///
+/// The terminator is located and the string ciphered in a single pass, rather
+/// than by finding its length first and then ciphering it. Every few
+/// kilobytes the scanned bytes are ciphered while they are still cached, so
+/// the string is only brought in from memory once. On x86_64 the string is
+/// scanned a block at a time with SSE2, and elsewhere a byte at a time.
+///
+/// # Safety
+/// `s` must point to a readable and writable null-terminated string. On
+/// x86_64, like the C library's `strlen`, this function loads whole aligned
+/// blocks, so it reads bytes before the start of the string and past its
+/// terminator that share a page with the string, but never writes them.
+///
+/// # Example
+/// ```
+/// let cipher = purecipher::rot13_alpha();
+/// let mut s = *b"Hello, world\0";
+///
+/// let len = unsafe { purecipher::encipher_cstr(&cipher, s.as_mut_ptr()) };
+///
+/// assert_eq!(12, len);
+/// assert_eq!(b"Uryyb, jbeyq\0", &s);
+/// ```
+pub unsafe fn encipher_cstr(cipher: &dyn PureCipher, s: *mut u8) -> usize {
+    cipher_cstr(s, |run| cipher.encipher_inplace(run))
+}
+
+/// Deciphers the null-terminated string at `s` inplace, returning its length.
+///
+/// This function is the inverse of `encipher_cstr`.
+///
+/// # Safety
+/// See `encipher_cstr`.
+pub unsafe fn decipher_cstr(cipher: &dyn PureCipher, s: *mut u8) -> usize {
+    cipher_cstr(s, |run| cipher.decipher_inplace(run))
+}
+
+/// Applies `op` to runs of the null-terminated string at `s` that together
+/// cover the whole string, returning its length.
+///
+/// The over-reads of the aligned blocks are deliberate. They are made only
+/// through SSE2 loads, which cannot fault within a readable page, and their
+/// bytes outside the string are masked off rather than used.
+#[cfg(target_arch = "x86_64")]
+unsafe fn cipher_cstr<F>(s: *mut u8, op: F) -> usize
+    where F: Fn(&mut [u8])
+{
+    let run = |start: usize, end: usize| op(std::slice::from_raw_parts_mut(s.add(start), end - start));
+
+    // The first block is read from its aligned start, ignoring the bytes that
+    // precede the string.
+    let skip = s as usize % BLOCK;
+    let zeros = zero_mask(s.sub(skip)) >> skip;
+    if zeros != 0 {
+        let len = zeros.trailing_zeros() as usize;
+        run(0, len);
+        return len;
+    }
+
+    let mut start = 0;
+    let mut len = BLOCK - skip;
+    loop {
+        let zeros = zero_mask(s.add(len));
+        if zeros != 0 {
+            len += zeros.trailing_zeros() as usize;
+            run(start, len);
+            return len;
+        }
+        len += BLOCK;
+        if len - start >= RUN {
+            run(start, len);
+            start = len;
+        }
+    }
+}
+
+/// Returns a mask of the zero bytes in the aligned block at `block`.
+#[cfg(target_arch = "x86_64")]
+#[inline(always)]
+unsafe fn zero_mask(block: *const u8) -> u64 {
+    use std::arch::x86_64::*;
+
+    // SSE2 is part of the x86_64 baseline, so no detection is needed.
+    let zero = _mm_setzero_si128();
+    let lanes = [
+        _mm_load_si128(block as *const __m128i),
+        _mm_load_si128(block.add(16) as *const __m128i),
+        _mm_load_si128(block.add(32) as *const __m128i),
+        _mm_load_si128(block.add(48) as *const __m128i),
+    ];
+    // Most blocks hold no terminator, which one comparison of the bytewise
+    // minimum of the block rules out.
+    let min = _mm_min_epu8(_mm_min_epu8(lanes[0], lanes[1]), _mm_min_epu8(lanes[2], lanes[3]));
+    if _mm_movemask_epi8(_mm_cmpeq_epi8(min, zero)) == 0 {
+        return 0;
+    }
+    lanes.iter()
+        .enumerate()
+        .fold(0, |mask, (i, &lane)| {
+            let hits = _mm_movemask_epi8(_mm_cmpeq_epi8(lane, zero)) as u16;
+            mask | (hits as u64) << (16 * i)
+        })
+}
+
+/// Applies `op` to runs of the null-terminated string at `s` that together
+/// cover the whole string, returning its length.
+///
+/// Without vector loads, reading bytes outside the string would be undefined
+/// behaviour, so the string is scanned one byte at a time.
+#[cfg(not(target_arch = "x86_64"))]
+unsafe fn cipher_cstr<F>(s: *mut u8, op: F) -> usize
+    where F: Fn(&mut [u8])
+{
+    let run = |start: usize, end: usize| op(std::slice::from_raw_parts_mut(s.add(start), end - start));
+
+    let mut start = 0;
+    let mut len = 0;
+    while *s.add(len) != 0 {
+        len += 1;
+        if len - start == RUN {
+            run(start, len);
+            start = len;
+        }
+    }
+    run(start, len);
+    len
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::rot13_alpha;
+
+    #[test]
+    fn cstr_lengths_and_alignments() {
+        let cipher = rot13_alpha();
+        let mut buffer = vec![0u8; 2 * RUN + 256];
+        for offset in 0..64 {
+            for &len in [0, 1, 15, 16, 17, 63, 64, 100, RUN - 1, RUN, RUN + 1, 2 * RUN + 3].iter() {
+                let text: Vec<u8> = (0..len).map(|i| b'a' + (i % 26) as u8).collect();
+                for b in buffer.iter_mut() {
+                    *b = b'x';
+                }
+                buffer[offset..offset + len].copy_from_slice(&text);
+                buffer[offset + len] = 0;
+
+                let s = buffer[offset..].as_mut_ptr();
+                assert_eq!(len, unsafe { encipher_cstr(&cipher, s) });
+                let mut expected = text.clone();
+                cipher.encipher_inplace(&mut expected);
+                assert_eq!(&expected[..], &buffer[offset..offset + len]);
+                // Bytes after the terminator are read but never written.
+                assert!(buffer[offset + len + 1..].iter().all(|&b| b == b'x'));
+
+                assert_eq!(len, unsafe { decipher_cstr(&cipher, s) });
+                assert_eq!(&text[..], &buffer[offset..offset + len]);
+            }
+        }
+    }
+}
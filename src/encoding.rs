@@ -0,0 +1,540 @@
+//! Ciphering fused with hex or base64 encoding, for ciphertext that travels
+//! through text-only transports.
+
+use super::PureCipher;
+use super::substitution::ALL_U8;
+
+/// Number of plaintext bytes enciphered and encoded at a time. It is a
+/// multiple of three, so that only the final chunk of base64 is padded.
+const ENCODE_CHUNK: usize = 3 * 1024;
+
+/// Number of characters decoded and deciphered at a time. It is a multiple of
+/// four, so that chunks of base64 hold whole quads.
+const DECODE_CHUNK: usize = 4 * 1024;
+
+/// Number of bytes before the enciphered bytes of a chunk in the scratch
+/// buffer. The vectorized base64 encoder loads each block of input from four
+/// bytes before it.
+const SCRATCH_PADDING: usize = 4;
+
+/// Marks bytes outside an alphabet in the decoding tables.
+const INVALID: u8 = 0xff;
+
+static HEX_DIGITS: &[u8; 16] = b"0123456789abcdef";
+
+static BASE64_DIGITS: &[u8; 64] = b"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static HEX_VALUES: [u8; ALL_U8] = {
+    let mut values = [INVALID; ALL_U8];
+    let mut i = 0;
+    while i < 16 {
+        values[HEX_DIGITS[i] as usize] = i as u8;
+        values[HEX_DIGITS[i].to_ascii_uppercase() as usize] = i as u8;
+        i += 1;
+    }
+    values
+};
+
+static BASE64_VALUES: [u8; ALL_U8] = {
+    let mut values = [INVALID; ALL_U8];
+    let mut i = 0;
+    while i < 64 {
+        values[BASE64_DIGITS[i] as usize] = i as u8;
+        i += 1;
+    }
+    values
+};
+
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+/// Encoding of bytes as ASCII text.
+pub enum TextEncoding {
+    /// Two lowercase hexadecimal digits per byte. Uppercase digits are also
+    /// accepted when decoding.
+    Hex,
+    /// Standard base64 with padding, as in RFC 4648.
+    Base64,
+}
+
+impl TextEncoding {
+    /// Returns the length of the text encoding `length` bytes.
+    pub fn encoded_len(self, length: usize) -> usize {
+        match self {
+            TextEncoding::Hex => 2 * length,
+            TextEncoding::Base64 => (length + 2) / 3 * 4,
+        }
+    }
+
+    /// Returns the number of bytes encoded by `text`, or `None` if its length
+    /// is not that of any encoded bytes. The characters themselves are not
+    /// checked.
+    pub fn decoded_len(self, text: &[u8]) -> Option<usize> {
+        match self {
+            TextEncoding::Hex if text.len() % 2 == 0 => Some(text.len() / 2),
+            TextEncoding::Base64 if text.len() % 4 == 0 => {
+                let padding = text.iter().rev().take(2).take_while(|&&c| c == b'=').count();
+                Some(text.len() / 4 * 3 - padding)
+            }
+            _ => None,
+        }
+    }
+}
+
+/// Enciphers `bytes` with the given cipher and writes the ciphertext to `text`
+/// in the given encoding, in a single pass. Returns the length of the text.
+///
+/// The bytes are enciphered a chunk at a time into a buffer on the stack, from
+/// which the chunk is encoded while still in L1 cache, so neither the
+/// ciphertext nor the text is ever allocated.
+///
+/// # Panics
+/// Panics if `text` is shorter than `encoding.encoded_len(bytes.len())`.
+///
+/// # Example
+/// ```
+/// use purecipher::TextEncoding;
+///
+/// let cipher = purecipher::caesar();
+/// let mut text = [0; 8];
+/// let length = purecipher::encipher_encode(&cipher, TextEncoding::Base64, b"abcd", &mut text);
+///
+/// assert_eq!(b"ZGVmZw==", &text[..length]);
+/// ```
+pub fn encipher_encode(cipher: &dyn PureCipher, encoding: TextEncoding, bytes: &[u8], text: &mut [u8]) -> usize {
+    let length = encoding.encoded_len(bytes.len());
+    assert!(text.len() >= length, "text buffer too short for {} encoded bytes", bytes.len());
+
+    let mut scratch = [0; SCRATCH_PADDING + ENCODE_CHUNK];
+    let mut offset = 0;
+    for chunk in bytes.chunks(ENCODE_CHUNK) {
+        let padded = &mut scratch[..SCRATCH_PADDING + chunk.len()];
+        padded[SCRATCH_PADDING..].copy_from_slice(chunk);
+        cipher.encipher_inplace(&mut padded[SCRATCH_PADDING..]);
+
+        let encoded = encoding.encoded_len(chunk.len());
+        encode(encoding, padded, &mut text[offset..offset + encoded]);
+        offset += encoded;
+    }
+    length
+}
+
+/// Decodes `text` in the given encoding and deciphers the result with the
+/// given cipher into `bytes`, in a single pass. Returns the number of bytes
+/// written, or `None` if `text` is not valid in the encoding or `bytes` is too
+/// short to hold the result, in which case the contents of `bytes` are
+/// unspecified.
+///
+/// # Example
+/// ```
+/// use purecipher::TextEncoding;
+///
+/// let cipher = purecipher::caesar();
+/// let mut bytes = [0; 4];
+///
+/// assert_eq!(Some(4), purecipher::decode_decipher(&cipher, TextEncoding::Hex, b"6465666A", &mut bytes));
+/// assert_eq!(b"abcg", &bytes);
+/// assert_eq!(None, purecipher::decode_decipher(&cipher, TextEncoding::Hex, b"6x", &mut bytes));
+/// ```
+pub fn decode_decipher(cipher: &dyn PureCipher, encoding: TextEncoding, text: &[u8], bytes: &mut [u8]) -> Option<usize> {
+    let length = encoding.decoded_len(text)?;
+    if bytes.len() < length {
+        return None;
+    }
+
+    let mut offset = 0;
+    let mut chunks = text.chunks(DECODE_CHUNK).peekable();
+    while let Some(chunk) = chunks.next() {
+        let last = chunks.peek().is_none();
+        let decoded = if last { length - offset } else { encoding.decoded_len(chunk)? };
+        let out = &mut bytes[offset..offset + decoded];
+        if !decode(encoding, chunk, out, last) {
+            return None;
+        }
+        cipher.decipher_inplace(out);
+        offset += decoded;
+    }
+    Some(length)
+}
+
+/// Encodes the bytes that follow the `SCRATCH_PADDING` bytes of `padded`
+/// into `out`, which has exactly the length of their encoding.
+fn encode(encoding: TextEncoding, padded: &[u8], out: &mut [u8]) {
+    let input = &padded[SCRATCH_PADDING..];
+    #[allow(unused_mut)]
+    let mut done = 0;
+    #[cfg(target_arch = "x86_64")]
+    {
+        if is_x86_feature_detected!("avx2") {
+            done = unsafe {
+                match encoding {
+                    TextEncoding::Hex => encode_hex_avx2(input, out),
+                    TextEncoding::Base64 => encode_base64_avx2(padded, out),
+                }
+            };
+        }
+    }
+    match encoding {
+        TextEncoding::Hex => encode_hex(&input[done..], &mut out[2 * done..]),
+        TextEncoding::Base64 => encode_base64(&input[done..], &mut out[done / 3 * 4..]),
+    }
+}
+
+/// Decodes `text` into `out`, which has exactly the length of the decoded
+/// bytes. Base64 padding is only accepted if `last` is set, as the text is the
+/// end of the input. Returns whether the text was valid.
+fn decode(encoding: TextEncoding, text: &[u8], out: &mut [u8], last: bool) -> bool {
+    #[allow(unused_mut)]
+    let mut done = 0;
+    #[cfg(target_arch = "x86_64")]
+    {
+        if is_x86_feature_detected!("avx2") {
+            done = unsafe {
+                match encoding {
+                    TextEncoding::Hex => decode_hex_avx2(text, out),
+                    TextEncoding::Base64 => decode_base64_avx2(text, out),
+                }
+            };
+        }
+    }
+    match encoding {
+        TextEncoding::Hex => decode_hex(&text[done..], &mut out[done / 2..]),
+        TextEncoding::Base64 => decode_base64(&text[done..], &mut out[done / 4 * 3..], last),
+    }
+}
+
+fn encode_hex(input: &[u8], out: &mut [u8]) {
+    for (&b, pair) in input.iter().zip(out.chunks_exact_mut(2)) {
+        pair[0] = HEX_DIGITS[(b >> 4) as usize];
+        pair[1] = HEX_DIGITS[(b & 0xf) as usize];
+    }
+}
+
+fn decode_hex(text: &[u8], out: &mut [u8]) -> bool {
+    let mut invalid = 0;
+    for (pair, b) in text.chunks_exact(2).zip(out.iter_mut()) {
+        let (high, low) = (HEX_VALUES[pair[0] as usize], HEX_VALUES[pair[1] as usize]);
+        invalid |= high | low;
+        *b = high << 4 | low;
+    }
+    // Valid digits never set the high bits that INVALID does.
+    invalid & 0xf0 == 0
+}
+
+fn encode_base64(input: &[u8], out: &mut [u8]) {
+    let mut triples = input.chunks_exact(3);
+    let mut quads = out.chunks_exact_mut(4);
+    for (triple, quad) in (&mut triples).zip(&mut quads) {
+        let word = (triple[0] as u32) << 16 | (triple[1] as u32) << 8 | triple[2] as u32;
+        for (k, c) in quad.iter_mut().enumerate() {
+            *c = BASE64_DIGITS[(word >> (18 - 6 * k) & 0x3f) as usize];
+        }
+    }
+    let rest = triples.remainder();
+    if let Some(quad) = quads.next() {
+        let word = rest.iter().enumerate().fold(0, |word, (k, &b)| word | (b as u32) << (16 - 8 * k));
+        for (k, c) in quad.iter_mut().enumerate() {
+            *c = if k <= rest.len() { BASE64_DIGITS[(word >> (18 - 6 * k) & 0x3f) as usize] } else { b'=' };
+        }
+    }
+}
+
+fn decode_base64(text: &[u8], out: &mut [u8], last: bool) -> bool {
+    let quads = text.len() / 4;
+    for (q, quad) in text.chunks_exact(4).enumerate() {
+        let padding = if last && q + 1 == quads {
+            quad.iter().rev().take(2).take_while(|&&c| c == b'=').count()
+        } else {
+            0
+        };
+        let mut word = 0;
+        for &c in &quad[..4 - padding] {
+            let value = BASE64_VALUES[c as usize];
+            if value == INVALID {
+                return false;
+            }
+            word = word << 6 | value as u32;
+        }
+        word <<= 6 * padding;
+        for (k, b) in out[3 * q..3 * q + 3 - padding].iter_mut().enumerate() {
+            *b = (word >> (16 - 8 * k)) as u8;
+        }
+    }
+    true
+}
+
+/// Hex encodes blocks of 32 bytes of `input` into `out`, returning the number
+/// of bytes encoded.
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "avx2")]
+unsafe fn encode_hex_avx2(input: &[u8], out: &mut [u8]) -> usize {
+    use std::arch::x86_64::*;
+
+    let digits = _mm256_broadcastsi128_si256(_mm_loadu_si128(HEX_DIGITS.as_ptr() as *const __m128i));
+    let nibble = _mm256_set1_epi8(0x0f);
+    let mut i = 0;
+    while input.len() - i >= 32 {
+        let block = _mm256_loadu_si256(input.as_ptr().add(i) as *const __m256i);
+        let high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+        let low = _mm256_shuffle_epi8(digits, _mm256_and_si256(block, nibble));
+        // Interleaving works within each 128-bit lane, so the halves of the
+        // two results are swapped back into order.
+        let first = _mm256_unpacklo_epi8(high, low);
+        let second = _mm256_unpackhi_epi8(high, low);
+        let dst = out.as_mut_ptr().add(2 * i) as *mut __m256i;
+        _mm256_storeu_si256(dst, _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(dst.add(1), _mm256_permute2x128_si256(first, second, 0x31));
+        i += 32;
+    }
+    i
+}
+
+/// Decodes blocks of 64 hex digits of `text` into `out`, returning the number
+/// of digits decoded. Decoding stops early at the first block holding any
+/// other character, which is left to the scalar decoder to reject.
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "avx2")]
+unsafe fn decode_hex_avx2(text: &[u8], out: &mut [u8]) -> usize {
+    use std::arch::x86_64::*;
+
+    // Multiplies the high digit of each pair by 16 and adds the low digit.
+    let weights = _mm256_set1_epi16(0x0110);
+    let mut i = 0;
+    while text.len() - i >= 64 {
+        let (high, high_valid) = hex_values_avx2(_mm256_loadu_si256(text.as_ptr().add(i) as *const __m256i));
+        let (low, low_valid) = hex_values_avx2(_mm256_loadu_si256(text.as_ptr().add(i + 32) as *const __m256i));
+        if _mm256_movemask_epi8(_mm256_and_si256(high_valid, low_valid)) != -1 {
+            break;
+        }
+        let packed = _mm256_packus_epi16(_mm256_maddubs_epi16(high, weights), _mm256_maddubs_epi16(low, weights));
+        _mm256_storeu_si256(out.as_mut_ptr().add(i / 2) as *mut __m256i, _mm256_permute4x64_epi64(packed, 0xd8));
+        i += 64;
+    }
+    i
+}
+
+/// Returns the value of each hex digit of `block`, and a mask of the bytes
+/// that are hex digits.
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "avx2")]
+unsafe fn hex_values_avx2(block: std::arch::x86_64::__m256i) -> (std::arch::x86_64::__m256i, std::arch::x86_64::__m256i) {
+    use std::arch::x86_64::*;
+
+    // Subtracting the first character of a range wraps everything below the
+    // range around above it, so one unsigned comparison checks both bounds.
+    let digit = _mm256_sub_epi8(block, _mm256_set1_epi8(b'0' as i8));
+    let is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+    let letter = _mm256_sub_epi8(_mm256_or_si256(block, _mm256_set1_epi8(0x20)), _mm256_set1_epi8(b'a' as i8));
+    let is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+    let value = _mm256_blendv_epi8(_mm256_add_epi8(letter, _mm256_set1_epi8(10)), digit, is_digit);
+    (value, _mm256_or_si256(is_digit, is_letter))
+}
+
+/// Base64 encodes blocks of 24 bytes of the bytes that follow the
+/// `SCRATCH_PADDING` bytes of `padded` into `out`, returning the number of
+/// bytes encoded.
+///
+/// This is the AVX2 encoder of Muła and Lemire. Each block is loaded from four
+/// bytes before it, so that its two halves of twelve bytes lie in separate
+/// 128-bit lanes.
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "avx2")]
+unsafe fn encode_base64_avx2(padded: &[u8], out: &mut [u8]) -> usize {
+    use std::arch::x86_64::*;
+
+    let input_len = padded.len() - SCRATCH_PADDING;
+    // Offsets to add to each 6-bit value, indexed by the range it falls in.
+    let offsets = _mm256_setr_epi8(
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+    );
+    let mut i = 0;
+    while input_len - i >= 28 {
+        let block = _mm256_loadu_si256(padded.as_ptr().add(i) as *const __m256i);
+        // Gather each three bytes into a 32-bit word and split its 24 bits
+        // into four bytes of six.
+        let words = _mm256_shuffle_epi8(block, _mm256_set_epi8(
+            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+            14, 15, 13, 14, 11, 12, 10, 11, 8, 9, 7, 8, 5, 6, 4, 5,
+        ));
+        let high = _mm256_mulhi_epu16(
+            _mm256_and_si256(words, _mm256_set1_epi32(0x0fc0_fc00)),
+            _mm256_set1_epi32(0x0400_0040),
+        );
+        let low = _mm256_mullo_epi16(
+            _mm256_and_si256(words, _mm256_set1_epi32(0x003f_03f0)),
+            _mm256_set1_epi32(0x0100_0010),
+        );
+        let values = _mm256_or_si256(high, low);
+
+        let mut ranges = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+        ranges = _mm256_sub_epi8(ranges, _mm256_cmpgt_epi8(values, _mm256_set1_epi8(25)));
+        let chars = _mm256_add_epi8(values, _mm256_shuffle_epi8(offsets, ranges));
+        _mm256_storeu_si256(out.as_mut_ptr().add(i / 3 * 4) as *mut __m256i, chars);
+        i += 24;
+    }
+    i
+}
+
+/// Decodes blocks of 32 base64 characters of `text` into `out`, returning the
+/// number of characters decoded. Decoding stops early at the first block
+/// holding any other character, and before the final quad, which is left to
+/// the scalar decoder along with any padding.
+///
+/// This is the AVX2 decoder of Muła and Lemire, validating with the lookups
+/// of aqrit. Each block stores 32 bytes of which 24 are decoded, so blocks
+/// are only decoded while at least 45 characters remain, which decode to more
+/// than the eight bytes stored past the end of the block.
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "avx2")]
+unsafe fn decode_base64_avx2(text: &[u8], out: &mut [u8]) -> usize {
+    use std::arch::x86_64::*;
+
+    // Flags of the characters allowed for each low and high nibble. A
+    // character is valid if its two flags have no bit in common.
+    let low_flags = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+    );
+    let high_flags = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+    );
+    // Offsets from each character to its value, indexed by its high nibble,
+    // or by one for '/'.
+    let offsets = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+    );
+    let slash = _mm256_set1_epi8(0x2f);
+    let mut i = 0;
+    while text.len() - i >= 45 {
+        let block = _mm256_loadu_si256(text.as_ptr().add(i) as *const __m256i);
+        let high_nibbles = _mm256_and_si256(_mm256_srli_epi32(block, 4), slash);
+        let low = _mm256_shuffle_epi8(low_flags, _mm256_and_si256(block, slash));
+        let high = _mm256_shuffle_epi8(high_flags, high_nibbles);
+        if _mm256_testz_si256(low, high) == 0 {
+            break;
+        }
+        let index = _mm256_add_epi8(_mm256_cmpeq_epi8(block, slash), high_nibbles);
+        let values = _mm256_add_epi8(block, _mm256_shuffle_epi8(offsets, index));
+
+        // Merge the four 6-bit values of each 32-bit word into 24 bits, then
+        // pack the three bytes of each word together.
+        let pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x0140_0140));
+        let words = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x0001_1000));
+        let packed = _mm256_shuffle_epi8(words, _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        ));
+        let bytes = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1));
+        debug_assert!(i / 4 * 3 + 32 <= out.len());
+        _mm256_storeu_si256(out.as_mut_ptr().add(i / 4 * 3) as *mut __m256i, bytes);
+        i += 32;
+    }
+    i
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::{encipher_bytes, leet_speak, NullCipher};
+
+    fn test_bytes(len: usize) -> Vec<u8> {
+        (0..len).map(|i| (i.wrapping_mul(2_654_435_761) >> 13) as u8).collect()
+    }
+
+    fn encoded(encoding: TextEncoding, bytes: &[u8]) -> Vec<u8> {
+        let mut text = vec![0; encoding.encoded_len(bytes.len())];
+        let length = encipher_encode(&NullCipher, encoding, bytes, &mut text);
+        assert_eq!(text.len(), length);
+        text
+    }
+
+    fn decoded(encoding: TextEncoding, text: &[u8]) -> Option<Vec<u8>> {
+        let mut bytes = vec![0; encoding.decoded_len(text)?];
+        decode_decipher(&NullCipher, encoding, text, &mut bytes).map(|_| bytes)
+    }
+
+    #[test]
+    fn encodings_match_rfc_4648() {
+        let vectors: &[(&str, &str, &str)] = &[
+            ("", "", ""),
+            ("f", "66", "Zg=="),
+            ("fo", "666f", "Zm8="),
+            ("foo", "666f6f", "Zm9v"),
+            ("foob", "666f6f62", "Zm9vYg=="),
+            ("fooba", "666f6f6261", "Zm9vYmE="),
+            ("foobar", "666f6f626172", "Zm9vYmFy"),
+        ];
+        for &(bytes, hex, base64) in vectors {
+            assert_eq!(hex.as_bytes(), &encoded(TextEncoding::Hex, bytes.as_bytes())[..]);
+            assert_eq!(base64.as_bytes(), &encoded(TextEncoding::Base64, bytes.as_bytes())[..]);
+            assert_eq!(Some(bytes.as_bytes().to_vec()), decoded(TextEncoding::Hex, hex.as_bytes()));
+            assert_eq!(Some(bytes.as_bytes().to_vec()), decoded(TextEncoding::Base64, base64.as_bytes()));
+        }
+        assert_eq!(Some(vec![0xab, 0xcd]), decoded(TextEncoding::Hex, b"AbCd"));
+    }
+
+    #[test]
+    fn encodings_round_trip_every_length() {
+        // Lengths around the block sizes of the vectorized kernels and the
+        // chunk sizes exercise every boundary between them.
+        let bytes = test_bytes(3 * ENCODE_CHUNK + 100);
+        let hex_reference: Vec<u8> = bytes.iter()
+            .flat_map(|&b| vec![HEX_DIGITS[(b >> 4) as usize], HEX_DIGITS[(b & 0xf) as usize]])
+            .collect();
+        let lengths = (0..100).chain(ENCODE_CHUNK - 40..ENCODE_CHUNK + 40).chain(Some(bytes.len()));
+        for len in lengths {
+            let input = &bytes[..len];
+            let hex = encoded(TextEncoding::Hex, input);
+            assert_eq!(&hex_reference[..2 * len], &hex[..]);
+            assert_eq!(Some(input.to_vec()), decoded(TextEncoding::Hex, &hex));
+
+            let mut base64 = encoded(TextEncoding::Base64, input);
+            let mut reference = vec![0; base64.len()];
+            encode_base64(input, &mut reference);
+            assert_eq!(reference, base64, "length {}", len);
+            assert_eq!(Some(input.to_vec()), decoded(TextEncoding::Base64, &base64));
+
+            // Corrupt a character, which lies in a vectorized block for
+            // longer inputs, and check that decoding fails.
+            if let Some(c) = base64.get_mut(len / 2) {
+                *c = b'*';
+                assert_eq!(None, decoded(TextEncoding::Base64, &base64));
+            }
+        }
+    }
+
+    #[test]
+    fn decoding_rejects_invalid_text() {
+        let hex = encoded(TextEncoding::Hex, &test_bytes(500));
+        for &(position, c) in &[(0, b'g'), (63, b' '), (64, b'G'), (999, b'/'), (300, 0xc0)] {
+            let mut corrupt = hex.clone();
+            corrupt[position] = c;
+            assert_eq!(None, decoded(TextEncoding::Hex, &corrupt));
+        }
+        assert_eq!(None, decoded(TextEncoding::Hex, b"abc"));
+
+        for text in &[&b"Zm9"[..], b"Zg=a", b"Z===", b"Zg==Zg==", b"Zm9v-mFy"] {
+            assert_eq!(None, decoded(TextEncoding::Base64, text));
+        }
+        let mut bytes = [0; 1];
+        assert_eq!(None, decode_decipher(&NullCipher, TextEncoding::Hex, b"abcd", &mut bytes));
+    }
+
+    #[test]
+    fn fused_matches_separate_passes() {
+        let leet = leet_speak();
+        let plaintext = test_bytes(ENCODE_CHUNK + 1000);
+        let ciphertext = encipher_bytes(&leet, &plaintext);
+
+        for &encoding in &[TextEncoding::Hex, TextEncoding::Base64] {
+            let mut text = vec![0; encoding.encoded_len(plaintext.len())];
+            encipher_encode(&leet, encoding, &plaintext, &mut text);
+            assert_eq!(encoded(encoding, &ciphertext), text);
+
+            let mut bytes = vec![0; plaintext.len()];
+            assert_eq!(Some(plaintext.len()), decode_decipher(&leet, encoding, &text, &mut bytes));
+            assert_eq!(plaintext, bytes);
+        }
+    }
+}
@@ -2,104 +2,1488 @@
 //!
 //! See the associated C header file for interface documentation.
 
+// `CipherObject` holds a Rust fat pointer, which the C header mirrors as the
+// two-word `purecipher_obj_t` that C code only ever passes back to this crate.
+#![allow(improper_ctypes_definitions)]
+
+use std::cmp::Ordering;
+use std::ptr;
 use std::slice;
 use std::ffi::CStr;
+use std::time::Duration;
+
+use libc::{c_char, c_int, size_t, int32_t};
+
+use super::{PureCipher, SubstitutionBuilder, SubstitutionCipher, ByteHistogram, NullCipher, PeriodicCipher};
+use super::{AffineCipher, FieldSelector};
+use super::batch;
+use super::cstr;
+use super::strided::{self, RecordField};
+use super::{CipherArena, CipherPool, PoolBatch};
+use super::{WideSubstitutionBuilder, WideSubstitutionCipher};
+use super::SwappableCipher;
+use super::{SharedCipher, SHARED_TABLES_LEN};
+use super::{NgramModel, Solver};
+use super::{Finder, MultiFinder, PatternMatch};
+use super::PlaintextOrder;
+use super::checksum::{self, Checksummed};
+use super::encoding::{self, TextEncoding};
+use super::pool::{Direction, RawJob};
+use super::context::{Callback, CipherContext, Submission};
+#[cfg(target_os = "linux")]
+use super::{CipherClient, CipherService};
+
+#[repr(C)]
+#[derive(Copy, Clone, Eq, PartialEq)]
+/// Type for PureCipher trait object pointers to be passed over ffi.
+pub struct CipherObject {
+    /// Fat pointer to cipher trait object.
+    ptr: *const dyn PureCipher,
+}
+
+#[repr(C)]
+/// Buffer to be ciphered by a pool, as passed over ffi.
+pub struct PoolJob {
+    cipher: CipherObject,
+    buffer: *mut u8,
+    length: size_t,
+}
+
+#[repr(C)]
+/// Buffer to be ciphered asynchronously by a context, as passed over ffi.
+pub struct SubmissionObject {
+    cipher: CipherObject,
+    buffer: *mut u8,
+    length: size_t,
+    decipher: c_int,
+    user_data: u64,
+    callback: Option<Callback>,
+}
+
+#[repr(C)]
+/// Completed submission reaped from a context, as passed over ffi.
+pub struct CompletionObject {
+    user_data: u64,
+}
+
+impl CipherObject {
+    /// Cipher object that does not refer to any cipher.
+    ///
+    /// This value is returned when a cipher cannot be constructed from the
+    /// arguments of an ffi call.
+    fn null() -> Self {
+        CipherObject { ptr: ptr::null::<NullCipher>() as *const dyn PureCipher }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_free(cipher: CipherObject) {
+    if cipher.ptr.is_null() {
+        return;
+    }
+    unsafe {
+        Box::from_raw(cipher.ptr as *mut PureCipher);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_encipher_buffer(cipher: CipherObject, buffer: *mut u8, length: size_t) {
+    if cipher.ptr.is_null() || buffer.is_null() {
+        return;
+    }
+
+    let cipher_ref = unsafe { &*cipher.ptr };
+    let slice = unsafe {
+        slice::from_raw_parts_mut(buffer, length)
+    };
+
+    cipher_ref.encipher_inplace(slice)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_decipher_buffer(cipher: CipherObject, buffer: *mut u8, length: size_t) {
+    if cipher.ptr.is_null() || buffer.is_null() {
+        return;
+    }
+
+    let cipher_ref = unsafe { &*cipher.ptr };
+    let slice = unsafe {
+        slice::from_raw_parts_mut(buffer, length)
+    };
+
+    cipher_ref.decipher_inplace(slice)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_encipher_str(cipher: CipherObject, s: *mut c_char) -> size_t {
+    if s.is_null() {
+        return 0;
+    }
+    if cipher.ptr.is_null() {
+        return unsafe { CStr::from_ptr(s) }.to_bytes().len();
+    }
+    // Trailing null byte is not encoded.
+    unsafe { cstr::encipher_cstr(&*cipher.ptr, s as *mut u8) }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_decipher_str(cipher: CipherObject, s: *mut c_char) -> size_t {
+    if s.is_null() {
+        return 0;
+    }
+    if cipher.ptr.is_null() {
+        return unsafe { CStr::from_ptr(s) }.to_bytes().len();
+    }
+    // Trailing null byte is not decoded.
+    unsafe { cstr::decipher_cstr(&*cipher.ptr, s as *mut u8) }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_encipher_batch(
+    ciphers: *const CipherObject,
+    arena: *mut u8,
+    offsets: *const size_t,
+    count: size_t,
+) {
+    if let Some((cipher_refs, arena, offsets)) = unsafe { batch_parts(ciphers, arena, offsets, count) } {
+        batch::encipher_batch(&cipher_refs, arena, offsets)
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_decipher_batch(
+    ciphers: *const CipherObject,
+    arena: *mut u8,
+    offsets: *const size_t,
+    count: size_t,
+) {
+    if let Some((cipher_refs, arena, offsets)) = unsafe { batch_parts(ciphers, arena, offsets, count) } {
+        batch::decipher_batch(&cipher_refs, arena, offsets)
+    }
+}
+
+/// Converts the raw arguments of a batch ciphering call into slices.
+///
+/// Returns `None` if any pointer is null or if the offsets do not describe
+/// `count` records within the arena, in which case the arena must be left
+/// unchanged.
+unsafe fn batch_parts<'a>(
+    ciphers: *const CipherObject,
+    arena: *mut u8,
+    offsets: *const size_t,
+    count: size_t,
+) -> Option<(Vec<&'a dyn PureCipher>, &'a mut [u8], &'a [usize])> {
+    if ciphers.is_null() || offsets.is_null() || (arena.is_null() && count > 0) {
+        return None;
+    }
+    let ciphers = slice::from_raw_parts(ciphers, count);
+    if ciphers.iter().any(|c| c.ptr.is_null()) {
+        return None;
+    }
+    let offsets = slice::from_raw_parts(offsets, count + 1);
+    let arena_len = offsets[count];
+    if !batch::check_offsets(count, arena_len, offsets) {
+        return None;
+    }
+    let arena = if arena.is_null() { &mut [][..] } else { slice::from_raw_parts_mut(arena, arena_len) };
+    Some((ciphers.iter().map(|c| &*c.ptr).collect(), arena, offsets))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_encipher_strided(
+    cipher: CipherObject,
+    base: *mut u8,
+    field_len: size_t,
+    stride: size_t,
+    count: size_t,
+) {
+    let field = RecordField { offset: 0, length: field_len };
+    purecipher_encipher_fields(cipher, base, stride, count, &field, 1)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_decipher_strided(
+    cipher: CipherObject,
+    base: *mut u8,
+    field_len: size_t,
+    stride: size_t,
+    count: size_t,
+) {
+    let field = RecordField { offset: 0, length: field_len };
+    purecipher_decipher_fields(cipher, base, stride, count, &field, 1)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_encipher_fields(
+    cipher: CipherObject,
+    records: *mut u8,
+    stride: size_t,
+    count: size_t,
+    fields: *const RecordField,
+    field_count: size_t,
+) {
+    if let Some((records, fields)) = unsafe { fields_parts(cipher, records, stride, count, fields, field_count) } {
+        strided::encipher_fields(unsafe { &*cipher.ptr }, records, stride, count, fields)
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_decipher_fields(
+    cipher: CipherObject,
+    records: *mut u8,
+    stride: size_t,
+    count: size_t,
+    fields: *const RecordField,
+    field_count: size_t,
+) {
+    if let Some((records, fields)) = unsafe { fields_parts(cipher, records, stride, count, fields, field_count) } {
+        strided::decipher_fields(unsafe { &*cipher.ptr }, records, stride, count, fields)
+    }
+}
+
+/// Converts the raw arguments of a field ciphering call into slices.
+///
+/// Returns `None` if any pointer is null or if the fields are invalid, in which
+/// case the records must be left unchanged. The records are taken to extend
+/// exactly to the end of the last field of the last record.
+unsafe fn fields_parts<'a>(
+    cipher: CipherObject,
+    records: *mut u8,
+    stride: size_t,
+    count: size_t,
+    fields: *const RecordField,
+    field_count: size_t,
+) -> Option<(&'a mut [u8], &'a [RecordField])> {
+    if cipher.ptr.is_null() || fields.is_null() || records.is_null() {
+        return None;
+    }
+    let fields = slice::from_raw_parts(fields, field_count);
+    let end = fields.iter()
+        .map(|f| f.offset.checked_add(f.length))
+        .fold(Some(0), |end, f_end| end.and_then(|e| f_end.map(|f| e.max(f))))?;
+    let len = match count {
+        0 => 0,
+        _ => (count - 1).checked_mul(stride)?.checked_add(end)?,
+    };
+    if !strided::check_fields(len, stride, count, fields) {
+        return None;
+    }
+    Some((slice::from_raw_parts_mut(records, len), fields))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_selector_new(delimiter: u8) -> *mut FieldSelector {
+    Box::into_raw(Box::new(FieldSelector::new(delimiter)))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_selector_free(selector: *mut FieldSelector) {
+    if selector.is_null() {
+        return;
+    }
+    unsafe {
+        drop(Box::from_raw(selector));
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_selector_quote(selector: *mut FieldSelector, quote: u8) {
+    let selector_ref = unsafe { &mut *selector };
+    selector_ref.set_quote(quote)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_selector_column(selector: *mut FieldSelector, column: size_t) {
+    let selector_ref = unsafe { &mut *selector };
+    selector_ref.select_column(column)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_selector_key(selector: *mut FieldSelector, key: *const c_char) {
+    if key.is_null() {
+        return;
+    }
+    let selector_ref = unsafe { &mut *selector };
+    selector_ref.select_key(unsafe { CStr::from_ptr(key) }.to_bytes())
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_selector_encipher(
+    selector: *const FieldSelector,
+    cipher: CipherObject,
+    text: *mut u8,
+    length: size_t,
+) {
+    if selector.is_null() || cipher.ptr.is_null() || text.is_null() {
+        return;
+    }
+    let text = unsafe { slice::from_raw_parts_mut(text, length) };
+    unsafe { &*selector }.encipher(unsafe { &*cipher.ptr }, text)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_selector_decipher(
+    selector: *const FieldSelector,
+    cipher: CipherObject,
+    text: *mut u8,
+    length: size_t,
+) {
+    if selector.is_null() || cipher.ptr.is_null() || text.is_null() {
+        return;
+    }
+    let text = unsafe { slice::from_raw_parts_mut(text, length) };
+    unsafe { &*selector }.decipher(unsafe { &*cipher.ptr }, text)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_histogram(buffer: *const u8, length: size_t, counts: *mut u64) {
+    if counts.is_null() || (buffer.is_null() && length > 0) {
+        return;
+    }
+    let bytes = if buffer.is_null() { &[][..] } else { unsafe { slice::from_raw_parts(buffer, length) } };
+    let counts = unsafe { &mut *(counts as *mut [u64; 256]) };
+
+    *counts = *ByteHistogram::from_bytes(bytes).counts();
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_histogram_plaintext(
+    cipher: CipherObject,
+    buffer: *const u8,
+    length: size_t,
+    counts: *mut u64,
+) {
+    if cipher.ptr.is_null() || counts.is_null() || (buffer.is_null() && length > 0) {
+        return;
+    }
+    let cipher_ref = unsafe { &*cipher.ptr };
+    let bytes = if buffer.is_null() { &[][..] } else { unsafe { slice::from_raw_parts(buffer, length) } };
+    let counts = unsafe { &mut *(counts as *mut [u64; 256]) };
+
+    *counts = *ByteHistogram::from_bytes(bytes).deciphered(cipher_ref).counts();
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_histogram_entropy(counts: *const u64) -> f64 {
+    if counts.is_null() {
+        return 0.0;
+    }
+    let counts = unsafe { *(counts as *const [u64; 256]) };
+    ByteHistogram::from_counts(counts).entropy()
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_histogram_chi_square(counts: *const u64, expected: *const f64) -> f64 {
+    if counts.is_null() || expected.is_null() {
+        return 0.0;
+    }
+    let counts = unsafe { *(counts as *const [u64; 256]) };
+    let expected = unsafe { &*(expected as *const [f64; 256]) };
+    ByteHistogram::from_counts(counts).chi_square(expected)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_crc32c(crc: u32, buffer: *const u8, length: size_t) -> u32 {
+    match unsafe { slice_or_empty(buffer, length) } {
+        Some(bytes) => checksum::crc32c(crc, bytes),
+        None => crc,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_crc32c_combine(crc1: u32, crc2: u32, length2: u64) -> u32 {
+    checksum::crc32c_combine(crc1, crc2, length2)
+}
+
+/// Selects the side of a cipher checksummed by a fused cipher and CRC pass.
+fn checksummed(checksum_ciphertext: c_int) -> Checksummed {
+    if checksum_ciphertext != 0 { Checksummed::Ciphertext } else { Checksummed::Plaintext }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_encipher_buffer_crc32c(
+    cipher: CipherObject,
+    buffer: *mut u8,
+    length: size_t,
+    crc: u32,
+    checksum_ciphertext: c_int,
+) -> u32 {
+    if cipher.ptr.is_null() || buffer.is_null() {
+        return crc;
+    }
+    let cipher_ref = unsafe { &*cipher.ptr };
+    let slice = unsafe { slice::from_raw_parts_mut(buffer, length) };
+    checksum::encipher_crc32c(cipher_ref, slice, crc, checksummed(checksum_ciphertext))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_decipher_buffer_crc32c(
+    cipher: CipherObject,
+    buffer: *mut u8,
+    length: size_t,
+    crc: u32,
+    checksum_ciphertext: c_int,
+) -> u32 {
+    if cipher.ptr.is_null() || buffer.is_null() {
+        return crc;
+    }
+    let cipher_ref = unsafe { &*cipher.ptr };
+    let slice = unsafe { slice::from_raw_parts_mut(buffer, length) };
+    checksum::decipher_crc32c(cipher_ref, slice, crc, checksummed(checksum_ciphertext))
+}
+
+/// Selects the text encoding identified by one of the `PURECIPHER_ENCODING_*`
+/// constants of the C header.
+fn text_encoding(encoding: c_int) -> Option<TextEncoding> {
+    match encoding {
+        0 => Some(TextEncoding::Hex),
+        1 => Some(TextEncoding::Base64),
+        _ => None,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_encoded_length(encoding: c_int, length: size_t) -> size_t {
+    text_encoding(encoding).map_or(0, |encoding| encoding.encoded_len(length))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_decoded_length(encoding: c_int, text: *const c_char, length: size_t) -> i64 {
+    let text = unsafe { slice_or_empty(text as *const u8, length) };
+    match (text_encoding(encoding), text) {
+        (Some(encoding), Some(text)) => encoding.decoded_len(text).map_or(-1, |length| length as i64),
+        _ => -1,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_encipher_encode(
+    cipher: CipherObject,
+    encoding: c_int,
+    buffer: *const u8,
+    length: size_t,
+    text: *mut c_char,
+    capacity: size_t,
+) -> size_t {
+    let bytes = unsafe { slice_or_empty(buffer, length) };
+    match (text_encoding(encoding), bytes) {
+        (Some(encoding), Some(bytes)) if !cipher.ptr.is_null() && !text.is_null() => {
+            if capacity < encoding.encoded_len(length) {
+                return 0;
+            }
+            let text = unsafe { slice::from_raw_parts_mut(text as *mut u8, capacity) };
+            encoding::encipher_encode(unsafe { &*cipher.ptr }, encoding, bytes, text)
+        }
+        _ => 0,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_decode_decipher(
+    cipher: CipherObject,
+    encoding: c_int,
+    text: *const c_char,
+    length: size_t,
+    buffer: *mut u8,
+    capacity: size_t,
+) -> i64 {
+    let text = unsafe { slice_or_empty(text as *const u8, length) };
+    match (text_encoding(encoding), text) {
+        (Some(encoding), Some(text)) if !cipher.ptr.is_null() && (!buffer.is_null() || capacity == 0) => {
+            let bytes = if buffer.is_null() { &mut [][..] } else { unsafe { slice::from_raw_parts_mut(buffer, capacity) } };
+            encoding::decode_decipher(unsafe { &*cipher.ptr }, encoding, text, bytes).map_or(-1, |length| length as i64)
+        }
+        _ => -1,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_cipher_pow(cipher: CipherObject, exponent: i64) -> CipherObject {
+    if cipher.ptr.is_null() {
+        return CipherObject::null();
+    }
+    let cipher_ref = unsafe { &*cipher.ptr };
+    let cipher_ptr = Box::new(SubstitutionCipher::from_cipher(cipher_ref).pow(exponent));
+    CipherObject { ptr: Box::into_raw(cipher_ptr) }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_cipher_inverse(cipher: CipherObject) -> CipherObject {
+    if cipher.ptr.is_null() {
+        return CipherObject::null();
+    }
+    let cipher_ref = unsafe { &*cipher.ptr };
+    let cipher_ptr = Box::new(SubstitutionCipher::from_cipher(cipher_ref).inverse());
+    CipherObject { ptr: Box::into_raw(cipher_ptr) }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_cipher_order(cipher: CipherObject) -> u64 {
+    if cipher.ptr.is_null() {
+        return 0;
+    }
+    let cipher_ref = unsafe { &*cipher.ptr };
+    SubstitutionCipher::from_cipher(cipher_ref).order()
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_cipher_cycles(cipher: CipherObject, elements: *mut u8, lengths: *mut u16) -> size_t {
+    if cipher.ptr.is_null() || elements.is_null() || lengths.is_null() {
+        return 0;
+    }
+    let cipher_ref = unsafe { &*cipher.ptr };
+    let elements = unsafe { slice::from_raw_parts_mut(elements, 256) };
+    let lengths = unsafe { slice::from_raw_parts_mut(lengths, 128) };
+
+    let cycles = SubstitutionCipher::from_cipher(cipher_ref).cycles();
+    let mut written = 0;
+    for (cycle, length) in cycles.iter().zip(lengths.iter_mut()) {
+        elements[written..written + cycle.len()].copy_from_slice(cycle);
+        written += cycle.len();
+        *length = cycle.len() as u16;
+    }
+    cycles.len()
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_cipher_table(cipher: CipherObject, map: *mut u8) {
+    if cipher.ptr.is_null() || map.is_null() {
+        return;
+    }
+    let cipher_ref = unsafe { &*cipher.ptr };
+    let map = unsafe { slice::from_raw_parts_mut(map, 256) };
+    for (b, mapped) in map.iter_mut().enumerate() {
+        *mapped = cipher_ref.encipher(b as u8);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_cipher_from_table(map: *const u8) -> CipherObject {
+    if map.is_null() {
+        return CipherObject::null();
+    }
+    let map = unsafe { &*(map as *const [u8; 256]) };
+    match SubstitutionCipher::from_table(map) {
+        Some(cipher) => CipherObject { ptr: Box::into_raw(Box::new(cipher)) },
+        None => CipherObject::null(),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_shared_write(cipher: CipherObject, tables: *mut u8) {
+    if cipher.ptr.is_null() || tables.is_null() {
+        return;
+    }
+    let tables = unsafe { &mut *(tables as *mut [u8; SHARED_TABLES_LEN]) };
+    SharedCipher::write_tables(unsafe { &*cipher.ptr }, tables);
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_cipher_shared(tables: *const u8) -> CipherObject {
+    if tables.is_null() {
+        return CipherObject::null();
+    }
+    // The caller keeps the tables alive for as long as the cipher.
+    let tables: &'static [u8; SHARED_TABLES_LEN] = unsafe { &*(tables as *const [u8; SHARED_TABLES_LEN]) };
+    match SharedCipher::from_tables(tables) {
+        Some(cipher) => CipherObject { ptr: Box::into_raw(Box::new(cipher)) },
+        None => CipherObject::null(),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_builder_new() -> *mut SubstitutionBuilder {
+    let builder = Box::new(SubstitutionBuilder::new());
+    Box::into_raw(builder)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_builder_swap(builder: *mut SubstitutionBuilder, left: u8, right: u8) {
+    let builder_ref = unsafe { &mut *builder };
+    builder_ref.swap(left, right)
+}
 
-use libc::{c_char, size_t, int32_t};
+#[no_mangle]
+pub extern "C" fn purecipher_builder_rotate(builder: *mut SubstitutionBuilder, from: u8, to: u8, offset: int32_t) {
+    let builder_ref = unsafe { &mut *builder };
+    builder_ref.rotate_range(from, to, offset as isize)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_builder_into_cipher(builder: *mut SubstitutionBuilder) -> CipherObject {
+    // No null pointer check is performed against the builder as no sensible
+    // error value can be returned. It is the caller's responsibility to pass a
+    // valid builder.
+    let builder_box = unsafe { Box::from_raw(builder) };
+    let cipher_ptr = Box::new(builder_box.into_cipher());
+    CipherObject { ptr: Box::into_raw(cipher_ptr) }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_builder_discard(builder: *mut SubstitutionBuilder) {
+    unsafe {
+        Box::from_raw(builder);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_periodic_new(ciphers: *const CipherObject, period: size_t) -> *mut PeriodicCipher {
+    if ciphers.is_null() || period == 0 {
+        return ptr::null_mut();
+    }
+    let ciphers = unsafe { slice::from_raw_parts(ciphers, period) };
+    if ciphers.iter().any(|c| c.ptr.is_null()) {
+        return ptr::null_mut();
+    }
+    let tables = ciphers.iter()
+        .map(|c| SubstitutionCipher::from_cipher(unsafe { &*c.ptr }))
+        .collect();
+    Box::into_raw(Box::new(PeriodicCipher::new(tables)))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_periodic_new_shifts(key: *const u8, period: size_t) -> *mut PeriodicCipher {
+    if key.is_null() || period == 0 {
+        return ptr::null_mut();
+    }
+    let key = unsafe { slice::from_raw_parts(key, period) };
+    Box::into_raw(Box::new(PeriodicCipher::from_shifts(key)))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_periodic_free(cipher: *mut PeriodicCipher) {
+    if cipher.is_null() {
+        return;
+    }
+    unsafe {
+        drop(Box::from_raw(cipher));
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_periodic_period(cipher: *const PeriodicCipher) -> size_t {
+    if cipher.is_null() {
+        return 0;
+    }
+    unsafe { &*cipher }.period()
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_periodic_encipher(
+    cipher: *const PeriodicCipher,
+    buffer: *mut u8,
+    length: size_t,
+    offset: u64,
+) {
+    if cipher.is_null() || buffer.is_null() {
+        return;
+    }
+    let cipher_ref = unsafe { &*cipher };
+    let slice = unsafe { slice::from_raw_parts_mut(buffer, length) };
+    cipher_ref.encipher_at(slice, offset)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_periodic_decipher(
+    cipher: *const PeriodicCipher,
+    buffer: *mut u8,
+    length: size_t,
+    offset: u64,
+) {
+    if cipher.is_null() || buffer.is_null() {
+        return;
+    }
+    let cipher_ref = unsafe { &*cipher };
+    let slice = unsafe { slice::from_raw_parts_mut(buffer, length) };
+    cipher_ref.decipher_at(slice, offset)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_pool_new(threads: size_t) -> *mut CipherPool {
+    Box::into_raw(Box::new(CipherPool::new(threads)))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_pool_free(pool: *mut CipherPool) {
+    if pool.is_null() {
+        return;
+    }
+    unsafe {
+        drop(Box::from_raw(pool));
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_pool_threads(pool: *const CipherPool) -> size_t {
+    if pool.is_null() {
+        return 0;
+    }
+    unsafe { &*pool }.threads()
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_pool_encipher(pool: *mut CipherPool, jobs: *const PoolJob, count: size_t) -> *mut PoolBatch {
+    unsafe { pool_submit(pool, jobs, count, Direction::Encipher) }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_pool_decipher(pool: *mut CipherPool, jobs: *const PoolJob, count: size_t) -> *mut PoolBatch {
+    unsafe { pool_submit(pool, jobs, count, Direction::Decipher) }
+}
+
+/// Submits the given jobs to a pool.
+///
+/// Returns null without ciphering anything if any pointer is null.
+unsafe fn pool_submit(pool: *mut CipherPool, jobs: *const PoolJob, count: size_t, direction: Direction) -> *mut PoolBatch {
+    if pool.is_null() || (jobs.is_null() && count > 0) {
+        return ptr::null_mut();
+    }
+    let jobs = if jobs.is_null() { &[][..] } else { slice::from_raw_parts(jobs, count) };
+    if jobs.iter().any(|job| job.cipher.ptr.is_null() || (job.buffer.is_null() && job.length > 0)) {
+        return ptr::null_mut();
+    }
+    let raw: Vec<RawJob> = jobs.iter()
+        .map(|job| RawJob { cipher: job.cipher.ptr, buffer: job.buffer, length: job.length })
+        .collect();
+    Box::into_raw(Box::new((&*pool).submit(&raw, direction)))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_batch_done(batch: *const PoolBatch) -> c_int {
+    if batch.is_null() {
+        return 1;
+    }
+    unsafe { &*batch }.is_done() as c_int
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_batch_wait(batch: *const PoolBatch) {
+    if batch.is_null() {
+        return;
+    }
+    unsafe { &*batch }.wait()
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_batch_free(batch: *mut PoolBatch) {
+    if batch.is_null() {
+        return;
+    }
+    let batch = unsafe { Box::from_raw(batch) };
+    batch.wait();
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_context_new(threads: size_t, entries: size_t) -> *mut CipherContext {
+    if entries == 0 {
+        return ptr::null_mut();
+    }
+    Box::into_raw(Box::new(CipherContext::new(threads, entries)))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_context_free(context: *mut CipherContext) {
+    if context.is_null() {
+        return;
+    }
+    unsafe {
+        drop(Box::from_raw(context));
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_context_eventfd(context: *const CipherContext) -> c_int {
+    if context.is_null() {
+        return -1;
+    }
+    unsafe { &*context }.event_fd()
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_context_submit(
+    context: *mut CipherContext,
+    submissions: *const SubmissionObject,
+    count: size_t,
+) -> size_t {
+    if context.is_null() || submissions.is_null() {
+        return 0;
+    }
+    let context = unsafe { &*context };
+    let submissions = unsafe { slice::from_raw_parts(submissions, count) };
+    let mut accepted = 0;
+    for s in submissions.iter() {
+        if s.cipher.ptr.is_null() || (s.buffer.is_null() && s.length > 0) {
+            break;
+        }
+        let submission = Submission {
+            cipher: s.cipher.ptr,
+            buffer: s.buffer,
+            length: s.length,
+            decipher: s.decipher != 0,
+            user_data: s.user_data,
+            callback: s.callback,
+        };
+        if !unsafe { context.submit(submission) } {
+            break;
+        }
+        accepted += 1;
+    }
+    accepted
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_context_reap(
+    context: *mut CipherContext,
+    completions: *mut CompletionObject,
+    max: size_t,
+) -> size_t {
+    if context.is_null() || completions.is_null() {
+        return 0;
+    }
+    // CompletionObject is a C struct holding a single u64.
+    let user_data = unsafe { slice::from_raw_parts_mut(completions as *mut u64, max) };
+    unsafe { &*context }.reap(user_data)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_arena_new() -> *mut CipherArena {
+    Box::into_raw(Box::new(CipherArena::new()))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_arena_free(arena: *mut CipherArena) {
+    if arena.is_null() {
+        return;
+    }
+    unsafe {
+        drop(Box::from_raw(arena));
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_arena_intern(arena: *const CipherArena, cipher: CipherObject) -> CipherObject {
+    if arena.is_null() || cipher.ptr.is_null() {
+        return CipherObject::null();
+    }
+    let interned = unsafe { &*arena }.intern(unsafe { &*cipher.ptr });
+    CipherObject { ptr: interned as *const dyn PureCipher }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_arena_intern_table(arena: *const CipherArena, map: *const u8) -> CipherObject {
+    if arena.is_null() || map.is_null() {
+        return CipherObject::null();
+    }
+    let map = unsafe { &*(map as *const [u8; 256]) };
+    match unsafe { &*arena }.intern_table(map) {
+        Some(interned) => CipherObject { ptr: interned as *const dyn PureCipher },
+        None => CipherObject::null(),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_arena_len(arena: *const CipherArena) -> size_t {
+    if arena.is_null() {
+        return 0;
+    }
+    unsafe { &*arena }.len()
+}
+
+/// Cipher owned by a swappable handle, freed like any other cipher object when
+/// the handle releases it.
+pub struct OwnedCipher(Box<dyn PureCipher>);
+
+// Cipher objects are shared between threads by C callers regardless.
+unsafe impl Send for OwnedCipher {}
+
+unsafe impl Sync for OwnedCipher {}
+
+impl PureCipher for OwnedCipher {
+    fn encipher(&self, token: u8) -> u8 { self.0.encipher(token) }
+
+    fn decipher(&self, token: u8) -> u8 { self.0.decipher(token) }
+
+    fn encipher_inplace(&self, bytes: &mut [u8]) { self.0.encipher_inplace(bytes) }
+
+    fn decipher_inplace(&self, bytes: &mut [u8]) { self.0.decipher_inplace(bytes) }
+}
+
+impl OwnedCipher {
+    /// Takes ownership of the cipher behind a cipher object.
+    unsafe fn from_object(cipher: CipherObject) -> Self {
+        OwnedCipher(Box::from_raw(cipher.ptr as *mut dyn PureCipher))
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_swap_new(cipher: CipherObject) -> *mut SwappableCipher<OwnedCipher> {
+    if cipher.ptr.is_null() {
+        return ptr::null_mut();
+    }
+    let cipher = unsafe { OwnedCipher::from_object(cipher) };
+    Box::into_raw(Box::new(SwappableCipher::new(cipher)))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_swap_free(swap: *mut SwappableCipher<OwnedCipher>) {
+    if swap.is_null() {
+        return;
+    }
+    unsafe {
+        drop(Box::from_raw(swap));
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_swap_cipher(swap: *const SwappableCipher<OwnedCipher>) -> CipherObject {
+    if swap.is_null() {
+        return CipherObject::null();
+    }
+    CipherObject { ptr: swap as *const dyn PureCipher }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_swap_store(swap: *const SwappableCipher<OwnedCipher>, cipher: CipherObject) -> c_int {
+    if swap.is_null() || cipher.ptr.is_null() {
+        return -1;
+    }
+    let cipher = unsafe { OwnedCipher::from_object(cipher) };
+    unsafe { &*swap }.store(cipher);
+    0
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_model_new(corpus: *const u8, length: size_t) -> *mut NgramModel {
+    if corpus.is_null() && length != 0 {
+        return ptr::null_mut();
+    }
+    let corpus = if length == 0 { &[][..] } else { unsafe { slice::from_raw_parts(corpus, length) } };
+    Box::into_raw(Box::new(NgramModel::from_corpus(corpus)))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_model_free(model: *mut NgramModel) {
+    if model.is_null() {
+        return;
+    }
+    unsafe {
+        drop(Box::from_raw(model));
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_model_score(model: *const NgramModel, text: *const u8, length: size_t) -> f64 {
+    if model.is_null() || text.is_null() {
+        return 0.0;
+    }
+    let text = unsafe { slice::from_raw_parts(text, length) };
+    unsafe { &*model }.score(text)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_solver_new(model: *const NgramModel) -> *mut Solver<'static> {
+    if model.is_null() {
+        return ptr::null_mut();
+    }
+    // The caller keeps the model alive for as long as the solver.
+    let model: &'static NgramModel = unsafe { &*model };
+    Box::into_raw(Box::new(Solver::new(model)))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_solver_free(solver: *mut Solver<'static>) {
+    if solver.is_null() {
+        return;
+    }
+    unsafe {
+        drop(Box::from_raw(solver));
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_solver_set_threads(solver: *mut Solver<'static>, threads: size_t) {
+    if !solver.is_null() {
+        unsafe { &mut *solver }.threads(threads);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_solver_set_time_limit(solver: *mut Solver<'static>, milliseconds: u64) {
+    if !solver.is_null() {
+        unsafe { &mut *solver }.time_limit(Duration::from_millis(milliseconds));
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_solver_set_max_restarts(solver: *mut Solver<'static>, restarts: u64) {
+    if !solver.is_null() {
+        unsafe { &mut *solver }.max_restarts(restarts);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_solver_set_seed(solver: *mut Solver<'static>, seed: u64) {
+    if !solver.is_null() {
+        unsafe { &mut *solver }.seed(seed);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_solver_add_crib(
+    solver: *mut Solver<'static>,
+    offset: size_t,
+    plaintext: *const u8,
+    length: size_t,
+) -> c_int {
+    if solver.is_null() || plaintext.is_null() {
+        return -1;
+    }
+    let plaintext = unsafe { slice::from_raw_parts(plaintext, length) };
+    unsafe { &mut *solver }.crib(offset, plaintext);
+    0
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_solver_solve(
+    solver: *const Solver<'static>,
+    ciphertext: *const u8,
+    length: size_t,
+    score: *mut f64,
+) -> CipherObject {
+    if solver.is_null() || ciphertext.is_null() {
+        return CipherObject::null();
+    }
+    let ciphertext = unsafe { slice::from_raw_parts(ciphertext, length) };
+    match unsafe { &*solver }.solve(ciphertext) {
+        Some(solution) => {
+            if !score.is_null() {
+                unsafe { *score = solution.score };
+            }
+            CipherObject { ptr: Box::into_raw(Box::new(solution.cipher)) }
+        }
+        None => CipherObject::null(),
+    }
+}
+
+/// Builds a slice from a pointer and length passed over ffi, where a null
+/// pointer is accepted for an empty slice.
+unsafe fn slice_or_empty<'a>(data: *const u8, length: size_t) -> Option<&'a [u8]> {
+    match (data.is_null(), length) {
+        (true, 0) => Some(&[]),
+        (true, _) => None,
+        (false, _) => Some(slice::from_raw_parts(data, length)),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_find(
+    cipher: CipherObject,
+    plaintext: *const u8,
+    plaintext_length: size_t,
+    ciphertext: *const u8,
+    length: size_t,
+) -> i64 {
+    let plaintext = unsafe { slice_or_empty(plaintext, plaintext_length) };
+    let ciphertext = unsafe { slice_or_empty(ciphertext, length) };
+    let (plaintext, ciphertext) = match (plaintext, ciphertext) {
+        (Some(plaintext), Some(ciphertext)) if !cipher.ptr.is_null() => (plaintext, ciphertext),
+        _ => return -1,
+    };
+    match Finder::new(unsafe { &*cipher.ptr }, plaintext).find(ciphertext) {
+        Some(offset) => offset as i64,
+        None => -1,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_find_all(
+    cipher: CipherObject,
+    plaintext: *const u8,
+    plaintext_length: size_t,
+    ciphertext: *const u8,
+    length: size_t,
+    offsets: *mut size_t,
+    capacity: size_t,
+) -> size_t {
+    let plaintext = unsafe { slice_or_empty(plaintext, plaintext_length) };
+    let ciphertext = unsafe { slice_or_empty(ciphertext, length) };
+    let (plaintext, ciphertext) = match (plaintext, ciphertext) {
+        (Some(plaintext), Some(ciphertext)) if !cipher.ptr.is_null() => (plaintext, ciphertext),
+        _ => return 0,
+    };
+    let found = Finder::new(unsafe { &*cipher.ptr }, plaintext).find_all(ciphertext);
+    if !offsets.is_null() {
+        let written = found.len().min(capacity);
+        unsafe { slice::from_raw_parts_mut(offsets, written) }.copy_from_slice(&found[..written]);
+    }
+    found.len()
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_multi_finder_new(
+    cipher: CipherObject,
+    patterns: *const *const u8,
+    lengths: *const size_t,
+    count: size_t,
+) -> *mut MultiFinder {
+    if cipher.ptr.is_null() || (count != 0 && (patterns.is_null() || lengths.is_null())) {
+        return ptr::null_mut();
+    }
+    let (patterns, lengths) = if count == 0 {
+        (&[][..], &[][..])
+    } else {
+        unsafe { (slice::from_raw_parts(patterns, count), slice::from_raw_parts(lengths, count)) }
+    };
+    let mut slices = Vec::with_capacity(count);
+    for (&pattern, &length) in patterns.iter().zip(lengths) {
+        match unsafe { slice_or_empty(pattern, length) } {
+            Some(pattern) => slices.push(pattern),
+            None => return ptr::null_mut(),
+        }
+    }
+    match MultiFinder::new(unsafe { &*cipher.ptr }, &slices) {
+        Some(finder) => Box::into_raw(Box::new(finder)),
+        None => ptr::null_mut(),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_multi_finder_free(finder: *mut MultiFinder) {
+    if finder.is_null() {
+        return;
+    }
+    unsafe {
+        drop(Box::from_raw(finder));
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_multi_finder_find_all(
+    finder: *const MultiFinder,
+    ciphertext: *const u8,
+    length: size_t,
+    matches: *mut PatternMatch,
+    capacity: size_t,
+) -> size_t {
+    let ciphertext = match unsafe { slice_or_empty(ciphertext, length) } {
+        Some(ciphertext) if !finder.is_null() => ciphertext,
+        _ => return 0,
+    };
+    let found = unsafe { &*finder }.find_all(ciphertext);
+    if !matches.is_null() {
+        let written = found.len().min(capacity);
+        unsafe { slice::from_raw_parts_mut(matches, written) }.copy_from_slice(&found[..written]);
+    }
+    found.len()
+}
 
-use super::{PureCipher, SubstitutionBuilder};
+/// Builds the list of keys passed over ffi as parallel arrays of pointers and
+/// lengths, or returns `None` if any key is invalid.
+unsafe fn key_slices<'a>(keys: *const *const u8, lengths: *const size_t, count: size_t) -> Option<Vec<&'a [u8]>> {
+    if count == 0 {
+        return Some(Vec::new());
+    }
+    if keys.is_null() || lengths.is_null() {
+        return None;
+    }
+    let keys = slice::from_raw_parts(keys, count);
+    let lengths = slice::from_raw_parts(lengths, count);
+    keys.iter().zip(lengths).map(|(&key, &length)| slice_or_empty(key, length)).collect()
+}
 
-#[repr(C)]
-#[derive(Copy, Clone, Eq, PartialEq)]
-/// Type for PureCipher trait object pointers to be passed over ffi.
-pub struct CipherObject {
-    /// Fat pointer to cipher trait object.
-    ptr: *const dyn PureCipher,
+#[no_mangle]
+pub extern "C" fn purecipher_order_new(cipher: CipherObject) -> *mut PlaintextOrder {
+    if cipher.ptr.is_null() {
+        return ptr::null_mut();
+    }
+    Box::into_raw(Box::new(PlaintextOrder::new(unsafe { &*cipher.ptr })))
 }
 
 #[no_mangle]
-pub extern "C" fn purecipher_free(cipher: CipherObject) {
+pub extern "C" fn purecipher_order_free(order: *mut PlaintextOrder) {
+    if order.is_null() {
+        return;
+    }
     unsafe {
-        Box::from_raw(cipher.ptr as *mut PureCipher);
+        drop(Box::from_raw(order));
     }
 }
 
 #[no_mangle]
-pub extern "C" fn purecipher_encipher_buffer(cipher: CipherObject, buffer: *mut u8, length: size_t) {
-    if cipher.ptr.is_null() || buffer.is_null() {
-        return;
+pub extern "C" fn purecipher_order_compare(
+    order: *const PlaintextOrder,
+    left: *const u8,
+    left_length: size_t,
+    right: *const u8,
+    right_length: size_t,
+) -> c_int {
+    let left = unsafe { slice_or_empty(left, left_length) };
+    let right = unsafe { slice_or_empty(right, right_length) };
+    match (left, right) {
+        (Some(left), Some(right)) if !order.is_null() => match unsafe { &*order }.compare(left, right) {
+            Ordering::Less => -1,
+            Ordering::Equal => 0,
+            Ordering::Greater => 1,
+        },
+        _ => 0,
     }
+}
 
-    let cipher_ref = unsafe { &*cipher.ptr };
-    let slice = unsafe {
-        slice::from_raw_parts_mut(buffer, length)
+#[no_mangle]
+pub extern "C" fn purecipher_order_argsort(
+    order: *const PlaintextOrder,
+    keys: *const *const u8,
+    lengths: *const size_t,
+    count: size_t,
+    indices: *mut size_t,
+) -> c_int {
+    let keys = match unsafe { key_slices(keys, lengths, count) } {
+        Some(keys) if !order.is_null() && (count == 0 || !indices.is_null()) => keys,
+        _ => return -1,
     };
+    if count > 0 {
+        let sorted = unsafe { &*order }.argsort(&keys);
+        unsafe { slice::from_raw_parts_mut(indices, count) }.copy_from_slice(&sorted);
+    }
+    0
+}
 
-    cipher_ref.encipher_inplace(slice)
+#[no_mangle]
+pub extern "C" fn purecipher_order_search(
+    order: *const PlaintextOrder,
+    keys: *const *const u8,
+    lengths: *const size_t,
+    count: size_t,
+    key: *const u8,
+    length: size_t,
+) -> size_t {
+    let keys = unsafe { key_slices(keys, lengths, count) };
+    let key = unsafe { slice_or_empty(key, length) };
+    match (keys, key) {
+        (Some(keys), Some(key)) if !order.is_null() => {
+            // The first of several equal keys is wanted, so search for the
+            // boundary below the key rather than any match.
+            let order = unsafe { &*order };
+            keys.binary_search_by(|probe| order.compare(probe, key).then(Ordering::Greater)).unwrap_err()
+        }
+        _ => count,
+    }
 }
 
 #[no_mangle]
-pub extern "C" fn purecipher_decipher_buffer(cipher: CipherObject, buffer: *mut u8, length: size_t) {
-    if cipher.ptr.is_null() || buffer.is_null() {
+pub extern "C" fn purecipher_wide_builder_new() -> *mut WideSubstitutionBuilder {
+    Box::into_raw(Box::new(WideSubstitutionBuilder::new()))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_wide_builder_swap(builder: *mut WideSubstitutionBuilder, left: u16, right: u16) {
+    let builder_ref = unsafe { &mut *builder };
+    builder_ref.swap(left, right)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_wide_builder_rotate(
+    builder: *mut WideSubstitutionBuilder,
+    from: u16,
+    to: u16,
+    offset: i32,
+) {
+    let builder_ref = unsafe { &mut *builder };
+    builder_ref.rotate_range(from, to, offset as isize)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_wide_builder_into_cipher(builder: *mut WideSubstitutionBuilder) -> *mut WideSubstitutionCipher {
+    let builder_box = unsafe { Box::from_raw(builder) };
+    Box::into_raw(Box::new(builder_box.into_cipher()))
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_wide_builder_discard(builder: *mut WideSubstitutionBuilder) {
+    unsafe {
+        drop(Box::from_raw(builder));
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_wide_from_table(map: *const u16) -> *mut WideSubstitutionCipher {
+    if map.is_null() {
+        return ptr::null_mut();
+    }
+    let map = unsafe { slice::from_raw_parts(map, 1 << 16) };
+    match WideSubstitutionCipher::from_table(map) {
+        Some(cipher) => Box::into_raw(Box::new(cipher)),
+        None => ptr::null_mut(),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_wide_free(cipher: *mut WideSubstitutionCipher) {
+    if cipher.is_null() {
         return;
     }
+    unsafe {
+        drop(Box::from_raw(cipher));
+    }
+}
 
-    let cipher_ref = unsafe { &*cipher.ptr };
-    let slice = unsafe {
-        slice::from_raw_parts_mut(buffer, length)
+#[no_mangle]
+pub extern "C" fn purecipher_wide_encipher(cipher: *const WideSubstitutionCipher, tokens: *mut u16, length: size_t) {
+    if cipher.is_null() || tokens.is_null() {
+        return;
+    }
+    let tokens = unsafe { slice::from_raw_parts_mut(tokens, length) };
+    unsafe { &*cipher }.encipher_inplace(tokens)
+}
+
+#[no_mangle]
+pub extern "C" fn purecipher_wide_decipher(cipher: *const WideSubstitutionCipher, tokens: *mut u16, length: size_t) {
+    if cipher.is_null() || tokens.is_null() {
+        return;
+    }
+    let tokens = unsafe { slice::from_raw_parts_mut(tokens, length) };
+    unsafe { &*cipher }.decipher_inplace(tokens)
+}
+
+#[cfg(target_os = "linux")]
+#[no_mangle]
+pub extern "C" fn purecipher_service_bind(path: *const c_char, threads: size_t) -> *mut CipherService {
+    if path.is_null() {
+        return ptr::null_mut();
+    }
+    let path = match unsafe { CStr::from_ptr(path) }.to_str() {
+        Ok(path) => path,
+        Err(_) => return ptr::null_mut(),
     };
+    match CipherService::bind(path, threads) {
+        Ok(service) => Box::into_raw(Box::new(service)),
+        Err(_) => ptr::null_mut(),
+    }
+}
 
-    cipher_ref.decipher_inplace(slice)
+#[cfg(target_os = "linux")]
+#[no_mangle]
+pub extern "C" fn purecipher_service_free(service: *mut CipherService) {
+    if service.is_null() {
+        return;
+    }
+    unsafe {
+        drop(Box::from_raw(service));
+    }
 }
 
+#[cfg(target_os = "linux")]
 #[no_mangle]
-pub extern "C" fn purecipher_encipher_str(cipher: CipherObject, s: *mut c_char) {
-    // Compute length of null-terminated string.
-    let s_ref = unsafe { CStr::from_ptr(s) };
-    // Trailing null byte is not encoded.
-    purecipher_encipher_buffer(cipher, s as *mut u8, s_ref.to_bytes().len())
+pub extern "C" fn purecipher_service_register(
+    service: *const CipherService,
+    name: *const c_char,
+    cipher: CipherObject,
+) -> i64 {
+    if service.is_null() || name.is_null() || cipher.ptr.is_null() {
+        return -1;
+    }
+    match unsafe { CStr::from_ptr(name) }.to_str() {
+        Ok(name) if name.len() <= super::service::MAX_NAME => {
+            unsafe { &*service }.register(name, unsafe { &*cipher.ptr }) as i64
+        }
+        _ => -1,
+    }
 }
 
+#[cfg(target_os = "linux")]
 #[no_mangle]
-pub extern "C" fn purecipher_decipher_str(cipher: CipherObject, s: *mut c_char) {
-    // Compute length of null-terminated string.
-    let s_ref = unsafe { CStr::from_ptr(s) };
-    // Trailing null byte is not decoded.
-    purecipher_decipher_buffer(cipher, s as *mut u8, s_ref.to_bytes().len())
+pub extern "C" fn purecipher_client_connect(path: *const c_char, slots: size_t, slot_size: size_t) -> *mut CipherClient {
+    if path.is_null() {
+        return ptr::null_mut();
+    }
+    let path = match unsafe { CStr::from_ptr(path) }.to_str() {
+        Ok(path) => path,
+        Err(_) => return ptr::null_mut(),
+    };
+    match CipherClient::connect(path, slots, slot_size) {
+        Ok(client) => Box::into_raw(Box::new(client)),
+        Err(_) => ptr::null_mut(),
+    }
 }
 
+#[cfg(target_os = "linux")]
 #[no_mangle]
-pub extern "C" fn purecipher_builder_new() -> *mut SubstitutionBuilder {
-    let builder = Box::new(SubstitutionBuilder::new());
-    Box::into_raw(builder)
+pub extern "C" fn purecipher_client_free(client: *mut CipherClient) {
+    if client.is_null() {
+        return;
+    }
+    unsafe {
+        drop(Box::from_raw(client));
+    }
 }
 
+#[cfg(target_os = "linux")]
 #[no_mangle]
-pub extern "C" fn purecipher_builder_swap(builder: *mut SubstitutionBuilder, left: u8, right: u8) {
-    let builder_ref = unsafe { &mut *builder };
-    builder_ref.swap(left, right)
+pub extern "C" fn purecipher_client_lookup(client: *const CipherClient, name: *const c_char) -> i64 {
+    if client.is_null() || name.is_null() {
+        return -1;
+    }
+    match unsafe { CStr::from_ptr(name) }.to_str() {
+        Ok(name) => unsafe { &*client }.lookup(name).map_or(-1, |id| id as i64),
+        Err(_) => -1,
+    }
 }
 
+#[cfg(target_os = "linux")]
 #[no_mangle]
-pub extern "C" fn purecipher_builder_rotate(builder: *mut SubstitutionBuilder, from: u8, to: u8, offset: int32_t) {
-    let builder_ref = unsafe { &mut *builder };
-    builder_ref.rotate_range(from, to, offset as isize)
+pub extern "C" fn purecipher_client_slot_size(client: *const CipherClient) -> size_t {
+    if client.is_null() {
+        return 0;
+    }
+    unsafe { &*client }.slot_size()
 }
 
+#[cfg(target_os = "linux")]
 #[no_mangle]
-pub extern "C" fn purecipher_builder_into_cipher(builder: *mut SubstitutionBuilder) -> CipherObject {
-    // No null pointer check is performed against the builder as no sensible
-    // error value can be returned. It is the caller's responsibility to pass a
-    // valid builder.
-    let builder_box = unsafe { Box::from_raw(builder) };
-    let cipher_ptr = Box::new(builder_box.into_cipher());
-    CipherObject { ptr: Box::into_raw(cipher_ptr) }
+pub extern "C" fn purecipher_client_buffer(client: *mut CipherClient, slot: size_t) -> *mut u8 {
+    if client.is_null() {
+        return ptr::null_mut();
+    }
+    let client = unsafe { &mut *client };
+    if slot >= client.slots() || client.in_flight(slot) {
+        return ptr::null_mut();
+    }
+    client.buffer(slot).as_mut_ptr()
 }
 
+#[cfg(target_os = "linux")]
 #[no_mangle]
-pub extern "C" fn purecipher_builder_discard(builder: *mut SubstitutionBuilder) {
-    unsafe {
-        Box::from_raw(builder);
+pub extern "C" fn purecipher_client_submit(
+    client: *mut CipherClient,
+    slot: size_t,
+    cipher: u32,
+    length: size_t,
+    decipher: c_int,
+) -> c_int {
+    if client.is_null() {
+        return -1;
+    }
+    let client = unsafe { &mut *client };
+    if slot >= client.slots() || client.in_flight(slot) || length > client.slot_size() {
+        return -1;
+    }
+    client.submit(slot, cipher, length, decipher != 0);
+    0
+}
+
+#[cfg(target_os = "linux")]
+#[no_mangle]
+pub extern "C" fn purecipher_client_wait(client: *mut CipherClient, slot: size_t) -> c_int {
+    if client.is_null() {
+        return -1;
+    }
+    let client = unsafe { &mut *client };
+    if slot >= client.slots() {
+        return -1;
+    }
+    match client.wait(slot) {
+        Ok(()) => 0,
+        Err(_) => -1,
     }
 }
 
@@ -121,6 +1505,18 @@ pub extern "C" fn purecipher_cipher_leet() -> CipherObject {
     CipherObject { ptr: Box::into_raw(cipher_ptr) }
 }
 
+#[no_mangle]
+pub extern "C" fn purecipher_cipher_affine(rows: *const u8, constant: u8) -> CipherObject {
+    if rows.is_null() {
+        return CipherObject::null();
+    }
+    let rows = unsafe { *(rows as *const [u8; 8]) };
+    match AffineCipher::new(rows, constant) {
+        Some(cipher) => CipherObject { ptr: Box::into_raw(Box::new(cipher)) },
+        None => CipherObject::null(),
+    }
+}
+
 #[no_mangle]
 pub extern "C" fn purecipher_cipher_null() -> CipherObject {
     let cipher_ptr = Box::new(super::NullCipher {});
@@ -168,10 +1564,10 @@ mod tests {
         let message = CString::new("I do not want to buy this record.").unwrap();
         assert_eq!(b"I do not want to buy this record.\0".as_ref(), message.as_bytes_with_nul());
 
-        purecipher_encipher_str(cipher_ptr, message.as_ptr() as *mut c_char);
+        assert_eq!(33, purecipher_encipher_str(cipher_ptr, message.as_ptr() as *mut c_char));
         assert_eq!(b"J!ep!opu!xbou!up!cvz!uijt!sfdpse/\0".as_ref(), message.as_bytes_with_nul());
 
-        purecipher_decipher_str(cipher_ptr, message.as_ptr() as *mut c_char);
+        assert_eq!(33, purecipher_decipher_str(cipher_ptr, message.as_ptr() as *mut c_char));
         assert_eq!(b"I do not want to buy this record.\0".as_ref(), message.as_bytes_with_nul());
     }
 
@@ -183,8 +1579,9 @@ mod tests {
         let message = CString::new("").unwrap();
         assert_eq!(b"\0".as_ref(), message.as_bytes_with_nul());
 
-        purecipher_encipher_str(cipher_ptr, message.as_ptr() as *mut c_char);
+        assert_eq!(0, purecipher_encipher_str(cipher_ptr, message.as_ptr() as *mut c_char));
         assert_eq!(b"\0".as_ref(), message.as_bytes_with_nul());
+        assert_eq!(0, purecipher_encipher_str(cipher_ptr, ptr::null_mut()));
     }
 
     #[test]
@@ -205,6 +1602,417 @@ mod tests {
         assert_eq!(b"AB", buf.as_ref());
     }
 
+    #[test]
+    fn cipher_batch() {
+        let ciphers = [purecipher_cipher_rot13(), purecipher_cipher_caesar(), purecipher_cipher_rot13()];
+        let offsets = [0, 3, 6, 9];
+        let mut arena = Vec::from("abcabcabc");
+
+        purecipher_encipher_batch(ciphers.as_ptr(), arena.as_mut_ptr(), offsets.as_ptr(), ciphers.len());
+        assert_eq!(b"nopdefnop".as_ref(), arena.as_slice());
+
+        purecipher_decipher_batch(ciphers.as_ptr(), arena.as_mut_ptr(), offsets.as_ptr(), ciphers.len());
+        assert_eq!(b"abcabcabc".as_ref(), arena.as_slice());
+
+        // Descending offsets must leave the arena unchanged.
+        let bad_offsets = [0, 6, 3, 9];
+        purecipher_encipher_batch(ciphers.as_ptr(), arena.as_mut_ptr(), bad_offsets.as_ptr(), ciphers.len());
+        assert_eq!(b"abcabcabc".as_ref(), arena.as_slice());
+
+        for &cipher in ciphers.iter() {
+            purecipher_free(cipher);
+        }
+    }
+
+    #[test]
+    fn histogram_plaintext() {
+        let cipher_ptr = purecipher_cipher_caesar();
+        let cipher_text = b"Zh dwwdfn dw gdzq.";
+        let mut counts = [0u64; 256];
+
+        purecipher_histogram(cipher_text.as_ptr(), cipher_text.len(), counts.as_mut_ptr());
+        assert_eq!(4, counts[b'd' as usize]);
+        assert_eq!(0, counts[b'a' as usize]);
+
+        purecipher_histogram_plaintext(cipher_ptr, cipher_text.as_ptr(), cipher_text.len(), counts.as_mut_ptr());
+        assert_eq!(4, counts[b'a' as usize]);
+        assert_eq!(1, counts[b'd' as usize]);
+        assert_eq!(cipher_text.len() as u64, counts.iter().sum());
+
+        purecipher_free(cipher_ptr);
+    }
+
+    #[test]
+    fn cipher_algebra() {
+        let caesar = purecipher_cipher_caesar();
+        let inverse = purecipher_cipher_inverse(caesar);
+        let cubed = purecipher_cipher_pow(caesar, 3);
+
+        assert_cipher_buffer(inverse, "Zh dwwdfn", "We attack");
+        assert_cipher_buffer(cubed, "abc XYZ", "jkl GHI");
+        assert_eq!(26, purecipher_cipher_order(caesar));
+
+        let mut elements = [0u8; 256];
+        let mut lengths = [0u16; 128];
+        assert_eq!(2, purecipher_cipher_cycles(caesar, elements.as_mut_ptr(), lengths.as_mut_ptr()));
+        assert_eq!([26, 26], lengths[..2]);
+        assert_eq!(b"ADGJMPSVYBEHKNQTWZCFILORUX".as_ref(), &elements[..26]);
+
+        assert!(purecipher_cipher_pow(CipherObject::null(), 2).ptr.is_null());
+
+        purecipher_free(caesar);
+        purecipher_free(inverse);
+        purecipher_free(cubed);
+    }
+
+    #[test]
+    fn cipher_tables() {
+        let leet = purecipher_cipher_leet();
+        let mut map = [0u8; 256];
+        purecipher_cipher_table(leet, map.as_mut_ptr());
+        let copy = purecipher_cipher_from_table(map.as_ptr());
+        assert_cipher_buffer(copy, "Speak leet", "5p3@k l331");
+
+        let mut tables = [0u8; SHARED_TABLES_LEN];
+        purecipher_shared_write(leet, tables.as_mut_ptr());
+        assert_eq!(map[..], tables[..256]);
+        let shared = purecipher_cipher_shared(tables.as_ptr());
+        assert_cipher_buffer(shared, "Speak leet", "5p3@k l331");
+
+        map[0] = map[1];
+        assert!(purecipher_cipher_from_table(map.as_ptr()).ptr.is_null());
+        tables[256] = tables[257];
+        assert!(purecipher_cipher_shared(tables.as_ptr()).ptr.is_null());
+
+        purecipher_free(leet);
+        purecipher_free(copy);
+        purecipher_free(shared);
+    }
+
+    #[test]
+    fn solver_recovers_cipher() {
+        let corpus = "the quick brown fox jumps over the lazy dog. ".repeat(100);
+        let model = purecipher_model_new(corpus.as_ptr(), corpus.len());
+        assert!(purecipher_model_score(model, b"the dog".as_ptr(), 7) > purecipher_model_score(model, b"xqz jvk".as_ptr(), 7));
+
+        let plaintext = b"the quick brown fox jumps over the lazy dog.";
+        let expected = purecipher_model_score(model, plaintext.as_ptr(), plaintext.len());
+        let caesar = purecipher_cipher_caesar();
+        let mut ciphertext = plaintext.to_vec();
+        purecipher_encipher_buffer(caesar, ciphertext.as_mut_ptr(), ciphertext.len());
+
+        let solver = purecipher_solver_new(model);
+        purecipher_solver_set_threads(solver, 2);
+        purecipher_solver_set_seed(solver, 7);
+        assert_eq!(0, purecipher_solver_add_crib(solver, 4, b"quick brown".as_ptr(), 11));
+        let mut score = 0.0;
+        let solved = purecipher_solver_solve(solver, ciphertext.as_ptr(), ciphertext.len(), &mut score);
+        assert!(!solved.ptr.is_null());
+        // Plaintext other than the original may score as well under a corpus
+        // of one sentence, but none better.
+        assert!(score > expected - 1e-3);
+        purecipher_decipher_buffer(solved, ciphertext.as_mut_ptr(), ciphertext.len());
+        assert_eq!(b"quick brown".as_ref(), &ciphertext[4..15]);
+
+        // A crib that runs past the end of the ciphertext cannot be satisfied.
+        assert_eq!(0, purecipher_solver_add_crib(solver, 40, b"foxes".as_ptr(), 5));
+        assert!(purecipher_solver_solve(solver, ciphertext.as_ptr(), ciphertext.len(), ptr::null_mut()).ptr.is_null());
+
+        purecipher_free(caesar);
+        purecipher_free(solved);
+        purecipher_solver_free(solver);
+        purecipher_model_free(model);
+    }
+
+    #[test]
+    fn find_in_ciphertext() {
+        let caesar = purecipher_cipher_caesar();
+        let mut ciphertext = Vec::from("ok\nERROR disk\nWARN disk\nERROR net");
+        purecipher_encipher_buffer(caesar, ciphertext.as_mut_ptr(), ciphertext.len());
+        let length = ciphertext.len();
+
+        assert_eq!(3, purecipher_find(caesar, b"ERROR".as_ptr(), 5, ciphertext.as_ptr(), length));
+        assert_eq!(-1, purecipher_find(caesar, b"FATAL".as_ptr(), 5, ciphertext.as_ptr(), length));
+
+        let mut offsets = [0; 1];
+        assert_eq!(2, purecipher_find_all(caesar, b"disk".as_ptr(), 4, ciphertext.as_ptr(), length, offsets.as_mut_ptr(), 1));
+        assert_eq!([9], offsets);
+        assert_eq!(2, purecipher_find_all(caesar, b"ERROR".as_ptr(), 5, ciphertext.as_ptr(), length, ptr::null_mut(), 0));
+
+        let patterns = [b"WARN".as_ptr(), b"net".as_ptr()];
+        let lengths = [4, 3];
+        let finder = purecipher_multi_finder_new(caesar, patterns.as_ptr(), lengths.as_ptr(), 2);
+        let mut matches = [PatternMatch { offset: 0, pattern: 0 }; 4];
+        assert_eq!(2, purecipher_multi_finder_find_all(finder, ciphertext.as_ptr(), length, matches.as_mut_ptr(), 4));
+        assert_eq!(PatternMatch { offset: 14, pattern: 0 }, matches[0]);
+        assert_eq!(PatternMatch { offset: 30, pattern: 1 }, matches[1]);
+
+        let lengths = [4, 0];
+        assert!(purecipher_multi_finder_new(caesar, patterns.as_ptr(), lengths.as_ptr(), 2).is_null());
+
+        purecipher_multi_finder_free(finder);
+        purecipher_free(caesar);
+    }
+
+    #[test]
+    fn cipher_buffer_crc32c() {
+        let cipher_ptr = purecipher_cipher_leet();
+        let text = b"Fused checksums save a pass over memory";
+        let mut buffer = text.to_vec();
+        let (head, tail) = text.split_at(10);
+
+        let crc = purecipher_encipher_buffer_crc32c(cipher_ptr, buffer.as_mut_ptr(), buffer.len(), 0, 0);
+        assert_eq!(purecipher_crc32c(0, text.as_ptr(), text.len()), crc);
+        assert_eq!(crc, purecipher_crc32c_combine(
+            purecipher_crc32c(0, head.as_ptr(), head.len()),
+            purecipher_crc32c(0, tail.as_ptr(), tail.len()),
+            tail.len() as u64,
+        ));
+
+        let ciphertext_crc = purecipher_crc32c(0, buffer.as_ptr(), buffer.len());
+        assert_eq!(ciphertext_crc, purecipher_decipher_buffer_crc32c(cipher_ptr, buffer.as_mut_ptr(), buffer.len(), 0, 1));
+        assert_eq!(&text[..], &buffer[..]);
+
+        assert_eq!(7, purecipher_encipher_buffer_crc32c(CipherObject::null(), buffer.as_mut_ptr(), buffer.len(), 7, 0));
+        purecipher_free(cipher_ptr);
+    }
+
+    #[test]
+    fn encipher_encode_round_trip() {
+        let caesar = purecipher_cipher_caesar();
+        let mut text = [0 as c_char; 12];
+        let mut bytes = [0u8; 8];
+
+        assert_eq!(8, purecipher_encoded_length(1, 5));
+        assert_eq!(0, purecipher_encipher_encode(caesar, 1, b"hello".as_ptr(), 5, text.as_mut_ptr(), 7));
+        assert_eq!(8, purecipher_encipher_encode(caesar, 1, b"hello".as_ptr(), 5, text.as_mut_ptr(), 12));
+        let encoded: Vec<u8> = text[..8].iter().map(|&c| c as u8).collect();
+        assert_eq!(b"a2hvb3I=", &encoded[..]);
+
+        assert_eq!(5, purecipher_decoded_length(1, text.as_ptr(), 8));
+        assert_eq!(5, purecipher_decode_decipher(caesar, 1, text.as_ptr(), 8, bytes.as_mut_ptr(), bytes.len()));
+        assert_eq!(b"hello", &bytes[..5]);
+        assert_eq!(-1, purecipher_decode_decipher(caesar, 1, text.as_ptr(), 8, bytes.as_mut_ptr(), 4));
+        assert_eq!(-1, purecipher_decode_decipher(caesar, 0, text.as_ptr(), 8, bytes.as_mut_ptr(), bytes.len()));
+        assert_eq!(-1, purecipher_decoded_length(2, text.as_ptr(), 8));
+        purecipher_free(caesar);
+    }
+
+    #[test]
+    fn plaintext_order() {
+        let caesar = purecipher_cipher_caesar();
+        let order = purecipher_order_new(caesar);
+        // "xray", "apple", "melon" and "apple" under caesar.
+        let keys = [b"audb".as_ptr(), b"dssoh".as_ptr(), b"phorq".as_ptr(), b"dssoh".as_ptr()];
+        let lengths = [4, 5, 5, 5];
+
+        assert_eq!(-1, purecipher_order_compare(order, keys[1], 5, keys[0], 4));
+        assert_eq!(0, purecipher_order_compare(order, keys[1], 5, keys[3], 5));
+        assert_eq!(1, purecipher_order_compare(order, keys[1], 5, keys[1], 4));
+
+        let mut indices = [0; 4];
+        assert_eq!(0, purecipher_order_argsort(order, keys.as_ptr(), lengths.as_ptr(), 4, indices.as_mut_ptr()));
+        assert_eq!([1, 3, 2, 0], indices);
+
+        let sorted: Vec<*const u8> = indices.iter().map(|&i| keys[i]).collect();
+        let sorted_lengths: Vec<size_t> = indices.iter().map(|&i| lengths[i]).collect();
+        let search = |key: &[u8]| purecipher_order_search(
+            order, sorted.as_ptr(), sorted_lengths.as_ptr(), 4, key.as_ptr(), key.len(),
+        );
+        assert_eq!(0, search(b"dssoh"));
+        assert_eq!(2, search(b"phorq"));
+        assert_eq!(4, search(b"}}"));
+
+        assert!(purecipher_order_new(CipherObject::null()).is_null());
+        purecipher_order_free(order);
+        purecipher_free(caesar);
+    }
+
+    #[test]
+    fn periodic_cipher() {
+        let ciphers = [purecipher_cipher_caesar(), purecipher_cipher_rot13()];
+        let periodic = purecipher_periodic_new(ciphers.as_ptr(), ciphers.len());
+        let vigenere = purecipher_periodic_new_shifts(b"\x01\x02".as_ptr(), 2);
+        assert_eq!(2, purecipher_periodic_period(periodic));
+
+        let mut buffer = Vec::from("aaaa");
+        purecipher_periodic_encipher(periodic, buffer[1..].as_mut_ptr(), 3, 1);
+        assert_eq!(b"andn".as_ref(), buffer.as_slice());
+        purecipher_periodic_decipher(periodic, buffer[1..].as_mut_ptr(), 3, 1);
+        assert_eq!(b"aaaa".as_ref(), buffer.as_slice());
+
+        purecipher_periodic_encipher(vigenere, buffer.as_mut_ptr(), buffer.len(), 0);
+        assert_eq!(b"bcbc".as_ref(), buffer.as_slice());
+
+        assert!(purecipher_periodic_new(ciphers.as_ptr(), 0).is_null());
+        assert!(purecipher_periodic_new_shifts(ptr::null(), 2).is_null());
+
+        purecipher_periodic_free(periodic);
+        purecipher_periodic_free(vigenere);
+        for &cipher in ciphers.iter() {
+            purecipher_free(cipher);
+        }
+    }
+
+    #[test]
+    fn pool_batches() {
+        let pool = purecipher_pool_new(2);
+        let rot13 = purecipher_cipher_rot13();
+        assert_eq!(2, purecipher_pool_threads(pool));
+
+        let mut buffers: Vec<Vec<u8>> = (0..100).map(|_| Vec::from("abc")).collect();
+        let jobs: Vec<PoolJob> = buffers.iter_mut()
+            .map(|b| PoolJob { cipher: rot13, buffer: b.as_mut_ptr(), length: b.len() })
+            .collect();
+
+        let batch = purecipher_pool_encipher(pool, jobs.as_ptr(), jobs.len());
+        purecipher_batch_wait(batch);
+        assert_eq!(1, purecipher_batch_done(batch));
+        purecipher_batch_free(batch);
+        assert!(buffers.iter().all(|b| b == b"nop"));
+
+        let batch = purecipher_pool_decipher(pool, jobs.as_ptr(), jobs.len());
+        purecipher_batch_free(batch);
+        assert!(buffers.iter().all(|b| b == b"abc"));
+
+        let invalid = [PoolJob { cipher: CipherObject::null(), buffer: ptr::null_mut(), length: 0 }];
+        assert!(purecipher_pool_encipher(pool, invalid.as_ptr(), 1).is_null());
+
+        purecipher_pool_free(pool);
+        purecipher_free(rot13);
+    }
+
+    #[test]
+    fn context_submit_reap() {
+        let context = purecipher_context_new(1, 2);
+        let rot13 = purecipher_cipher_rot13();
+        let mut buffer = Vec::from("abc");
+        let submission = |user_data| SubmissionObject {
+            cipher: rot13,
+            buffer: buffer.as_ptr() as *mut u8,
+            length: buffer.len(),
+            decipher: 0,
+            user_data,
+            callback: None,
+        };
+
+        // Only two submissions fit in the context.
+        let submissions = [submission(1), submission(2), submission(3)];
+        assert_eq!(2, purecipher_context_submit(context, submissions.as_ptr(), 3));
+
+        let mut completions = [CompletionObject { user_data: 0 }, CompletionObject { user_data: 0 }];
+        let mut reaped = 0;
+        while reaped < 2 {
+            reaped += purecipher_context_reap(context, completions[reaped..].as_mut_ptr(), 2 - reaped);
+        }
+        let mut user_data = [completions[0].user_data, completions[1].user_data];
+        user_data.sort();
+        assert_eq!([1, 2], user_data);
+        assert_eq!(b"abc".as_ref(), buffer.as_slice());
+
+        let invalid = SubmissionObject { cipher: CipherObject::null(), ..submission(4) };
+        assert_eq!(0, purecipher_context_submit(context, &invalid, 1));
+        assert!(purecipher_context_new(1, 0).is_null());
+
+        purecipher_context_free(context);
+        purecipher_free(rot13);
+    }
+
+    #[test]
+    fn arena_interning() {
+        let arena = purecipher_arena_new();
+        let rot13 = purecipher_cipher_rot13();
+
+        let first = purecipher_arena_intern(arena, rot13);
+        let second = purecipher_arena_intern(arena, rot13);
+        assert!(first == second);
+        assert_eq!(1, purecipher_arena_len(arena));
+        assert_cipher_buffer(first, "Looks good!", "Ybbxf tbbq!");
+
+        let mut map = [0u8; 256];
+        for (i, b) in map.iter_mut().enumerate() {
+            *b = (i as u8).wrapping_add(1);
+        }
+        let shift = purecipher_arena_intern_table(arena, map.as_ptr());
+        assert_cipher_buffer(shift, "abc", "bcd");
+        assert_eq!(2, purecipher_arena_len(arena));
+
+        map[0] = map[1];
+        assert!(purecipher_arena_intern_table(arena, map.as_ptr()).ptr.is_null());
+
+        purecipher_arena_free(arena);
+        purecipher_free(rot13);
+    }
+
+    #[test]
+    fn wide_builder_cipher() {
+        let builder = purecipher_wide_builder_new();
+        purecipher_wide_builder_rotate(builder, 0x3041, 0x3096, 1);
+        purecipher_wide_builder_swap(builder, 0, 0xffff);
+        let cipher = purecipher_wide_builder_into_cipher(builder);
+
+        let mut tokens = [0x3041u16, 0x3096, 0, 42];
+        purecipher_wide_encipher(cipher, tokens.as_mut_ptr(), tokens.len());
+        assert_eq!([0x3042, 0x3041, 0xffff, 42], tokens);
+
+        purecipher_wide_decipher(cipher, tokens.as_mut_ptr(), tokens.len());
+        assert_eq!([0x3041, 0x3096, 0, 42], tokens);
+
+        purecipher_wide_free(cipher);
+
+        let table = vec![7u16; 1 << 16];
+        assert!(purecipher_wide_from_table(table.as_ptr()).is_null());
+    }
+
+    #[test]
+    fn cipher_fields() {
+        let cipher = purecipher_cipher_rot13();
+        let mut records = Vec::from("id=abc;id=def;id=ghi");
+        purecipher_encipher_strided(cipher, records[3..].as_mut_ptr(), 3, 7, 3);
+        assert_eq!(b"id=nop;id=qrs;id=tuv".as_ref(), records.as_slice());
+
+        let fields = [RecordField { offset: 0, length: 2 }, RecordField { offset: 4, length: 1 }];
+        purecipher_decipher_fields(cipher, records.as_mut_ptr(), 7, 3, fields.as_ptr(), 2);
+        assert_eq!(b"vq=nbp;vq=qes;vq=thv".as_ref(), records.as_slice());
+
+        // Fields wider than the stride must leave the records unchanged.
+        purecipher_encipher_strided(cipher, records.as_mut_ptr(), 8, 7, 3);
+        assert_eq!(b"vq=nbp;vq=qes;vq=thv".as_ref(), records.as_slice());
+
+        purecipher_free(cipher);
+    }
+
+    #[test]
+    fn selector_fields() {
+        let cipher = purecipher_cipher_rot13();
+        let selector = purecipher_selector_new(b'\t');
+        purecipher_selector_column(selector, 1);
+        let key = CString::new("name").unwrap();
+        purecipher_selector_key(selector, key.as_ptr());
+
+        let mut text = Vec::from("1\tabc\tname=def\n2\tghi\tid=jkl");
+        purecipher_selector_encipher(selector, cipher, text.as_mut_ptr(), text.len());
+        assert_eq!(b"1\tnop\tname=qrs\n2\ttuv\tid=jkl".as_ref(), text.as_slice());
+
+        purecipher_selector_decipher(selector, cipher, text.as_mut_ptr(), text.len());
+        assert_eq!(b"1\tabc\tname=def\n2\tghi\tid=jkl".as_ref(), text.as_slice());
+
+        purecipher_selector_free(selector);
+        purecipher_free(cipher);
+    }
+
+    #[test]
+    fn cipher_affine() {
+        // Swap the nibbles of each byte.
+        let rows = [0x10, 0x20, 0x40, 0x80, 0x01, 0x02, 0x04, 0x08];
+        let cipher_ptr = purecipher_cipher_affine(rows.as_ptr(), 0);
+
+        assert_cipher_buffer(cipher_ptr, [0x12, 0xab, 0x00], [0x21, 0xba, 0x00]);
+
+        purecipher_free(cipher_ptr);
+        assert!(purecipher_cipher_affine([0u8; 8].as_ptr(), 0).ptr.is_null());
+    }
+
     #[test]
     fn cipher_caesar() {
         let cipher_ptr = purecipher_cipher_caesar();
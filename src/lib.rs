@@ -7,11 +7,50 @@
 extern crate libc;
 
 mod substitution;
+mod affine;
 mod classic;
+mod batch;
+mod cstr;
+mod strided;
+mod delimited;
+mod stats;
+mod periodic;
+mod pool;
+mod context;
+mod arena;
+mod wide;
+mod swap;
+mod shared;
+mod solver;
+mod search;
+mod order;
+mod checksum;
+mod encoding;
+#[cfg(target_os = "linux")]
+mod service;
 pub mod ffi;
 
 pub use self::substitution::{SubstitutionCipher, SubstitutionBuilder};
-pub use self::classic::{caesar, leet_speak, rot13_alpha};
+pub use self::affine::AffineCipher;
+pub use self::classic::{caesar, leet_speak, rot13_alpha, CAESAR, LEET_SPEAK, ROT13_ALPHA};
+pub use self::batch::{encipher_batch, decipher_batch};
+pub use self::cstr::{encipher_cstr, decipher_cstr};
+pub use self::strided::{RecordField, encipher_fields, decipher_fields};
+pub use self::delimited::FieldSelector;
+pub use self::stats::ByteHistogram;
+pub use self::periodic::PeriodicCipher;
+pub use self::pool::{CipherJob, CipherPool, PoolBatch};
+pub use self::arena::{ArenaCipher, CipherArena};
+pub use self::wide::{WideSubstitutionCipher, WideSubstitutionBuilder};
+pub use self::swap::SwappableCipher;
+pub use self::shared::{SharedCipher, SHARED_TABLES_LEN};
+pub use self::solver::{NgramModel, Solution, Solver};
+pub use self::search::{Finder, MultiFinder, PatternMatch};
+pub use self::order::PlaintextOrder;
+pub use self::checksum::{Checksummed, crc32c, crc32c_combine, encipher_crc32c, decipher_crc32c};
+pub use self::encoding::{TextEncoding, encipher_encode, decode_decipher};
+#[cfg(target_os = "linux")]
+pub use self::service::{CipherClient, CipherService};
 
 /// Encipher some bytes with the given pure cipher.
 ///
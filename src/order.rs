@@ -0,0 +1,238 @@
+//! Ordering ciphertext by its plaintext without deciphering it.
+
+use std::cmp::Ordering;
+
+use super::PureCipher;
+use super::SubstitutionCipher;
+use super::substitution::ALL_U8;
+
+/// Buckets of at most this many keys are sorted by comparison instead of being
+/// split further by radix.
+const SMALL_BUCKET: usize = 32;
+
+/// Order of ciphertext keys by their plaintext under some cipher.
+///
+/// The order is described by a rank for each ciphertext byte: the byte it
+/// deciphers to. Two ciphertexts are ordered by the ranks of the first byte at
+/// which they differ, since equal ciphertext bytes decipher to equal plaintext,
+/// or by length if one is a prefix of the other. Keys are compared, sorted and
+/// searched in the lexicographic order of their plaintext without any of it
+/// being materialized.
+///
+/// # Example
+/// ```
+/// use std::cmp::Ordering;
+/// use purecipher::PlaintextOrder;
+///
+/// let caesar = purecipher::caesar();
+/// let order = PlaintextOrder::new(&caesar);
+///
+/// // "apple" and "xray" encipher to "dssoh" and "audb", which are in the
+/// // opposite order.
+/// assert_eq!(Ordering::Less, order.compare(b"dssoh", b"audb"));
+///
+/// let mut keys = vec![&b"audb"[..], b"edqdqd", b"dssoh"];
+/// order.sort(&mut keys);
+/// assert_eq!(vec![&b"dssoh"[..], b"edqdqd", b"audb"], keys);
+/// ```
+#[derive(Clone)]
+pub struct PlaintextOrder {
+    /// Rank of each ciphertext byte.
+    rank: [u8; ALL_U8],
+}
+
+impl PlaintextOrder {
+    /// Builds the order of ciphertext enciphered with `cipher`.
+    pub fn new(cipher: &dyn PureCipher) -> Self {
+        Self { rank: *SubstitutionCipher::from_cipher(cipher).inverse_table() }
+    }
+
+    /// Compares two ciphertexts in the lexicographic order of their
+    /// plaintext.
+    pub fn compare(&self, left: &[u8], right: &[u8]) -> Ordering {
+        match mismatch(left, right) {
+            Some(i) => self.rank[left[i] as usize].cmp(&self.rank[right[i] as usize]),
+            None => left.len().cmp(&right.len()),
+        }
+    }
+
+    /// Sorts ciphertext keys in the lexicographic order of their plaintext.
+    ///
+    /// The sort is stable. See `argsort`.
+    pub fn sort<T: AsRef<[u8]>>(&self, keys: &mut [T]) {
+        let mut order = self.argsort(keys);
+        // Move each key to its position by following the cycles of the
+        // permutation, in which position i takes the key at order[i].
+        for start in 0..order.len() {
+            let mut i = start;
+            while order[i] != start {
+                let next = order[i];
+                keys.swap(i, next);
+                order[i] = i;
+                i = next;
+            }
+            order[i] = i;
+        }
+    }
+
+    /// Returns the indices of the given ciphertext keys in the lexicographic
+    /// order of their plaintext, with equal keys in their original order.
+    ///
+    /// Keys are sorted by an MSD radix sort on the ranks of their bytes. Small
+    /// buckets of keys are finished by comparison.
+    pub fn argsort<T: AsRef<[u8]>>(&self, keys: &[T]) -> Vec<usize> {
+        let keys: Vec<&[u8]> = keys.iter().map(|key| key.as_ref()).collect();
+        let mut indices: Vec<usize> = (0..keys.len()).collect();
+        let mut scratch = vec![0; keys.len()];
+
+        // Ranges of indices whose keys share their first depth bytes.
+        let mut pending = vec![(0, keys.len(), 0)];
+        while let Some((start, end, depth)) = pending.pop() {
+            let bucket = &mut indices[start..end];
+            if bucket.len() <= SMALL_BUCKET {
+                bucket.sort_by(|&a, &b| self.compare(&keys[a][depth..], &keys[b][depth..]));
+                continue;
+            }
+
+            // Bucket 0 holds keys that end at this depth, and bucket r + 1
+            // those whose next byte has rank r.
+            let mut counts = [0usize; ALL_U8 + 1];
+            for &i in bucket.iter() {
+                counts[self.bucket(keys[i], depth)] += 1;
+            }
+            if counts[1..].iter().any(|&count| count == bucket.len()) {
+                // Every key continues with the same byte, as in a common
+                // prefix, so there is nothing to move.
+                pending.push((start, end, depth + 1));
+                continue;
+            }
+            let mut offsets = [0usize; ALL_U8 + 1];
+            let mut total = 0;
+            for (offset, &count) in offsets.iter_mut().zip(counts.iter()) {
+                *offset = total;
+                total += count;
+            }
+            let scratch = &mut scratch[..bucket.len()];
+            for &i in bucket.iter() {
+                let b = self.bucket(keys[i], depth);
+                scratch[offsets[b]] = i;
+                offsets[b] += 1;
+            }
+            bucket.copy_from_slice(scratch);
+
+            // Keys that ended are equal, so only the other buckets are split
+            // further.
+            let mut bucket_start = start + counts[0];
+            for &count in counts[1..].iter() {
+                if count > 1 {
+                    pending.push((bucket_start, bucket_start + count, depth + 1));
+                }
+                bucket_start += count;
+            }
+        }
+        indices
+    }
+
+    /// Searches sorted ciphertext keys for the given ciphertext.
+    ///
+    /// Returns `Ok` with the index of a matching key, or `Err` with the index
+    /// at which the key could be inserted while keeping the keys sorted, like
+    /// `slice::binary_search`.
+    pub fn binary_search<T: AsRef<[u8]>>(&self, sorted: &[T], key: &[u8]) -> Result<usize, usize> {
+        sorted.binary_search_by(|probe| self.compare(probe.as_ref(), key))
+    }
+
+    /// Returns the radix bucket of `key` at the given depth.
+    #[inline]
+    fn bucket(&self, key: &[u8], depth: usize) -> usize {
+        match key.get(depth) {
+            Some(&b) => self.rank[b as usize] as usize + 1,
+            None => 0,
+        }
+    }
+}
+
+/// Returns the first index at which `left` and `right` differ, if either is
+/// not a prefix of the other.
+#[inline]
+fn mismatch(left: &[u8], right: &[u8]) -> Option<usize> {
+    let len = left.len().min(right.len());
+    let (left, right) = (&left[..len], &right[..len]);
+    // Compare eight bytes at a time, and locate the first differing byte from
+    // the lowest set bit of the difference.
+    let mut offset = 0;
+    for (l, r) in left.chunks_exact(8).zip(right.chunks_exact(8)) {
+        let mut word_l = [0; 8];
+        let mut word_r = [0; 8];
+        word_l.copy_from_slice(l);
+        word_r.copy_from_slice(r);
+        let diff = u64::from_le_bytes(word_l) ^ u64::from_le_bytes(word_r);
+        if diff != 0 {
+            return Some(offset + diff.trailing_zeros() as usize / 8);
+        }
+        offset += 8;
+    }
+    (offset..len).find(|&i| left[i] != right[i])
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::{decipher_bytes, encipher_bytes, leet_speak, SubstitutionBuilder};
+
+    /// A cipher that reverses the order of byte values, so ciphertext order
+    /// is the opposite of plaintext order.
+    fn reversing() -> SubstitutionCipher {
+        let mut builder = SubstitutionBuilder::new();
+        for b in 0..128u8 {
+            builder.swap(b, 255 - b);
+        }
+        builder.into_cipher()
+    }
+
+    #[test]
+    fn compare_matches_plaintext_order() {
+        let cipher = reversing();
+        let order = PlaintextOrder::new(&cipher);
+        let plaintexts = [&b""[..], b"a", b"ab", b"abcdefghij", b"abcdefghik", b"abcdefgh", b"b", b"\xff"];
+
+        for &left in plaintexts.iter() {
+            for &right in plaintexts.iter() {
+                let (l, r) = (encipher_bytes(&cipher, left), encipher_bytes(&cipher, right));
+                assert_eq!(left.cmp(right), order.compare(&l, &r), "{:?} {:?}", left, right);
+            }
+        }
+    }
+
+    #[test]
+    fn sort_matches_plaintext_sort() {
+        let leet = leet_speak();
+        let order = PlaintextOrder::new(&leet);
+        // Many keys sharing long prefixes, so that buckets are split by radix
+        // several levels deep.
+        let mut plaintexts: Vec<Vec<u8>> = (0..5_000u32)
+            .map(|i| format!("user-{}-{}", i % 7, (i * 7919) % 1000).into_bytes())
+            .collect();
+        plaintexts.push(Vec::new());
+        plaintexts.push(b"user-".to_vec());
+        let mut keys: Vec<Vec<u8>> = plaintexts.iter().map(|p| encipher_bytes(&leet, p)).collect();
+
+        let indices = order.argsort(&keys);
+        // Equal keys keep their original order.
+        for pair in indices.windows(2) {
+            if keys[pair[0]] == keys[pair[1]] {
+                assert!(pair[0] < pair[1]);
+            }
+        }
+
+        order.sort(&mut keys);
+        plaintexts.sort();
+        let sorted: Vec<Vec<u8>> = keys.iter().map(|k| decipher_bytes(&leet, k)).collect();
+        assert_eq!(plaintexts, sorted);
+
+        let probe = encipher_bytes(&leet, "user-3-");
+        let position = order.binary_search(&keys, &probe).unwrap_err();
+        assert!(sorted[position - 1] < b"user-3-".to_vec() && sorted[position] > b"user-3-".to_vec());
+        assert!(order.binary_search(&keys, &keys[100]).is_ok());
+    }
+}
@@ -0,0 +1,318 @@
+//! Position-dependent (periodic) substitution ciphers.
+
+use std::u8;
+
+use super::{PureCipher, SubstitutionCipher};
+use super::substitution::ALL_U8;
+
+/// Minimum number of bytes in the repeated key block used by the shift kernel.
+///
+/// Blocks are a whole number of periods long, so every block of the buffer
+/// starts at the same phase of the key. A block of at least 64 bytes gives the
+/// compiler room to process it in full vector registers.
+const MIN_SHIFT_BLOCK: usize = 64;
+
+/// Longest period of general tables ciphered with the lane-masked lookup
+/// kernel.
+///
+/// The kernel performs two 128-entry lookups per phase for every vector, so
+/// beyond this period looking up one byte at a time is as fast.
+const MAX_LANE_PERIOD: usize = 16;
+
+/// Polyalphabetic cipher that selects a substitution by position.
+///
+/// The byte at stream position `i` is ciphered with the substitution at index
+/// `i % period`. Ciphering is stateless: callers pass the stream position of
+/// the first byte of each buffer, so chunks of a stream may be ciphered
+/// independently, in any order, or in parallel.
+///
+/// When every substitution is a rotation of all 256 bytes, as in a byte-wise
+/// Vigenère cipher, buffers are ciphered by adding a repeated key block to the
+/// data lane by lane instead of performing a table lookup per byte.
+///
+/// General tables with periods of up to 16 are looked up 64 bytes at a time
+/// on CPUs with AVX-512 VBMI, each table filling the lanes of its phase.
+/// Longer periods, and other CPUs, look up one byte at a time.
+///
+/// # Example
+/// ```
+/// use purecipher::PeriodicCipher;
+///
+/// let cipher = PeriodicCipher::from_shifts(&[1, 2, 3]);
+/// let mut buffer = *b"aaaaaa";
+///
+/// cipher.encipher_at(&mut buffer, 0);
+/// assert_eq!(b"bcdbcd", &buffer);
+///
+/// // The second half of the stream can be deciphered on its own.
+/// cipher.decipher_at(&mut buffer[3..], 3);
+/// assert_eq!(b"bcdaaa", &buffer);
+/// ```
+pub struct PeriodicCipher {
+    /// Lookup table enciphering the byte at each position within the period.
+    maps: Vec<[u8; ALL_U8]>,
+    /// Lookup table deciphering the byte at each position within the period.
+    inverses: Vec<[u8; ALL_U8]>,
+    /// Additive key equivalent to `maps`, if every table is a rotation.
+    shifts: Option<Vec<u8>>,
+}
+
+impl PeriodicCipher {
+    /// Builds a periodic cipher from the substitution used at each position
+    /// within the period.
+    ///
+    /// # Panics
+    /// This function will panic if `tables` is empty.
+    pub fn new(tables: Vec<SubstitutionCipher>) -> Self {
+        assert!(!tables.is_empty(), "periodic cipher requires at least one table");
+        let shifts = tables.iter().map(rotation_of).collect();
+        Self::with_shifts(&tables, shifts)
+    }
+
+    /// Builds a byte-wise Vigenère cipher that adds `key[i % key.len()]`,
+    /// modulo 256, to the byte at stream position `i`.
+    ///
+    /// # Panics
+    /// This function will panic if `key` is empty.
+    pub fn from_shifts(key: &[u8]) -> Self {
+        assert!(!key.is_empty(), "periodic cipher requires at least one table");
+        let tables: Vec<_> = key.iter().map(|&shift| shift_cipher(shift)).collect();
+        Self::with_shifts(&tables, Some(key.to_vec()))
+    }
+
+    /// Builds a periodic cipher from its substitutions and their equivalent
+    /// additive key, if any.
+    fn with_shifts(tables: &[SubstitutionCipher], shifts: Option<Vec<u8>>) -> Self {
+        let lookup = |apply: &dyn Fn(u8) -> u8| {
+            let mut map = [0; ALL_U8];
+            for b in 0..=u8::MAX {
+                map[b as usize] = apply(b);
+            }
+            map
+        };
+        Self {
+            maps: tables.iter().map(|table| lookup(&|b| table.encipher(b))).collect(),
+            inverses: tables.iter().map(|table| lookup(&|b| table.decipher(b))).collect(),
+            shifts,
+        }
+    }
+
+    /// Returns the number of positions after which the substitutions repeat.
+    pub fn period(&self) -> usize {
+        self.maps.len()
+    }
+
+    /// Enciphers `bytes` inplace, given the stream position of its first byte.
+    pub fn encipher_at(&self, bytes: &mut [u8], offset: u64) {
+        let phase = (offset % self.period() as u64) as usize;
+        match self.shifts {
+            Some(ref key) => add_key(bytes, key, phase, u8::wrapping_add),
+            None => {
+                lookup_tables(bytes, &self.maps, phase);
+            }
+        }
+    }
+
+    /// Deciphers `bytes` inplace, given the stream position of its first byte.
+    pub fn decipher_at(&self, bytes: &mut [u8], offset: u64) {
+        let phase = (offset % self.period() as u64) as usize;
+        match self.shifts {
+            Some(ref key) => add_key(bytes, key, phase, u8::wrapping_sub),
+            None => {
+                lookup_tables(bytes, &self.inverses, phase);
+            }
+        }
+    }
+}
+
+/// Combines each byte of `bytes` with the repeating `key`, starting at the
+/// given phase of the key.
+///
+/// The key is first expanded into a block spanning a whole number of periods,
+/// which is then combined with the buffer one block at a time. The inner loop
+/// has no data-dependent indexing and is vectorized by the compiler.
+fn add_key<F>(bytes: &mut [u8], key: &[u8], phase: usize, op: F)
+    where F: Fn(u8, u8) -> u8
+{
+    let periods = (MIN_SHIFT_BLOCK + key.len() - 1) / key.len();
+    let block_len = periods * key.len();
+    let expanded: Vec<u8> = key.iter()
+        .cycle()
+        .skip(phase)
+        .take(block_len)
+        .cloned()
+        .collect();
+
+    for block in bytes.chunks_mut(block_len) {
+        for (b, &k) in block.iter_mut().zip(expanded.iter()) {
+            *b = op(*b, k);
+        }
+    }
+}
+
+/// Replaces the byte at each position `i` of `bytes` through the table at index
+/// `(phase + i) % tables.len()`.
+fn lookup_tables(bytes: &mut [u8], tables: &[[u8; ALL_U8]], phase: usize) {
+    let mut done = 0;
+    #[cfg(target_arch = "x86_64")]
+    {
+        if tables.len() <= MAX_LANE_PERIOD && is_x86_feature_detected!("avx512vbmi")
+            && is_x86_feature_detected!("avx512bw") {
+            done = unsafe { lookup_tables_vbmi(bytes, tables, phase) };
+        }
+    }
+    let tables = tables.iter().cycle().skip((phase + done) % tables.len());
+    for (b, table) in bytes[done..].iter_mut().zip(tables) {
+        *b = table[*b as usize];
+    }
+}
+
+/// Looks up whole 64-byte vectors of `bytes` as `lookup_tables` does,
+/// returning the number of bytes looked up.
+///
+/// Each table is held as four 64-byte quarters. For every phase, the lanes
+/// that use its table are filled by a lookup in its lower and upper halves,
+/// selected by the high bit of each byte.
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "avx512f,avx512bw,avx512vbmi")]
+unsafe fn lookup_tables_vbmi(bytes: &mut [u8], tables: &[[u8; ALL_U8]], phase: usize) -> usize {
+    use std::arch::x86_64::*;
+
+    // Lanes of a vector starting at phase `r` that use the table at index
+    // `k`, at `lanes[r * period + k]`.
+    let period = tables.len();
+    let mut lanes = [0u64; MAX_LANE_PERIOD * MAX_LANE_PERIOD];
+    for r in 0..period {
+        for i in 0..64 {
+            lanes[r * period + (r + i) % period] |= 1 << i;
+        }
+    }
+
+    let mut r = phase;
+    for block in bytes.chunks_exact_mut(64) {
+        let x = _mm512_loadu_si512(block.as_ptr() as *const _);
+        let high = _mm512_movepi8_mask(x);
+        let mut y = _mm512_setzero_si512();
+        for (k, table) in tables.iter().enumerate() {
+            let quarter = |q: usize| _mm512_loadu_si512(table.as_ptr().add(64 * q) as *const _);
+            let uses = lanes[r * period + k];
+            let low_half = _mm512_maskz_permutex2var_epi8(uses & !high, quarter(0), x, quarter(1));
+            let high_half = _mm512_maskz_permutex2var_epi8(uses & high, quarter(2), x, quarter(3));
+            y = _mm512_ternarylogic_epi32::<0xfe>(y, low_half, high_half);
+        }
+        _mm512_storeu_si512(block.as_mut_ptr() as *mut _, y);
+        r = (r + 64) % period;
+    }
+    bytes.len() - bytes.len() % 64
+}
+
+/// Builds the substitution cipher that adds `shift` to every byte.
+fn shift_cipher(shift: u8) -> SubstitutionCipher {
+    let mut builder = super::SubstitutionBuilder::new();
+    builder.rotate_range(0, u8::MAX, shift as isize);
+    builder.into_cipher()
+}
+
+/// Returns the shift performed by `cipher` if it rotates all 256 bytes.
+fn rotation_of(cipher: &SubstitutionCipher) -> Option<u8> {
+    let shift = cipher.encipher(0);
+    if (0..=u8::MAX).all(|b| cipher.encipher(b) == b.wrapping_add(shift)) {
+        Some(shift)
+    } else {
+        None
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::{caesar, rot13_alpha};
+
+    #[test]
+    fn periodic_shifts_match_tables() {
+        let key = b"a longer key that spans more than one vector block of data";
+        let shifted = PeriodicCipher::from_shifts(key);
+        let tables: Vec<_> = key.iter().map(|&k| shift_cipher(k)).collect();
+        let tabled = PeriodicCipher::with_shifts(&tables, None);
+        let text: Vec<u8> = (0..1000u32).map(|i| (i * 31 % 251) as u8).collect();
+
+        for &offset in [0, 1, 57, 58, 1 << 40].iter() {
+            let mut expected = text.clone();
+            tabled.encipher_at(&mut expected, offset);
+
+            let mut actual = text.clone();
+            shifted.encipher_at(&mut actual, offset);
+            assert_eq!(expected, actual);
+
+            shifted.decipher_at(&mut actual, offset);
+            assert_eq!(text, actual);
+        }
+    }
+
+    #[test]
+    fn periodic_tables_round_trip() {
+        let cipher = PeriodicCipher::new(vec![caesar(), rot13_alpha(), SubstitutionCipher::default()]);
+        assert!(cipher.shifts.is_none());
+        assert_eq!(3, cipher.period());
+
+        let mut buffer = *b"aaaaaaa";
+        cipher.encipher_at(&mut buffer, 0);
+        assert_eq!(b"dnadnad", &buffer);
+
+        cipher.decipher_at(&mut buffer, 0);
+        assert_eq!(b"aaaaaaa", &buffer);
+    }
+
+    #[test]
+    fn periodic_tables_match_positions() {
+        let base = vec![caesar(), rot13_alpha(), caesar().inverse(), rot13_alpha().pow(3)];
+        let text: Vec<u8> = (0..1000u32).map(|i| (i * 31 % 251) as u8).collect();
+
+        for period in 1..=MAX_LANE_PERIOD + 1 {
+            let tables: Vec<_> = (0..period).map(|k| base[k % base.len()].pow(k as i64 + 1)).collect();
+            let cipher = PeriodicCipher::with_shifts(&tables, None);
+            for &offset in [0, 1, 63, 64, 1 << 40].iter() {
+                for &len in [0, 63, 64, 65, 200, 1000].iter() {
+                    let expected: Vec<u8> = text[..len].iter()
+                        .enumerate()
+                        .map(|(i, &b)| tables[((offset + i as u64) % period as u64) as usize].encipher(b))
+                        .collect();
+
+                    let mut actual = text[..len].to_vec();
+                    cipher.encipher_at(&mut actual, offset);
+                    assert_eq!(expected, actual);
+
+                    cipher.decipher_at(&mut actual, offset);
+                    assert_eq!(&text[..len], &actual[..]);
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn periodic_chunks_are_independent() {
+        let cipher = PeriodicCipher::new(vec![caesar(), rot13_alpha()]);
+        let text = b"The quick brown fox jumps over the lazy dog";
+
+        let mut whole = text.to_vec();
+        cipher.encipher_at(&mut whole, 5);
+
+        let mut chunked = text.to_vec();
+        let (left, right) = chunked.split_at_mut(14);
+        cipher.encipher_at(right, 5 + 14);
+        cipher.encipher_at(left, 5);
+        assert_eq!(whole, chunked);
+    }
+
+    #[test]
+    fn periodic_new_detects_rotations() {
+        let cipher = PeriodicCipher::new(vec![shift_cipher(3), shift_cipher(200)]);
+        assert_eq!(Some(vec![3, 200]), cipher.shifts);
+    }
+
+    #[test]
+    #[should_panic]
+    fn periodic_empty_key_panics() {
+        PeriodicCipher::from_shifts(&[]);
+    }
+}
@@ -0,0 +1,449 @@
+//! Work-stealing thread pool for ciphering many small buffers.
+
+use std::cmp;
+use std::collections::VecDeque;
+use std::mem;
+use std::panic::{self, AssertUnwindSafe};
+use std::slice;
+use std::sync::{Arc, Condvar, Mutex};
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::thread::{self, JoinHandle};
+
+use super::PureCipher;
+
+/// Number of bytes that a single task aims to cipher.
+///
+/// Jobs smaller than this are coalesced into one task so that the cost of
+/// scheduling is amortized over many messages, while larger jobs are split so
+/// that a single large job can still be shared between workers.
+pub(crate) const TASK_BYTES: usize = 64 * 1024;
+
+/// Direction in which the buffers of a batch are ciphered.
+#[derive(Copy, Clone, Debug, Eq, PartialEq)]
+pub(crate) enum Direction {
+    Encipher,
+    Decipher,
+}
+
+/// A buffer to be ciphered inplace with the given cipher.
+pub struct CipherJob<'a> {
+    /// Cipher applied to the buffer.
+    pub cipher: &'a (dyn PureCipher + Sync),
+    /// Bytes to be ciphered inplace.
+    pub buffer: &'a mut [u8],
+}
+
+/// Unowned view of a buffer to be ciphered by the pool.
+///
+/// The submitter of a batch guarantees that both pointers stay valid, and that
+/// no other references to the buffer exist, until the batch completes.
+#[derive(Copy, Clone)]
+pub(crate) struct RawJob {
+    pub cipher: *const dyn PureCipher,
+    pub buffer: *mut u8,
+    pub length: usize,
+}
+
+unsafe impl Send for RawJob {}
+
+unsafe impl Sync for RawJob {}
+
+/// Converts a borrowed cipher into a raw pointer for use by the pool's
+/// workers, which may only dereference it while the borrow is alive.
+fn erase_lifetime<'a>(cipher: &'a (dyn PureCipher + Sync + 'a)) -> *const dyn PureCipher {
+    let cipher = cipher as *const (dyn PureCipher + 'a);
+    unsafe { mem::transmute::<*const (dyn PureCipher + 'a), *const (dyn PureCipher + 'static)>(cipher) }
+}
+
+/// Pool of worker threads that cipher batches of buffers.
+///
+/// Each worker owns a deque of tasks. Submitted batches are divided between
+/// the deques, workers take tasks from the back of their own deque, and idle
+/// workers steal from the front of the others' deques. No queue is shared by
+/// every worker, so throughput scales with the number of cores even when
+/// buffers are only a few hundred bytes long.
+///
+/// # Example
+/// ```
+/// use purecipher::{CipherJob, CipherPool};
+///
+/// let pool = CipherPool::new(2);
+/// let caesar = purecipher::caesar();
+/// let rot13 = purecipher::rot13_alpha();
+///
+/// let mut first = *b"abc";
+/// let mut second = *b"abc";
+/// pool.encipher(vec![
+///     CipherJob { cipher: &caesar, buffer: &mut first },
+///     CipherJob { cipher: &rot13, buffer: &mut second },
+/// ]);
+///
+/// assert_eq!(b"def", &first);
+/// assert_eq!(b"nop", &second);
+/// ```
+pub struct CipherPool {
+    shared: Arc<Shared>,
+    workers: Vec<JoinHandle<()>>,
+}
+
+impl CipherPool {
+    /// Starts a pool with the given number of worker threads.
+    ///
+    /// If `threads` is zero, one worker is started per available core.
+    pub fn new(threads: usize) -> Self {
+        let threads = if threads == 0 {
+            thread::available_parallelism().map_or(1, |n| n.get())
+        } else {
+            threads
+        };
+        let shared = Arc::new(Shared {
+            deques: (0..threads).map(|_| Mutex::new(VecDeque::new())).collect(),
+            queued: AtomicUsize::new(0),
+            next_deque: AtomicUsize::new(0),
+            shutdown: AtomicBool::new(false),
+            sleep: Mutex::new(()),
+            wake: Condvar::new(),
+        });
+        let workers = (0..threads)
+            .map(|index| {
+                let shared = Arc::clone(&shared);
+                thread::spawn(move || shared.run_worker(index))
+            })
+            .collect();
+        Self { shared, workers }
+    }
+
+    /// Returns the number of worker threads in this pool.
+    pub fn threads(&self) -> usize {
+        self.workers.len()
+    }
+
+    /// Enciphers every job, blocking until all of them are complete.
+    ///
+    /// # Panics
+    /// This function will panic if any cipher panics.
+    pub fn encipher(&self, jobs: Vec<CipherJob>) {
+        self.run(jobs, Direction::Encipher)
+    }
+
+    /// Deciphers every job, blocking until all of them are complete.
+    ///
+    /// # Panics
+    /// This function will panic if any cipher panics.
+    pub fn decipher(&self, jobs: Vec<CipherJob>) {
+        self.run(jobs, Direction::Decipher)
+    }
+
+    fn run(&self, jobs: Vec<CipherJob>, direction: Direction) {
+        let raw: Vec<RawJob> = jobs.into_iter()
+            .map(|job| RawJob {
+                cipher: erase_lifetime(job.cipher),
+                buffer: job.buffer.as_mut_ptr(),
+                length: job.buffer.len(),
+            })
+            .collect();
+        // The jobs' borrows outlive this call, which does not return until
+        // every buffer has been ciphered.
+        let batch = unsafe { self.submit(&raw, direction) };
+        batch.wait();
+        assert!(!batch.panicked(), "cipher panicked in pool worker");
+    }
+
+    /// Submits a batch of jobs without waiting for it to complete.
+    ///
+    /// Every cipher and buffer must remain valid until the returned batch
+    /// reports completion.
+    pub(crate) unsafe fn submit(&self, jobs: &[RawJob], direction: Direction) -> PoolBatch {
+        let mut pieces = Vec::with_capacity(jobs.len());
+        for job in jobs.iter().filter(|job| job.length > 0) {
+            // Split large jobs so that they can be spread over several tasks.
+            let mut start = 0;
+            while start < job.length {
+                let length = cmp::min(TASK_BYTES, job.length - start);
+                pieces.push(RawJob { buffer: job.buffer.add(start), length, ..*job });
+                start += length;
+            }
+        }
+
+        // Coalesce consecutive pieces into tasks of roughly TASK_BYTES bytes.
+        let mut ranges = Vec::new();
+        let mut task_start = 0;
+        let mut task_bytes = 0;
+        for (i, piece) in pieces.iter().enumerate() {
+            task_bytes += piece.length;
+            if task_bytes >= TASK_BYTES {
+                ranges.push((task_start, i + 1));
+                task_start = i + 1;
+                task_bytes = 0;
+            }
+        }
+        if task_start < pieces.len() {
+            ranges.push((task_start, pieces.len()));
+        }
+
+        let state = Arc::new(BatchState {
+            direction,
+            pieces,
+            remaining: AtomicUsize::new(ranges.len()),
+            panicked: AtomicBool::new(false),
+            done: Mutex::new(ranges.is_empty()),
+            finished: Condvar::new(),
+        });
+        let tasks = ranges.into_iter()
+            .map(|(start, end)| Task { batch: Arc::clone(&state), start, end })
+            .collect();
+        self.shared.push_tasks(tasks);
+        PoolBatch { state }
+    }
+}
+
+impl Drop for CipherPool {
+    /// Stops the pool once every submitted task has been completed.
+    fn drop(&mut self) {
+        self.shared.shutdown.store(true, Ordering::SeqCst);
+        {
+            let _guard = self.shared.sleep.lock().unwrap();
+            self.shared.wake.notify_all();
+        }
+        for worker in self.workers.drain(..) {
+            let _ = worker.join();
+        }
+    }
+}
+
+/// Handle on the completion of a batch submitted to a `CipherPool`.
+///
+/// Dropping the handle does not cancel the batch.
+pub struct PoolBatch {
+    state: Arc<BatchState>,
+}
+
+impl PoolBatch {
+    /// Returns whether every job in the batch has been ciphered.
+    pub fn is_done(&self) -> bool {
+        self.state.remaining.load(Ordering::Acquire) == 0
+    }
+
+    /// Blocks until every job in the batch has been ciphered.
+    pub fn wait(&self) {
+        let mut done = self.state.done.lock().unwrap();
+        while !*done {
+            done = self.state.finished.wait(done).unwrap();
+        }
+    }
+
+    /// Returns whether a cipher panicked while ciphering this batch.
+    pub fn panicked(&self) -> bool {
+        self.state.panicked.load(Ordering::Acquire)
+    }
+}
+
+/// Jobs of a submitted batch and their progress.
+struct BatchState {
+    direction: Direction,
+    /// Jobs of the batch, with large jobs split into several pieces.
+    pieces: Vec<RawJob>,
+    /// Number of tasks of this batch that have not yet completed.
+    remaining: AtomicUsize,
+    panicked: AtomicBool,
+    done: Mutex<bool>,
+    finished: Condvar,
+}
+
+/// Contiguous range of a batch's pieces ciphered by one worker.
+struct Task {
+    batch: Arc<BatchState>,
+    start: usize,
+    end: usize,
+}
+
+impl Task {
+    fn run(self) {
+        let batch = &self.batch;
+        let result = panic::catch_unwind(AssertUnwindSafe(|| {
+            for piece in batch.pieces[self.start..self.end].iter() {
+                let cipher = unsafe { &*piece.cipher };
+                let buffer = unsafe { slice::from_raw_parts_mut(piece.buffer, piece.length) };
+                match batch.direction {
+                    Direction::Encipher => cipher.encipher_inplace(buffer),
+                    Direction::Decipher => cipher.decipher_inplace(buffer),
+                }
+            }
+        }));
+        if result.is_err() {
+            batch.panicked.store(true, Ordering::Release);
+        }
+        if batch.remaining.fetch_sub(1, Ordering::AcqRel) == 1 {
+            *batch.done.lock().unwrap() = true;
+            batch.finished.notify_all();
+        }
+    }
+}
+
+/// State shared between a pool and its workers.
+struct Shared {
+    /// Task deque owned by each worker.
+    deques: Vec<Mutex<VecDeque<Task>>>,
+    /// Number of tasks waiting in any deque.
+    queued: AtomicUsize,
+    /// Deque that receives the first tasks of the next submitted batch.
+    next_deque: AtomicUsize,
+    shutdown: AtomicBool,
+    /// Lock under which idle workers wait for `wake`.
+    sleep: Mutex<()>,
+    wake: Condvar,
+}
+
+impl Shared {
+    /// Divides the given tasks into contiguous runs, one per deque, and wakes
+    /// idle workers to process them.
+    fn push_tasks(&self, tasks: Vec<Task>) {
+        if tasks.is_empty() {
+            return;
+        }
+        let count = tasks.len();
+        let deques = self.deques.len();
+        let run_len = (count + deques - 1) / deques;
+        let first = self.next_deque.fetch_add(1, Ordering::Relaxed);
+
+        // The tasks are counted before any is queued, so that a worker taking
+        // one cannot decrement the count below zero.
+        self.queued.fetch_add(count, Ordering::SeqCst);
+        let mut tasks = tasks.into_iter().peekable();
+        let mut index = first;
+        while tasks.peek().is_some() {
+            let mut deque = self.deques[index % deques].lock().unwrap();
+            deque.extend(tasks.by_ref().take(run_len));
+            index += 1;
+        }
+
+        let _guard = self.sleep.lock().unwrap();
+        if count >= deques {
+            self.wake.notify_all();
+        } else {
+            for _ in 0..count {
+                self.wake.notify_one();
+            }
+        }
+    }
+
+    /// Takes a task from the back of the worker's own deque, or else steals
+    /// one from the front of another worker's deque.
+    fn find_task(&self, index: usize) -> Option<Task> {
+        if let Some(task) = self.deques[index].lock().unwrap().pop_back() {
+            return Some(task);
+        }
+        let deques = self.deques.len();
+        (1..deques)
+            .map(|k| (index + k) % deques)
+            .filter_map(|victim| self.deques[victim].lock().unwrap().pop_front())
+            .next()
+    }
+
+    fn run_worker(&self, index: usize) {
+        loop {
+            if let Some(task) = self.find_task(index) {
+                let queued = self.queued.fetch_sub(1, Ordering::SeqCst);
+                debug_assert!(queued > 0, "task taken before it was counted");
+                task.run();
+                continue;
+            }
+
+            // Tasks are counted in `queued` before they are queued and
+            // workers are woken, so checking it under the sleep lock cannot
+            // miss a submission.
+            let mut guard = self.sleep.lock().unwrap();
+            loop {
+                let queued = self.queued.load(Ordering::SeqCst);
+                if queued > 0 {
+                    break;
+                }
+                if self.shutdown.load(Ordering::SeqCst) {
+                    return;
+                }
+                guard = self.wake.wait(guard).unwrap();
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::{caesar, rot13_alpha, encipher_bytes};
+
+    #[test]
+    fn pool_small_jobs() {
+        let pool = CipherPool::new(3);
+        let caesar = caesar();
+        let rot13 = rot13_alpha();
+
+        let messages: Vec<Vec<u8>> = (0..2000)
+            .map(|i| format!("message number {}", i).into_bytes())
+            .collect();
+        let mut buffers = messages.clone();
+        let jobs = buffers.iter_mut()
+            .enumerate()
+            .map(|(i, buffer)| CipherJob {
+                cipher: if i % 2 == 0 { &caesar } else { &rot13 },
+                buffer,
+            })
+            .collect();
+        pool.encipher(jobs);
+
+        for (i, (message, buffer)) in messages.iter().zip(buffers.iter()).enumerate() {
+            let cipher: &dyn PureCipher = if i % 2 == 0 { &caesar } else { &rot13 };
+            assert_eq!(&encipher_bytes(cipher, message), buffer);
+        }
+
+        let jobs = buffers.iter_mut()
+            .enumerate()
+            .map(|(i, buffer)| CipherJob {
+                cipher: if i % 2 == 0 { &caesar } else { &rot13 },
+                buffer,
+            })
+            .collect();
+        pool.decipher(jobs);
+        assert_eq!(messages, buffers);
+    }
+
+    #[test]
+    fn pool_splits_large_jobs() {
+        let pool = CipherPool::new(2);
+        let rot13 = rot13_alpha();
+        let text: Vec<u8> = (0..3 * TASK_BYTES + 17).map(|i| b'a' + (i % 26) as u8).collect();
+
+        let mut buffer = text.clone();
+        pool.encipher(vec![CipherJob { cipher: &rot13, buffer: &mut buffer }]);
+        assert_eq!(encipher_bytes(&rot13, &text), buffer);
+    }
+
+    #[test]
+    fn pool_empty_batches() {
+        let pool = CipherPool::new(0);
+        assert!(pool.threads() > 0);
+
+        pool.encipher(Vec::new());
+        let batch = unsafe { pool.submit(&[], Direction::Encipher) };
+        assert!(batch.is_done());
+        batch.wait();
+    }
+
+    #[test]
+    fn pool_drop_completes_submitted_batches() {
+        let rot13 = rot13_alpha();
+        let mut buffer = vec![b'a'; 4 * TASK_BYTES];
+        let job = RawJob {
+            cipher: &rot13 as &dyn PureCipher as *const dyn PureCipher,
+            buffer: buffer.as_mut_ptr(),
+            length: buffer.len(),
+        };
+
+        let pool = CipherPool::new(2);
+        let batch = unsafe { pool.submit(&[job], Direction::Encipher) };
+        drop(pool);
+
+        assert!(batch.is_done());
+        assert!(buffer.iter().all(|&b| b == b'n'));
+    }
+}
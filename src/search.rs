@@ -0,0 +1,409 @@
+//! Searching ciphertext for plaintext patterns without deciphering it.
+//!
+//! A substitution cipher maps each byte independently, so plaintext occurs at
+//! some offset of the plaintext exactly when its encipherment occurs at the same
+//! offset of the ciphertext. Patterns are enciphered once and the ciphertext is
+//! searched as is.
+
+use std::cmp;
+use std::thread;
+
+use libc::{c_int, c_void};
+
+use super::PureCipher;
+use super::substitution::ALL_U8;
+
+/// Ciphertext at least this long is searched on multiple threads.
+const PARALLEL_THRESHOLD: usize = 1 << 22;
+
+/// Finder for the occurrences of a single plaintext pattern in ciphertext.
+///
+/// Candidate matches are located with the C library's `memchr`, which is
+/// vectorized on common platforms, by the byte of the pattern that is expected
+/// to be rarest in text, and then verified. The ciphertext is searched on all
+/// cores once it is large enough.
+///
+/// # Example
+/// ```
+/// use purecipher::Finder;
+///
+/// let caesar = purecipher::caesar();
+/// let ciphertext = purecipher::encipher_bytes(&caesar, "INFO ok\nERROR disk full\nERROR again");
+///
+/// let finder = Finder::new(&caesar, "ERROR");
+/// assert_eq!(Some(8), finder.find(&ciphertext));
+/// assert_eq!(vec![8, 24], finder.find_all(&ciphertext));
+/// ```
+#[derive(Clone, Debug)]
+pub struct Finder {
+    /// Enciphered pattern.
+    needle: Vec<u8>,
+    /// Position within the pattern of the byte by which candidates are located.
+    anchor: usize,
+}
+
+impl Finder {
+    /// Builds a finder for the ciphertext of `plaintext` under `cipher`.
+    pub fn new(cipher: &dyn PureCipher, plaintext: impl AsRef<[u8]>) -> Self {
+        let plaintext = plaintext.as_ref();
+        let anchor = (0..plaintext.len())
+            .min_by_key(|&i| commonness(plaintext[i]))
+            .unwrap_or(0);
+        Self { needle: super::encipher_bytes(cipher, plaintext), anchor }
+    }
+
+    /// Returns the offset of the first occurrence of the pattern in
+    /// `ciphertext`. An empty pattern occurs at offset zero.
+    pub fn find(&self, ciphertext: impl AsRef<[u8]>) -> Option<usize> {
+        let ciphertext = ciphertext.as_ref();
+        let mut found = None;
+        self.search(ciphertext, 0, ciphertext.len() + 1, |offset| {
+            found = Some(offset);
+            false
+        });
+        found
+    }
+
+    /// Returns the offsets of every occurrence of the pattern in `ciphertext`,
+    /// in increasing order, including occurrences that overlap. An empty
+    /// pattern occurs at every offset, up to and including the length of the
+    /// ciphertext.
+    pub fn find_all(&self, ciphertext: impl AsRef<[u8]>) -> Vec<usize> {
+        let ciphertext = ciphertext.as_ref();
+        collect_matches(ciphertext.len() + 1, &|start, end, matches: &mut Vec<usize>| {
+            self.search(ciphertext, start, end, |offset| {
+                matches.push(offset);
+                true
+            })
+        })
+    }
+
+    /// Calls `report` with the offset of each occurrence that starts within
+    /// `start..end`, in increasing order, until it returns `false`.
+    fn search(&self, ciphertext: &[u8], start: usize, end: usize, mut report: impl FnMut(usize) -> bool) {
+        let needle = &self.needle[..];
+        if ciphertext.len() < needle.len() {
+            return;
+        }
+        let end = cmp::min(end, ciphertext.len() - needle.len() + 1);
+        if needle.is_empty() {
+            (start..end).take_while(|&offset| report(offset)).for_each(drop);
+            return;
+        }
+
+        let anchor = self.anchor;
+        let mut offset = start;
+        while offset < end {
+            let candidate = match memchr(&ciphertext[offset + anchor..end + anchor], needle[anchor]) {
+                Some(i) => offset + i,
+                None => return,
+            };
+            if &ciphertext[candidate..candidate + needle.len()] == needle && !report(candidate) {
+                return;
+            }
+            offset = candidate + 1;
+        }
+    }
+}
+
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Eq, Ord, PartialEq, PartialOrd)]
+/// An occurrence of one of the patterns of a `MultiFinder`.
+pub struct PatternMatch {
+    /// Offset of the occurrence within the ciphertext.
+    pub offset: usize,
+    /// Index of the pattern that occurs.
+    pub pattern: usize,
+}
+
+/// Largest number of distinct anchor bytes for which a `MultiFinder` compares
+/// sixteen bytes at a time against each anchor byte, rather than looking every
+/// byte up in a table.
+const MAX_VECTOR_ANCHORS: usize = 8;
+
+/// Finder for the occurrences of several plaintext patterns in ciphertext in a
+/// single pass.
+///
+/// Like a `Finder`, each pattern is anchored at the byte expected to be rarest
+/// in text. Candidate matches are located by comparing sixteen bytes of
+/// ciphertext at a time against the distinct anchor bytes, if there are few
+/// enough, and only the patterns anchored at a matching byte are then compared.
+/// The ciphertext is searched on all cores once it is large enough.
+///
+/// # Example
+/// ```
+/// use purecipher::{MultiFinder, PatternMatch};
+///
+/// let caesar = purecipher::caesar();
+/// let ciphertext = purecipher::encipher_bytes(&caesar, "WARN low disk\nERROR disk full");
+///
+/// let finder = MultiFinder::new(&caesar, &["ERROR", "WARN", "disk"]).unwrap();
+/// let matches = finder.find_all(&ciphertext);
+/// assert_eq!(PatternMatch { offset: 14, pattern: 0 }, matches[2]);
+/// assert_eq!(vec![0, 9, 14, 20], matches.iter().map(|m| m.offset).collect::<Vec<_>>());
+/// ```
+#[derive(Clone, Debug)]
+pub struct MultiFinder {
+    /// Enciphered patterns.
+    patterns: Vec<Vec<u8>>,
+    /// Position within each pattern of the byte by which candidates are
+    /// located.
+    anchors: Vec<usize>,
+    /// Largest position of any anchor.
+    max_anchor: usize,
+    /// Distinct enciphered anchor bytes.
+    anchor_bytes: Vec<u8>,
+    /// Indices of the patterns anchored at each enciphered byte, in increasing
+    /// order.
+    by_anchor: Vec<Vec<usize>>,
+}
+
+impl MultiFinder {
+    /// Builds a finder for the ciphertext of each of `patterns` under
+    /// `cipher`.
+    ///
+    /// Returns `None` if some pattern is empty.
+    pub fn new<P: AsRef<[u8]>>(cipher: &dyn PureCipher, patterns: &[P]) -> Option<Self> {
+        if patterns.iter().any(|pattern| pattern.as_ref().is_empty()) {
+            return None;
+        }
+        let anchors: Vec<usize> = patterns.iter()
+            .map(|pattern| {
+                let pattern = pattern.as_ref();
+                (0..pattern.len()).min_by_key(|&i| commonness(pattern[i])).unwrap()
+            })
+            .collect();
+        let patterns: Vec<Vec<u8>> = patterns.iter()
+            .map(|pattern| super::encipher_bytes(cipher, pattern))
+            .collect();
+
+        let mut by_anchor = vec![Vec::new(); ALL_U8];
+        for (i, (pattern, &anchor)) in patterns.iter().zip(anchors.iter()).enumerate() {
+            by_anchor[pattern[anchor] as usize].push(i);
+        }
+        let anchor_bytes = (0..ALL_U8)
+            .filter(|&b| !by_anchor[b].is_empty())
+            .map(|b| b as u8)
+            .collect();
+        let max_anchor = anchors.iter().cloned().max().unwrap_or(0);
+        Some(Self { patterns, anchors, max_anchor, anchor_bytes, by_anchor })
+    }
+
+    /// Returns every occurrence of the patterns in `ciphertext`, ordered by
+    /// offset and then by pattern, including occurrences that overlap.
+    pub fn find_all(&self, ciphertext: impl AsRef<[u8]>) -> Vec<PatternMatch> {
+        let ciphertext = ciphertext.as_ref();
+        collect_matches(ciphertext.len(), &|start, end, matches: &mut Vec<PatternMatch>| {
+            self.search(ciphertext, start, end, matches)
+        })
+    }
+
+    /// Adds the occurrences that start within `start..end` to `matches`, in
+    /// order.
+    fn search(&self, ciphertext: &[u8], start: usize, end: usize, matches: &mut Vec<PatternMatch>) {
+        let first = matches.len();
+        let scan_end = cmp::min(end + self.max_anchor, ciphertext.len());
+        if start >= scan_end {
+            return;
+        }
+        self.scan(&ciphertext[start..scan_end], |position| {
+            let position = start + position;
+            for &i in self.by_anchor[ciphertext[position] as usize].iter() {
+                let anchor = self.anchors[i];
+                if position < anchor || position - anchor < start || position - anchor >= end {
+                    continue;
+                }
+                let offset = position - anchor;
+                if ciphertext[offset..].starts_with(&self.patterns[i]) {
+                    matches.push(PatternMatch { offset, pattern: i });
+                }
+            }
+        });
+        // Patterns anchored at different positions are found out of order.
+        matches[first..].sort_unstable();
+    }
+
+    /// Calls `hit` with the position of each anchor byte in `bytes`, in
+    /// increasing order.
+    fn scan(&self, bytes: &[u8], mut hit: impl FnMut(usize)) {
+        let mut scanned = 0;
+        #[cfg(target_arch = "x86_64")]
+        {
+            if self.anchor_bytes.len() <= MAX_VECTOR_ANCHORS {
+                scanned = unsafe { self.scan_sse2(bytes, &mut hit) };
+            }
+        }
+        for (i, &b) in bytes.iter().enumerate().skip(scanned) {
+            if !self.by_anchor[b as usize].is_empty() {
+                hit(i);
+            }
+        }
+    }
+
+    /// Calls `hit` with the position of each anchor byte in the longest prefix
+    /// of `bytes` that is a multiple of sixteen bytes long, and returns the
+    /// length of that prefix.
+    #[cfg(target_arch = "x86_64")]
+    unsafe fn scan_sse2(&self, bytes: &[u8], hit: &mut impl FnMut(usize)) -> usize {
+        use std::arch::x86_64::*;
+
+        let mut needles = [_mm_setzero_si128(); MAX_VECTOR_ANCHORS];
+        for (needle, &b) in needles.iter_mut().zip(self.anchor_bytes.iter()) {
+            *needle = _mm_set1_epi8(b as i8);
+        }
+        let needles = &needles[..self.anchor_bytes.len()];
+
+        let blocks = bytes.len() / 16;
+        for block in 0..blocks {
+            let chunk = _mm_loadu_si128(bytes.as_ptr().add(block * 16) as *const __m128i);
+            let mut found = _mm_setzero_si128();
+            for &needle in needles {
+                found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, needle));
+            }
+            let mut mask = _mm_movemask_epi8(found) as u32;
+            while mask != 0 {
+                hit(block * 16 + mask.trailing_zeros() as usize);
+                mask &= mask - 1;
+            }
+        }
+        blocks * 16
+    }
+}
+
+/// Runs `search` over the candidate offsets `0..len`, splitting them between
+/// all available cores if there are enough, and returns the matches it adds in
+/// order.
+///
+/// `search(start, end, matches)` must add the matches that start within
+/// `start..end` to `matches` in order.
+fn collect_matches<T: Send>(len: usize, search: &(dyn Fn(usize, usize, &mut Vec<T>) + Sync)) -> Vec<T> {
+    let threads = thread::available_parallelism().map_or(1, |n| n.get());
+    let mut matches = Vec::new();
+    if len < PARALLEL_THRESHOLD || threads == 1 {
+        search(0, len, &mut matches);
+        return matches;
+    }
+
+    let chunk_len = (len + threads - 1) / threads;
+    let partials: Vec<Vec<T>> = thread::scope(|scope| {
+        let handles: Vec<_> = (0..len).step_by(chunk_len)
+            .map(|start| scope.spawn(move || {
+                let mut partial = Vec::new();
+                search(start, cmp::min(start + chunk_len, len), &mut partial);
+                partial
+            }))
+            .collect();
+        handles.into_iter().map(|h| h.join().unwrap()).collect()
+    });
+    for partial in partials {
+        matches.extend(partial);
+    }
+    matches
+}
+
+/// Returns the offset of the first occurrence of `byte` in `bytes`.
+#[inline]
+fn memchr(bytes: &[u8], byte: u8) -> Option<usize> {
+    let found = unsafe { libc::memchr(bytes.as_ptr() as *const c_void, byte as c_int, bytes.len()) };
+    if found.is_null() {
+        None
+    } else {
+        Some(found as usize - bytes.as_ptr() as usize)
+    }
+}
+
+/// Rough commonness of a byte in text such as logs and documents, higher
+/// being more common.
+///
+/// A finder locates candidate matches by the least common byte of its pattern
+/// so that as few candidates as possible need to be verified. The ciphertext of
+/// a byte is exactly as common in ciphertext as the byte is in plaintext.
+fn commonness(b: u8) -> u8 {
+    const LETTERS: &[u8; 26] = b"etaoinshrdlcumwfgypbvkjxqz";
+    match b {
+        b' ' => 255,
+        b'a'..=b'z' => 250 - LETTERS.iter().position(|&l| l == b).unwrap() as u8,
+        b'A'..=b'Z' => 200 - LETTERS.iter().position(|&l| l == b.to_ascii_lowercase()).unwrap() as u8,
+        b'\n' | b'\t' | b'.' | b',' | b':' | b'=' | b'"' => 210,
+        b'0'..=b'9' => 170,
+        0x21..=0x7e => 150,
+        _ => 100,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::{caesar, encipher_bytes, leet_speak, rot13_alpha};
+
+    /// Offsets of every occurrence of `needle` in `haystack`, found naively.
+    fn naive(haystack: &[u8], needle: &[u8]) -> Vec<usize> {
+        (0..=haystack.len())
+            .filter(|&i| haystack[i..].starts_with(needle))
+            .collect()
+    }
+
+    #[test]
+    fn finder_matches_naive_search() {
+        let leet = leet_speak();
+        let text = b"elite hackers speak leet; leet leet leeet! see? tele-leet".as_ref();
+        let ciphertext = encipher_bytes(&leet, text);
+
+        for needle in [&b"leet"[..], b"ee", b"e", b"!", b"t", b"elite", b"missing", b""].iter() {
+            let finder = Finder::new(&leet, needle);
+            let expected = naive(text, needle);
+            assert_eq!(expected, finder.find_all(&ciphertext), "{:?}", needle);
+            assert_eq!(expected.first().cloned(), finder.find(&ciphertext));
+        }
+        assert_eq!(None, Finder::new(&leet, "longer than the ciphertext").find(b"short"));
+        assert_eq!(vec![0], Finder::new(&leet, "").find_all(b""));
+    }
+
+    #[test]
+    fn finder_threaded_matches_serial() {
+        let rot13 = rot13_alpha();
+        let text: Vec<u8> = (0..PARALLEL_THRESHOLD + 12_345)
+            .map(|i| b"abcab"[(i * 7 + i / 5) % 5])
+            .collect();
+        let ciphertext = encipher_bytes(&rot13, &text);
+
+        let finder = Finder::new(&rot13, "acbb");
+        let mut serial = Vec::new();
+        finder.search(&ciphertext, 0, ciphertext.len() + 1, |offset| {
+            serial.push(offset);
+            true
+        });
+        assert!(!serial.is_empty());
+        assert_eq!(serial, finder.find_all(&ciphertext));
+
+        let multi = MultiFinder::new(&rot13, &["acbb", "bb", "aaa"]).unwrap();
+        let mut serial = Vec::new();
+        multi.search(&ciphertext, 0, ciphertext.len(), &mut serial);
+        assert!(!serial.is_empty());
+        assert_eq!(serial, multi.find_all(&ciphertext));
+    }
+
+    #[test]
+    fn multi_finder_matches_naive_search() {
+        let caesar = caesar();
+        let text = b"a cat, a cart and a carton".as_ref();
+        let ciphertext = encipher_bytes(&caesar, text);
+
+        // More distinct anchor bytes than are compared sixteen at a time.
+        let many = ["a", "c", "t", "r", "n", "o", "d", ",", " ", "ca", "on"];
+        for patterns in [&["cat", "car", "carton", "a c"][..], &["a", "ca", "zzz"], &["rt"], &many].iter() {
+            let finder = MultiFinder::new(&caesar, patterns).unwrap();
+            let mut expected: Vec<PatternMatch> = patterns.iter().enumerate()
+                .flat_map(|(i, pattern)| {
+                    naive(text, pattern.as_bytes()).into_iter().map(move |offset| PatternMatch { offset, pattern: i })
+                })
+                .collect();
+            expected.sort();
+            assert_eq!(expected, finder.find_all(&ciphertext), "{:?}", patterns);
+        }
+
+        let none: [&str; 0] = [];
+        assert!(MultiFinder::new(&caesar, &none).unwrap().find_all(&ciphertext).is_empty());
+        assert!(MultiFinder::new(&caesar, &["cat", ""]).is_none());
+    }
+}
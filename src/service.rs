@@ -0,0 +1,913 @@
+//! Local cipher service shared by processes through shared memory.
+//!
+//! A `CipherService` owns the ciphers, the table cache and the worker threads
+//! of every process on a host. Clients connect over a Unix domain socket,
+//! which carries only control messages: looking up ciphers by name and
+//! attaching a ring of buffers. The ring is a memfd mapped by both the client
+//! and the service, so the bytes to cipher are written by the client directly
+//! into memory the service ciphers in place, and neither side copies them.
+//! The service only maps memfds sealed against resizing, so a client cannot
+//! pull the ring out from under it.
+//! Submissions and completions are announced through futexes in the ring,
+//! which are only woken when the other side is asleep.
+
+use std::collections::HashMap;
+use std::ffi::CString;
+use std::hint;
+use std::io::{self, Read, Write};
+use std::mem;
+use std::os::unix::io::{AsRawFd, FromRawFd, OwnedFd, RawFd};
+use std::os::unix::net::{UnixListener, UnixStream};
+use std::path::{Path, PathBuf};
+use std::ptr;
+use std::slice;
+use std::sync::{Arc, Mutex, RwLock};
+use std::sync::atomic::{AtomicBool, AtomicU32, Ordering};
+use std::thread::{self, JoinHandle};
+use std::time::Duration;
+
+use super::{CipherArena, CipherJob, CipherPool, PureCipher};
+use super::arena::ArenaCipher;
+use super::pool::TASK_BYTES;
+
+/// Longest cipher name that can be looked up, in bytes.
+pub const MAX_NAME: usize = 64;
+
+/// Most slots that a single ring may hold.
+pub const MAX_SLOTS: usize = 4096;
+
+/// Identifies a ring created by a compatible client.
+const RING_MAGIC: u32 = 0x5043_5247;
+
+/// Size of the ring header and of each slot header, one cache line each so
+/// that the client and the service do not falsely share them.
+const LINE: usize = 64;
+
+/// Number of times a side polls for the other before going to sleep, on hosts
+/// with more than one core.
+const SPINS: usize = 200;
+
+/// How long a client sleeps before checking that the service is still alive.
+const CLIENT_POLL: Duration = Duration::from_millis(100);
+
+/// Slot states. A slot is free, or owned by the client, until it is
+/// submitted; it is owned by the service until it is done or has failed.
+const SLOT_FREE: u32 = 0;
+const SLOT_SUBMITTED: u32 = 1;
+const SLOT_DONE: u32 = 2;
+const SLOT_FAILED: u32 = 3;
+
+/// Control message operations.
+const OP_LOOKUP: u32 = 1;
+const OP_ATTACH: u32 = 2;
+
+/// Header at the start of a ring's shared memory.
+///
+/// Every field is atomic since the other process may access it at any time.
+#[repr(C)]
+struct RingHeader {
+    magic: AtomicU32,
+    slots: AtomicU32,
+    slot_size: AtomicU32,
+    /// Futex word advanced by the client after submitting slots.
+    submitted: AtomicU32,
+    /// Futex word advanced by the service after completing slots.
+    completed: AtomicU32,
+    /// Whether the service is waiting on `submitted`.
+    service_waiting: AtomicU32,
+    /// Whether the client is waiting on `completed`.
+    client_waiting: AtomicU32,
+    /// Set by the service when it stops serving the ring.
+    closed: AtomicU32,
+}
+
+/// Header describing the submission held by one slot of a ring.
+#[repr(C)]
+struct SlotHeader {
+    state: AtomicU32,
+    cipher: AtomicU32,
+    decipher: AtomicU32,
+    length: AtomicU32,
+}
+
+/// Placement of the headers and buffers within a ring.
+///
+/// The ring header is followed by one line per slot header, then by the slot
+/// buffers, each of which starts on its own line.
+#[derive(Copy, Clone)]
+struct Layout {
+    slots: usize,
+    slot_size: usize,
+    stride: usize,
+}
+
+impl Layout {
+    fn new(slots: usize, slot_size: usize) -> Option<Self> {
+        if slots == 0 || slots > MAX_SLOTS || slot_size == 0 || slot_size > u32::MAX as usize {
+            return None;
+        }
+        let stride = slot_size.checked_add(LINE - 1)? / LINE * LINE;
+        stride.checked_mul(slots)?.checked_add(LINE * (slots + 1))?;
+        Some(Self { slots, slot_size, stride })
+    }
+
+    fn len(&self) -> usize {
+        LINE * (self.slots + 1) + self.stride * self.slots
+    }
+
+    fn slot_header(&self, slot: usize) -> usize {
+        LINE * (slot + 1)
+    }
+
+    fn slot_buffer(&self, slot: usize) -> usize {
+        LINE * (self.slots + 1) + self.stride * slot
+    }
+}
+
+/// Shared memory mapping of a ring.
+struct Mapping {
+    ptr: *mut u8,
+    layout: Layout,
+}
+
+unsafe impl Send for Mapping {}
+
+unsafe impl Sync for Mapping {}
+
+impl Mapping {
+    fn map(fd: RawFd, layout: Layout) -> io::Result<Self> {
+        let ptr = unsafe {
+            libc::mmap(ptr::null_mut(), layout.len(), libc::PROT_READ | libc::PROT_WRITE, libc::MAP_SHARED, fd, 0)
+        };
+        if ptr == libc::MAP_FAILED {
+            return Err(io::Error::last_os_error());
+        }
+        Ok(Self { ptr: ptr as *mut u8, layout })
+    }
+
+    fn header(&self) -> &RingHeader {
+        unsafe { &*(self.ptr as *const RingHeader) }
+    }
+
+    fn slot(&self, slot: usize) -> &SlotHeader {
+        debug_assert!(slot < self.layout.slots);
+        unsafe { &*(self.ptr.add(self.layout.slot_header(slot)) as *const SlotHeader) }
+    }
+
+    /// Returns the buffer of the given slot.
+    ///
+    /// The caller must own the slot, as recorded by its state.
+    unsafe fn buffer(&self, slot: usize, length: usize) -> &mut [u8] {
+        debug_assert!(slot < self.layout.slots && length <= self.layout.slot_size);
+        slice::from_raw_parts_mut(self.ptr.add(self.layout.slot_buffer(slot)), length)
+    }
+}
+
+impl Drop for Mapping {
+    fn drop(&mut self) {
+        unsafe { libc::munmap(self.ptr as *mut libc::c_void, self.layout.len()) };
+    }
+}
+
+/// Control message sent from a client to the service.
+#[repr(C)]
+#[derive(Copy, Clone)]
+struct Request {
+    op: u32,
+    name_len: u32,
+    name: [u8; MAX_NAME],
+}
+
+/// Control message sent from the service in reply to a request.
+#[repr(C)]
+#[derive(Copy, Clone)]
+struct Reply {
+    /// Zero on success, or a negated errno value.
+    status: i32,
+    value: u32,
+}
+
+/// Cipher service shared by every client on a host.
+///
+/// Ciphers registered with the service are interned in a single
+/// `CipherArena`, so each distinct table is stored once however many clients
+/// use it, and every client's buffers are ciphered by a single `CipherPool`,
+/// so the service alone decides how many cores ciphering may use.
+///
+/// Each client connection is served by a thread that reads control messages,
+/// and each attached ring by a thread that collects submitted slots and
+/// ciphers them. Batches smaller than one pool task are ciphered by the ring's
+/// thread itself.
+///
+/// Dropping the service stops serving every client and removes its socket.
+///
+/// # Example
+/// ```
+/// use purecipher::{CipherClient, CipherService};
+///
+/// let path = std::env::temp_dir().join(format!("purecipher-doc-{}.sock", std::process::id()));
+/// let service = CipherService::bind(&path, 2).unwrap();
+/// service.register("rot13", &purecipher::rot13_alpha());
+///
+/// let mut client = CipherClient::connect(&path, 4, 4096).unwrap();
+/// let rot13 = client.lookup("rot13").unwrap();
+///
+/// client.buffer(0)[..5].copy_from_slice(b"hello");
+/// client.submit(0, rot13, 5, false);
+/// client.wait(0).unwrap();
+/// assert_eq!(b"uryyb", &client.buffer(0)[..5]);
+/// ```
+pub struct CipherService {
+    shared: Arc<ServiceShared>,
+    path: PathBuf,
+    acceptor: Option<JoinHandle<()>>,
+}
+
+/// State shared between a service and the threads serving its clients.
+struct ServiceShared {
+    pool: CipherPool,
+    arena: CipherArena,
+    registry: RwLock<Registry>,
+    connections: Mutex<Vec<(UnixStream, JoinHandle<()>)>>,
+    shutdown: AtomicBool,
+}
+
+/// Registered ciphers, identified by their index.
+struct Registry {
+    names: HashMap<String, u32>,
+    ciphers: Vec<Registered>,
+}
+
+/// Cipher interned in the service's arena, which outlives every thread that
+/// refers to it.
+#[derive(Copy, Clone)]
+struct Registered(*const ArenaCipher);
+
+unsafe impl Send for Registered {}
+
+unsafe impl Sync for Registered {}
+
+impl CipherService {
+    /// Starts a service listening on the Unix domain socket at `path`, with
+    /// the given number of pool workers.
+    ///
+    /// If `threads` is zero, one worker is started per available core.
+    pub fn bind<P: AsRef<Path>>(path: P, threads: usize) -> io::Result<Self> {
+        let path = path.as_ref().to_path_buf();
+        let listener = UnixListener::bind(&path)?;
+        let shared = Arc::new(ServiceShared {
+            pool: CipherPool::new(threads),
+            arena: CipherArena::new(),
+            registry: RwLock::new(Registry { names: HashMap::new(), ciphers: Vec::new() }),
+            connections: Mutex::new(Vec::new()),
+            shutdown: AtomicBool::new(false),
+        });
+        let acceptor = {
+            let shared = Arc::clone(&shared);
+            thread::spawn(move || shared.accept(listener))
+        };
+        Ok(Self { shared, path, acceptor: Some(acceptor) })
+    }
+
+    /// Registers a cipher under the given name, returning its identifier.
+    ///
+    /// Registering a name again makes it refer to the new cipher; clients
+    /// that already looked up the old cipher continue to use it.
+    ///
+    /// # Panics
+    /// This function will panic if `name` is longer than `MAX_NAME` bytes.
+    pub fn register(&self, name: &str, cipher: &dyn PureCipher) -> u32 {
+        assert!(name.len() <= MAX_NAME, "cipher name is longer than MAX_NAME bytes");
+        let interned = Registered(self.shared.arena.intern(cipher));
+        let mut registry = self.shared.registry.write().unwrap();
+        let id = registry.ciphers.len() as u32;
+        registry.ciphers.push(interned);
+        registry.names.insert(name.to_owned(), id);
+        id
+    }
+}
+
+impl Drop for CipherService {
+    /// Stops serving every client and removes the service's socket.
+    fn drop(&mut self) {
+        self.shared.shutdown.store(true, Ordering::SeqCst);
+        // Wake the acceptor, which checks for shutdown after each connection.
+        let _ = UnixStream::connect(&self.path);
+        if let Some(acceptor) = self.acceptor.take() {
+            let _ = acceptor.join();
+        }
+        let connections = mem::replace(&mut *self.shared.connections.lock().unwrap(), Vec::new());
+        for (stream, handle) in connections {
+            let _ = stream.shutdown(std::net::Shutdown::Both);
+            let _ = handle.join();
+        }
+        let _ = std::fs::remove_file(&self.path);
+    }
+}
+
+impl ServiceShared {
+    fn accept(self: Arc<Self>, listener: UnixListener) {
+        for stream in listener.incoming() {
+            if self.shutdown.load(Ordering::SeqCst) {
+                return;
+            }
+            let stream = match stream {
+                Ok(stream) => stream,
+                Err(_) => continue,
+            };
+            let control = match stream.try_clone() {
+                Ok(control) => control,
+                Err(_) => continue,
+            };
+            let shared = Arc::clone(&self);
+            let handle = thread::spawn(move || shared.serve(stream));
+            let mut connections = self.connections.lock().unwrap();
+            connections.retain(|&(_, ref handle)| !handle.is_finished());
+            connections.push((control, handle));
+        }
+    }
+
+    /// Answers a client's control messages until it disconnects.
+    fn serve(self: Arc<Self>, stream: UnixStream) {
+        let mut ring: Option<(Arc<RingServer>, JoinHandle<()>)> = None;
+        while let Ok(Some((request, fd))) = recv_request(&stream) {
+            let reply = match request.op {
+                OP_LOOKUP => self.lookup(&request),
+                OP_ATTACH if ring.is_none() => match fd.map(RingServer::attach) {
+                    Some(Ok(server)) => {
+                        let server = Arc::new(server);
+                        let handle = {
+                            let (shared, server) = (Arc::clone(&self), Arc::clone(&server));
+                            thread::spawn(move || server.run(&shared))
+                        };
+                        ring = Some((server, handle));
+                        Reply { status: 0, value: 0 }
+                    }
+                    Some(Err(err)) => Reply { status: -err.raw_os_error().unwrap_or(libc::EINVAL), value: 0 },
+                    None => Reply { status: -libc::EINVAL, value: 0 },
+                },
+                _ => Reply { status: -libc::EINVAL, value: 0 },
+            };
+            if (&stream).write_all(as_bytes(&reply)).is_err() {
+                break;
+            }
+        }
+        if let Some((server, handle)) = ring {
+            server.stop();
+            let _ = handle.join();
+        }
+    }
+
+    fn lookup(&self, request: &Request) -> Reply {
+        let name = request.name.get(..request.name_len as usize)
+            .and_then(|name| std::str::from_utf8(name).ok());
+        match name.and_then(|name| self.registry.read().unwrap().names.get(name).cloned()) {
+            Some(id) => Reply { status: 0, value: id },
+            None => Reply { status: -libc::ENOENT, value: 0 },
+        }
+    }
+}
+
+/// Service side of an attached ring.
+struct RingServer {
+    mapping: Mapping,
+    stop: AtomicBool,
+    spins: usize,
+}
+
+impl RingServer {
+    /// Maps the ring in the given memfd, after checking that it is sealed
+    /// against shrinking and as large as its header claims.
+    ///
+    /// A client that could shrink the memfd after attaching it would make
+    /// the service fault on its next access to the ring.
+    fn attach(fd: OwnedFd) -> io::Result<Self> {
+        let invalid = || io::Error::from_raw_os_error(libc::EINVAL);
+        let seals = unsafe { libc::fcntl(fd.as_raw_fd(), libc::F_GET_SEALS) };
+        if seals < 0 || seals & libc::F_SEAL_SHRINK == 0 {
+            return Err(invalid());
+        }
+        let mut stat: libc::stat = unsafe { mem::zeroed() };
+        if unsafe { libc::fstat(fd.as_raw_fd(), &mut stat) } != 0 {
+            return Err(io::Error::last_os_error());
+        }
+        if (stat.st_size as usize) < LINE {
+            return Err(invalid());
+        }
+        let header = Mapping::map(fd.as_raw_fd(), Layout { slots: 0, slot_size: 0, stride: 0 })?;
+        let magic = header.header().magic.load(Ordering::Acquire);
+        let slots = header.header().slots.load(Ordering::Relaxed) as usize;
+        let slot_size = header.header().slot_size.load(Ordering::Relaxed) as usize;
+        drop(header);
+
+        // The geometry is read once, so the client cannot later change it.
+        let layout = Layout::new(slots, slot_size).ok_or_else(invalid)?;
+        if magic != RING_MAGIC || (stat.st_size as usize) < layout.len() {
+            return Err(invalid());
+        }
+        Ok(Self { mapping: Mapping::map(fd.as_raw_fd(), layout)?, stop: AtomicBool::new(false), spins: spin_limit() })
+    }
+
+    fn stop(&self) {
+        self.stop.store(true, Ordering::SeqCst);
+        let header = self.mapping.header();
+        header.submitted.fetch_add(1, Ordering::SeqCst);
+        futex_wake(&header.submitted);
+    }
+
+    /// Ciphers submitted slots until the ring is stopped.
+    fn run(&self, shared: &ServiceShared) {
+        let header = self.mapping.header();
+        let layout = self.mapping.layout;
+        let mut spins = 0;
+        loop {
+            let seen = header.submitted.load(Ordering::SeqCst);
+            if self.stop.load(Ordering::SeqCst) {
+                break;
+            }
+
+            let mut encipher = Vec::new();
+            let mut decipher = Vec::new();
+            let mut failed = Vec::new();
+            let mut bytes = 0;
+            {
+                let registry = shared.registry.read().unwrap();
+                for slot in 0..layout.slots {
+                    let header = self.mapping.slot(slot);
+                    if header.state.load(Ordering::Acquire) != SLOT_SUBMITTED {
+                        continue;
+                    }
+                    // Every field is read once and checked, since the client
+                    // is not trusted to leave them alone.
+                    let cipher = registry.ciphers.get(header.cipher.load(Ordering::Relaxed) as usize);
+                    let length = header.length.load(Ordering::Relaxed) as usize;
+                    match cipher {
+                        Some(&Registered(cipher)) if length <= layout.slot_size => {
+                            let job = (slot, unsafe { &*cipher }, length);
+                            if header.decipher.load(Ordering::Relaxed) != 0 {
+                                decipher.push(job);
+                            } else {
+                                encipher.push(job);
+                            }
+                            bytes += length;
+                        }
+                        _ => failed.push(slot),
+                    }
+                }
+            }
+
+            if encipher.is_empty() && decipher.is_empty() && failed.is_empty() {
+                if spins < self.spins {
+                    spins += 1;
+                    hint::spin_loop();
+                    continue;
+                }
+                spins = 0;
+                header.service_waiting.store(1, Ordering::SeqCst);
+                futex_wait(&header.submitted, seen, None);
+                header.service_waiting.store(0, Ordering::SeqCst);
+                continue;
+            }
+            spins = 0;
+
+            if bytes < TASK_BYTES {
+                for job in self.jobs(&encipher) {
+                    job.cipher.encipher_inplace(job.buffer);
+                }
+                for job in self.jobs(&decipher) {
+                    job.cipher.decipher_inplace(job.buffer);
+                }
+            } else {
+                shared.pool.encipher(self.jobs(&encipher));
+                shared.pool.decipher(self.jobs(&decipher));
+            }
+
+            let done = encipher.iter().chain(decipher.iter()).map(|&(slot, _, _)| (slot, SLOT_DONE));
+            for (slot, state) in done.chain(failed.iter().map(|&slot| (slot, SLOT_FAILED))) {
+                self.mapping.slot(slot).state.store(state, Ordering::Release);
+            }
+            header.completed.fetch_add(1, Ordering::SeqCst);
+            if header.client_waiting.load(Ordering::SeqCst) != 0 {
+                futex_wake(&header.completed);
+            }
+        }
+
+        header.closed.store(1, Ordering::SeqCst);
+        header.completed.fetch_add(1, Ordering::SeqCst);
+        futex_wake(&header.completed);
+    }
+
+    /// Builds jobs for the buffers of the given submitted slots, which are
+    /// owned by the service until it marks them done.
+    fn jobs<'a>(&'a self, slots: &[(usize, &'a ArenaCipher, usize)]) -> Vec<CipherJob<'a>> {
+        slots.iter()
+            .map(|&(slot, cipher, length)| CipherJob { cipher, buffer: unsafe { self.mapping.buffer(slot, length) } })
+            .collect()
+    }
+}
+
+/// Client of a `CipherService`, with a ring of buffers shared with it.
+///
+/// Slots of the ring are identified by their index. The client fills a
+/// slot's buffer in place, submits it, and once the service has ciphered it,
+/// reads the result from the same buffer. Any number of slots may be in
+/// flight at once.
+///
+/// A client is used by one thread at a time, so processes with many threads
+/// should give each thread its own client.
+pub struct CipherClient {
+    stream: UnixStream,
+    mapping: Mapping,
+    in_flight: Vec<bool>,
+    spins: usize,
+}
+
+impl CipherClient {
+    /// Connects to the service listening at `path` and attaches a ring of
+    /// `slots` buffers of `slot_size` bytes each.
+    pub fn connect<P: AsRef<Path>>(path: P, slots: usize, slot_size: usize) -> io::Result<Self> {
+        let layout = Layout::new(slots, slot_size).ok_or_else(|| io::Error::from_raw_os_error(libc::EINVAL))?;
+        let stream = UnixStream::connect(path)?;
+        let fd = ring_memfd(layout.len())?;
+        Self::attach(stream, &fd, layout)
+    }
+
+    /// Initializes the ring in the given memfd and attaches it to the
+    /// service at the other end of `stream`.
+    fn attach(stream: UnixStream, fd: &OwnedFd, layout: Layout) -> io::Result<Self> {
+        let mapping = Mapping::map(fd.as_raw_fd(), layout)?;
+        let header = mapping.header();
+        header.slots.store(layout.slots as u32, Ordering::Relaxed);
+        header.slot_size.store(layout.slot_size as u32, Ordering::Relaxed);
+        header.magic.store(RING_MAGIC, Ordering::Release);
+
+        let client = Self { stream, mapping, in_flight: vec![false; layout.slots], spins: spin_limit() };
+        client.request(OP_ATTACH, "", Some(fd.as_raw_fd()))?;
+        Ok(client)
+    }
+
+    /// Returns the identifier of the cipher registered under `name`.
+    pub fn lookup(&self, name: &str) -> io::Result<u32> {
+        if name.len() > MAX_NAME {
+            return Err(io::Error::from_raw_os_error(libc::ENAMETOOLONG));
+        }
+        self.request(OP_LOOKUP, name, None)
+    }
+
+    /// Returns the number of slots in this client's ring.
+    pub fn slots(&self) -> usize {
+        self.mapping.layout.slots
+    }
+
+    /// Returns the size of each slot's buffer.
+    pub fn slot_size(&self) -> usize {
+        self.mapping.layout.slot_size
+    }
+
+    /// Returns whether the given slot has been submitted but not waited on.
+    pub fn in_flight(&self, slot: usize) -> bool {
+        self.in_flight[slot]
+    }
+
+    /// Returns the whole buffer of the given slot.
+    ///
+    /// # Panics
+    /// This function will panic if the slot does not exist or is in flight.
+    pub fn buffer(&mut self, slot: usize) -> &mut [u8] {
+        assert!(!self.in_flight[slot], "slot is in flight");
+        unsafe { self.mapping.buffer(slot, self.mapping.layout.slot_size) }
+    }
+
+    /// Submits the first `length` bytes of the given slot to be enciphered,
+    /// or deciphered, with the given cipher.
+    ///
+    /// # Panics
+    /// This function will panic if the slot does not exist or is in flight,
+    /// or if `length` exceeds the size of the slot.
+    pub fn submit(&mut self, slot: usize, cipher: u32, length: usize, decipher: bool) {
+        assert!(!self.in_flight[slot], "slot is in flight");
+        assert!(length <= self.slot_size(), "length exceeds slot size");
+        self.in_flight[slot] = true;
+
+        let slot = self.mapping.slot(slot);
+        slot.cipher.store(cipher, Ordering::Relaxed);
+        slot.decipher.store(decipher as u32, Ordering::Relaxed);
+        slot.length.store(length as u32, Ordering::Relaxed);
+        slot.state.store(SLOT_SUBMITTED, Ordering::Release);
+
+        let header = self.mapping.header();
+        header.submitted.fetch_add(1, Ordering::SeqCst);
+        if header.service_waiting.load(Ordering::SeqCst) != 0 {
+            futex_wake(&header.submitted);
+        }
+    }
+
+    /// Blocks until the service has ciphered the given slot, which is then
+    /// owned by the client again.
+    ///
+    /// Returns immediately if the slot is not in flight. Fails if the service
+    /// rejected the submission, in which case the buffer is left unchanged,
+    /// or if the service stopped.
+    pub fn wait(&mut self, slot: usize) -> io::Result<()> {
+        if !self.in_flight[slot] {
+            return Ok(());
+        }
+        let header = self.mapping.header();
+        let state = &self.mapping.slot(slot).state;
+        let mut spins = 0;
+        loop {
+            let seen = header.completed.load(Ordering::SeqCst);
+            match state.load(Ordering::Acquire) {
+                SLOT_DONE | SLOT_FAILED => break,
+                _ => {}
+            }
+            if header.closed.load(Ordering::SeqCst) != 0 {
+                return Err(io::Error::from_raw_os_error(libc::EPIPE));
+            }
+            if spins < self.spins {
+                spins += 1;
+                hint::spin_loop();
+                continue;
+            }
+            header.client_waiting.store(1, Ordering::SeqCst);
+            futex_wait(&header.completed, seen, Some(CLIENT_POLL));
+            header.client_waiting.store(0, Ordering::SeqCst);
+            // A service that exits without stopping the ring never sets
+            // `closed`, but does close its end of the socket.
+            if !peer_alive(&self.stream) {
+                return Err(io::Error::from_raw_os_error(libc::EPIPE));
+            }
+        }
+
+        self.in_flight[slot] = false;
+        match state.swap(SLOT_FREE, Ordering::Acquire) {
+            SLOT_DONE => Ok(()),
+            _ => Err(io::Error::from_raw_os_error(libc::EINVAL)),
+        }
+    }
+
+    /// Sends a control message and returns the value of its reply.
+    fn request(&self, op: u32, name: &str, fd: Option<RawFd>) -> io::Result<u32> {
+        let mut request = Request { op, name_len: name.len() as u32, name: [0; MAX_NAME] };
+        request.name[..name.len()].copy_from_slice(name.as_bytes());
+        send_request(&self.stream, &request, fd)?;
+
+        let mut reply = Reply { status: 0, value: 0 };
+        (&self.stream).read_exact(as_bytes_mut(&mut reply))?;
+        if reply.status < 0 {
+            return Err(io::Error::from_raw_os_error(-reply.status));
+        }
+        Ok(reply.value)
+    }
+}
+
+/// Creates a memfd of `len` bytes for a ring, sealed so that its size can
+/// never change while the service has it mapped.
+fn ring_memfd(len: usize) -> io::Result<OwnedFd> {
+    let name = CString::new("purecipher-ring").unwrap();
+    let fd = unsafe { libc::memfd_create(name.as_ptr(), libc::MFD_CLOEXEC | libc::MFD_ALLOW_SEALING) };
+    if fd < 0 {
+        return Err(io::Error::last_os_error());
+    }
+    let fd = unsafe { OwnedFd::from_raw_fd(fd) };
+    if unsafe { libc::ftruncate(fd.as_raw_fd(), len as libc::off_t) } != 0 {
+        return Err(io::Error::last_os_error());
+    }
+    let seals = libc::F_SEAL_SHRINK | libc::F_SEAL_GROW | libc::F_SEAL_SEAL;
+    if unsafe { libc::fcntl(fd.as_raw_fd(), libc::F_ADD_SEALS, seals) } != 0 {
+        return Err(io::Error::last_os_error());
+    }
+    Ok(fd)
+}
+
+/// Returns the number of times to poll for the other side before sleeping.
+///
+/// On a single core, the other side cannot make progress while this side
+/// spins, so it goes to sleep at once.
+fn spin_limit() -> usize {
+    match thread::available_parallelism() {
+        Ok(cores) if cores.get() > 1 => SPINS,
+        _ => 0,
+    }
+}
+
+/// Returns whether the other end of the stream has not hung up.
+fn peer_alive(stream: &UnixStream) -> bool {
+    let mut byte = 0u8;
+    let received = unsafe {
+        libc::recv(stream.as_raw_fd(), &mut byte as *mut u8 as *mut libc::c_void, 1, libc::MSG_PEEK | libc::MSG_DONTWAIT)
+    };
+    received != 0
+}
+
+fn send_request(stream: &UnixStream, request: &Request, fd: Option<RawFd>) -> io::Result<()> {
+    let bytes = as_bytes(request);
+    let mut iov = libc::iovec { iov_base: bytes.as_ptr() as *mut libc::c_void, iov_len: bytes.len() };
+    // Large and aligned enough for the control message carrying one fd.
+    let mut control = [0u64; 8];
+    let mut msg: libc::msghdr = unsafe { mem::zeroed() };
+    msg.msg_iov = &mut iov;
+    msg.msg_iovlen = 1;
+    if let Some(fd) = fd {
+        unsafe {
+            msg.msg_control = control.as_mut_ptr() as *mut libc::c_void;
+            msg.msg_controllen = libc::CMSG_SPACE(mem::size_of::<RawFd>() as u32) as _;
+            let cmsg = libc::CMSG_FIRSTHDR(&msg);
+            (*cmsg).cmsg_level = libc::SOL_SOCKET;
+            (*cmsg).cmsg_type = libc::SCM_RIGHTS;
+            (*cmsg).cmsg_len = libc::CMSG_LEN(mem::size_of::<RawFd>() as u32) as _;
+            ptr::write_unaligned(libc::CMSG_DATA(cmsg) as *mut RawFd, fd);
+        }
+    }
+    let sent = unsafe { libc::sendmsg(stream.as_raw_fd(), &msg, libc::MSG_NOSIGNAL) };
+    if sent < 0 {
+        return Err(io::Error::last_os_error());
+    }
+    (&*stream).write_all(&bytes[sent as usize..])
+}
+
+/// Receives a request and any fd passed with it, or `None` at end of stream.
+fn recv_request(stream: &UnixStream) -> io::Result<Option<(Request, Option<OwnedFd>)>> {
+    let mut request = Request { op: 0, name_len: 0, name: [0; MAX_NAME] };
+    let received;
+    let mut fd = None;
+    {
+        let bytes = as_bytes_mut(&mut request);
+        let mut iov = libc::iovec { iov_base: bytes.as_mut_ptr() as *mut libc::c_void, iov_len: bytes.len() };
+        let mut control = [0u64; 8];
+        let mut msg: libc::msghdr = unsafe { mem::zeroed() };
+        msg.msg_iov = &mut iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.as_mut_ptr() as *mut libc::c_void;
+        msg.msg_controllen = mem::size_of_val(&control) as _;
+        received = unsafe { libc::recvmsg(stream.as_raw_fd(), &mut msg, libc::MSG_CMSG_CLOEXEC) };
+        if received < 0 {
+            return Err(io::Error::last_os_error());
+        }
+        unsafe {
+            let mut cmsg = libc::CMSG_FIRSTHDR(&msg);
+            while !cmsg.is_null() {
+                if (*cmsg).cmsg_level == libc::SOL_SOCKET && (*cmsg).cmsg_type == libc::SCM_RIGHTS {
+                    let raw = ptr::read_unaligned(libc::CMSG_DATA(cmsg) as *const RawFd);
+                    fd = Some(OwnedFd::from_raw_fd(raw));
+                }
+                cmsg = libc::CMSG_NXTHDR(&msg, cmsg);
+            }
+        }
+    }
+    if received == 0 {
+        return Ok(None);
+    }
+    (&*stream).read_exact(&mut as_bytes_mut(&mut request)[received as usize..])?;
+    Ok(Some((request, fd)))
+}
+
+fn as_bytes<T: Copy>(value: &T) -> &[u8] {
+    unsafe { slice::from_raw_parts(value as *const T as *const u8, mem::size_of::<T>()) }
+}
+
+fn as_bytes_mut<T: Copy>(value: &mut T) -> &mut [u8] {
+    unsafe { slice::from_raw_parts_mut(value as *mut T as *mut u8, mem::size_of::<T>()) }
+}
+
+/// Sleeps while `word` holds `expected`, or until the timeout elapses.
+///
+/// The futex is not private, since the word is shared between processes.
+fn futex_wait(word: &AtomicU32, expected: u32, timeout: Option<Duration>) {
+    let timeout = timeout.map(|t| libc::timespec { tv_sec: t.as_secs() as _, tv_nsec: t.subsec_nanos() as _ });
+    let timeout_ptr = timeout.as_ref().map_or(ptr::null(), |t| t as *const libc::timespec);
+    unsafe {
+        libc::syscall(libc::SYS_futex, word as *const AtomicU32, libc::FUTEX_WAIT, expected, timeout_ptr);
+    }
+}
+
+/// Wakes every thread sleeping on `word`.
+fn futex_wake(word: &AtomicU32) {
+    unsafe {
+        libc::syscall(libc::SYS_futex, word as *const AtomicU32, libc::FUTEX_WAKE, libc::c_int::MAX);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::{caesar, rot13_alpha};
+
+    fn socket_path(name: &str) -> PathBuf {
+        std::env::temp_dir().join(format!("purecipher-{}-{}.sock", name, std::process::id()))
+    }
+
+    #[test]
+    fn service_ciphers_slots() {
+        let path = socket_path("slots");
+        let service = CipherService::bind(&path, 2).unwrap();
+        let rot13 = service.register("rot13", &rot13_alpha());
+        service.register("caesar", &caesar());
+
+        let mut client = CipherClient::connect(&path, 8, 100).unwrap();
+        assert_eq!(rot13, client.lookup("rot13").unwrap());
+        let caesar = client.lookup("caesar").unwrap();
+        assert_eq!(Some(libc::ENOENT), client.lookup("vigenere").unwrap_err().raw_os_error());
+
+        for slot in 0..client.slots() {
+            client.buffer(slot)[..3].copy_from_slice(b"abc");
+            client.submit(slot, if slot % 2 == 0 { rot13 } else { caesar }, 3, false);
+        }
+        for slot in 0..client.slots() {
+            client.wait(slot).unwrap();
+            let expected = if slot % 2 == 0 { b"nop" } else { b"def" };
+            assert_eq!(expected, &client.buffer(slot)[..3]);
+        }
+
+        client.submit(1, caesar, 3, true);
+        client.wait(1).unwrap();
+        assert_eq!(b"abc", &client.buffer(1)[..3]);
+    }
+
+    #[test]
+    fn service_uses_pool_for_large_batches() {
+        let path = socket_path("large");
+        let service = CipherService::bind(&path, 2).unwrap();
+        let rot13 = service.register("rot13", &rot13_alpha());
+
+        let slot_size = TASK_BYTES;
+        let mut client = CipherClient::connect(&path, 4, slot_size).unwrap();
+        let text: Vec<u8> = (0..slot_size).map(|i| b'a' + (i % 26) as u8).collect();
+        for slot in 0..4 {
+            client.buffer(slot).copy_from_slice(&text);
+            client.submit(slot, rot13, slot_size, false);
+        }
+        let mut expected = text.clone();
+        rot13_alpha().encipher_inplace(&mut expected);
+        for slot in 0..4 {
+            client.wait(slot).unwrap();
+            assert_eq!(&expected[..], client.buffer(slot));
+        }
+    }
+
+    #[test]
+    fn service_rejects_unknown_ciphers() {
+        let path = socket_path("reject");
+        let service = CipherService::bind(&path, 1).unwrap();
+        service.register("rot13", &rot13_alpha());
+
+        let mut client = CipherClient::connect(&path, 1, 16).unwrap();
+        client.buffer(0)[..3].copy_from_slice(b"abc");
+        client.submit(0, 42, 3, false);
+        assert!(client.wait(0).is_err());
+        assert!(!client.in_flight(0));
+        assert_eq!(b"abc", &client.buffer(0)[..3]);
+    }
+
+    #[test]
+    fn client_notices_service_stopping() {
+        let path = socket_path("stop");
+        let service = CipherService::bind(&path, 1).unwrap();
+        let mut client = CipherClient::connect(&path, 1, 16).unwrap();
+        drop(service);
+
+        client.submit(0, 0, 3, false);
+        assert!(client.wait(0).is_err());
+        assert!(!path.exists());
+    }
+
+    #[test]
+    fn service_survives_client_truncating_ring() {
+        let path = socket_path("truncate");
+        let service = CipherService::bind(&path, 1).unwrap();
+        let rot13 = service.register("rot13", &rot13_alpha());
+
+        let layout = Layout::new(2, 16).unwrap();
+        let fd = ring_memfd(layout.len()).unwrap();
+        let mut client = CipherClient::attach(UnixStream::connect(&path).unwrap(), &fd, layout).unwrap();
+        assert_ne!(0, unsafe { libc::ftruncate(fd.as_raw_fd(), 0) });
+        assert_eq!(Some(libc::EPERM), io::Error::last_os_error().raw_os_error());
+
+        client.buffer(0)[..3].copy_from_slice(b"abc");
+        client.submit(0, rot13, 3, false);
+        client.wait(0).unwrap();
+        assert_eq!(b"nop", &client.buffer(0)[..3]);
+    }
+
+    #[test]
+    fn service_rejects_unsealed_rings() {
+        let path = socket_path("unsealed");
+        let _service = CipherService::bind(&path, 1).unwrap();
+
+        let layout = Layout::new(1, 16).unwrap();
+        let name = CString::new("purecipher-ring").unwrap();
+        let fd = unsafe { OwnedFd::from_raw_fd(libc::memfd_create(name.as_ptr(), libc::MFD_CLOEXEC)) };
+        assert_eq!(0, unsafe { libc::ftruncate(fd.as_raw_fd(), layout.len() as libc::off_t) });
+        let attached = CipherClient::attach(UnixStream::connect(&path).unwrap(), &fd, layout);
+        assert_eq!(Some(libc::EINVAL), attached.err().and_then(|err| err.raw_os_error()));
+    }
+
+    #[test]
+    fn connect_rejects_bad_geometry() {
+        let path = socket_path("geometry");
+        let _service = CipherService::bind(&path, 1).unwrap();
+        assert!(CipherClient::connect(&path, 0, 16).is_err());
+        assert!(CipherClient::connect(&path, MAX_SLOTS + 1, 16).is_err());
+        assert!(CipherClient::connect(&path, 1, 0).is_err());
+    }
+}
@@ -0,0 +1,132 @@
+//! Substitution ciphers whose lookup tables live in memory they do not own.
+
+use super::PureCipher;
+use super::affine::{self, AffineCipher};
+use super::substitution::ALL_U8;
+
+/// Number of bytes occupied by the tables of a `SharedCipher`: the table used
+/// to encipher bytes, followed by the table used to decipher them.
+pub const SHARED_TABLES_LEN: usize = 2 * ALL_U8;
+
+/// Substitution cipher that looks bytes up in tables owned by someone else,
+/// such as a segment of memory shared between processes.
+///
+/// Any number of ciphers, in any number of processes, may use the same tables,
+/// so a pool of worker processes keeps a single physical copy of them. Building
+/// a cipher from existing tables only validates them; nothing is copied.
+///
+/// The tables must not be modified while any cipher uses them.
+///
+/// # Example
+/// ```
+/// use purecipher::{PureCipher, SharedCipher, SHARED_TABLES_LEN};
+///
+/// let mut tables = [0; SHARED_TABLES_LEN];
+/// SharedCipher::write_tables(&purecipher::caesar(), &mut tables);
+///
+/// let cipher = SharedCipher::from_tables(&tables).unwrap();
+/// assert_eq!(b'd', cipher.encipher(b'a'));
+/// assert_eq!(b'a', cipher.decipher(b'd'));
+/// ```
+#[derive(Clone, Debug)]
+pub struct SharedCipher<'a> {
+    /// Table used to encipher bytes.
+    map: &'a [u8; ALL_U8],
+    /// Table used to decipher bytes.
+    inv: &'a [u8; ALL_U8],
+    /// Equivalent affine cipher, if one exists. It is used to cipher buffers
+    /// instead of the lookup tables if the running CPU supports GFNI.
+    affine: Option<AffineCipher>,
+}
+
+impl<'a> SharedCipher<'a> {
+    /// Writes the tables describing the given cipher to `tables`, in the layout
+    /// expected by `from_tables`.
+    ///
+    /// The tables are built by enciphering every byte value once, so `cipher`
+    /// is expected to uphold the `PureCipher` contract of being a bijection on
+    /// bytes.
+    pub fn write_tables(cipher: &dyn PureCipher, tables: &mut [u8; SHARED_TABLES_LEN]) {
+        let (map, inv) = tables.split_at_mut(ALL_U8);
+        for (b, mapped) in map.iter_mut().enumerate() {
+            *mapped = cipher.encipher(b as u8);
+            inv[*mapped as usize] = b as u8;
+        }
+    }
+
+    /// Builds a cipher that uses the given tables, as written by
+    /// `write_tables`.
+    ///
+    /// Returns `None` if the second table is not the inverse of the first, in
+    /// which case the tables do not describe a cipher.
+    pub fn from_tables(tables: &'a [u8; SHARED_TABLES_LEN]) -> Option<Self> {
+        let map = unsafe { &*(tables.as_ptr() as *const [u8; ALL_U8]) };
+        let inv = unsafe { &*(tables[ALL_U8..].as_ptr() as *const [u8; ALL_U8]) };
+        // If every byte maps back to itself, the first table is injective and
+        // therefore a permutation, and the second is its inverse.
+        if (0..ALL_U8).any(|b| inv[map[b] as usize] as usize != b) {
+            return None;
+        }
+        Some(Self { map, inv, affine: AffineCipher::from_table(map) })
+    }
+}
+
+impl<'a> PureCipher for SharedCipher<'a> {
+    fn encipher(&self, token: u8) -> u8 {
+        self.map[token as usize]
+    }
+
+    fn decipher(&self, token: u8) -> u8 {
+        self.inv[token as usize]
+    }
+
+    fn encipher_inplace(&self, bytes: &mut [u8]) {
+        match self.affine {
+            Some(ref affine) if affine::has_gfni() => affine.encipher_inplace(bytes),
+            _ => bytes.iter_mut().for_each(|b| *b = self.map[*b as usize]),
+        }
+    }
+
+    fn decipher_inplace(&self, bytes: &mut [u8]) {
+        match self.affine {
+            Some(ref affine) if affine::has_gfni() => affine.decipher_inplace(bytes),
+            _ => bytes.iter_mut().for_each(|b| *b = self.inv[*b as usize]),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::{caesar, leet_speak};
+
+    #[test]
+    fn shared_matches_source_cipher() {
+        let leet = leet_speak();
+        let mut tables = [0; SHARED_TABLES_LEN];
+        SharedCipher::write_tables(&leet, &mut tables);
+        let cipher = SharedCipher::from_tables(&tables).unwrap();
+
+        for b in 0..=u8::MAX {
+            assert_eq!(leet.encipher(b), cipher.encipher(b));
+            assert_eq!(leet.decipher(b), cipher.decipher(b));
+        }
+        let mut buffer = *b"Hello, world!";
+        cipher.encipher_inplace(&mut buffer);
+        assert_eq!(&buffer, b"H3llo, worldi");
+        cipher.decipher_inplace(&mut buffer);
+        assert_eq!(&buffer, b"Hello, world!");
+    }
+
+    #[test]
+    fn shared_rejects_inconsistent_tables() {
+        let mut tables = [0; SHARED_TABLES_LEN];
+        SharedCipher::write_tables(&caesar(), &mut tables);
+
+        tables.swap(ALL_U8 + 1, ALL_U8 + 2);
+        assert!(SharedCipher::from_tables(&tables).is_none());
+
+        tables = [0; SHARED_TABLES_LEN];
+        assert!(SharedCipher::from_tables(&tables).is_none());
+    }
+}
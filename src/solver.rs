@@ -0,0 +1,592 @@
+//! Recovery of unknown substitution ciphers from ciphertext alone.
+
+use std::cmp;
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use super::SubstitutionCipher;
+use super::substitution::ALL_U8;
+
+/// Number of hill climbs run by a solver whose restart budget was not set.
+const DEFAULT_RESTARTS: u64 = 64;
+
+/// Frequency, relative to a single occurrence, assumed for bigrams that never
+/// occur in the corpus of a model.
+const UNSEEN_BIGRAM: f64 = 0.01;
+
+/// Smallest gain in score for which a swap is kept. Swaps are scored in single
+/// precision, so without a margin a swap and its reverse may both appear to
+/// improve the score by a rounding error, and a climb would never end.
+const MIN_GAIN: f32 = 1e-3;
+
+/// Marks a byte that does not occur in the ciphertext being solved.
+const NO_SYMBOL: u16 = u16::MAX;
+
+/// Byte bigram statistics of the language that ciphertext is expected to
+/// decipher to.
+///
+/// A model is built once from a corpus of representative plaintext, such as
+/// prose in the expected language or a sample of the expected records, and
+/// may then be shared by any number of solvers. It holds two tables of 65536
+/// 32-bit floats.
+pub struct NgramModel {
+    /// Natural logarithm of the relative frequency of each bigram, indexed by
+    /// `first * 256 + second`.
+    log_freq: Box<[f32]>,
+    /// The same frequencies indexed by `second * 256 + first`.
+    log_freq_t: Box<[f32]>,
+    /// Byte values ordered from most to least frequent in the corpus.
+    by_frequency: [u8; ALL_U8],
+    /// Whether each byte value occurs in the corpus.
+    seen: [bool; ALL_U8],
+}
+
+impl NgramModel {
+    /// Builds a model from the bigrams of the given corpus.
+    ///
+    /// Bigrams absent from the corpus are assumed to be rare rather than
+    /// impossible, so the corpus only needs to be large enough to represent
+    /// the common ones well. A few hundred kilobytes of text is plenty.
+    pub fn from_corpus(corpus: impl AsRef<[u8]>) -> Self {
+        let corpus = corpus.as_ref();
+        let mut counts = vec![0u64; ALL_U8 * ALL_U8];
+        let mut unigrams = [0u64; ALL_U8];
+        for pair in corpus.windows(2) {
+            counts[pair[0] as usize * ALL_U8 + pair[1] as usize] += 1;
+        }
+        for &b in corpus {
+            unigrams[b as usize] += 1;
+        }
+
+        let total = cmp::max(1, corpus.len().saturating_sub(1)) as f64;
+        let log_freq: Box<[f32]> = counts.iter()
+            .map(|&count| {
+                let count = if count > 0 { count as f64 } else { UNSEEN_BIGRAM };
+                (count / total).ln() as f32
+            })
+            .collect();
+        let mut log_freq_t = vec![0.0; ALL_U8 * ALL_U8].into_boxed_slice();
+        for first in 0..ALL_U8 {
+            for second in 0..ALL_U8 {
+                log_freq_t[second * ALL_U8 + first] = log_freq[first * ALL_U8 + second];
+            }
+        }
+
+        let mut by_frequency = [0; ALL_U8];
+        let mut order: Vec<usize> = (0..ALL_U8).collect();
+        order.sort_by(|&a, &b| unigrams[b].cmp(&unigrams[a]));
+        let mut seen = [false; ALL_U8];
+        for (rank, &b) in order.iter().enumerate() {
+            by_frequency[rank] = b as u8;
+            seen[b] = unigrams[b] > 0;
+        }
+        Self { log_freq, log_freq_t, by_frequency, seen }
+    }
+
+    /// Returns the mean log-frequency of the bigrams of `text` under this
+    /// model. Text that resembles the corpus scores higher.
+    ///
+    /// Text shorter than two bytes scores zero.
+    pub fn score(&self, text: impl AsRef<[u8]>) -> f64 {
+        let text = text.as_ref();
+        if text.len() < 2 {
+            return 0.0;
+        }
+        let sum: f64 = text.windows(2)
+            .map(|pair| self.log_freq[pair[0] as usize * ALL_U8 + pair[1] as usize] as f64)
+            .sum();
+        sum / (text.len() - 1) as f64
+    }
+}
+
+/// Cipher recovered by a `Solver`.
+#[derive(Clone, Debug)]
+pub struct Solution {
+    /// The most likely cipher found, which enciphers the recovered plaintext
+    /// to the ciphertext.
+    pub cipher: SubstitutionCipher,
+    /// Score of the recovered plaintext under the solver's model. See
+    /// `NgramModel::score`.
+    pub score: f64,
+    /// Number of hill climbs run.
+    pub restarts: u64,
+}
+
+/// Solver that recovers substitution ciphers from ciphertext by hill climbing
+/// on the bigram statistics of an `NgramModel`.
+///
+/// Each hill climb starts from a key that matches the byte frequencies of the
+/// ciphertext to those of the model, randomly perturbed after the first climb,
+/// and repeatedly swaps the plaintext of two bytes while that improves the
+/// score. Swaps are scored incrementally from the bigram counts of the
+/// ciphertext, which are computed once, so the cost of a climb does not depend
+/// on the length of the ciphertext. Independent climbs run in parallel on all
+/// cores, and the best key found is returned.
+///
+/// The cost of a solve is bounded by a number of climbs, 64 by default, and
+/// optionally by a time limit.
+///
+/// # Example
+/// ```
+/// use std::time::Duration;
+/// use purecipher::{NgramModel, PureCipher, Solver};
+///
+/// let model = NgramModel::from_corpus("the quick brown fox jumps over the lazy dog. ".repeat(100));
+/// let ciphertext = purecipher::encipher_bytes(&purecipher::caesar(), "the lazy dog jumps");
+///
+/// let mut solver = Solver::new(&model);
+/// solver.time_limit(Duration::from_secs(1)).crib(4, b"lazy");
+/// let solution = solver.solve(&ciphertext).unwrap();
+///
+/// assert_eq!(b'l', solution.cipher.decipher(ciphertext[4]));
+/// ```
+pub struct Solver<'a> {
+    model: &'a NgramModel,
+    threads: usize,
+    time_limit: Option<Duration>,
+    max_restarts: u64,
+    seed: u64,
+    /// Known plaintext and its offset within the ciphertext.
+    cribs: Vec<(usize, Vec<u8>)>,
+}
+
+impl<'a> Solver<'a> {
+    /// Builds a solver that scores candidate plaintext with the given model.
+    pub fn new(model: &'a NgramModel) -> Self {
+        Self {
+            model,
+            threads: 0,
+            time_limit: None,
+            max_restarts: DEFAULT_RESTARTS,
+            seed: 0,
+            cribs: Vec::new(),
+        }
+    }
+
+    /// Sets the number of threads that climb in parallel. Zero, the default,
+    /// uses one thread per available core.
+    pub fn threads(&mut self, threads: usize) -> &mut Self {
+        self.threads = threads;
+        self
+    }
+
+    /// Stops solving once the given time has elapsed. Climbs in progress are
+    /// cut short, so a solve overruns the limit by at most one sweep of swaps.
+    pub fn time_limit(&mut self, limit: Duration) -> &mut Self {
+        self.time_limit = Some(limit);
+        self
+    }
+
+    /// Sets the total number of climbs run across all threads. `u64::MAX`
+    /// leaves the solve bounded only by its time limit.
+    pub fn max_restarts(&mut self, restarts: u64) -> &mut Self {
+        self.max_restarts = restarts;
+        self
+    }
+
+    /// Seeds the random perturbations of restarted climbs.
+    pub fn seed(&mut self, seed: u64) -> &mut Self {
+        self.seed = seed;
+        self
+    }
+
+    /// Declares that the ciphertext starting at `offset` deciphers to
+    /// `plaintext`. The bytes it determines are held fixed while climbing.
+    pub fn crib(&mut self, offset: usize, plaintext: &[u8]) -> &mut Self {
+        self.cribs.push((offset, plaintext.to_vec()));
+        self
+    }
+
+    /// Recovers the most likely cipher that enciphers some plaintext to the
+    /// given ciphertext.
+    ///
+    /// Returns `None` if a crib extends past the end of the ciphertext or
+    /// contradicts another crib.
+    pub fn solve(&self, ciphertext: &[u8]) -> Option<Solution> {
+        let problem = Problem::new(self.model, ciphertext, &self.cribs)?;
+        let deadline = self.time_limit.map(|limit| Instant::now() + limit);
+        let threads = match self.threads {
+            0 => thread::available_parallelism().map_or(1, |n| n.get()),
+            threads => threads,
+        };
+
+        let restarts = AtomicU64::new(0);
+        let completed = AtomicU64::new(0);
+        let best = Mutex::new(Climber::new(&problem, problem.initial_key));
+        thread::scope(|scope| {
+            for t in 0..threads {
+                let (problem, restarts, completed, best) = (&problem, &restarts, &completed, &best);
+                let mut rng = Rng::new(self.seed, t);
+                scope.spawn(move || loop {
+                    let restart = restarts.fetch_add(1, Ordering::Relaxed);
+                    if restart >= self.max_restarts || deadline.map_or(false, |d| Instant::now() >= d) {
+                        break;
+                    }
+                    let mut climber = Climber::new(problem, problem.initial_key);
+                    if restart > 0 {
+                        climber.perturb(&mut rng);
+                    }
+                    climber.climb(deadline);
+                    completed.fetch_add(1, Ordering::Relaxed);
+
+                    let mut best = best.lock().unwrap();
+                    if climber.score > best.score {
+                        *best = climber;
+                    }
+                });
+            }
+        });
+
+        // Rescore from scratch, since incremental updates accumulate rounding.
+        let best = best.into_inner().unwrap();
+        let best = Climber::new(&problem, best.key);
+        let mut map = [0; ALL_U8];
+        for (c, &p) in best.key.iter().enumerate() {
+            map[p as usize] = c as u8;
+        }
+        let bigrams = ciphertext.len().saturating_sub(1);
+        Some(Solution {
+            cipher: SubstitutionCipher::from_table(&map).unwrap(),
+            score: if bigrams > 0 { best.score as f64 / bigrams as f64 } else { 0.0 },
+            restarts: completed.into_inner(),
+        })
+    }
+}
+
+/// Ciphertext being solved, reduced to the counts of its bigrams.
+struct Problem<'m> {
+    model: &'m NgramModel,
+    /// Distinct bytes of the ciphertext, from most to least frequent.
+    symbols: Vec<u8>,
+    /// Position of each byte in `symbols`, or `NO_SYMBOL`.
+    index: [u16; ALL_U8],
+    /// Count of each bigram of symbols, indexed by `first * k + second` for
+    /// `k` symbols.
+    counts: Vec<f32>,
+    /// The same counts indexed by `second * k + first`.
+    counts_t: Vec<f32>,
+    /// Whether the plaintext of each byte is fixed by a crib.
+    fixed: [bool; ALL_U8],
+    /// Key that every climb starts from, mapping each ciphertext byte to its
+    /// plaintext.
+    initial_key: [u8; ALL_U8],
+}
+
+impl<'m> Problem<'m> {
+    fn new(model: &'m NgramModel, ciphertext: &[u8], cribs: &[(usize, Vec<u8>)]) -> Option<Self> {
+        let mut fixed = [false; ALL_U8];
+        let mut key = [0u8; ALL_U8];
+        let mut taken = [false; ALL_U8];
+        for &(offset, ref plaintext) in cribs {
+            let end = offset.checked_add(plaintext.len())?;
+            for (&c, &p) in ciphertext.get(offset..end)?.iter().zip(plaintext.iter()) {
+                if fixed[c as usize] {
+                    if key[c as usize] != p {
+                        return None;
+                    }
+                } else if taken[p as usize] {
+                    return None;
+                } else {
+                    fixed[c as usize] = true;
+                    key[c as usize] = p;
+                    taken[p as usize] = true;
+                }
+            }
+        }
+
+        let mut frequency = [0u64; ALL_U8];
+        for &c in ciphertext {
+            frequency[c as usize] += 1;
+        }
+        let mut symbols: Vec<u8> = (0..=u8::max_value()).filter(|&c| frequency[c as usize] > 0).collect();
+        symbols.sort_by(|&a, &b| frequency[b as usize].cmp(&frequency[a as usize]));
+        let mut index = [NO_SYMBOL; ALL_U8];
+        for (i, &c) in symbols.iter().enumerate() {
+            index[c as usize] = i as u16;
+        }
+
+        let k = symbols.len();
+        let mut counts = vec![0.0; k * k];
+        let mut counts_t = vec![0.0; k * k];
+        for pair in ciphertext.windows(2) {
+            let (first, second) = (index[pair[0] as usize] as usize, index[pair[1] as usize] as usize);
+            counts[first * k + second] += 1.0;
+            counts_t[second * k + first] += 1.0;
+        }
+
+        // Match the most frequent ciphertext bytes with the most frequent
+        // plaintext bytes of the model, then give the bytes absent from the
+        // ciphertext whatever plaintext remains.
+        let mut unused = model.by_frequency.iter().cloned().filter(|&p| !taken[p as usize]);
+        let absent = (0..=u8::max_value()).filter(|&c| frequency[c as usize] == 0);
+        for c in symbols.iter().cloned().chain(absent) {
+            if !fixed[c as usize] {
+                key[c as usize] = unused.next().unwrap();
+            }
+        }
+        Some(Self { model, symbols, index, counts, counts_t, fixed, initial_key: key })
+    }
+}
+
+/// State of a single hill climb.
+struct Climber<'p, 'm: 'p> {
+    problem: &'p Problem<'m>,
+    /// Plaintext of each ciphertext byte.
+    key: [u8; ALL_U8],
+    /// Plaintext of each symbol, as `plain[i] == key[symbols[i]]`.
+    plain: Vec<u8>,
+    /// Sum of the log-frequencies of the bigrams of the plaintext.
+    score: f32,
+}
+
+impl<'p, 'm> Climber<'p, 'm> {
+    fn new(problem: &'p Problem<'m>, key: [u8; ALL_U8]) -> Self {
+        let plain: Vec<u8> = problem.symbols.iter().map(|&c| key[c as usize]).collect();
+        let k = plain.len();
+        let log_freq = &problem.model.log_freq;
+        let mut score = 0.0;
+        for i in 0..k {
+            let row = &log_freq[plain[i] as usize * ALL_U8..][..ALL_U8];
+            score += dot(&problem.counts[i * k..][..k], row, &plain);
+        }
+        Self { problem, key, plain, score }
+    }
+
+    /// Scrambles the plaintext of the symbols not fixed by a crib.
+    fn perturb(&mut self, rng: &mut Rng) {
+        let movable: Vec<u8> = self.problem.symbols.iter().cloned()
+            .filter(|&c| !self.problem.fixed[c as usize])
+            .collect();
+        if movable.len() < 2 {
+            return;
+        }
+        for _ in 0..movable.len() {
+            let a = movable[rng.below(movable.len())];
+            let b = movable[rng.below(movable.len())];
+            self.key.swap(a as usize, b as usize);
+        }
+        *self = Climber::new(self.problem, self.key);
+    }
+
+    /// Sum of the log-frequencies of the bigrams in which symbol `a` or `b`
+    /// occurs in either position. `b` may equal `a`.
+    fn partial(&self, a: usize, b: usize) -> f32 {
+        let problem = self.problem;
+        let model = problem.model;
+        let k = self.plain.len();
+        let plain = &self.plain;
+
+        let changed = [a, b];
+        let changed = if a == b { &changed[..1] } else { &changed[..] };
+
+        let mut total = 0.0;
+        for &i in changed {
+            let row = &model.log_freq[plain[i] as usize * ALL_U8..][..ALL_U8];
+            let col = &model.log_freq_t[plain[i] as usize * ALL_U8..][..ALL_U8];
+            total += dot(&problem.counts[i * k..][..k], row, plain);
+            total += dot(&problem.counts_t[i * k..][..k], col, plain);
+        }
+        // Bigrams of two changed symbols were counted in a row and a column.
+        for &i in changed {
+            for &j in changed {
+                total -= problem.counts[i * k + j] * model.log_freq[plain[i] as usize * ALL_U8 + plain[j] as usize];
+            }
+        }
+        total
+    }
+
+    /// Swaps the plaintext of ciphertext bytes `c` and `d`, where `c` is the
+    /// symbol `a` and `d` is the symbol `b`, or `b == a` if `d` does not occur
+    /// in the ciphertext.
+    fn swap(&mut self, c: usize, d: usize, a: usize, b: usize) {
+        self.key.swap(c, d);
+        self.plain[a] = self.key[c];
+        if b != a {
+            self.plain[b] = self.key[d];
+        }
+    }
+
+    /// Applies every swap that improves the score until none does, or until
+    /// the deadline passes.
+    fn climb(&mut self, deadline: Option<Instant>) {
+        let problem = self.problem;
+        let mut improved = true;
+        while improved {
+            improved = false;
+            for a in 0..problem.symbols.len() {
+                let c = problem.symbols[a] as usize;
+                if problem.fixed[c] {
+                    continue;
+                }
+                if deadline.map_or(false, |d| Instant::now() >= d) {
+                    return;
+                }
+                for d in 0..ALL_U8 {
+                    if d == c || problem.fixed[d] {
+                        continue;
+                    }
+                    let b = match problem.index[d] {
+                        // Plaintext the model has never seen cannot improve the score.
+                        NO_SYMBOL if !problem.model.seen[self.key[d] as usize] => continue,
+                        NO_SYMBOL => a,
+                        b => b as usize,
+                    };
+                    let before = self.partial(a, b);
+                    self.swap(c, d, a, b);
+                    let after = self.partial(a, b);
+                    if after - before > MIN_GAIN {
+                        self.score += after - before;
+                        improved = true;
+                    } else {
+                        self.swap(c, d, a, b);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/// Weighted sum of the entries of `table` selected by `plain`, as
+/// `sum(weights[j] * table[plain[j]])`.
+#[inline]
+fn dot(weights: &[f32], table: &[f32], plain: &[u8]) -> f32 {
+    // Independent accumulators let the additions proceed in parallel.
+    let mut sums = [0.0f32; 8];
+    let mut weight_chunks = weights.chunks_exact(8);
+    let mut plain_chunks = plain.chunks_exact(8);
+    for (w, p) in weight_chunks.by_ref().zip(plain_chunks.by_ref()) {
+        for lane in 0..8 {
+            sums[lane] += w[lane] * table[p[lane] as usize];
+        }
+    }
+    let mut total: f32 = sums.iter().sum();
+    for (&w, &p) in weight_chunks.remainder().iter().zip(plain_chunks.remainder()) {
+        total += w * table[p as usize];
+    }
+    total
+}
+
+/// Xorshift generator for the perturbations of restarted climbs.
+struct Rng(u64);
+
+impl Rng {
+    fn new(seed: u64, stream: usize) -> Self {
+        let state = seed ^ (stream as u64 + 1).wrapping_mul(0x9E37_79B9_7F4A_7C15);
+        Rng(if state == 0 { 1 } else { state })
+    }
+
+    fn next(&mut self) -> u64 {
+        self.0 ^= self.0 >> 12;
+        self.0 ^= self.0 << 25;
+        self.0 ^= self.0 >> 27;
+        self.0.wrapping_mul(0x2545_F491_4F6C_DD1D)
+    }
+
+    /// Returns a number in `0..bound`.
+    fn below(&mut self, bound: usize) -> usize {
+        (self.next() % bound as u64) as usize
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::{caesar, encipher_bytes, PureCipher, SubstitutionBuilder};
+
+    /// Plaintext in which every lowercase letter occurs.
+    const TEXT: &str = "\
+        the river ran quietly past the old mill, where the miller kept his \
+        books of accounts and a jar of dried beans on the window ledge. every \
+        morning he walked along the bank to count the boats that came down \
+        from the hills, and every evening he wrote the number in a small \
+        grey ledger with a pencil that he sharpened with a kitchen knife. \
+        nobody in the village knew why he counted them, and when the \
+        schoolmaster asked him, he only said that a man should know what \
+        passes his door. the boats carried wool and timber and sometimes \
+        barrels of apples, and the boatmen waved to him as they went by. in \
+        the winter the river froze and there was nothing to count, so he sat \
+        by the fire and read the ledgers from the beginning, as if they told \
+        a story that only he could follow. his daughter thought it was a \
+        lazy habit for a working man, but she never said so, because she \
+        had seen how his face changed when he found a year in which the \
+        boats had been many and the harvest good. quite often he would \
+        jump up from his chair to show her a page, tapping the figures with \
+        his finger, and she would nod and smile and go back to her sewing.";
+
+    /// Cipher that scrambles the lowercase letters and the space.
+    fn scramble() -> SubstitutionCipher {
+        let mut builder = SubstitutionBuilder::new();
+        builder.rotate_range(b'a', b'z', 7);
+        builder.swap(b'e', b' ');
+        builder.swap(b'q', b'c');
+        builder.swap(b'm', b'x');
+        builder.into_cipher()
+    }
+
+    #[test]
+    fn solver_recovers_substitution() {
+        let model = NgramModel::from_corpus(TEXT);
+        let cipher = scramble();
+        let ciphertext = encipher_bytes(&cipher, TEXT);
+
+        let mut solver = Solver::new(&model);
+        solver.threads(2).max_restarts(8).seed(1);
+        let solution = solver.solve(&ciphertext).unwrap();
+
+        let recovered: Vec<u8> = ciphertext.iter().map(|&c| solution.cipher.decipher(c)).collect();
+        let correct = recovered.iter().zip(TEXT.bytes()).filter(|&(&a, b)| a == b).count();
+        assert!(correct * 100 >= TEXT.len() * 98, "{}", String::from_utf8_lossy(&recovered));
+        assert!((solution.score - model.score(TEXT)).abs() < 0.5);
+        assert_eq!(8, solution.restarts);
+    }
+
+    #[test]
+    fn solver_keeps_cribs() {
+        let model = NgramModel::from_corpus(TEXT);
+        let ciphertext = encipher_bytes(&caesar(), "the boats came down");
+
+        let mut solver = Solver::new(&model);
+        solver.threads(1).max_restarts(2).crib(4, b"boats");
+        let solution = solver.solve(&ciphertext).unwrap();
+        for (&c, &p) in ciphertext[4..9].iter().zip(b"boats") {
+            assert_eq!(p, solution.cipher.decipher(c));
+        }
+    }
+
+    #[test]
+    fn solver_rejects_invalid_cribs() {
+        let model = NgramModel::from_corpus(TEXT);
+        let ciphertext = encipher_bytes(&caesar(), "abc abc");
+
+        let mut past_end = Solver::new(&model);
+        past_end.crib(5, b"abc");
+        assert!(past_end.solve(&ciphertext).is_none());
+
+        let mut contradictory = Solver::new(&model);
+        contradictory.crib(0, b"abc").crib(4, b"abd");
+        assert!(contradictory.solve(&ciphertext).is_none());
+    }
+
+    #[test]
+    fn solver_honours_time_limit() {
+        let model = NgramModel::from_corpus(TEXT);
+        let ciphertext = encipher_bytes(&scramble(), TEXT);
+
+        let start = Instant::now();
+        let mut solver = Solver::new(&model);
+        solver.threads(2).max_restarts(u64::max_value()).time_limit(Duration::from_millis(50));
+        let solution = solver.solve(&ciphertext).unwrap();
+
+        assert!(start.elapsed() < Duration::from_secs(2));
+        assert!(solution.restarts > 0);
+    }
+
+    #[test]
+    fn model_scores_language_above_noise() {
+        let model = NgramModel::from_corpus(TEXT);
+        assert!(model.score("the boats came down the river") > model.score("xqz vvk jjwq zzpx"));
+        assert_eq!(0.0, model.score("a"));
+    }
+}
@@ -0,0 +1,277 @@
+//! Byte frequency statistics for plain and ciphered data.
+
+use std::cmp;
+use std::thread;
+
+use super::PureCipher;
+use super::substitution::ALL_U8;
+
+/// Number of independent sub-histograms used when counting bytes.
+///
+/// Runs of equal bytes would otherwise make every increment depend on the
+/// store of the previous one. Spreading consecutive bytes over several tables
+/// lets those increments proceed in parallel.
+const SUB_HISTOGRAMS: usize = 4;
+
+/// Inputs at least this long are counted on multiple threads.
+const PARALLEL_THRESHOLD: usize = 1 << 22;
+
+/// Largest number of bytes counted into 32-bit sub-histograms before they are
+/// flushed into the 64-bit totals.
+const FLUSH_INTERVAL: usize = 1 << 30;
+
+#[derive(Clone)]
+/// Frequency of each byte value within some data.
+pub struct ByteHistogram {
+    counts: [u64; ALL_U8],
+}
+
+impl ByteHistogram {
+    /// Builds an empty histogram.
+    pub fn new() -> Self {
+        Self { counts: [0; ALL_U8] }
+    }
+
+    /// Builds a histogram from the given counts.
+    pub fn from_counts(counts: [u64; ALL_U8]) -> Self {
+        Self { counts }
+    }
+
+    /// Counts the frequency of each byte value in `bytes`.
+    ///
+    /// Large inputs are split across all available cores.
+    ///
+    /// # Example
+    /// ```
+    /// use purecipher::ByteHistogram;
+    ///
+    /// let histogram = ByteHistogram::from_bytes(b"hello");
+    ///
+    /// assert_eq!(2, histogram.counts()[b'l' as usize]);
+    /// assert_eq!(5, histogram.total());
+    /// ```
+    pub fn from_bytes(bytes: impl AsRef<[u8]>) -> Self {
+        let mut histogram = Self::new();
+        histogram.add_bytes(bytes);
+        histogram
+    }
+
+    /// Adds the byte values in `bytes` to this histogram.
+    pub fn add_bytes(&mut self, bytes: impl AsRef<[u8]>) {
+        let bytes = bytes.as_ref();
+        let threads = thread::available_parallelism().map_or(1, |n| n.get());
+
+        if bytes.len() < PARALLEL_THRESHOLD || threads == 1 {
+            count_bytes(bytes, &mut self.counts);
+        } else {
+            count_bytes_threaded(bytes, threads, &mut self.counts);
+        }
+    }
+
+    /// Returns the number of occurrences of each byte value.
+    pub fn counts(&self) -> &[u64; ALL_U8] {
+        &self.counts
+    }
+
+    /// Returns the total number of bytes counted.
+    pub fn total(&self) -> u64 {
+        self.counts.iter().sum()
+    }
+
+    /// Maps this histogram of ciphertext through the inverse of `cipher`.
+    ///
+    /// The result is the histogram of the plaintext that the counted
+    /// ciphertext deciphers to. Only the 256 counts are permuted; the
+    /// ciphertext itself never needs to be deciphered.
+    ///
+    /// # Example
+    /// ```
+    /// use purecipher::ByteHistogram;
+    ///
+    /// let caesar = purecipher::caesar();
+    /// let histogram = ByteHistogram::from_bytes(b"Zh dwwdfn").deciphered(&caesar);
+    ///
+    /// assert_eq!(2, histogram.counts()[b'a' as usize]);
+    /// ```
+    pub fn deciphered(&self, cipher: &dyn PureCipher) -> Self {
+        let mut counts = [0; ALL_U8];
+        for (b, &count) in self.counts.iter().enumerate() {
+            counts[cipher.decipher(b as u8) as usize] += count;
+        }
+        Self { counts }
+    }
+
+    /// Computes the Shannon entropy of the counted bytes in bits per byte.
+    ///
+    /// The entropy of an empty histogram is zero.
+    pub fn entropy(&self) -> f64 {
+        let total = self.total();
+        if total == 0 {
+            return 0.0;
+        }
+        let total = total as f64;
+        self.counts.iter()
+            .filter(|&&count| count > 0)
+            .map(|&count| {
+                let p = count as f64 / total;
+                -p * p.log2()
+            })
+            .sum()
+    }
+
+    /// Computes Pearson's chi-square statistic of the counted bytes against
+    /// a reference distribution.
+    ///
+    /// `expected` holds the relative frequency of each byte value in the
+    /// reference distribution and is normalized before use, so raw counts may
+    /// be given as well as probabilities. Byte values with an expected
+    /// frequency of zero are skipped if they were never observed, and make the
+    /// statistic infinite otherwise.
+    ///
+    /// Zero is returned for an empty histogram or an all-zero reference.
+    pub fn chi_square(&self, expected: &[f64; ALL_U8]) -> f64 {
+        let total = self.total() as f64;
+        let expected_sum: f64 = expected.iter().sum();
+        if total == 0.0 || expected_sum <= 0.0 {
+            return 0.0;
+        }
+        self.counts.iter()
+            .zip(expected.iter())
+            .map(|(&observed, &weight)| {
+                let expected_count = total * weight / expected_sum;
+                let diff = observed as f64 - expected_count;
+                if expected_count > 0.0 {
+                    diff * diff / expected_count
+                } else if observed > 0 {
+                    ::std::f64::INFINITY
+                } else {
+                    0.0
+                }
+            })
+            .sum()
+    }
+}
+
+impl Default for ByteHistogram {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// Adds the byte values of `bytes` to `counts` on the calling thread.
+fn count_bytes(bytes: &[u8], counts: &mut [u64; ALL_U8]) {
+    let mut sub = [[0u32; ALL_U8]; SUB_HISTOGRAMS];
+
+    for block in bytes.chunks(FLUSH_INTERVAL) {
+        let mut quads = block.chunks_exact(SUB_HISTOGRAMS);
+        for quad in quads.by_ref() {
+            sub[0][quad[0] as usize] += 1;
+            sub[1][quad[1] as usize] += 1;
+            sub[2][quad[2] as usize] += 1;
+            sub[3][quad[3] as usize] += 1;
+        }
+        for &b in quads.remainder() {
+            sub[0][b as usize] += 1;
+        }
+
+        for table in sub.iter_mut() {
+            for (total, count) in counts.iter_mut().zip(table.iter_mut()) {
+                *total += *count as u64;
+                *count = 0;
+            }
+        }
+    }
+}
+
+/// Adds the byte values of `bytes` to `counts`, splitting the work evenly
+/// between `threads` threads.
+fn count_bytes_threaded(bytes: &[u8], threads: usize, counts: &mut [u64; ALL_U8]) {
+    let chunk_len = cmp::max(1, (bytes.len() + threads - 1) / threads);
+    let partials: Vec<[u64; ALL_U8]> = thread::scope(|scope| {
+        let handles: Vec<_> = bytes.chunks(chunk_len)
+            .map(|chunk| scope.spawn(move || {
+                let mut partial = [0; ALL_U8];
+                count_bytes(chunk, &mut partial);
+                partial
+            }))
+            .collect();
+        handles.into_iter().map(|h| h.join().unwrap()).collect()
+    });
+
+    for partial in partials.iter() {
+        for (total, &count) in counts.iter_mut().zip(partial.iter()) {
+            *total += count;
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::rot13_alpha;
+
+    #[test]
+    fn histogram_counts_all_bytes() {
+        let bytes: Vec<u8> = (0..=255u8).chain(b"aab".iter().cloned()).collect();
+        let histogram = ByteHistogram::from_bytes(&bytes);
+
+        assert_eq!(259, histogram.total());
+        assert_eq!(3, histogram.counts()[b'a' as usize]);
+        assert_eq!(2, histogram.counts()[b'b' as usize]);
+        assert_eq!(1, histogram.counts()[0]);
+        assert_eq!(1, histogram.counts()[255]);
+    }
+
+    #[test]
+    fn histogram_threaded_matches_serial() {
+        let bytes: Vec<u8> = (0..100_003usize)
+            .map(|i| (i * 7 + i / 3) as u8)
+            .collect();
+
+        let mut serial = [0; ALL_U8];
+        count_bytes(&bytes, &mut serial);
+
+        for threads in 1..=5 {
+            let mut threaded = [0; ALL_U8];
+            count_bytes_threaded(&bytes, threads, &mut threaded);
+            assert_eq!(&serial[..], &threaded[..]);
+        }
+    }
+
+    #[test]
+    fn histogram_deciphered_matches_plaintext() {
+        let cipher = rot13_alpha();
+        let text = b"The quick brown fox jumps over the lazy dog";
+        let cipher_text = super::super::encipher_bytes(&cipher, &text[..]);
+
+        let expected = ByteHistogram::from_bytes(&text[..]);
+        let actual = ByteHistogram::from_bytes(&cipher_text).deciphered(&cipher);
+        assert_eq!(&expected.counts()[..], &actual.counts()[..]);
+    }
+
+    #[test]
+    fn histogram_entropy() {
+        assert_eq!(0.0, ByteHistogram::new().entropy());
+        assert_eq!(0.0, ByteHistogram::from_bytes(b"aaaa").entropy());
+        assert_eq!(1.0, ByteHistogram::from_bytes(b"abab").entropy());
+
+        let all: Vec<u8> = (0..=255).collect();
+        assert_eq!(8.0, ByteHistogram::from_bytes(&all).entropy());
+    }
+
+    #[test]
+    fn histogram_chi_square() {
+        let uniform = [1.0; ALL_U8];
+        let all: Vec<u8> = (0..=255).collect();
+        assert_eq!(0.0, ByteHistogram::from_bytes(&all).chi_square(&uniform));
+
+        // Two observations of 'a' against an even split between 'a' and 'b'.
+        let mut reference = [0.0; ALL_U8];
+        reference[b'a' as usize] = 0.5;
+        reference[b'b' as usize] = 0.5;
+        assert_eq!(2.0, ByteHistogram::from_bytes(b"aa").chi_square(&reference));
+
+        // Observing a byte with zero expected frequency.
+        assert!(ByteHistogram::from_bytes(b"c").chi_square(&reference).is_infinite());
+    }
+}
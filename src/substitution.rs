@@ -5,9 +5,10 @@ use std::fmt;
 use std::ops::{Index, IndexMut};
 
 use super::{PureCipher, NullCipher};
+use super::affine::{self, AffineCipher};
 
 /// The number of values that can be index by a single unsigned byte.
-const ALL_U8: usize = u8::MAX as usize + 1;
+pub(crate) const ALL_U8: usize = u8::MAX as usize + 1;
 
 #[derive(Clone)]
 /// Index based mapping between bytes.
@@ -26,14 +27,58 @@ impl fmt::Debug for ByteMapping {
 }
 
 impl Default for ByteMapping {
-    // Builds an array of every 8-bit byte in ascending order.
     fn default() -> Self {
+        Self::identity()
+    }
+}
+
+// The methods below are `const fn`s so that ciphers can be built at compile
+// time. Iterators and trait methods such as `Index` are not available in
+// constant evaluation, hence the explicit loops.
+impl ByteMapping {
+    /// Builds an array of every 8-bit byte in ascending order.
+    const fn identity() -> Self {
         let mut bytes = [0; ALL_U8];
-        for b in 0..=u8::MAX {
-            bytes[b as usize] = b;
+        let mut b = 0;
+        while b < ALL_U8 {
+            bytes[b] = b as u8;
+            b += 1;
+        }
+        ByteMapping(bytes)
+    }
+
+    /// Builds the mapping that applies `self` followed by `next`.
+    const fn then(&self, next: &ByteMapping) -> ByteMapping {
+        let mut bytes = [0; ALL_U8];
+        let mut b = 0;
+        while b < ALL_U8 {
+            bytes[b] = next.0[self.0[b] as usize];
+            b += 1;
+        }
+        ByteMapping(bytes)
+    }
+
+    /// Builds the mapping that undoes `self`, assuming `self` is a bijection.
+    const fn inverse(&self) -> ByteMapping {
+        let mut bytes = [0; ALL_U8];
+        let mut b = 0;
+        while b < ALL_U8 {
+            bytes[self.0[b] as usize] = b as u8;
+            b += 1;
         }
         ByteMapping(bytes)
     }
+
+    /// Reverses the order of the targets of the bytes in `start..end`.
+    const fn reverse(&mut self, mut start: usize, mut end: usize) {
+        while start + 1 < end {
+            end -= 1;
+            let buf = self.0[start];
+            self.0[start] = self.0[end];
+            self.0[end] = buf;
+            start += 1;
+        }
+    }
 }
 
 impl Index<u8> for ByteMapping {
@@ -54,6 +99,27 @@ impl IndexMut<u8> for ByteMapping {
 /// Convenience structure to help build substitution ciphers.
 ///
 /// For simplicity, ciphers may only be expressed with swaps and shifts.
+///
+/// Every method of the builder is a `const fn`, so ciphers can be built at
+/// compile time and stored in constants or statics, whose tables then live in
+/// read-only data.
+///
+/// # Example
+/// ```
+/// use purecipher::{PureCipher, SubstitutionBuilder, SubstitutionCipher};
+///
+/// static ATBASH_DIGITS: SubstitutionCipher = {
+///     let mut builder = SubstitutionBuilder::new();
+///     builder.swap(b'0', b'9');
+///     builder.swap(b'1', b'8');
+///     builder.swap(b'2', b'7');
+///     builder.swap(b'3', b'6');
+///     builder.swap(b'4', b'5');
+///     builder.into_cipher()
+/// };
+///
+/// assert_eq!(b'7', ATBASH_DIGITS.encipher(b'2'));
+/// ```
 pub struct SubstitutionBuilder {
     /// Index based mapping between bytes.
     map: ByteMapping,
@@ -75,8 +141,8 @@ impl SubstitutionBuilder {
     ///     assert_eq!(b, cipher.encipher(b));
     /// }
     /// ```
-    pub fn new() -> Self {
-        Self { map: ByteMapping::default() }
+    pub const fn new() -> Self {
+        Self { map: ByteMapping::identity() }
     }
 
     /// Swaps the mappings of `left` and `right` in the resulting cipher.
@@ -97,10 +163,10 @@ impl SubstitutionBuilder {
     /// assert_eq!(b'C', cipher.encipher(b'C'));
     /// assert_eq!(b'B', cipher.encipher(b'D'));
     /// ```
-    pub fn swap(&mut self, left: u8, right: u8) {
-        let buf = self.map[left];
-        self.map[left] = self.map[right];
-        self.map[right] = buf;
+    pub const fn swap(&mut self, left: u8, right: u8) {
+        let buf = self.map.0[left as usize];
+        self.map.0[left as usize] = self.map.0[right as usize];
+        self.map.0[right as usize] = buf;
     }
 
     /// Rotates the mapping target of each byte in the resulting cipher.
@@ -122,34 +188,47 @@ impl SubstitutionBuilder {
     /// assert_eq!(b'A', cipher.encipher(b'C'));
     /// assert_eq!(b'D', cipher.encipher(b'D'));
     /// ```
-    pub fn rotate_range(&mut self, from: u8, to: u8, offset: isize) {
-        let abs_offset = offset.abs() as usize % (1 + to as u16 - from as u16) as usize;
-        let slice = &mut self.map.0[from as usize..=to as usize];
-
-        if offset < 0 {
-            slice.rotate_right(abs_offset);
-        } else {
-            slice.rotate_left(abs_offset);
-        }
+    pub const fn rotate_range(&mut self, from: u8, to: u8, offset: isize) {
+        assert!(from <= to, "the end of the range must not precede its start");
+        let from = from as usize;
+        let end = to as usize + 1;
+        let len = end - from;
+
+        // Rotating left by `shift` is done by reversing the two parts of the
+        // range on either side of `shift` and then the whole range.
+        let shift = offset.unsigned_abs() % len;
+        let shift = if offset < 0 { (len - shift) % len } else { shift };
+        self.map.reverse(from, from + shift);
+        self.map.reverse(from + shift, end);
+        self.map.reverse(from, end);
     }
 
     /// Convert this builder into a substitution cipher.
-    pub fn into_cipher(self) -> SubstitutionCipher { self.into() }
+    ///
+    /// If the built mapping is an affine map over GF(2), such as XOR with a
+    /// constant byte, and the running CPU supports GFNI, the cipher will
+    /// cipher buffers with GFNI instructions instead of its lookup tables.
+    pub const fn into_cipher(self) -> SubstitutionCipher {
+        SubstitutionCipher::from_bytes_unchecked(self.map)
+    }
 }
 
 impl Into<SubstitutionCipher> for SubstitutionBuilder {
     fn into(self) -> SubstitutionCipher {
-        SubstitutionCipher::from_bytes_unchecked(self.map)
+        self.into_cipher()
     }
 }
 
-#[derive(Debug)]
+#[derive(Clone, Debug)]
 /// Cipher that transforms bytes via direct substitution.
 pub struct SubstitutionCipher {
     /// Index-based mapping to encipher bytes.
     map: ByteMapping,
     /// Index-based mapping to decipher bytes.
     inv: ByteMapping,
+    /// Equivalent affine cipher, if one exists. It is used to cipher buffers
+    /// instead of the lookup tables if the running CPU supports GFNI.
+    affine: Option<AffineCipher>,
 }
 
 impl SubstitutionCipher {
@@ -157,19 +236,185 @@ impl SubstitutionCipher {
     ///
     /// Please note that duplicate bytes in the provided byte mapping will
     /// result in an irreversible cipher.
-    fn from_bytes_unchecked(map: ByteMapping) -> Self {
-        let mut inv = ByteMapping([0; ALL_U8]);
-        for (i, &b) in map.0.iter().enumerate() {
-            inv[b] = i as u8;
+    const fn from_bytes_unchecked(map: ByteMapping) -> Self {
+        let inv = map.inverse();
+        let affine = AffineCipher::from_table(&map.0);
+        Self { map, inv, affine }
+    }
+}
+
+impl SubstitutionCipher {
+    /// Build a `SubstitutionCipher` that ciphers bytes identically to the
+    /// given cipher.
+    ///
+    /// The lookup table is built by enciphering every byte value once, so
+    /// `cipher` is expected to uphold the `PureCipher` contract of being a
+    /// bijection on bytes.
+    pub fn from_cipher(cipher: &dyn PureCipher) -> Self {
+        let mut map = ByteMapping::default();
+        for b in 0..=u8::MAX {
+            map[b] = cipher.encipher(b);
+        }
+        Self::from_bytes_unchecked(map)
+    }
+
+    /// Build a `SubstitutionCipher` from the given table, in which `map[b]` is
+    /// the byte that `b` is enciphered to.
+    ///
+    /// Returns `None` if `map` is not a permutation of all 256 bytes.
+    ///
+    /// # Example
+    /// ```
+    /// use purecipher::{PureCipher, SubstitutionCipher};
+    ///
+    /// let cipher = SubstitutionCipher::from_table(purecipher::caesar().table()).unwrap();
+    /// assert_eq!(b'd', cipher.encipher(b'a'));
+    ///
+    /// assert!(SubstitutionCipher::from_table(&[0; 256]).is_none());
+    /// ```
+    pub fn from_table(map: &[u8; ALL_U8]) -> Option<Self> {
+        let mut seen = [false; ALL_U8];
+        for &b in map.iter() {
+            if seen[b as usize] {
+                return None;
+            }
+            seen[b as usize] = true;
+        }
+        Some(Self::from_bytes_unchecked(ByteMapping(*map)))
+    }
+
+    /// Returns the table used to encipher bytes, in which `table[b]` is the
+    /// byte that `b` is enciphered to.
+    ///
+    /// These 256 bytes are a complete description of the cipher.
+    pub fn table(&self) -> &[u8; ALL_U8] {
+        &self.map.0
+    }
+
+    /// Returns the table used to decipher bytes, in which `table[b]` is the
+    /// byte that `b` is deciphered to.
+    pub fn inverse_table(&self) -> &[u8; ALL_U8] {
+        &self.inv.0
+    }
+
+    /// Returns the cipher that enciphers bytes the way this cipher deciphers
+    /// them.
+    ///
+    /// # Example
+    /// ```
+    /// use purecipher::PureCipher;
+    ///
+    /// let caesar = purecipher::caesar();
+    /// let inverse = caesar.inverse();
+    ///
+    /// assert_eq!(b'a', inverse.encipher(b'd'));
+    /// assert_eq!(b'd', inverse.decipher(b'a'));
+    /// ```
+    pub fn inverse(&self) -> Self {
+        Self {
+            map: self.inv.clone(),
+            inv: self.map.clone(),
+            affine: self.affine.as_ref().map(AffineCipher::inverse),
         }
-        Self { map, inv }
+    }
+
+    /// Returns the cipher equivalent to applying this cipher `exponent` times.
+    ///
+    /// A negative exponent applies the inverse of this cipher instead, and an
+    /// exponent of zero yields a cipher that maps every byte to itself. The
+    /// result is computed by repeated squaring of the lookup table, so the cost
+    /// is logarithmic in the magnitude of the exponent.
+    ///
+    /// # Example
+    /// ```
+    /// use purecipher::PureCipher;
+    ///
+    /// let caesar = purecipher::caesar();
+    ///
+    /// assert_eq!(b'j', caesar.pow(3).encipher(b'a'));
+    /// assert_eq!(b'x', caesar.pow(-1).encipher(b'a'));
+    /// assert_eq!(b'a', caesar.pow(26).encipher(b'a'));
+    /// ```
+    pub fn pow(&self, exponent: i64) -> Self {
+        let (mut base, mut remaining) = if exponent < 0 {
+            (self.inv.clone(), exponent.unsigned_abs())
+        } else {
+            (self.map.clone(), exponent as u64)
+        };
+
+        let mut map = ByteMapping::default();
+        while remaining > 0 {
+            if remaining & 1 == 1 {
+                map = map.then(&base);
+            }
+            remaining >>= 1;
+            if remaining > 0 {
+                base = base.then(&base);
+            }
+        }
+        Self::from_bytes_unchecked(map)
+    }
+
+    /// Decomposes this cipher's permutation into disjoint cycles.
+    ///
+    /// Each cycle lists bytes in the order in which the cipher maps them, so
+    /// that each byte enciphers to its successor and the last byte enciphers
+    /// to the first. Each cycle starts with its smallest byte, and cycles are
+    /// ordered by their first byte. Bytes that encipher to themselves are
+    /// omitted.
+    ///
+    /// # Example
+    /// ```
+    /// let rot13 = purecipher::rot13_alpha();
+    /// let cycles = rot13.cycles();
+    ///
+    /// assert_eq!(26, cycles.len());
+    /// assert_eq!(vec![b'A', b'N'], cycles[0]);
+    /// ```
+    pub fn cycles(&self) -> Vec<Vec<u8>> {
+        let mut visited = [false; ALL_U8];
+        let mut cycles = Vec::new();
+
+        for start in 0..=u8::MAX {
+            if visited[start as usize] || self.map[start] == start {
+                continue;
+            }
+            let mut cycle = Vec::new();
+            let mut b = start;
+            while !visited[b as usize] {
+                visited[b as usize] = true;
+                cycle.push(b);
+                b = self.map[b];
+            }
+            cycles.push(cycle);
+        }
+        cycles
+    }
+
+    /// Returns the order of this cipher's permutation.
+    ///
+    /// This is the smallest positive number of times this cipher can be
+    /// applied in succession to yield the identity mapping, i.e. the least
+    /// common multiple of its cycle lengths.
+    ///
+    /// # Example
+    /// ```
+    /// assert_eq!(26, purecipher::caesar().order());
+    /// assert_eq!(2, purecipher::rot13_alpha().order());
+    /// ```
+    pub fn order(&self) -> u64 {
+        fn gcd(a: u64, b: u64) -> u64 {
+            if b == 0 { a } else { gcd(b, a % b) }
+        }
+        self.cycles().iter()
+            .map(|cycle| cycle.len() as u64)
+            .fold(1, |order, len| order / gcd(order, len) * len)
     }
 }
 
 impl Default for SubstitutionCipher {
     fn default() -> Self {
-        let map = ByteMapping::default();
-        Self { inv: map.clone(), map }
+        Self::from_bytes_unchecked(ByteMapping::default())
     }
 }
 
@@ -187,6 +432,20 @@ impl PureCipher for SubstitutionCipher {
     fn decipher(&self, token: u8) -> u8 {
         self.inv[token]
     }
+
+    fn encipher_inplace(&self, bytes: &mut [u8]) {
+        match self.affine {
+            Some(ref affine) if affine::has_gfni() => affine.encipher_inplace(bytes),
+            _ => bytes.iter_mut().for_each(|b| *b = self.map[*b]),
+        }
+    }
+
+    fn decipher_inplace(&self, bytes: &mut [u8]) {
+        match self.affine {
+            Some(ref affine) if affine::has_gfni() => affine.decipher_inplace(bytes),
+            _ => bytes.iter_mut().for_each(|b| *b = self.inv[*b]),
+        }
+    }
 }
 
 #[cfg(test)]
@@ -296,6 +555,76 @@ mod tests {
         }
     }
 
+    #[test]
+    fn sub_cipher_pow_matches_repeated_application() {
+        let mut builder = SubstitutionBuilder::new();
+        builder.rotate_range(0, 99, 7);
+        builder.rotate_range(100, 254, -3);
+        builder.swap(3, 200);
+        let cipher = builder.into_cipher();
+
+        for exponent in -20..=20i64 {
+            let powered = cipher.pow(exponent);
+            for b in 0..=u8::MAX {
+                let mut expected = b;
+                for _ in 0..exponent.abs() {
+                    expected = if exponent < 0 { cipher.decipher(expected) } else { cipher.encipher(expected) };
+                }
+                assert_eq!(expected, powered.encipher(b));
+                assert_eq!(b, powered.decipher(expected));
+            }
+        }
+    }
+
+    #[test]
+    fn sub_cipher_pow_extreme_exponents() {
+        let mut builder = SubstitutionBuilder::new();
+        builder.rotate_range(0, u8::MAX, 1);
+        let cipher = builder.into_cipher();
+
+        // The order of a full rotation is 256, so only the low byte matters.
+        assert_eq!(255, cipher.pow(i64::MAX).encipher(0));
+        assert_eq!(0, cipher.pow(i64::MIN).encipher(0));
+    }
+
+    #[test]
+    fn sub_cipher_inverse() {
+        let mut builder = SubstitutionBuilder::new();
+        builder.rotate_range(b'a', b'z', 5);
+        let cipher = builder.into_cipher();
+        let inverse = cipher.inverse();
+
+        for b in 0..=u8::MAX {
+            assert_eq!(b, inverse.encipher(cipher.encipher(b)));
+            assert_eq!(cipher.decipher(b), inverse.encipher(b));
+        }
+    }
+
+    #[test]
+    fn sub_cipher_cycles_and_order() {
+        let mut builder = SubstitutionBuilder::new();
+        builder.rotate_range(10, 12, 1);
+        builder.rotate_range(20, 24, 1);
+        builder.swap(30, 31);
+        let cipher = builder.into_cipher();
+
+        assert_eq!(vec![vec![10, 11, 12], vec![20, 21, 22, 23, 24], vec![30, 31]], cipher.cycles());
+        assert_eq!(30, cipher.order());
+        assert_eq!(SubstitutionCipher::default().encipher(99), cipher.pow(30).encipher(99));
+
+        assert!(SubstitutionCipher::default().cycles().is_empty());
+        assert_eq!(1, SubstitutionCipher::default().order());
+    }
+
+    #[test]
+    fn sub_cipher_from_cipher() {
+        let cipher = SubstitutionCipher::from_cipher(&NullCipher);
+        for b in 0..=u8::MAX {
+            assert_eq!(b, cipher.encipher(b));
+            assert_eq!(b, cipher.decipher(b));
+        }
+    }
+
     #[test]
     fn sub_cipher_from_bytes_unchecked() {
         let test_range = (b'A', b'Z');
@@ -315,4 +644,55 @@ mod tests {
             assert_eq!(b + 1, cipher.encipher(b))
         }
     }
-}
\ No newline at end of file
+
+    #[test]
+    #[should_panic]
+    fn sub_builder_rotate_panics_on_reversed_range() {
+        SubstitutionBuilder::new().rotate_range(b'Z', b'A', 1);
+    }
+
+    #[test]
+    fn sub_builder_const_matches_runtime() {
+        const CONST_CIPHER: SubstitutionCipher = {
+            let mut builder = SubstitutionBuilder::new();
+            builder.rotate_range(0, 99, 7);
+            builder.rotate_range(100, 254, -3);
+            builder.rotate_range(0, u8::MAX, isize::MIN);
+            builder.swap(3, 200);
+            builder.into_cipher()
+        };
+
+        let mut builder = SubstitutionBuilder::new();
+        builder.rotate_range(0, 99, 7);
+        builder.rotate_range(100, 254, -3);
+        builder.rotate_range(0, u8::MAX, isize::MIN);
+        builder.swap(3, 200);
+        let cipher = builder.into_cipher();
+
+        for b in 0..=u8::MAX {
+            assert_eq!(cipher.encipher(b), CONST_CIPHER.encipher(b));
+            assert_eq!(cipher.decipher(b), CONST_CIPHER.decipher(b));
+        }
+    }
+
+    #[test]
+    fn sub_builder_detects_affine_mapping() {
+        // Flipping the case of ASCII letters is XOR with 0x20.
+        let mut builder = SubstitutionBuilder::new();
+        for b in (0..=u8::MAX).filter(|b| b & 0x20 == 0) {
+            builder.swap(b, b ^ 0x20);
+        }
+        let cipher = builder.into_cipher();
+        assert!(cipher.affine.is_some());
+
+        let mut buffer = Vec::from(&b"Attack at Dawn, attack AT DAWN!"[..]);
+        cipher.encipher_inplace(&mut buffer);
+        assert_eq!(&b"aTTACK\x00AT\x00dAWN\x0c\x00ATTACK\x00at\x00dawn\x01"[..], &buffer[..]);
+        cipher.inverse().encipher_inplace(&mut buffer);
+        assert_eq!(&b"Attack at Dawn, attack AT DAWN!"[..], &buffer[..]);
+
+        let mut builder = SubstitutionBuilder::new();
+        builder.swap(b'a', b'b');
+        assert!(builder.into_cipher().affine.is_none());
+    }
+}
@@ -0,0 +1,361 @@
+//! Cipher handles whose cipher can be replaced while in use.
+//!
+//! Replaced ciphers are reclaimed with a userspace flavour of read-copy-update.
+//! Every thread that reads through a handle owns a counter, which it alone
+//! writes: beginning a read copies the global grace period counter into it,
+//! and ending the read clears it, each with a plain store. A writer publishes
+//! a new cipher with one atomic swap, then waits for a grace period, during
+//! which it flips the phase of the global counter twice and waits until no
+//! thread is in a read that began in the previous phase. Only then is the old
+//! cipher freed.
+//!
+//! Plain stores by readers are not ordered against the writer's loads by the
+//! hardware. On Linux, the writer instead issues `membarrier`, which runs a
+//! memory barrier on every thread of the process, so readers only need to
+//! keep the compiler from reordering. Elsewhere, readers issue a full fence.
+
+use std::marker::PhantomData;
+use std::sync::{Arc, Mutex, Once};
+use std::sync::atomic::{self, AtomicPtr, AtomicU8, AtomicUsize, Ordering};
+use std::thread;
+
+use super::{PureCipher, SubstitutionCipher};
+
+/// Added to a reader's counter for each read it is nested in.
+const NEST_ONE: usize = 1;
+
+/// Bit of the grace period counter that flips twice in each grace period.
+const PHASE: usize = 1 << (usize::BITS / 2);
+
+/// Bits of a reader's counter that count the reads it is nested in.
+const NEST_MASK: usize = PHASE - 1;
+
+/// Number of times a writer polls the reader counters before yielding.
+const SPINS: usize = 100;
+
+/// Phase of the current grace period, with a nesting count of one, as copied
+/// by readers beginning a read.
+static GP_COUNTER: AtomicUsize = AtomicUsize::new(NEST_ONE);
+
+/// Counters of every live thread that has read through a handle. The lock is
+/// held for the whole of a grace period, so grace periods do not overlap.
+static READERS: Mutex<Vec<Arc<ReaderCount>>> = Mutex::new(Vec::new());
+
+/// Whether writers issue `membarrier` on behalf of readers.
+static MEMBARRIER: AtomicU8 = AtomicU8::new(MEMBARRIER_UNKNOWN);
+
+const MEMBARRIER_UNKNOWN: u8 = 0;
+const MEMBARRIER_READY: u8 = 1;
+const MEMBARRIER_UNSUPPORTED: u8 = 2;
+
+static MEMBARRIER_INIT: Once = Once::new();
+
+thread_local! {
+    static READER: ReaderRegistration = ReaderRegistration::new();
+}
+
+/// Counter of a reader thread, aligned to its own cache line so that readers
+/// do not falsely share it.
+#[repr(align(64))]
+struct ReaderCount(AtomicUsize);
+
+/// Registers the current thread's counter with writers for as long as the
+/// thread lives.
+struct ReaderRegistration(Arc<ReaderCount>);
+
+impl ReaderRegistration {
+    fn new() -> Self {
+        let count = Arc::new(ReaderCount(AtomicUsize::new(0)));
+        lock_readers().push(Arc::clone(&count));
+        ReaderRegistration(count)
+    }
+
+    /// Begins a read, which lasts until the returned guard is dropped.
+    #[inline]
+    fn lock<'a>(&'a self) -> ReadGuard<'a> {
+        let count = &self.0 .0;
+        let nesting = count.load(Ordering::Relaxed);
+        if nesting & NEST_MASK == 0 {
+            count.store(GP_COUNTER.load(Ordering::Relaxed), Ordering::Relaxed);
+            reader_fence();
+        } else {
+            count.store(nesting + NEST_ONE, Ordering::Relaxed);
+        }
+        ReadGuard(count)
+    }
+}
+
+impl Drop for ReaderRegistration {
+    fn drop(&mut self) {
+        lock_readers().retain(|count| !Arc::ptr_eq(count, &self.0));
+    }
+}
+
+/// Ends a read when dropped, including when the reader panics.
+struct ReadGuard<'a>(&'a AtomicUsize);
+
+impl<'a> Drop for ReadGuard<'a> {
+    #[inline]
+    fn drop(&mut self) {
+        let nesting = self.0.load(Ordering::Relaxed);
+        if nesting & NEST_MASK == NEST_ONE {
+            reader_fence();
+        }
+        self.0.store(nesting - NEST_ONE, Ordering::Release);
+    }
+}
+
+fn lock_readers() -> std::sync::MutexGuard<'static, Vec<Arc<ReaderCount>>> {
+    READERS.lock().unwrap_or_else(|poisoned| poisoned.into_inner())
+}
+
+/// Orders a reader's counter against the cipher it reads.
+#[inline]
+fn reader_fence() {
+    if MEMBARRIER.load(Ordering::Relaxed) == MEMBARRIER_READY {
+        atomic::compiler_fence(Ordering::SeqCst);
+    } else {
+        atomic::fence(Ordering::SeqCst);
+    }
+}
+
+/// Orders the accesses of every reader against the writer's.
+fn writer_fence() {
+    if MEMBARRIER.load(Ordering::Relaxed) == MEMBARRIER_READY {
+        membarrier(MEMBARRIER_READY);
+    } else {
+        atomic::fence(Ordering::SeqCst);
+    }
+}
+
+/// Registers the process for expedited membarriers, if the kernel supports
+/// them. Readers fence on their own until registration succeeds.
+fn init_membarrier() {
+    MEMBARRIER_INIT.call_once(|| {
+        let state = if membarrier(MEMBARRIER_UNKNOWN) { MEMBARRIER_READY } else { MEMBARRIER_UNSUPPORTED };
+        MEMBARRIER.store(state, Ordering::SeqCst);
+    });
+}
+
+/// Registers for expedited membarriers if `state` is unknown, or issues one
+/// otherwise, returning whether the call succeeded.
+#[cfg(target_os = "linux")]
+fn membarrier(state: u8) -> bool {
+    let command = if state == MEMBARRIER_UNKNOWN {
+        libc::MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED
+    } else {
+        libc::MEMBARRIER_CMD_PRIVATE_EXPEDITED
+    };
+    unsafe { libc::syscall(libc::SYS_membarrier, command, 0) == 0 }
+}
+
+#[cfg(not(target_os = "linux"))]
+fn membarrier(_state: u8) -> bool { false }
+
+/// Waits until no thread is in a read that may have loaded a cipher published
+/// before this call.
+///
+/// A reader may have copied the grace period counter long ago and only now be
+/// about to load a cipher. Flipping the phase twice, and each time waiting
+/// for the readers of the old phase, catches such readers, while readers that
+/// begin during the wait join the new phase and cannot keep the writer
+/// waiting.
+fn synchronize() {
+    let readers = lock_readers();
+    writer_fence();
+    for _ in 0..2 {
+        let phase = GP_COUNTER.fetch_xor(PHASE, Ordering::SeqCst) ^ PHASE;
+        for count in readers.iter() {
+            let mut spins = 0;
+            loop {
+                let value = count.0.load(Ordering::SeqCst);
+                if value & NEST_MASK == 0 || (value ^ phase) & PHASE == 0 {
+                    break;
+                }
+                if spins < SPINS {
+                    spins += 1;
+                    std::hint::spin_loop();
+                } else {
+                    thread::yield_now();
+                }
+            }
+        }
+    }
+    writer_fence();
+}
+
+/// Handle through which a cipher is used while another thread may replace it.
+///
+/// Readers cipher through the handle without taking locks or executing any
+/// atomic read-modify-write instruction. A writer replaces the cipher with a
+/// single atomic swap, then waits for every read that may still use the old
+/// cipher to end before freeing it. Writers wait for each other and for
+/// readers; readers never wait, except to register the first time a thread
+/// reads through any handle.
+///
+/// Each call to a `PureCipher` method is one read, so a buffer is always
+/// ciphered entirely by one cipher, even if the cipher is replaced midway.
+///
+/// # Example
+/// ```
+/// use purecipher::{PureCipher, SwappableCipher};
+///
+/// let handle = SwappableCipher::new(purecipher::caesar());
+/// assert_eq!(b'd', handle.encipher(b'a'));
+///
+/// handle.store(purecipher::rot13_alpha());
+/// assert_eq!(b'n', handle.encipher(b'a'));
+/// ```
+pub struct SwappableCipher<C = SubstitutionCipher> {
+    current: AtomicPtr<C>,
+    /// The handle owns a `C`, which it shares between threads.
+    _cipher: PhantomData<*const C>,
+}
+
+unsafe impl<C: Send + Sync> Send for SwappableCipher<C> {}
+
+unsafe impl<C: Send + Sync> Sync for SwappableCipher<C> {}
+
+impl<C> SwappableCipher<C> {
+    /// Builds a handle that initially ciphers with the given cipher.
+    pub fn new(cipher: C) -> Self {
+        init_membarrier();
+        Self { current: AtomicPtr::new(Box::into_raw(Box::new(cipher))), _cipher: PhantomData }
+    }
+
+    /// Calls `f` with the current cipher, which is not freed until `f`
+    /// returns.
+    ///
+    /// Reads may be nested, including reads through other handles.
+    #[inline]
+    pub fn read<F, R>(&self, f: F) -> R
+        where F: FnOnce(&C) -> R
+    {
+        READER.with(|reader| {
+            let _guard = reader.lock();
+            f(unsafe { &*self.current.load(Ordering::Acquire) })
+        })
+    }
+
+    /// Replaces the cipher, returning the old one once no reader holds it.
+    ///
+    /// This function blocks until every read that began before the cipher
+    /// was replaced has ended, through this handle or any other. It must not
+    /// be called from within a read.
+    pub fn swap(&self, cipher: C) -> C {
+        let old = self.current.swap(Box::into_raw(Box::new(cipher)), Ordering::SeqCst);
+        synchronize();
+        *unsafe { Box::from_raw(old) }
+    }
+
+    /// Replaces the cipher, freeing the old one once no reader holds it.
+    ///
+    /// See `swap`.
+    pub fn store(&self, cipher: C) {
+        drop(self.swap(cipher))
+    }
+}
+
+impl<C> Drop for SwappableCipher<C> {
+    fn drop(&mut self) {
+        drop(unsafe { Box::from_raw(*self.current.get_mut()) });
+    }
+}
+
+impl<C: PureCipher> PureCipher for SwappableCipher<C> {
+    fn encipher(&self, token: u8) -> u8 {
+        self.read(|cipher| cipher.encipher(token))
+    }
+
+    fn decipher(&self, token: u8) -> u8 {
+        self.read(|cipher| cipher.decipher(token))
+    }
+
+    fn encipher_inplace(&self, bytes: &mut [u8]) {
+        self.read(|cipher| cipher.encipher_inplace(bytes))
+    }
+
+    fn decipher_inplace(&self, bytes: &mut [u8]) {
+        self.read(|cipher| cipher.decipher_inplace(bytes))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use super::super::{caesar, rot13_alpha};
+
+    use std::sync::Arc;
+    use std::sync::atomic::AtomicBool;
+
+    /// Cipher that records whether it has been dropped, and how many of its
+    /// kind are alive.
+    struct Tracked {
+        cipher: SubstitutionCipher,
+        dropped: AtomicBool,
+        alive: Arc<AtomicUsize>,
+    }
+
+    impl Tracked {
+        fn new(cipher: SubstitutionCipher, alive: &Arc<AtomicUsize>) -> Self {
+            alive.fetch_add(1, Ordering::SeqCst);
+            Self { cipher, dropped: AtomicBool::new(false), alive: Arc::clone(alive) }
+        }
+    }
+
+    impl Drop for Tracked {
+        fn drop(&mut self) {
+            assert!(!self.dropped.swap(true, Ordering::SeqCst));
+            self.alive.fetch_sub(1, Ordering::SeqCst);
+        }
+    }
+
+    #[test]
+    fn swap_returns_old_cipher() {
+        let handle = SwappableCipher::new(caesar());
+        let mut text = *b"abc";
+        handle.encipher_inplace(&mut text);
+        assert_eq!(b"def", &text);
+
+        let old = handle.swap(rot13_alpha());
+        assert_eq!(b'd', old.encipher(b'a'));
+        handle.decipher_inplace(&mut text);
+        assert_eq!(b"qrs", &text);
+    }
+
+    #[test]
+    fn swap_concurrent_readers() {
+        let alive = Arc::new(AtomicUsize::new(0));
+        let handle = Arc::new(SwappableCipher::new(Tracked::new(caesar(), &alive)));
+        let stop = Arc::new(AtomicBool::new(false));
+
+        let readers: Vec<_> = (0..4)
+            .map(|_| {
+                let (handle, stop) = (Arc::clone(&handle), Arc::clone(&stop));
+                thread::spawn(move || {
+                    while !stop.load(Ordering::SeqCst) {
+                        handle.read(|tracked| {
+                            let mut text = *b"abcdefgh";
+                            tracked.cipher.encipher_inplace(&mut text);
+                            assert!(!tracked.dropped.load(Ordering::SeqCst));
+                            // The whole buffer is ciphered by one cipher.
+                            assert!(&text == b"defghijk" || &text == b"nopqrstu");
+                        });
+                    }
+                })
+            })
+            .collect();
+
+        for i in 0..1000 {
+            let cipher = if i % 2 == 0 { rot13_alpha() } else { caesar() };
+            handle.store(Tracked::new(cipher, &alive));
+            assert_eq!(1, alive.load(Ordering::SeqCst));
+        }
+        stop.store(true, Ordering::SeqCst);
+        for reader in readers {
+            reader.join().unwrap();
+        }
+        drop(handle);
+        assert_eq!(0, alive.load(Ordering::SeqCst));
+    }
+}
@@ -0,0 +1,281 @@
+//! Substitution ciphers over 16-bit tokens.
+
+use std::fmt;
+use std::sync::OnceLock;
+use std::u16;
+
+/// Number of distinct 16-bit tokens.
+const ALL_U16: usize = u16::MAX as usize + 1;
+
+/// Lookup table from each 16-bit token to its substitute.
+///
+/// The table holds one padding entry past the last token so that vectorized
+/// kernels may load 32 bits at the address of any token's entry.
+#[derive(Clone)]
+struct WordMapping(Box<[u16]>);
+
+impl WordMapping {
+    /// Builds the mapping of each token to itself.
+    fn identity() -> Self {
+        let mut table: Vec<u16> = (0..ALL_U16).map(|t| t as u16).collect();
+        table.push(0);
+        WordMapping(table.into_boxed_slice())
+    }
+
+    /// Builds the mapping that undoes this one.
+    fn inverse(&self) -> Self {
+        let mut table = vec![0; ALL_U16 + 1];
+        for (token, &mapped) in self.0[..ALL_U16].iter().enumerate() {
+            table[mapped as usize] = token as u16;
+        }
+        WordMapping(table.into_boxed_slice())
+    }
+
+    /// Substitutes each token of `tokens` inplace.
+    fn apply(&self, tokens: &mut [u16]) {
+        #[cfg(target_arch = "x86_64")]
+        {
+            if is_x86_feature_detected!("avx2") {
+                return unsafe { self.apply_avx2(tokens) };
+            }
+        }
+        self.apply_scalar(tokens)
+    }
+
+    fn apply_scalar(&self, tokens: &mut [u16]) {
+        let table = &self.0[..ALL_U16];
+        for t in tokens.iter_mut() {
+            *t = table[*t as usize];
+        }
+    }
+
+    /// Substitutes sixteen tokens at a time using AVX2 gathers.
+    ///
+    /// Each lane gathers the 32 bits starting at its token's entry and keeps
+    /// the low half, which is why the table is padded by one entry.
+    #[cfg(target_arch = "x86_64")]
+    #[target_feature(enable = "avx2")]
+    unsafe fn apply_avx2(&self, tokens: &mut [u16]) {
+        use std::arch::x86_64::*;
+
+        let base = self.0.as_ptr() as *const i32;
+        let low_half = _mm256_set1_epi32(0xffff);
+        let mut blocks = tokens.chunks_exact_mut(16);
+        for block in blocks.by_ref() {
+            let words = _mm256_loadu_si256(block.as_ptr() as *const __m256i);
+            let lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(words));
+            let hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(words, 1));
+            let lo = _mm256_and_si256(_mm256_i32gather_epi32(base, lo, 2), low_half);
+            let hi = _mm256_and_si256(_mm256_i32gather_epi32(base, hi, 2), low_half);
+            // Packing interleaves the 128-bit halves of its operands.
+            let packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0b11_01_10_00);
+            _mm256_storeu_si256(block.as_mut_ptr() as *mut __m256i, packed);
+        }
+        self.apply_scalar(blocks.into_remainder());
+    }
+}
+
+impl fmt::Debug for WordMapping {
+    fn fmt(&self, f: &mut fmt::Formatter) -> Result<(), fmt::Error> {
+        write!(f, "WordMapping {{ .. }}")
+    }
+}
+
+#[derive(Debug)]
+/// Convenience structure to help build 16-bit substitution ciphers.
+///
+/// This structure mirrors `SubstitutionBuilder`, with ciphers expressed as
+/// swaps and shifts of 16-bit tokens.
+pub struct WideSubstitutionBuilder {
+    /// Index based mapping between tokens.
+    map: WordMapping,
+}
+
+impl WideSubstitutionBuilder {
+    /// Build a new `WideSubstitutionBuilder` with each token mapped to itself.
+    pub fn new() -> Self {
+        Self { map: WordMapping::identity() }
+    }
+
+    /// Swaps the mappings of `left` and `right` in the resulting cipher.
+    pub fn swap(&mut self, left: u16, right: u16) {
+        self.map.0.swap(left as usize, right as usize);
+    }
+
+    /// Rotates the mapping target of each token in the given inclusive range
+    /// in the resulting cipher.
+    ///
+    /// # Panics
+    /// This method will panic if `to` < `from`.
+    ///
+    /// # Examples
+    /// ```
+    /// use purecipher::WideSubstitutionBuilder;
+    ///
+    /// let mut builder = WideSubstitutionBuilder::new();
+    /// builder.rotate_range(0x3041, 0x3096, 1);
+    ///
+    /// let cipher = builder.into_cipher();
+    ///
+    /// assert_eq!(0x3042, cipher.encipher(0x3041));
+    /// assert_eq!(0x3041, cipher.encipher(0x3096));
+    /// assert_eq!(0x3041, cipher.decipher(0x3042));
+    /// ```
+    pub fn rotate_range(&mut self, from: u16, to: u16, offset: isize) {
+        assert!(from <= to, "the end of the range must not precede its start");
+        let abs_offset = offset.unsigned_abs() % (1 + to as usize - from as usize);
+        let slice = &mut self.map.0[from as usize..=to as usize];
+
+        if offset < 0 {
+            slice.rotate_right(abs_offset);
+        } else {
+            slice.rotate_left(abs_offset);
+        }
+    }
+
+    /// Convert this builder into a 16-bit substitution cipher.
+    pub fn into_cipher(self) -> WideSubstitutionCipher {
+        WideSubstitutionCipher { map: self.map, inv: OnceLock::new() }
+    }
+}
+
+impl Default for WideSubstitutionBuilder {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+#[derive(Debug)]
+/// Cipher that transforms 16-bit tokens via direct substitution.
+///
+/// The forward table occupies 128 KiB, small enough to stay resident in the
+/// L2 cache of most cores. The inverse table, another 128 KiB, is only built
+/// when the cipher first deciphers, so ciphers used only to encipher never
+/// pay for it. Where AVX2 is available, tokens are substituted sixteen at a
+/// time with gather instructions.
+pub struct WideSubstitutionCipher {
+    /// Index-based mapping to encipher tokens.
+    map: WordMapping,
+    /// Index-based mapping to decipher tokens, built on first use.
+    inv: OnceLock<WordMapping>,
+}
+
+impl WideSubstitutionCipher {
+    /// Builds a cipher that enciphers each token `t` to `map[t]`.
+    ///
+    /// Returns `None` unless `map` is a permutation of all 65536 tokens.
+    pub fn from_table(map: &[u16]) -> Option<Self> {
+        if map.len() != ALL_U16 {
+            return None;
+        }
+        let mut seen = vec![false; ALL_U16];
+        for &t in map.iter() {
+            if seen[t as usize] {
+                return None;
+            }
+            seen[t as usize] = true;
+        }
+        let mut table = map.to_vec();
+        table.push(0);
+        Some(Self { map: WordMapping(table.into_boxed_slice()), inv: OnceLock::new() })
+    }
+
+    /// Enciphers a single token.
+    pub fn encipher(&self, token: u16) -> u16 {
+        self.map.0[token as usize]
+    }
+
+    /// Deciphers a single token.
+    pub fn decipher(&self, token: u16) -> u16 {
+        self.inverse().0[token as usize]
+    }
+
+    /// Enciphers a buffer of tokens inplace.
+    pub fn encipher_inplace(&self, tokens: &mut [u16]) {
+        self.map.apply(tokens)
+    }
+
+    /// Deciphers a buffer of tokens inplace.
+    pub fn decipher_inplace(&self, tokens: &mut [u16]) {
+        self.inverse().apply(tokens)
+    }
+
+    fn inverse(&self) -> &WordMapping {
+        self.inv.get_or_init(|| self.map.inverse())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Builds a cipher that scatters tokens across the whole table.
+    fn scrambled() -> WideSubstitutionCipher {
+        let mut builder = WideSubstitutionBuilder::new();
+        for t in 0..ALL_U16 as u32 {
+            builder.swap(t as u16, (t.wrapping_mul(40503) >> 3) as u16);
+        }
+        builder.into_cipher()
+    }
+
+    #[test]
+    fn wide_builder_new_is_identity() {
+        let cipher = WideSubstitutionBuilder::new().into_cipher();
+        for t in 0..=u16::MAX {
+            assert_eq!(t, cipher.encipher(t));
+        }
+    }
+
+    #[test]
+    fn wide_builder_swap_and_rotate() {
+        let mut builder = WideSubstitutionBuilder::new();
+        builder.rotate_range(10, 12, -1);
+        builder.swap(0, u16::MAX);
+
+        let cipher = builder.into_cipher();
+        assert_eq!(12, cipher.encipher(10));
+        assert_eq!(10, cipher.encipher(11));
+        assert_eq!(u16::MAX, cipher.encipher(0));
+        assert_eq!(0, cipher.decipher(u16::MAX));
+    }
+
+    #[test]
+    fn wide_builder_rotate_extreme_offset() {
+        let mut builder = WideSubstitutionBuilder::new();
+        builder.rotate_range(0, u16::MAX, isize::MIN);
+        assert_eq!(0, builder.into_cipher().encipher(0));
+    }
+
+    #[test]
+    #[should_panic(expected = "must not precede")]
+    fn wide_builder_rotate_reversed_range_panics() {
+        WideSubstitutionBuilder::new().rotate_range(12, 10, 1);
+    }
+
+    #[test]
+    fn wide_kernels_agree() {
+        let cipher = scrambled();
+        let tokens: Vec<u16> = (0..1000u32).map(|i| (i.wrapping_mul(2654435761) >> 16) as u16).chain(Some(u16::MAX)).collect();
+
+        let mut expected = tokens.clone();
+        cipher.map.apply_scalar(&mut expected);
+
+        let mut actual = tokens.clone();
+        cipher.encipher_inplace(&mut actual);
+        assert_eq!(expected, actual);
+
+        cipher.decipher_inplace(&mut actual);
+        assert_eq!(tokens, actual);
+    }
+
+    #[test]
+    fn wide_from_table() {
+        let cipher = scrambled();
+        let table: Vec<u16> = (0..=u16::MAX).map(|t| cipher.encipher(t)).collect();
+        let copy = WideSubstitutionCipher::from_table(&table).unwrap();
+        assert_eq!(cipher.encipher(1234), copy.encipher(1234));
+
+        assert!(WideSubstitutionCipher::from_table(&table[1..]).is_none());
+        assert!(WideSubstitutionCipher::from_table(&vec![0; ALL_U16]).is_none());
+    }
+}
@@ -0,0 +1,57 @@
+/**
+ * Benchmark of the per-call cost of ciphering small buffers through the C++
+ * wrapper.
+ *
+ * Small buffers make the cost of calling into the purecipher library, rather
+ * than the cost of ciphering, dominate. Comparing the output of builds with and
+ * without the PURECIPHER_STATIC and PURECIPHER_LTO CMake options shows the
+ * overhead saved by linking statically and by cross-language LTO.
+ */
+#include "purecipher.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace {
+    using purecipher::Cipher;
+
+    /// Total number of bytes ciphered for each buffer size.
+    constexpr std::size_t BYTES_PER_SIZE = 1 << 26;
+
+    /// Buffer sizes to measure, in bytes.
+    constexpr std::size_t SIZES[] = {1, 4, 16, 64, 256};
+
+    /// Returns the mean time in nanoseconds taken to encipher a buffer of
+    /// `size` bytes with `cipher`.
+    double time_per_call(const Cipher& cipher, std::size_t size) {
+        std::vector<std::uint8_t> buffer(size, 'a');
+        const std::size_t calls = BYTES_PER_SIZE / size;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < calls; ++i) {
+            cipher.encipher_inplace(buffer.data(), buffer.size());
+            // Keep the compiler from merging or dropping calls once they are
+            // visible to it under LTO.
+            asm volatile("" : : "r"(buffer.data()) : "memory");
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        return std::chrono::duration<double, std::nano>(elapsed).count() / calls;
+    }
+
+    void report(std::string_view label, const Cipher& cipher) {
+        for (const auto size : SIZES) {
+            std::cout << label << "\t" << size << "\t" << time_per_call(cipher, size) << "\n";
+        }
+    }
+}
+
+int main() {
+    std::cout << "cipher\tbytes\tns/call\n";
+    report("null", Cipher::null());
+    report("rot13", Cipher::rot13());
+    return 0;
+}
@@ -10,12 +10,87 @@
 
 #include "purecipher.h"
 
+#include <array>
+#include <chrono>
 #include <cstdint>
+#include <future>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace purecipher {
+    /**
+     * Number of occurrences of each byte value within some data.
+     */
+    using Histogram = std::array<std::uint64_t, 256>;
+
+    /**
+     * Counts the occurrences of each byte value in the given bytes.
+     *
+     * @param buffer Sequence of bytes to be counted.
+     * @return The number of occurrences of each byte value.
+     */
+    Histogram histogram(const std::vector<std::uint8_t>& buffer);
+
+    /**
+     * Computes the Shannon entropy of the given byte counts.
+     *
+     * @param counts Number of occurrences of each byte value.
+     * @return Entropy in bits per byte, between 0 and 8.
+     */
+    double entropy(const Histogram& counts);
+
+    /**
+     * Computes Pearson's chi-square statistic of the given byte counts against
+     * a reference distribution.
+     *
+     * @param counts Number of occurrences of each byte value.
+     * @param expected Relative frequency of each byte value in the reference distribution.
+     * @return The chi-square statistic.
+     */
+    double chi_square(const Histogram& counts, const std::array<double, 256>& expected);
+
+    /**
+     * Computes the CRC32C checksum of the given bytes, continuing from the
+     * checksum of the bytes that preceded them.
+     *
+     * @param buffer Sequence of bytes to be checksummed.
+     * @param crc Checksum of the preceding bytes, or 0 for the first bytes.
+     * @return The checksum of the preceding bytes followed by the given bytes.
+     */
+    std::uint32_t crc32c(const std::vector<std::uint8_t>& buffer, std::uint32_t crc = 0);
+
+    /**
+     * Combines the checksums of two consecutive runs of bytes into the
+     * checksum of both, so that chunks may be checksummed separately.
+     *
+     * @param crc1 Checksum of the first bytes.
+     * @param crc2 Checksum of the bytes that follow them.
+     * @param length2 Number of bytes checksummed by crc2.
+     * @return The checksum of both runs of bytes.
+     */
+    inline std::uint32_t crc32c_combine(std::uint32_t crc1, std::uint32_t crc2, std::uint64_t length2) {
+        return purecipher_crc32c_combine(crc1, crc2, length2);
+    }
+
+    /**
+     * Encoding of ciphertext as text, for text-only transports.
+     */
+    enum class TextEncoding {
+        Hex = PURECIPHER_ENCODING_HEX,
+        Base64 = PURECIPHER_ENCODING_BASE64,
+    };
+
+    /**
+     * The side of a cipher whose bytes are checksummed while ciphering.
+     */
+    enum class Checksummed {
+        Plaintext,
+        Ciphertext,
+    };
+
     /**
      * A pure (stateless) cipher.
      *
@@ -26,17 +101,54 @@ namespace purecipher {
         /**
          * Pointer to the cipher object that this instance wraps.
          */
-        const purecipher_obj_t m_cipher_ptr;
+        purecipher_obj_t m_cipher_ptr;
 
         /**
          * Whether or not this instance's cipher pointer is owned by this instance.
          *
-         * The pointer unfortunately cannot be placed under a std::unique_ptr
-         * with a custom deleter because it is represented by a fat pointer
-         * struct rather than an opaque pointer.
+         * Ciphers interned in a CipherArena refer to pointers owned by the
+         * arena. The pointer unfortunately cannot be placed under a
+         * std::unique_ptr with a custom deleter because it is represented by
+         * a fat pointer struct rather than an opaque pointer.
+         */
+        bool m_owned;
+
+        /**
+         * Whether or not this instance has been moved from.
          */
         bool m_moved;
 
+        friend class PeriodicCipher;
+        friend class CipherPool;
+        friend class CipherContext;
+        friend class CipherArena;
+        friend class SwappableCipher;
+        friend class FieldSelector;
+        friend class MultiFinder;
+        friend class PlaintextOrder;
+
+        /**
+         * Creates a Cipher that refers to a cipher object pointer owned by
+         * some other object, such as a CipherArena.
+         *
+         * @param cipher_ptr Borrowed cipher object pointer.
+         * @param owned Whether this instance is responsible for freeing the pointer.
+         */
+        Cipher(purecipher_obj_t cipher_ptr, bool owned)
+            : m_cipher_ptr{cipher_ptr}, m_owned{owned}, m_moved{false} {}
+
+        /**
+         * Collects the cipher object pointers for a batch ciphering call.
+         *
+         * Returns fewer pointers than there are ciphers if the offsets do not
+         * describe one record per cipher within the arena.
+         */
+        static std::vector<purecipher_obj_t> batch_ptrs(
+            const std::vector<const Cipher*>& ciphers,
+            const std::vector<std::uint8_t>& arena,
+            const std::vector<std::size_t>& offsets
+        );
+
     public:
         /**
          * Creates a new Cipher from the given cipher object pointer.
@@ -47,7 +159,7 @@ namespace purecipher {
          * @param cipher_ptr Owned cipher object pointer.
          */
         explicit Cipher(purecipher_obj_t cipher_ptr)
-            : m_cipher_ptr{cipher_ptr}, m_moved{false} {}
+            : m_cipher_ptr{cipher_ptr}, m_owned{true}, m_moved{false} {}
 
         /*
          * Copy-constructor is disabled as no interface is provided for cloning
@@ -62,13 +174,14 @@ namespace purecipher {
         Cipher& operator=(const Cipher& other) = delete;
 
         /*
-         * Move-assignment is disabled as the cipher pointer is declared
-         * constant and cannot be re-assigned.
+         * Move-assignment. This instance takes over the ownership, if any, of
+         * the moved-from instance's cipher pointer.
          */
-        Cipher& operator=(Cipher&& other) = delete;
+        Cipher& operator=(Cipher&& other) noexcept;
 
         /*
-         * Move-constructor.
+         * Move-constructor. The new instance takes over the ownership, if
+         * any, of the moved-from instance's cipher pointer.
          */
         Cipher(Cipher&& other) noexcept;
 
@@ -76,7 +189,7 @@ namespace purecipher {
          * Deconstructor. Since this class is declared final, this method has
          * not been marked virtual.
          */
-        ~Cipher() { if (!m_moved) { purecipher_free(m_cipher_ptr); }}
+        ~Cipher() { if (m_owned) { purecipher_free(m_cipher_ptr); }}
 
         /**
          * Enciphers the elements of the given vector of bytes inplace.
@@ -92,22 +205,116 @@ namespace purecipher {
          */
         void decipher_inplace(std::vector<std::uint8_t>& buffer) const;
 
+        /**
+         * Enciphers the elements of the given vector of bytes inplace while
+         * computing their CRC32C checksum in the same pass.
+         *
+         * @param buffer Sequence of bytes to be enciphered.
+         * @param checksummed Whether the plaintext or ciphertext is checksummed.
+         * @param crc Checksum of the preceding bytes, or 0 for the first bytes.
+         * @return The checksum, continued from crc.
+         */
+        std::uint32_t encipher_inplace_crc32c(
+            std::vector<std::uint8_t>& buffer,
+            Checksummed checksummed,
+            std::uint32_t crc = 0
+        ) const;
+
+        /**
+         * Deciphers the elements of the given vector of bytes inplace while
+         * computing their CRC32C checksum in the same pass.
+         *
+         * @param buffer Sequence of bytes to be deciphered.
+         * @param checksummed Whether the plaintext or ciphertext is checksummed.
+         * @param crc Checksum of the preceding bytes, or 0 for the first bytes.
+         * @return The checksum, continued from crc.
+         */
+        std::uint32_t decipher_inplace_crc32c(
+            std::vector<std::uint8_t>& buffer,
+            Checksummed checksummed,
+            std::uint32_t crc = 0
+        ) const;
+
+        /**
+         * Enciphers the given bytes and writes the ciphertext to the given
+         * character buffer in the given encoding, in a single pass.
+         *
+         * @param data Bytes to be enciphered, which are not modified.
+         * @param size Number of bytes to be enciphered.
+         * @param encoding Encoding of the ciphertext.
+         * @param text Buffer receiving the encoded ciphertext.
+         * @param capacity Size of the text buffer.
+         * @return The number of characters written, or 0 if the text buffer
+         *         is too small.
+         */
+        std::size_t encipher_encode(
+            const std::uint8_t* data,
+            std::size_t size,
+            TextEncoding encoding,
+            char* text,
+            std::size_t capacity
+        ) const {
+            return purecipher_encipher_encode(
+                m_cipher_ptr, static_cast<int>(encoding), data, size, text, capacity
+            );
+        }
+
+        /**
+         * Enciphers the given bytes into a new string in the given encoding,
+         * in a single pass.
+         *
+         * @param buffer Sequence of bytes to be enciphered.
+         * @param encoding Encoding of the ciphertext.
+         * @return The encoded ciphertext.
+         */
+        std::string encipher_encode(const std::vector<std::uint8_t>& buffer, TextEncoding encoding) const;
+
+        /**
+         * Decodes the given text in the given encoding and deciphers the
+         * result into the given byte buffer, in a single pass.
+         *
+         * @param text Encoded ciphertext.
+         * @param encoding Encoding of the ciphertext.
+         * @param data Buffer receiving the plaintext.
+         * @param capacity Size of the byte buffer.
+         * @return The number of bytes written, or an empty optional if the
+         *         text is not valid or the byte buffer is too small.
+         */
+        std::optional<std::size_t> decode_decipher(
+            std::string_view text,
+            TextEncoding encoding,
+            std::uint8_t* data,
+            std::size_t capacity
+        ) const;
+
+        /**
+         * Decodes the given text in the given encoding and deciphers the
+         * result into a new vector of bytes, in a single pass.
+         *
+         * @param text Encoded ciphertext.
+         * @param encoding Encoding of the ciphertext.
+         * @return The plaintext, or an empty optional if the text is not valid.
+         */
+        std::optional<std::vector<std::uint8_t>> decode_decipher(std::string_view text, TextEncoding encoding) const;
+
         /**
          * Encipher the given null-terminated string inplace.
          *
          * @param str Null-terminated c-style string.
+         * @return The length of the string.
          */
-        void encipher_inplace(char* str) const {
-            purecipher_encipher_str(m_cipher_ptr, str);
+        std::size_t encipher_inplace(char* str) const {
+            return purecipher_encipher_str(m_cipher_ptr, str);
         };
 
         /**
          * Decipher the given null-terminated string inplace.
          *
          * @param str Null-terminated c-style string.
+         * @return The length of the string.
          */
-        void decipher_inplace(char* str) const {
-            purecipher_decipher_str(m_cipher_ptr, str);
+        std::size_t decipher_inplace(char* str) const {
+            return purecipher_decipher_str(m_cipher_ptr, str);
         };
 
         /**
@@ -162,6 +369,157 @@ namespace purecipher {
          */
         std::string decipher(const std::string& str) const;
 
+        /**
+         * Builds a cipher equivalent to applying this cipher the given number
+         * of times in succession.
+         *
+         * @param exponent Number of applications. Negative values apply the inverse.
+         * @return New cipher equivalent to this cipher raised to the given power.
+         */
+        Cipher pow(std::int64_t exponent) const { return Cipher(purecipher_cipher_pow(m_cipher_ptr, exponent)); };
+
+        /**
+         * Builds a cipher that enciphers bytes the way this cipher deciphers them.
+         *
+         * @return New cipher that is the inverse of this cipher.
+         */
+        Cipher inverse() const { return Cipher(purecipher_cipher_inverse(m_cipher_ptr)); };
+
+        /**
+         * Computes the smallest positive number of times this cipher can be
+         * applied in succession to leave every byte unchanged.
+         *
+         * @return The order of this cipher's permutation.
+         */
+        std::uint64_t order() const { return purecipher_cipher_order(m_cipher_ptr); };
+
+        /**
+         * Decomposes this cipher's permutation into disjoint cycles, omitting
+         * bytes that are mapped to themselves.
+         *
+         * @return Each cycle, listing bytes in the order in which this cipher maps them.
+         */
+        std::vector<std::vector<std::uint8_t>> cycles() const;
+
+        /**
+         * Counts the occurrences of each byte value in the plaintext of the
+         * given ciphertext, without deciphering it.
+         *
+         * @param buffer Sequence of enciphered bytes.
+         * @return The number of occurrences of each plaintext byte value.
+         */
+        Histogram plaintext_histogram(const std::vector<std::uint8_t>& buffer) const;
+
+        /**
+         * Finds the first occurrence of the given plaintext within the given
+         * ciphertext, without deciphering it.
+         *
+         * @param plaintext Plaintext to find.
+         * @param ciphertext Sequence of enciphered bytes.
+         * @return The offset of the occurrence, if any.
+         */
+        std::optional<std::size_t> find(const std::string& plaintext, const std::vector<std::uint8_t>& ciphertext) const;
+
+        /**
+         * Finds every occurrence of the given plaintext within the given
+         * ciphertext, including occurrences that overlap, without deciphering
+         * it.
+         *
+         * @param plaintext Plaintext to find.
+         * @param ciphertext Sequence of enciphered bytes.
+         * @return The offsets of the occurrences in increasing order.
+         */
+        std::vector<std::size_t> find_all(const std::string& plaintext, const std::vector<std::uint8_t>& ciphertext) const;
+
+        /**
+         * Enciphers count fields of field_len bytes lying stride bytes apart,
+         * the first starting at base.
+         *
+         * @param base First byte of the first field.
+         * @param field_len Number of bytes in each field.
+         * @param stride Distance in bytes between consecutive fields.
+         * @param count Number of fields.
+         */
+        void encipher_strided(std::uint8_t* base, std::size_t field_len, std::size_t stride, std::size_t count) const {
+            purecipher_encipher_strided(m_cipher_ptr, base, field_len, stride, count);
+        }
+
+        /**
+         * Deciphers count fields of field_len bytes lying stride bytes apart,
+         * the first starting at base.
+         *
+         * @param base First byte of the first field.
+         * @param field_len Number of bytes in each field.
+         * @param stride Distance in bytes between consecutive fields.
+         * @param count Number of fields.
+         */
+        void decipher_strided(std::uint8_t* base, std::size_t field_len, std::size_t stride, std::size_t count) const {
+            purecipher_decipher_strided(m_cipher_ptr, base, field_len, stride, count);
+        }
+
+        /**
+         * Enciphers the given fields of fixed-size records inplace.
+         *
+         * Only whole records are ciphered. If the fields overlap or do not
+         * fit within a record, the records are left unchanged.
+         *
+         * @param records Storage holding every record.
+         * @param stride Size of each record in bytes.
+         * @param fields Fields to be enciphered within each record.
+         */
+        void encipher_fields(
+            std::vector<std::uint8_t>& records,
+            std::size_t stride,
+            const std::vector<purecipher_field_t>& fields
+        ) const;
+
+        /**
+         * Deciphers the given fields of fixed-size records inplace.
+         *
+         * @param records Storage holding every record.
+         * @param stride Size of each record in bytes.
+         * @param fields Fields to be deciphered within each record.
+         */
+        void decipher_fields(
+            std::vector<std::uint8_t>& records,
+            std::size_t stride,
+            const std::vector<purecipher_field_t>& fields
+        ) const;
+
+        /**
+         * Enciphers a batch of records stored contiguously in an arena, each
+         * with its own cipher.
+         *
+         * Record i spans the bytes [offsets[i], offsets[i + 1]) of the arena
+         * and is enciphered with ciphers[i]. Records are processed grouped by
+         * cipher. If the offsets are invalid, the arena is left unchanged.
+         *
+         * @param ciphers The cipher used for each record.
+         * @param arena Contiguous storage holding every record.
+         * @param offsets Ascending record offsets, one more than the number of ciphers.
+         */
+        static void encipher_batch(
+            const std::vector<const Cipher*>& ciphers,
+            std::vector<std::uint8_t>& arena,
+            const std::vector<std::size_t>& offsets
+        );
+
+        /**
+         * Deciphers a batch of records stored contiguously in an arena, each
+         * with its own cipher.
+         *
+         * See Cipher::encipher_batch for a description of the arguments.
+         *
+         * @param ciphers The cipher used for each record.
+         * @param arena Contiguous storage holding every record.
+         * @param offsets Ascending record offsets, one more than the number of ciphers.
+         */
+        static void decipher_batch(
+            const std::vector<const Cipher*>& ciphers,
+            std::vector<std::uint8_t>& arena,
+            const std::vector<std::size_t>& offsets
+        );
+
         /**
          * Builds a cipher that performs no ciphering.
 
@@ -189,6 +547,633 @@ namespace purecipher {
          * @return Cipher for stereotypical "leet" speak.
          */
         static Cipher leet() { return Cipher(purecipher_cipher_leet()); };
+
+        /**
+         * Builds a pure cipher that enciphers each byte x as Ax + constant
+         * over GF(2), where bit k of rows[i] is the entry of A in row i and
+         * column k.
+         *
+         * @param rows Rows of an invertible 8x8 bit matrix.
+         * @param constant Byte added to each enciphered byte.
+         * @return Affine cipher, which leaves buffers unchanged if the matrix is singular.
+         */
+        static Cipher affine(const std::array<std::uint8_t, 8>& rows, std::uint8_t constant) {
+            return Cipher(purecipher_cipher_affine(rows.data(), constant));
+        };
+    };
+
+    /**
+     * A polyalphabetic cipher that selects a substitution by stream position.
+     *
+     * The byte at stream position i is ciphered with the substitution at index
+     * i % period(). Each ciphering call is given the stream position of its
+     * first byte, so chunks of a stream can be ciphered independently.
+     */
+    class PeriodicCipher final {
+        /**
+         * Pointer to the periodic cipher that this instance wraps.
+         */
+        std::unique_ptr<purecipher_periodic_t, decltype(&purecipher_periodic_free)> m_periodic_ptr;
+
+        /**
+         * Creates a PeriodicCipher to wrap the given periodic cipher pointer.
+         *
+         * @param periodic_ptr Owned pointer to a periodic cipher.
+         */
+        explicit PeriodicCipher(purecipher_periodic_t* const periodic_ptr)
+            : m_periodic_ptr{periodic_ptr, purecipher_periodic_free} {}
+
+    public:
+        /**
+         * Creates a periodic cipher from the cipher used at each position
+         * within the period.
+         *
+         * The tables of the given ciphers are copied, so they need not outlive
+         * this object.
+         *
+         * @param ciphers Cipher used at each position. Must not be empty.
+         */
+        explicit PeriodicCipher(const std::vector<const Cipher*>& ciphers);
+
+        /**
+         * Builds a byte-wise Vigenere cipher, which adds key[i % key.size()]
+         * modulo 256 to the byte at stream position i.
+         *
+         * @param key Shift applied at each position. Must not be empty.
+         * @return Vigenere cipher for the given key.
+         */
+        static PeriodicCipher from_shifts(const std::vector<std::uint8_t>& key) {
+            return PeriodicCipher(purecipher_periodic_new_shifts(key.data(), key.size()));
+        }
+
+        /**
+         * Returns the number of positions after which the substitutions repeat.
+         *
+         * @return The period of this cipher.
+         */
+        std::size_t period() const { return purecipher_periodic_period(m_periodic_ptr.get()); }
+
+        /**
+         * Encipher the buffer of bytes inplace.
+         *
+         * @param buf Buffer of bytes to operate on.
+         * @param len The length of the given buffer.
+         * @param offset Stream position of the first byte of the buffer.
+         */
+        void encipher_inplace(std::uint8_t* buf, std::size_t len, std::uint64_t offset = 0) const {
+            purecipher_periodic_encipher(m_periodic_ptr.get(), buf, len, offset);
+        }
+
+        /**
+         * Decipher the buffer of bytes inplace.
+         *
+         * @param buf Buffer of bytes to operate on.
+         * @param len The length of the given buffer.
+         * @param offset Stream position of the first byte of the buffer.
+         */
+        void decipher_inplace(std::uint8_t* buf, std::size_t len, std::uint64_t offset = 0) const {
+            purecipher_periodic_decipher(m_periodic_ptr.get(), buf, len, offset);
+        }
+
+        /**
+         * Encipher the given vector of bytes.
+         *
+         * @param buffer Sequence of bytes to be enciphered.
+         * @param offset Stream position of the first byte of the buffer.
+         * @return New sequence of enciphered bytes.
+         */
+        std::vector<std::uint8_t> encipher(const std::vector<std::uint8_t>& buffer, std::uint64_t offset = 0) const;
+
+        /**
+         * Decipher the given vector of bytes.
+         *
+         * @param buffer Sequence of bytes to be deciphered.
+         * @param offset Stream position of the first byte of the buffer.
+         * @return New sequence of deciphered bytes.
+         */
+        std::vector<std::uint8_t> decipher(const std::vector<std::uint8_t>& buffer, std::uint64_t offset = 0) const;
+    };
+
+    /**
+     * A pool of worker threads that cipher batches of buffers.
+     *
+     * Workers own separate task deques and steal work from each other, and
+     * small buffers are grouped into larger tasks, so batches of many short
+     * messages scale across all cores.
+     */
+    class CipherPool final {
+        /**
+         * Pointer to the pool that this instance wraps.
+         */
+        std::unique_ptr<purecipher_pool_t, decltype(&purecipher_pool_free)> m_pool_ptr;
+
+    public:
+        /**
+         * A buffer to be ciphered inplace with the given cipher.
+         */
+        struct Job {
+            const Cipher* cipher;
+            std::uint8_t* buffer;
+            std::size_t length;
+        };
+
+        /**
+         * Handle on the completion of a batch submitted to a pool.
+         *
+         * Destroying a batch blocks until every buffer in it has been ciphered.
+         */
+        class Batch final {
+            /**
+             * Pointer to the batch handle that this instance wraps.
+             */
+            std::unique_ptr<purecipher_batch_t, decltype(&purecipher_batch_free)> m_batch_ptr;
+
+        public:
+            /**
+             * Creates a Batch to wrap the given batch handle.
+             *
+             * @param batch_ptr Owned pointer to a batch handle.
+             */
+            explicit Batch(purecipher_batch_t* const batch_ptr)
+                : m_batch_ptr{batch_ptr, purecipher_batch_free} {}
+
+            /**
+             * Returns whether the batch was accepted by the pool.
+             *
+             * Batches containing an invalid job are rejected without ciphering
+             * any of their buffers.
+             *
+             * @return Whether the batch's buffers are being ciphered.
+             */
+            bool valid() const { return m_batch_ptr != nullptr; }
+
+            /**
+             * Returns whether every buffer in the batch has been ciphered.
+             *
+             * @return Whether the batch has completed.
+             */
+            bool done() const { return purecipher_batch_done(m_batch_ptr.get()) != 0; }
+
+            /**
+             * Blocks until every buffer in the batch has been ciphered.
+             */
+            void wait() const { purecipher_batch_wait(m_batch_ptr.get()); }
+        };
+
+        /**
+         * Starts a pool with the given number of worker threads.
+         *
+         * @param threads Number of workers, or zero for one per available core.
+         */
+        explicit CipherPool(std::size_t threads = 0)
+            : m_pool_ptr{purecipher_pool_new(threads), purecipher_pool_free} {}
+
+        /**
+         * Returns the number of worker threads in this pool.
+         *
+         * @return The number of workers.
+         */
+        std::size_t threads() const { return purecipher_pool_threads(m_pool_ptr.get()); }
+
+        /**
+         * Submits a batch of buffers to be enciphered, without waiting for
+         * them to be ciphered.
+         *
+         * The ciphers and buffers referenced by the jobs must outlive the
+         * returned batch's completion.
+         *
+         * @param jobs Buffers to be enciphered and their ciphers.
+         * @return Handle on the completion of the batch.
+         */
+        Batch encipher(const std::vector<Job>& jobs);
+
+        /**
+         * Submits a batch of buffers to be deciphered, without waiting for
+         * them to be ciphered.
+         *
+         * See CipherPool::encipher for the requirements on the jobs.
+         *
+         * @param jobs Buffers to be deciphered and their ciphers.
+         * @return Handle on the completion of the batch.
+         */
+        Batch decipher(const std::vector<Job>& jobs);
+
+    private:
+        /**
+         * Converts the given jobs into their C representation.
+         */
+        static std::vector<purecipher_job_t> job_ptrs(const std::vector<Job>& jobs);
+    };
+
+    /**
+     * A context that ciphers buffers asynchronously on its own worker threads.
+     *
+     * Each submission returns a future that becomes ready once its buffer has
+     * been ciphered, so callers never block on ciphering unless they choose to
+     * wait on the future.
+     */
+    class CipherContext final {
+        /**
+         * Pointer to the context that this instance wraps.
+         */
+        std::unique_ptr<purecipher_context_t, decltype(&purecipher_context_free)> m_context_ptr;
+
+        /**
+         * Submits a buffer to be enciphered or deciphered.
+         */
+        std::future<void> submit(const Cipher& cipher, std::uint8_t* buf, std::size_t len, bool decipher);
+
+    public:
+        /**
+         * Starts a context with its own worker threads.
+         *
+         * Destroying the context blocks until every submitted buffer has been
+         * ciphered.
+         *
+         * @param threads Number of workers, or zero for one per available core.
+         * @param entries Maximum number of buffers being ciphered at once.
+         */
+        explicit CipherContext(std::size_t threads = 0, std::size_t entries = 1024)
+            : m_context_ptr{purecipher_context_new(threads, entries), purecipher_context_free} {}
+
+        /**
+         * Enciphers the buffer of bytes inplace asynchronously.
+         *
+         * The cipher and buffer must remain valid, and the buffer must not be
+         * accessed, until the returned future is ready. If the maximum number
+         * of buffers are already being ciphered, the future holds a
+         * std::runtime_error instead.
+         *
+         * @param cipher Cipher to apply.
+         * @param buf Buffer of bytes to operate on.
+         * @param len The length of the given buffer.
+         * @return Future that becomes ready once the buffer has been enciphered.
+         */
+        std::future<void> encipher(const Cipher& cipher, std::uint8_t* buf, std::size_t len) {
+            return submit(cipher, buf, len, false);
+        }
+
+        /**
+         * Deciphers the buffer of bytes inplace asynchronously.
+         *
+         * See CipherContext::encipher for the requirements on the arguments.
+         *
+         * @param cipher Cipher to apply.
+         * @param buf Buffer of bytes to operate on.
+         * @param len The length of the given buffer.
+         * @return Future that becomes ready once the buffer has been deciphered.
+         */
+        std::future<void> decipher(const Cipher& cipher, std::uint8_t* buf, std::size_t len) {
+            return submit(cipher, buf, len, true);
+        }
+    };
+
+    /**
+     * An arena that deduplicates substitution ciphers by their lookup tables.
+     *
+     * Identical ciphers interned in the same arena share a single table, and
+     * interning a cipher does not allocate memory of its own. Ciphers returned
+     * by an arena do not own their cipher pointers and must not outlive the
+     * arena.
+     */
+    class CipherArena final {
+        /**
+         * Pointer to the arena that this instance wraps.
+         */
+        std::unique_ptr<purecipher_arena_t, decltype(&purecipher_arena_free)> m_arena_ptr;
+
+    public:
+        /**
+         * Creates a new, empty cipher arena.
+         */
+        CipherArena() : m_arena_ptr{purecipher_arena_new(), purecipher_arena_free} {}
+
+        /**
+         * Interns a cipher that ciphers bytes identically to the given cipher.
+         *
+         * @param cipher Cipher to intern. It may be destroyed afterwards.
+         * @return Cipher owned by this arena.
+         */
+        Cipher intern(const Cipher& cipher) const;
+
+        /**
+         * Interns a cipher that enciphers each byte b to map[b].
+         *
+         * @param map Permutation of all 256 byte values.
+         * @return Cipher owned by this arena.
+         */
+        Cipher intern(const std::array<std::uint8_t, 256>& map) const;
+
+        /**
+         * Returns the number of distinct ciphers interned in this arena.
+         *
+         * @return The number of distinct ciphers.
+         */
+        std::size_t size() const { return purecipher_arena_len(m_arena_ptr.get()); }
+    };
+
+    /**
+     * A handle to a cipher that may be replaced while other threads cipher
+     * with it.
+     *
+     * Threads cipher through the Cipher returned by cipher() without taking
+     * any locks, and each call uses a single cipher throughout. Replacing the
+     * cipher waits until no call uses the old cipher any more.
+     */
+    class SwappableCipher final {
+        /**
+         * Pointer to the handle that this instance wraps.
+         */
+        std::unique_ptr<purecipher_swap_t, decltype(&purecipher_swap_free)> m_swap_ptr;
+
+    public:
+        /**
+         * Creates a handle that initially ciphers with the given cipher.
+         *
+         * @param cipher Cipher to take ownership of.
+         */
+        explicit SwappableCipher(Cipher&& cipher);
+
+        /**
+         * Returns a cipher that ciphers with whichever cipher this handle
+         * holds at the time of each call.
+         *
+         * @return Cipher owned by this handle, which must not outlive it.
+         */
+        Cipher cipher() const { return Cipher(purecipher_swap_cipher(m_swap_ptr.get()), false); }
+
+        /**
+         * Replaces the cipher of this handle, blocking until no call uses the
+         * old cipher and then destroying it.
+         *
+         * @param cipher Cipher to take ownership of.
+         */
+        void store(Cipher&& cipher);
+    };
+
+    /**
+     * A finder for the occurrences of several plaintext patterns in
+     * ciphertext, in a single pass and without deciphering it.
+     */
+    class MultiFinder final {
+        /**
+         * Pointer to the finder that this instance wraps.
+         */
+        std::unique_ptr<purecipher_multi_finder_t, decltype(&purecipher_multi_finder_free)> m_finder_ptr;
+
+    public:
+        /**
+         * Creates a finder for the given patterns as enciphered by the given
+         * cipher. The finder is invalid if any pattern is empty.
+         *
+         * @param cipher Cipher that the ciphertext to be searched was enciphered with.
+         * @param patterns Plaintext patterns to find.
+         */
+        MultiFinder(const Cipher& cipher, const std::vector<std::string>& patterns);
+
+        /**
+         * Returns whether this finder was created successfully.
+         */
+        bool valid() const { return m_finder_ptr != nullptr; }
+
+        /**
+         * Finds every occurrence of the patterns within the given ciphertext,
+         * including occurrences that overlap.
+         *
+         * @param ciphertext Sequence of enciphered bytes.
+         * @return The occurrences, ordered by offset and then by pattern index.
+         */
+        std::vector<purecipher_match_t> find_all(const std::vector<std::uint8_t>& ciphertext) const;
+    };
+
+    /**
+     * The order of ciphertext keys by their plaintext under some cipher.
+     *
+     * Keys are compared and sorted without being deciphered. An instance is
+     * itself a comparator, so it may be passed to std::sort, std::lower_bound
+     * or std::map to order ciphertext as its plaintext would be ordered.
+     */
+    class PlaintextOrder final {
+        /**
+         * Pointer to the order that this instance wraps.
+         */
+        std::shared_ptr<purecipher_order_t> m_order_ptr;
+
+    public:
+        /**
+         * Creates the order of ciphertext enciphered by the given cipher.
+         *
+         * @param cipher Cipher that the keys were enciphered with.
+         */
+        explicit PlaintextOrder(const Cipher& cipher);
+
+        /**
+         * Compares two ciphertexts in the lexicographic order of their
+         * plaintext.
+         *
+         * @return A negative value, zero or a positive value if the plaintext
+         *         of left is less than, equal to or greater than that of right.
+         */
+        int compare(const std::vector<std::uint8_t>& left, const std::vector<std::uint8_t>& right) const {
+            return purecipher_order_compare(
+                m_order_ptr.get(), left.data(), left.size(), right.data(), right.size()
+            );
+        }
+
+        /**
+         * Returns whether the plaintext of left sorts before that of right.
+         */
+        bool operator()(const std::vector<std::uint8_t>& left, const std::vector<std::uint8_t>& right) const {
+            return compare(left, right) < 0;
+        }
+
+        /**
+         * Computes the sorted order of the given keys without moving them.
+         *
+         * @param keys Sequence of ciphertext keys.
+         * @return The index of the key at each position of the sorted order.
+         *         Equal keys keep their relative order.
+         */
+        std::vector<std::size_t> argsort(const std::vector<std::vector<std::uint8_t>>& keys) const;
+
+        /**
+         * Sorts the given keys by their plaintext. This is considerably faster
+         * than std::sort with this instance as the comparator, as the keys are
+         * sorted by radix.
+         *
+         * @param keys Sequence of ciphertext keys to sort inplace.
+         */
+        void sort(std::vector<std::vector<std::uint8_t>>& keys) const;
+    };
+
+    /**
+     * Bigram statistics of a corpus of plaintext, used by a Solver to score
+     * candidate plaintext.
+     */
+    class NgramModel final {
+        /**
+         * Pointer to the model that this instance wraps.
+         */
+        std::unique_ptr<purecipher_model_t, decltype(&purecipher_model_free)> m_model_ptr;
+
+        friend class Solver;
+
+    public:
+        /**
+         * Builds a model from the bigram frequencies of the given corpus.
+         *
+         * @param corpus Plaintext of the kind expected to be recovered.
+         */
+        explicit NgramModel(const std::string& corpus)
+            : m_model_ptr{
+                purecipher_model_new(reinterpret_cast<const std::uint8_t*>(corpus.data()), corpus.size()),
+                purecipher_model_free
+            } {}
+
+        /**
+         * Returns the mean log frequency of the bigrams of the given text.
+         * Higher scores indicate text that is more like the corpus.
+         */
+        double score(const std::string& text) const {
+            return purecipher_model_score(
+                m_model_ptr.get(),
+                reinterpret_cast<const std::uint8_t*>(text.data()),
+                text.size()
+            );
+        }
+    };
+
+    /**
+     * A solver that recovers substitution ciphers from ciphertext by hill
+     * climbing on the statistics of an NgramModel.
+     *
+     * The model must outlive the solver.
+     */
+    class Solver final {
+        /**
+         * Pointer to the solver that this instance wraps.
+         */
+        std::unique_ptr<purecipher_solver_t, decltype(&purecipher_solver_free)> m_solver_ptr;
+
+    public:
+        /**
+         * Creates a solver that scores candidate plaintext with the given
+         * model, running one thread per core and 64 climbs per solve.
+         */
+        explicit Solver(const NgramModel& model)
+            : m_solver_ptr{purecipher_solver_new(model.m_model_ptr.get()), purecipher_solver_free} {}
+
+        /**
+         * Sets the number of threads that climb in parallel. Zero uses one
+         * thread per core.
+         */
+        Solver& threads(std::size_t threads);
+
+        /**
+         * Stops each solve once the given time has elapsed.
+         */
+        Solver& time_limit(std::chrono::milliseconds limit);
+
+        /**
+         * Sets the total number of climbs run by each solve.
+         */
+        Solver& max_restarts(std::uint64_t restarts);
+
+        /**
+         * Seeds the random perturbations of restarted climbs.
+         */
+        Solver& seed(std::uint64_t seed);
+
+        /**
+         * Declares that the ciphertext starting at offset deciphers to the
+         * given plaintext.
+         */
+        Solver& crib(std::size_t offset, const std::string& plaintext);
+
+        /**
+         * Recovers the most likely cipher that enciphers some plaintext to
+         * the given ciphertext.
+         *
+         * @param ciphertext Ciphertext to solve.
+         * @param score If not null, receives the score of the recovered plaintext.
+         * @return The recovered cipher.
+         * @throws std::invalid_argument If the cribs do not fit the ciphertext.
+         */
+        Cipher solve(const std::vector<std::uint8_t>& ciphertext, double* score = nullptr) const;
+    };
+
+    /**
+     * A selection of fields within delimited text records, such as CSV rows or
+     * key=value log lines, to be ciphered in place.
+     *
+     * Records are separated by newlines and fields by a delimiter byte. Text
+     * can only be deciphered by a selector if the cipher maps delimiter, quote
+     * and newline bytes to themselves and no other byte onto them.
+     */
+    class FieldSelector final {
+        /**
+         * Pointer to the selector that this instance wraps.
+         */
+        std::unique_ptr<purecipher_selector_t, decltype(&purecipher_selector_free)> m_selector_ptr;
+
+    public:
+        /**
+         * Creates a selector for fields separated by the given delimiter that
+         * selects no fields.
+         *
+         * @param delimiter Byte that separates fields.
+         */
+        explicit FieldSelector(char delimiter)
+            : m_selector_ptr{purecipher_selector_new(static_cast<std::uint8_t>(delimiter)), purecipher_selector_free} {}
+
+        /**
+         * Sets the byte that quotes fields.
+         *
+         * @param quote Byte that quotes fields containing delimiters or newlines.
+         * @return This instance.
+         */
+        FieldSelector& quote(char quote) {
+            purecipher_selector_quote(m_selector_ptr.get(), static_cast<std::uint8_t>(quote));
+            return *this;
+        }
+
+        /**
+         * Selects the field in the given zero-based column of every record.
+         *
+         * @param column Index of the column to be selected.
+         * @return This instance.
+         */
+        FieldSelector& column(std::size_t column) {
+            purecipher_selector_column(m_selector_ptr.get(), column);
+            return *this;
+        }
+
+        /**
+         * Selects the value of every field of the form key=value.
+         *
+         * @param key Key whose values are to be selected.
+         * @return This instance.
+         */
+        FieldSelector& key(const std::string& key) {
+            purecipher_selector_key(m_selector_ptr.get(), key.c_str());
+            return *this;
+        }
+
+        /**
+         * Enciphers the selected fields of the given text inplace.
+         *
+         * @param cipher Cipher used to encipher the fields.
+         * @param text Delimited text records.
+         */
+        void encipher(const Cipher& cipher, std::string& text) const;
+
+        /**
+         * Deciphers the selected fields of the given text inplace.
+         *
+         * @param cipher Cipher used to decipher the fields.
+         * @param text Delimited text records.
+         */
+        void decipher(const Cipher& cipher, std::string& text) const;
     };
 
     /**
@@ -274,6 +1259,130 @@ namespace purecipher {
          */
         Cipher into_cipher();
     };
+
+    /**
+     * A substitution cipher over 16-bit tokens, such as UTF-16 code units.
+     */
+    class WideCipher final {
+        /**
+         * Pointer to the 16-bit cipher that this instance wraps.
+         */
+        std::unique_ptr<purecipher_wide_t, decltype(&purecipher_wide_free)> m_cipher_ptr;
+
+    public:
+        /**
+         * Creates a WideCipher to wrap the given 16-bit cipher.
+         *
+         * @param cipher_ptr Owned pointer to a 16-bit cipher.
+         */
+        explicit WideCipher(purecipher_wide_t* const cipher_ptr) : m_cipher_ptr{cipher_ptr, purecipher_wide_free} {}
+
+        /**
+         * Creates a cipher that enciphers each token t to map[t].
+         *
+         * @param map Permutation of all 65536 tokens.
+         * @return The cipher, which is invalid if map is not a permutation.
+         */
+        static WideCipher from_table(const std::vector<std::uint16_t>& map);
+
+        /**
+         * Checks whether this instance wraps a cipher.
+         *
+         * @return True if this instance may be used to cipher tokens.
+         */
+        bool valid() const { return m_cipher_ptr != nullptr; }
+
+        /**
+         * Encipher the buffer of tokens inplace.
+         *
+         * @param buf Buffer of tokens to operate on.
+         * @param len The number of tokens in the given buffer.
+         */
+        void encipher_inplace(std::uint16_t* buf, std::size_t len) const {
+            purecipher_wide_encipher(m_cipher_ptr.get(), buf, len);
+        }
+
+        /**
+         * Decipher the buffer of tokens inplace.
+         *
+         * @param buf Buffer of tokens to operate on.
+         * @param len The number of tokens in the given buffer.
+         */
+        void decipher_inplace(std::uint16_t* buf, std::size_t len) const {
+            purecipher_wide_decipher(m_cipher_ptr.get(), buf, len);
+        }
+
+        /**
+         * Encipher the given UTF-16 string.
+         *
+         * @param str String to be enciphered.
+         * @return New enciphered string.
+         */
+        std::u16string encipher(const std::u16string& str) const;
+
+        /**
+         * Decipher the given UTF-16 string.
+         *
+         * @param str String to be deciphered.
+         * @return New deciphered string.
+         */
+        std::u16string decipher(const std::u16string& str) const;
+    };
+
+    /**
+     * Helper class to build substitution ciphers over 16-bit tokens.
+     */
+    class WideSubstitutionBuilder final {
+        /**
+         * Pointer to the builder that this instance wraps.
+         */
+        std::unique_ptr<purecipher_wide_builder_t, decltype(&purecipher_wide_builder_discard)> m_builder_ptr;
+
+    public:
+        /**
+         * Creates a new builder that maps each token to itself.
+         */
+        WideSubstitutionBuilder()
+            : m_builder_ptr{purecipher_wide_builder_new(), purecipher_wide_builder_discard} {}
+
+        /**
+         * Rotates each token in the given inclusive range by the given offset
+         * in the cipher mapping that this builder will produce.
+         *
+         * @param from Start of the range to be rotated.
+         * @param to End of the range to be rotated (inclusive)
+         * @param offset Magnitude and direction of the token rotation.
+         * @return This instance.
+         */
+        WideSubstitutionBuilder& rotate(std::uint16_t from, std::uint16_t to, std::int32_t offset) {
+            purecipher_wide_builder_rotate(m_builder_ptr.get(), from, to, offset);
+            return *this;
+        }
+
+        /**
+         * Swaps the two given tokens in the cipher mapping that this builder
+         * will produce.
+         *
+         * @param left The first token to be swapped.
+         * @param right The second token to be swapped.
+         * @return This instance.
+         */
+        WideSubstitutionBuilder& swap(std::uint16_t left, std::uint16_t right) {
+            purecipher_wide_builder_swap(m_builder_ptr.get(), left, right);
+            return *this;
+        }
+
+        /**
+         * Converts this builder instance into a WideCipher object.
+         *
+         * This member function consumes this builder.
+         *
+         * @return Cipher implementing the mapping produced by this builder.
+         */
+        WideCipher into_cipher() {
+            return WideCipher(purecipher_wide_builder_into_cipher(m_builder_ptr.release()));
+        }
+    };
 }
 
 #endif //PURECIPHER_PRUECIPHER_H
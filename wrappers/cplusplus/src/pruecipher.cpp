@@ -1,7 +1,40 @@
 #include "purecipher.hpp"
 
+#include <stdexcept>
+
+using purecipher::Checksummed;
 using purecipher::Cipher;
+using purecipher::CipherArena;
+using purecipher::CipherContext;
+using purecipher::CipherPool;
+using purecipher::FieldSelector;
+using purecipher::Histogram;
+using purecipher::MultiFinder;
+using purecipher::PeriodicCipher;
+using purecipher::PlaintextOrder;
+using purecipher::Solver;
 using purecipher::SubstitutionBuilder;
+using purecipher::SwappableCipher;
+using purecipher::TextEncoding;
+using purecipher::WideCipher;
+
+Histogram purecipher::histogram(const std::vector<std::uint8_t>& buffer) {
+    Histogram counts{};
+    purecipher_histogram(buffer.data(), buffer.size(), counts.data());
+    return counts;
+}
+
+double purecipher::entropy(const Histogram& counts) {
+    return purecipher_histogram_entropy(counts.data());
+}
+
+double purecipher::chi_square(const Histogram& counts, const std::array<double, 256>& expected) {
+    return purecipher_histogram_chi_square(counts.data(), expected.data());
+}
+
+std::uint32_t purecipher::crc32c(const std::vector<std::uint8_t>& buffer, std::uint32_t crc) {
+    return purecipher_crc32c(crc, buffer.data(), buffer.size());
+}
 
 void Cipher::encipher_inplace(std::vector<std::uint8_t>& buffer) const {
     purecipher_encipher_buffer(m_cipher_ptr, buffer.data(), buffer.size());
@@ -11,6 +44,59 @@ void Cipher::decipher_inplace(std::vector<std::uint8_t>& buffer) const {
     purecipher_decipher_buffer(m_cipher_ptr, buffer.data(), buffer.size());
 }
 
+std::uint32_t Cipher::encipher_inplace_crc32c(
+    std::vector<std::uint8_t>& buffer,
+    Checksummed checksummed,
+    std::uint32_t crc
+) const {
+    return purecipher_encipher_buffer_crc32c(
+        m_cipher_ptr, buffer.data(), buffer.size(), crc, checksummed == Checksummed::Ciphertext
+    );
+}
+
+std::uint32_t Cipher::decipher_inplace_crc32c(
+    std::vector<std::uint8_t>& buffer,
+    Checksummed checksummed,
+    std::uint32_t crc
+) const {
+    return purecipher_decipher_buffer_crc32c(
+        m_cipher_ptr, buffer.data(), buffer.size(), crc, checksummed == Checksummed::Ciphertext
+    );
+}
+
+std::string Cipher::encipher_encode(const std::vector<std::uint8_t>& buffer, TextEncoding encoding) const {
+    std::string text(purecipher_encoded_length(static_cast<int>(encoding), buffer.size()), '\0');
+    encipher_encode(buffer.data(), buffer.size(), encoding, text.data(), text.size());
+    return text;
+}
+
+std::optional<std::size_t> Cipher::decode_decipher(
+    std::string_view text,
+    TextEncoding encoding,
+    std::uint8_t* data,
+    std::size_t capacity
+) const {
+    const std::int64_t length = purecipher_decode_decipher(
+        m_cipher_ptr, static_cast<int>(encoding), text.data(), text.size(), data, capacity
+    );
+    if (length < 0) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(length);
+}
+
+std::optional<std::vector<std::uint8_t>> Cipher::decode_decipher(std::string_view text, TextEncoding encoding) const {
+    const std::int64_t length = purecipher_decoded_length(static_cast<int>(encoding), text.data(), text.size());
+    if (length < 0) {
+        return std::nullopt;
+    }
+    std::vector<std::uint8_t> buffer(static_cast<std::size_t>(length));
+    if (!decode_decipher(text, encoding, buffer.data(), buffer.size())) {
+        return std::nullopt;
+    }
+    return buffer;
+}
+
 std::vector<std::uint8_t> Cipher::encipher(const std::vector<std::uint8_t>& buffer) const {
     std::vector<uint8_t> cipher_buffer{buffer};
     this->encipher_inplace(cipher_buffer);
@@ -39,10 +125,349 @@ std::string Cipher::decipher(const std::string& str) const {
     return std::string(cipher_buffer.begin(), cipher_buffer.end());
 }
 
-Cipher::Cipher(Cipher&& other) noexcept: m_cipher_ptr{other.m_cipher_ptr}, m_moved{false} {
+std::vector<std::vector<std::uint8_t>> Cipher::cycles() const {
+    std::array<std::uint8_t, 256> elements{};
+    std::array<std::uint16_t, 128> lengths{};
+    const std::size_t count = purecipher_cipher_cycles(m_cipher_ptr, elements.data(), lengths.data());
+
+    std::vector<std::vector<std::uint8_t>> cycles;
+    cycles.reserve(count);
+    auto cycle_begin = elements.begin();
+    for (std::size_t i = 0; i < count; ++i) {
+        cycles.emplace_back(cycle_begin, cycle_begin + lengths[i]);
+        cycle_begin += lengths[i];
+    }
+    return cycles;
+}
+
+Histogram Cipher::plaintext_histogram(const std::vector<std::uint8_t>& buffer) const {
+    Histogram counts{};
+    purecipher_histogram_plaintext(m_cipher_ptr, buffer.data(), buffer.size(), counts.data());
+    return counts;
+}
+
+std::optional<std::size_t> Cipher::find(
+    const std::string& plaintext,
+    const std::vector<std::uint8_t>& ciphertext
+) const {
+    const std::int64_t offset = purecipher_find(
+        m_cipher_ptr,
+        reinterpret_cast<const std::uint8_t*>(plaintext.data()),
+        plaintext.size(),
+        ciphertext.data(),
+        ciphertext.size()
+    );
+    if (offset < 0) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(offset);
+}
+
+std::vector<std::size_t> Cipher::find_all(
+    const std::string& plaintext,
+    const std::vector<std::uint8_t>& ciphertext
+) const {
+    const auto* pattern = reinterpret_cast<const std::uint8_t*>(plaintext.data());
+    std::vector<std::size_t> offsets(16);
+    std::size_t count = purecipher_find_all(
+        m_cipher_ptr, pattern, plaintext.size(), ciphertext.data(), ciphertext.size(), offsets.data(), offsets.size()
+    );
+    if (count > offsets.size()) {
+        // Search again now that the number of occurrences is known.
+        offsets.resize(count);
+        count = purecipher_find_all(
+            m_cipher_ptr, pattern, plaintext.size(), ciphertext.data(), ciphertext.size(), offsets.data(), count
+        );
+    }
+    offsets.resize(count);
+    return offsets;
+}
+
+void Cipher::encipher_fields(
+    std::vector<std::uint8_t>& records,
+    std::size_t stride,
+    const std::vector<purecipher_field_t>& fields
+) const {
+    const std::size_t count = stride == 0 ? 0 : records.size() / stride;
+    purecipher_encipher_fields(m_cipher_ptr, records.data(), stride, count, fields.data(), fields.size());
+}
+
+void Cipher::decipher_fields(
+    std::vector<std::uint8_t>& records,
+    std::size_t stride,
+    const std::vector<purecipher_field_t>& fields
+) const {
+    const std::size_t count = stride == 0 ? 0 : records.size() / stride;
+    purecipher_decipher_fields(m_cipher_ptr, records.data(), stride, count, fields.data(), fields.size());
+}
+
+std::vector<purecipher_obj_t> Cipher::batch_ptrs(
+    const std::vector<const Cipher*>& ciphers,
+    const std::vector<std::uint8_t>& arena,
+    const std::vector<std::size_t>& offsets
+) {
+    std::vector<purecipher_obj_t> cipher_ptrs;
+    if (offsets.size() != ciphers.size() + 1 || offsets.back() > arena.size()) {
+        return cipher_ptrs;
+    }
+    cipher_ptrs.reserve(ciphers.size());
+    for (const Cipher* cipher : ciphers) {
+        cipher_ptrs.push_back(cipher->m_cipher_ptr);
+    }
+    return cipher_ptrs;
+}
+
+void Cipher::encipher_batch(
+    const std::vector<const Cipher*>& ciphers,
+    std::vector<std::uint8_t>& arena,
+    const std::vector<std::size_t>& offsets
+) {
+    const std::vector<purecipher_obj_t> cipher_ptrs = batch_ptrs(ciphers, arena, offsets);
+    if (cipher_ptrs.size() == ciphers.size()) {
+        purecipher_encipher_batch(cipher_ptrs.data(), arena.data(), offsets.data(), cipher_ptrs.size());
+    }
+}
+
+void Cipher::decipher_batch(
+    const std::vector<const Cipher*>& ciphers,
+    std::vector<std::uint8_t>& arena,
+    const std::vector<std::size_t>& offsets
+) {
+    const std::vector<purecipher_obj_t> cipher_ptrs = batch_ptrs(ciphers, arena, offsets);
+    if (cipher_ptrs.size() == ciphers.size()) {
+        purecipher_decipher_batch(cipher_ptrs.data(), arena.data(), offsets.data(), cipher_ptrs.size());
+    }
+}
+
+Cipher::Cipher(Cipher&& other) noexcept
+    : m_cipher_ptr{other.m_cipher_ptr}, m_owned{other.m_owned}, m_moved{other.m_moved} {
+    other.m_owned = false;
     other.m_moved = true;
 }
 
+Cipher& Cipher::operator=(Cipher&& other) noexcept {
+    if (this != &other) {
+        if (m_owned) {
+            purecipher_free(m_cipher_ptr);
+        }
+        m_cipher_ptr = other.m_cipher_ptr;
+        m_owned = other.m_owned;
+        m_moved = other.m_moved;
+        other.m_owned = false;
+        other.m_moved = true;
+    }
+    return *this;
+}
+
+PeriodicCipher::PeriodicCipher(const std::vector<const Cipher*>& ciphers)
+    : m_periodic_ptr{nullptr, purecipher_periodic_free} {
+    std::vector<purecipher_obj_t> cipher_ptrs;
+    cipher_ptrs.reserve(ciphers.size());
+    for (const Cipher* cipher : ciphers) {
+        cipher_ptrs.push_back(cipher->m_cipher_ptr);
+    }
+    m_periodic_ptr.reset(purecipher_periodic_new(cipher_ptrs.data(), cipher_ptrs.size()));
+}
+
+std::vector<std::uint8_t> PeriodicCipher::encipher(const std::vector<std::uint8_t>& buffer, std::uint64_t offset) const {
+    std::vector<std::uint8_t> cipher_buffer{buffer};
+    this->encipher_inplace(cipher_buffer.data(), cipher_buffer.size(), offset);
+    return cipher_buffer;
+}
+
+std::vector<std::uint8_t> PeriodicCipher::decipher(const std::vector<std::uint8_t>& buffer, std::uint64_t offset) const {
+    std::vector<std::uint8_t> cipher_buffer{buffer};
+    this->decipher_inplace(cipher_buffer.data(), cipher_buffer.size(), offset);
+    return cipher_buffer;
+}
+
+std::vector<purecipher_job_t> CipherPool::job_ptrs(const std::vector<Job>& jobs) {
+    std::vector<purecipher_job_t> job_ptrs;
+    job_ptrs.reserve(jobs.size());
+    for (const Job& job : jobs) {
+        job_ptrs.push_back(purecipher_job_t{job.cipher->m_cipher_ptr, job.buffer, job.length});
+    }
+    return job_ptrs;
+}
+
+CipherPool::Batch CipherPool::encipher(const std::vector<Job>& jobs) {
+    const std::vector<purecipher_job_t> job_ptrs = CipherPool::job_ptrs(jobs);
+    return Batch(purecipher_pool_encipher(m_pool_ptr.get(), job_ptrs.data(), job_ptrs.size()));
+}
+
+CipherPool::Batch CipherPool::decipher(const std::vector<Job>& jobs) {
+    const std::vector<purecipher_job_t> job_ptrs = CipherPool::job_ptrs(jobs);
+    return Batch(purecipher_pool_decipher(m_pool_ptr.get(), job_ptrs.data(), job_ptrs.size()));
+}
+
+namespace {
+    /**
+     * Fulfills the promise whose address was given as a submission's user data.
+     */
+    void fulfill_promise(std::uint64_t user_data) {
+        const std::unique_ptr<std::promise<void>> promise{reinterpret_cast<std::promise<void>*>(user_data)};
+        promise->set_value();
+    }
+}
+
+std::future<void> CipherContext::submit(const Cipher& cipher, std::uint8_t* buf, std::size_t len, bool decipher) {
+    auto promise = std::make_unique<std::promise<void>>();
+    std::future<void> future = promise->get_future();
+
+    const purecipher_submission_t submission{
+        cipher.m_cipher_ptr,
+        buf,
+        len,
+        decipher,
+        reinterpret_cast<std::uintptr_t>(promise.get()),
+        fulfill_promise,
+    };
+    if (purecipher_context_submit(m_context_ptr.get(), &submission, 1) == 1) {
+        // Ownership of the promise passes to the completion callback.
+        promise.release();
+    } else {
+        promise->set_exception(std::make_exception_ptr(std::runtime_error("cipher context is full")));
+    }
+    return future;
+}
+
+MultiFinder::MultiFinder(const Cipher& cipher, const std::vector<std::string>& patterns)
+    : m_finder_ptr{nullptr, purecipher_multi_finder_free} {
+    std::vector<const std::uint8_t*> pattern_ptrs;
+    std::vector<std::size_t> lengths;
+    pattern_ptrs.reserve(patterns.size());
+    lengths.reserve(patterns.size());
+    for (const std::string& pattern : patterns) {
+        pattern_ptrs.push_back(reinterpret_cast<const std::uint8_t*>(pattern.data()));
+        lengths.push_back(pattern.size());
+    }
+    m_finder_ptr.reset(
+        purecipher_multi_finder_new(cipher.m_cipher_ptr, pattern_ptrs.data(), lengths.data(), patterns.size())
+    );
+}
+
+std::vector<purecipher_match_t> MultiFinder::find_all(const std::vector<std::uint8_t>& ciphertext) const {
+    std::vector<purecipher_match_t> matches(16);
+    std::size_t count = purecipher_multi_finder_find_all(
+        m_finder_ptr.get(), ciphertext.data(), ciphertext.size(), matches.data(), matches.size()
+    );
+    if (count > matches.size()) {
+        // Search again now that the number of occurrences is known.
+        matches.resize(count);
+        count = purecipher_multi_finder_find_all(
+            m_finder_ptr.get(), ciphertext.data(), ciphertext.size(), matches.data(), count
+        );
+    }
+    matches.resize(count);
+    return matches;
+}
+
+PlaintextOrder::PlaintextOrder(const Cipher& cipher)
+    : m_order_ptr{purecipher_order_new(cipher.m_cipher_ptr), purecipher_order_free} {}
+
+std::vector<std::size_t> PlaintextOrder::argsort(const std::vector<std::vector<std::uint8_t>>& keys) const {
+    std::vector<const std::uint8_t*> key_ptrs;
+    std::vector<std::size_t> lengths;
+    key_ptrs.reserve(keys.size());
+    lengths.reserve(keys.size());
+    for (const std::vector<std::uint8_t>& key : keys) {
+        key_ptrs.push_back(key.data());
+        lengths.push_back(key.size());
+    }
+    std::vector<std::size_t> indices(keys.size());
+    purecipher_order_argsort(m_order_ptr.get(), key_ptrs.data(), lengths.data(), keys.size(), indices.data());
+    return indices;
+}
+
+void PlaintextOrder::sort(std::vector<std::vector<std::uint8_t>>& keys) const {
+    const std::vector<std::size_t> indices = argsort(keys);
+    std::vector<std::vector<std::uint8_t>> sorted;
+    sorted.reserve(keys.size());
+    for (std::size_t index : indices) {
+        sorted.push_back(std::move(keys[index]));
+    }
+    keys = std::move(sorted);
+}
+
+Cipher CipherArena::intern(const Cipher& cipher) const {
+    return Cipher(purecipher_arena_intern(m_arena_ptr.get(), cipher.m_cipher_ptr), false);
+}
+
+Cipher CipherArena::intern(const std::array<std::uint8_t, 256>& map) const {
+    return Cipher(purecipher_arena_intern_table(m_arena_ptr.get(), map.data()), false);
+}
+
+SwappableCipher::SwappableCipher(Cipher&& cipher)
+    : m_swap_ptr{purecipher_swap_new(cipher.m_cipher_ptr), purecipher_swap_free} {
+    if (m_swap_ptr) {
+        cipher.m_owned = false;
+        cipher.m_moved = true;
+    }
+}
+
+void SwappableCipher::store(Cipher&& cipher) {
+    if (purecipher_swap_store(m_swap_ptr.get(), cipher.m_cipher_ptr) == 0) {
+        cipher.m_owned = false;
+        cipher.m_moved = true;
+    }
+}
+
+Solver& Solver::threads(std::size_t threads) {
+    purecipher_solver_set_threads(m_solver_ptr.get(), threads);
+    return *this;
+}
+
+Solver& Solver::time_limit(std::chrono::milliseconds limit) {
+    purecipher_solver_set_time_limit(m_solver_ptr.get(), static_cast<std::uint64_t>(limit.count()));
+    return *this;
+}
+
+Solver& Solver::max_restarts(std::uint64_t restarts) {
+    purecipher_solver_set_max_restarts(m_solver_ptr.get(), restarts);
+    return *this;
+}
+
+Solver& Solver::seed(std::uint64_t seed) {
+    purecipher_solver_set_seed(m_solver_ptr.get(), seed);
+    return *this;
+}
+
+Solver& Solver::crib(std::size_t offset, const std::string& plaintext) {
+    purecipher_solver_add_crib(
+        m_solver_ptr.get(),
+        offset,
+        reinterpret_cast<const std::uint8_t*>(plaintext.data()),
+        plaintext.size()
+    );
+    return *this;
+}
+
+Cipher Solver::solve(const std::vector<std::uint8_t>& ciphertext, double* score) const {
+    const purecipher_obj_t cipher = purecipher_solver_solve(m_solver_ptr.get(), ciphertext.data(), ciphertext.size(), score);
+    if (cipher._data == nullptr) {
+        throw std::invalid_argument("cribs do not fit the ciphertext");
+    }
+    return Cipher(cipher);
+}
+
+void FieldSelector::encipher(const Cipher& cipher, std::string& text) const {
+    purecipher_selector_encipher(
+        m_selector_ptr.get(),
+        cipher.m_cipher_ptr,
+        reinterpret_cast<std::uint8_t*>(text.data()),
+        text.size()
+    );
+}
+
+void FieldSelector::decipher(const Cipher& cipher, std::string& text) const {
+    purecipher_selector_decipher(
+        m_selector_ptr.get(),
+        cipher.m_cipher_ptr,
+        reinterpret_cast<std::uint8_t*>(text.data()),
+        text.size()
+    );
+}
+
 SubstitutionBuilder::SubstitutionBuilder(SubstitutionBuilder&& other) noexcept
     : m_builder_ptr{std::move(other.m_builder_ptr)} {}
 
@@ -69,3 +494,22 @@ Cipher SubstitutionBuilder::into_cipher() {
     purecipher_builder_t* builder = m_builder_ptr.release();
     return Cipher(purecipher_builder_into_cipher(builder));
 }
+
+WideCipher WideCipher::from_table(const std::vector<std::uint16_t>& map) {
+    if (map.size() != 1u << 16u) {
+        return WideCipher(nullptr);
+    }
+    return WideCipher(purecipher_wide_from_table(map.data()));
+}
+
+std::u16string WideCipher::encipher(const std::u16string& str) const {
+    std::u16string result{str};
+    encipher_inplace(reinterpret_cast<std::uint16_t*>(result.data()), result.size());
+    return result;
+}
+
+std::u16string WideCipher::decipher(const std::u16string& str) const {
+    std::u16string result{str};
+    decipher_inplace(reinterpret_cast<std::uint16_t*>(result.data()), result.size());
+    return result;
+}
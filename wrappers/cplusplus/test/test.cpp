@@ -2,14 +2,32 @@
 
 #include <iostream>
 #include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
 
 #define TEST_CASE(LABEL) test_case_t{LABEL, #LABEL}
 
 #define ITERABLE_EQUAL(LEFT, RIGHT) std::equal((LEFT).begin(), (LEFT).end(), (RIGHT).begin())
 
 namespace {
+    using purecipher::Checksummed;
     using purecipher::Cipher;
+    using purecipher::CipherArena;
+    using purecipher::CipherContext;
+    using purecipher::CipherPool;
+    using purecipher::FieldSelector;
+    using purecipher::MultiFinder;
+    using purecipher::NgramModel;
+    using purecipher::PeriodicCipher;
+    using purecipher::PlaintextOrder;
+    using purecipher::Solver;
     using purecipher::SubstitutionBuilder;
+    using purecipher::SwappableCipher;
+    using purecipher::TextEncoding;
+    using purecipher::WideCipher;
+    using purecipher::WideSubstitutionBuilder;
 
     /// Raw sample text to be used in cipher test cases.
     constexpr std::string_view ROT13_SAMPLE_RAW = "Looks good! \xF0\x9F\x91\x8D";
@@ -81,6 +99,18 @@ namespace {
         return ITERABLE_EQUAL(sample_raw, buffer);
     }
 
+    bool test_cipher_c_str_inplace() {
+        const Cipher cipher_rot13{Cipher::rot13()};
+        char message[] = "A well filled with pineapples.";
+
+        if (cipher_rot13.encipher_inplace(message) != 30
+            || std::string{message} != "N jryy svyyrq jvgu cvarnccyrf.") {
+            return false;
+        }
+        return cipher_rot13.decipher_inplace(message) == 30
+            && std::string{message} == "A well filled with pineapples.";
+    }
+
     bool test_rot13() {
         return check_cipher_string(Cipher::rot13(), "A well filled with pineapples.", "N jryy svyyrq jvgu cvarnccyrf.");
     }
@@ -93,14 +123,364 @@ namespace {
         return check_cipher_string(Cipher::leet(), "Pure ciphers are the BEST!", "Pur3 c!ph3rs @r3 1h3 BE5Ti");
     }
 
+    bool test_affine() {
+        // Flipping bit 5 toggles the case of ASCII letters.
+        const Cipher cipher = Cipher::affine({0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80}, 0x20);
+        return check_cipher_string(cipher, "NorwegianBlueNorwegianBlueNorwegianBlue", "nORWEGIANbLUEnORWEGIANbLUEnORWEGIANbLUE");
+    }
+
+    bool test_cipher_batch() {
+        const Cipher caesar{Cipher::caesar()};
+        const Cipher rot13{Cipher::rot13()};
+        const std::string text = "attackattackattack";
+        const std::string expected = "nggnpxdwwdfnnggnpx";
+
+        std::vector<uint8_t> arena{text.begin(), text.end()};
+        const std::vector<const Cipher*> ciphers{&rot13, &caesar, &rot13};
+        const std::vector<std::size_t> offsets{0, 6, 12, 18};
+
+        Cipher::encipher_batch(ciphers, arena, offsets);
+        if (!ITERABLE_EQUAL(expected, arena)) {
+            return false;
+        }
+        Cipher::decipher_batch(ciphers, arena, offsets);
+        return ITERABLE_EQUAL(text, arena);
+    }
+
+    bool test_cipher_fields() {
+        const Cipher rot13{Cipher::rot13()};
+        const std::string text = "id=abc;id=def;id=ghi;";
+        std::vector<uint8_t> records{text.begin(), text.end()};
+
+        rot13.encipher_strided(records.data() + 3, 3, 7, 3);
+        const bool strided = std::string(records.begin(), records.end()) == "id=nop;id=qrs;id=tuv;";
+
+        rot13.decipher_fields(records, 7, {{0, 2}, {4, 1}});
+        return strided && std::string(records.begin(), records.end()) == "vq=nbp;vq=qes;vq=thv;";
+    }
+
+    bool test_field_selector() {
+        const Cipher rot13{Cipher::rot13()};
+        FieldSelector selector{','};
+        selector.quote('"').column(1);
+
+        std::string text = "1,\"Smith, John\",NY\n2,Doe,\"LA\"\n";
+        selector.encipher(rot13, text);
+        const bool enciphered = text == "1,\"Fzvgu, Wbua\",NY\n2,Qbr,\"LA\"\n";
+
+        selector.decipher(rot13, text);
+        return enciphered && text == "1,\"Smith, John\",NY\n2,Doe,\"LA\"\n";
+    }
+
+    bool test_histogram() {
+        const Cipher cipher_rot13{Cipher::rot13()};
+        const std::vector<uint8_t> sample_ciphered{ROT13_SAMPLE_CIPHERED.begin(), ROT13_SAMPLE_CIPHERED.end()};
+
+        const purecipher::Histogram cipher_counts = purecipher::histogram(sample_ciphered);
+        const purecipher::Histogram plain_counts = cipher_rot13.plaintext_histogram(sample_ciphered);
+
+        std::array<double, 256> uniform{};
+        uniform.fill(1.0);
+
+        return cipher_counts['b'] == 4 && cipher_counts['o'] == 0
+            && plain_counts['o'] == 4 && plain_counts['b'] == 0
+            && purecipher::entropy(cipher_counts) > 0.0
+            && purecipher::chi_square(cipher_counts, uniform) > 0.0;
+    }
+
+    bool test_crc32c() {
+        const Cipher caesar{Cipher::caesar()};
+        const std::string message = "We attack at dawn.";
+        std::vector<std::uint8_t> buffer{message.begin(), message.end()};
+        const std::vector<std::uint8_t> head{buffer.begin(), buffer.begin() + 5};
+        const std::vector<std::uint8_t> tail{buffer.begin() + 5, buffer.end()};
+
+        const std::uint32_t plaintext_crc = purecipher::crc32c(buffer);
+        const std::uint32_t sent = caesar.encipher_inplace_crc32c(buffer, Checksummed::Plaintext);
+        const std::uint32_t ciphertext_crc = purecipher::crc32c(buffer);
+        const std::uint32_t received = caesar.decipher_inplace_crc32c(buffer, Checksummed::Ciphertext);
+
+        return sent == plaintext_crc
+               && received == ciphertext_crc
+               && sent != received
+               && std::string(buffer.begin(), buffer.end()) == message
+               && purecipher::crc32c(tail, purecipher::crc32c(head)) == plaintext_crc
+               && purecipher::crc32c_combine(purecipher::crc32c(head), purecipher::crc32c(tail), tail.size()) == plaintext_crc;
+    }
+
+    bool test_encode() {
+        const Cipher caesar{Cipher::caesar()};
+        const std::string message = "Attack at dawn";
+        const std::vector<std::uint8_t> buffer{message.begin(), message.end()};
+
+        const std::string hex = caesar.encipher_encode(buffer, TextEncoding::Hex);
+        const std::string base64 = caesar.encipher_encode(buffer, TextEncoding::Base64);
+        std::array<char, 19> short_text{};
+        std::array<std::uint8_t, 32> decoded{};
+        const std::optional<std::size_t> length = caesar.decode_decipher(
+            base64, TextEncoding::Base64, decoded.data(), decoded.size()
+        );
+
+        return hex == "44777764666e2064772067647a71"
+               && base64 == "RHd3ZGZuIGR3IGdkenE="
+               && caesar.decode_decipher(hex, TextEncoding::Hex) == std::optional{buffer}
+               && length == std::optional<std::size_t>{14}
+               && std::equal(buffer.begin(), buffer.end(), decoded.begin())
+               && caesar.encipher_encode(buffer.data(), buffer.size(), TextEncoding::Base64,
+                                         short_text.data(), short_text.size()) == 0
+               && !caesar.decode_decipher("RHd3*GZu", TextEncoding::Base64).has_value();
+    }
+
+    bool test_cipher_algebra() {
+        const Cipher caesar{Cipher::caesar()};
+        const std::vector<std::vector<uint8_t>> cycles = caesar.cycles();
+
+        return check_cipher_string(caesar.pow(2), "We attack at dawn.", "Ck gzzgiq gz jgct.")
+            && check_cipher_string(caesar.pow(-1), "We attack at dawn.", "Tb xqqxzh xq axtk.")
+            && check_cipher_string(caesar.inverse(), "Zh dwwdfn dw gdzq.", "We attack at dawn.")
+            && caesar.order() == 26
+            && cycles.size() == 2
+            && cycles[0].size() == 26 && cycles[0][0] == 'A' && cycles[0][1] == 'D';
+    }
+
+    bool test_periodic() {
+        const Cipher cipher_null{Cipher::null()};
+        const Cipher cipher_rot13{Cipher::rot13()};
+        const PeriodicCipher periodic{{&cipher_null, &cipher_rot13}};
+        const PeriodicCipher vigenere = PeriodicCipher::from_shifts({1, 2, 3});
+        const std::vector<uint8_t> text(7, 'a');
+
+        const std::vector<uint8_t> vigenere_text = vigenere.encipher(text);
+        const std::string expected = "bcdbcdb";
+        if (!ITERABLE_EQUAL(expected, vigenere_text) || text != vigenere.decipher(vigenere_text)) {
+            return false;
+        }
+
+        // Encipher the stream starting from its second byte.
+        const std::vector<uint8_t> tail = periodic.encipher(text, 1);
+        const std::string expected_tail = "nananan";
+        return periodic.period() == 2 && ITERABLE_EQUAL(expected_tail, tail);
+    }
+
+    bool test_pool() {
+        CipherPool pool{2};
+        const Cipher cipher_rot13{Cipher::rot13()};
+        std::vector<std::string> messages(100, "Looks good!");
+
+        std::vector<CipherPool::Job> jobs;
+        for (auto& message : messages) {
+            jobs.push_back({&cipher_rot13, reinterpret_cast<uint8_t*>(message.data()), message.size()});
+        }
+
+        const CipherPool::Batch batch = pool.encipher(jobs);
+        batch.wait();
+        if (pool.threads() != 2 || !batch.valid() || !batch.done()) {
+            return false;
+        }
+        return std::all_of(messages.begin(), messages.end(), [](const std::string& message) {
+            return message == "Ybbxf tbbq!";
+        });
+    }
+
+    bool test_context() {
+        CipherContext context{2, 4};
+        const Cipher cipher_rot13{Cipher::rot13()};
+        std::array<std::string, 4> messages{"Looks", "good!", "Looks", "good!"};
+
+        std::vector<std::future<void>> futures;
+        for (auto& message : messages) {
+            futures.push_back(context.encipher(cipher_rot13, reinterpret_cast<uint8_t*>(message.data()), message.size()));
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+        return messages[0] == "Ybbxf" && messages[1] == "tbbq!" && messages[2] == messages[0];
+    }
+
+    bool test_arena() {
+        const CipherArena arena;
+        const Cipher first = arena.intern(Cipher::rot13());
+        const Cipher second = arena.intern(Cipher::rot13());
+
+        std::array<uint8_t, 256> map{};
+        for (size_t b = 0; b < map.size(); ++b) {
+            map[b] = static_cast<uint8_t>(b + 1);
+        }
+        const Cipher shift = arena.intern(map);
+
+        return arena.size() == 2
+               && check_cipher_string(first, "Looks good!", "Ybbxf tbbq!")
+               && check_cipher_string(second, "Looks good!", "Ybbxf tbbq!")
+               && check_cipher_string(shift, "abc", "bcd");
+    }
+
+    bool test_arena_moved() {
+        const CipherArena arena;
+        bool passed;
+        {
+            std::vector<Cipher> ciphers;
+            ciphers.push_back(arena.intern(Cipher::rot13()));
+            ciphers.push_back(arena.intern(Cipher::caesar()));
+            Cipher moved = std::move(ciphers[0]);
+            passed = check_cipher_string(moved, "Looks good!", "Ybbxf tbbq!")
+                     && check_cipher_string(ciphers[1], "abc", "def");
+
+            // Assigning over an owned cipher frees it and borrows the table.
+            Cipher assigned = Cipher::caesar();
+            assigned = std::move(moved);
+            passed = passed && check_cipher_string(assigned, "Looks good!", "Ybbxf tbbq!");
+        }
+        // The moved ciphers were destroyed without freeing the arena's tables.
+        return passed && arena.size() == 2
+               && check_cipher_string(arena.intern(Cipher::rot13()), "Looks good!", "Ybbxf tbbq!");
+    }
+
+    bool test_swappable() {
+        SwappableCipher handle(Cipher::caesar());
+        const Cipher cipher = handle.cipher();
+        const bool before = check_cipher_string(cipher, "abc", "def");
+
+        handle.store(Cipher::rot13());
+        return before && check_cipher_string(cipher, "abc", "nop");
+    }
+
+    bool test_swappable_moved() {
+        SwappableCipher handle(Cipher::caesar());
+        bool passed;
+        {
+            std::vector<Cipher> ciphers;
+            ciphers.push_back(handle.cipher());
+            ciphers.push_back(handle.cipher());
+            passed = check_cipher_string(ciphers[0], "abc", "def");
+            handle.store(Cipher::rot13());
+            passed = passed && check_cipher_string(ciphers[1], "abc", "nop");
+        }
+        // The moved ciphers were destroyed without freeing the handle.
+        handle.store(Cipher::caesar());
+        return passed && check_cipher_string(handle.cipher(), "abc", "def");
+    }
+
+    bool test_find() {
+        const Cipher cipher = Cipher::caesar();
+        std::string log = "ok\nERROR disk\nWARN disk\nERROR net";
+        for (int i = 0; i < 10; ++i) {
+            log += "\nERROR again";
+        }
+        const std::vector<std::uint8_t> ciphertext = cipher.encipher(std::vector<std::uint8_t>(log.begin(), log.end()));
+
+        const std::vector<std::size_t> errors = cipher.find_all("ERROR", ciphertext);
+        const MultiFinder finder(cipher, {"WARN", "net"});
+        const std::vector<purecipher_match_t> matches = finder.find_all(ciphertext);
+
+        return cipher.find("ERROR", ciphertext) == std::optional<std::size_t>{3}
+               && !cipher.find("FATAL", ciphertext).has_value()
+               && errors.size() == 12
+               && errors[1] == 24
+               && matches.size() == 2
+               && matches[0].offset == 14 && matches[0].pattern == 0
+               && matches[1].offset == 30 && matches[1].pattern == 1
+               && !MultiFinder(cipher, {"WARN", ""}).valid();
+    }
+
+    bool test_order() {
+        const Cipher cipher = Cipher::caesar();
+        const PlaintextOrder order(cipher);
+        const std::vector<std::string> words{"pear", "apple", "melon", "apple", "fig", "peach"};
+        std::vector<std::vector<std::uint8_t>> keys;
+        for (const std::string& word : words) {
+            keys.push_back(cipher.encipher(std::vector<std::uint8_t>(word.begin(), word.end())));
+        }
+
+        std::vector<std::vector<std::uint8_t>> compared{keys};
+        std::sort(compared.begin(), compared.end(), order);
+        order.sort(keys);
+
+        std::vector<std::string> plaintext;
+        for (const std::vector<std::uint8_t>& key : keys) {
+            const std::vector<std::uint8_t> word = cipher.decipher(key);
+            plaintext.emplace_back(word.begin(), word.end());
+        }
+        std::vector<std::string> expected{words};
+        std::sort(expected.begin(), expected.end());
+
+        return plaintext == expected
+               && compared == keys
+               && order.compare(keys[0], keys[1]) == 0
+               && order.compare(keys[5], keys[4]) > 0
+               && std::lower_bound(keys.begin(), keys.end(), keys[3], order) - keys.begin() == 3;
+    }
+
+    bool test_solver() {
+        std::string corpus;
+        for (int i = 0; i < 100; ++i) {
+            corpus += "the quick brown fox jumps over the lazy dog. ";
+        }
+        const NgramModel model(corpus);
+        Solver solver(model);
+        solver.threads(2).time_limit(std::chrono::seconds(5)).crib(4, "quick brown");
+
+        const std::string plaintext = "the quick brown fox jumps over the lazy dog.";
+        const std::vector<std::uint8_t> ciphertext = Cipher::caesar().encipher(
+            std::vector<std::uint8_t>(plaintext.begin(), plaintext.end())
+        );
+        double score = 0.0;
+        const Cipher solved = solver.solve(ciphertext, &score);
+        const std::vector<std::uint8_t> recovered = solved.decipher(ciphertext);
+
+        bool rejected = false;
+        try {
+            solver.crib(40, "foxes").solve(ciphertext);
+        } catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        // Other plaintext may score as well under a corpus of one sentence,
+        // but none better.
+        return std::string(recovered.begin() + 4, recovered.begin() + 15) == "quick brown"
+               && score > model.score(plaintext) - 1e-3
+               && rejected;
+    }
+
+    bool test_wide() {
+        // Shift hiragana one ahead.
+        const WideCipher cipher = WideSubstitutionBuilder().rotate(u'\u3041', u'\u3096', 1).into_cipher();
+
+        const std::u16string greeting = u"\u3053\u3093\u306b\u3061\u306f, \u3053\u3093\u306b\u3061\u306f!";
+        const std::u16string expected = u"\u3054\u3094\u306c\u3062\u3070, \u3054\u3094\u306c\u3062\u3070!";
+
+        std::vector<std::uint16_t> not_a_permutation(1u << 16u);
+        return cipher.encipher(greeting) == expected
+               && cipher.decipher(expected) == greeting
+               && !WideCipher::from_table(not_a_permutation).valid();
+    }
+
     /// All test cases that will be run.
     constexpr auto TEST_CASES = std::array{
         TEST_CASE(test_builder_new_matches_null),
         TEST_CASE(test_cipher_vector),
         TEST_CASE(test_cipher_vector_inplace),
+        TEST_CASE(test_cipher_c_str_inplace),
         TEST_CASE(test_rot13),
         TEST_CASE(test_caesar),
         TEST_CASE(test_leet),
+        TEST_CASE(test_affine),
+        TEST_CASE(test_cipher_batch),
+        TEST_CASE(test_cipher_fields),
+        TEST_CASE(test_field_selector),
+        TEST_CASE(test_histogram),
+        TEST_CASE(test_crc32c),
+        TEST_CASE(test_encode),
+        TEST_CASE(test_cipher_algebra),
+        TEST_CASE(test_periodic),
+        TEST_CASE(test_pool),
+        TEST_CASE(test_context),
+        TEST_CASE(test_arena),
+        TEST_CASE(test_arena_moved),
+        TEST_CASE(test_swappable),
+        TEST_CASE(test_swappable_moved),
+        TEST_CASE(test_solver),
+        TEST_CASE(test_find),
+        TEST_CASE(test_order),
+        TEST_CASE(test_wide),
     };
 }
 
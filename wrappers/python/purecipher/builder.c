@@ -2,19 +2,16 @@
 
 #include "cipher.h"
 
-/*
- * Python Exception type raised for errors in PureCipher_BuilderObject methods.
- */
-PyObject *PureCipher_BuilderError;
-
 /*
  * Destructor for PureCipher_BuilderObject.
  */
 static void Builder_dealloc(PureCipher_BuilderObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
     if (self->builder != NULL) {
         purecipher_builder_discard(self->builder);
     }
-    Py_TYPE(self)->tp_free((PyObject *) self);
+    type->tp_free((PyObject *) self);
+    Py_DECREF(type);
 }
 
 /*
@@ -33,10 +30,11 @@ static PyObject *Builder_new(PyTypeObject *type, PyObject *Py_UNUSED(args), PyOb
  * Checks if the given builder object has been consumed.
  */
 static PyObject *Builder_is_consumed(PureCipher_BuilderObject *self, PyObject *Py_UNUSED(args)) {
-    if (self->builder == NULL) {
-        Py_RETURN_TRUE;
-    }
-    Py_RETURN_FALSE;
+    int consumed;
+    PURECIPHER_BEGIN_CRITICAL_SECTION(self);
+    consumed = self->builder == NULL;
+    PURECIPHER_END_CRITICAL_SECTION();
+    return PyBool_FromLong(consumed);
 }
 
 const PyDoc_STRVAR(Builder_is_consumed_doc,
@@ -46,17 +44,20 @@ const PyDoc_STRVAR(Builder_is_consumed_doc,
  * Convert a substitution builder into a cipher object.
  */
 static PyObject *Builder_into_cipher(PureCipher_BuilderObject *self, PyObject *Py_UNUSED(args)) {
-    if (PureCipher_BuilderObject_check_consumed(self) < 0) {
-        return NULL;
-    }
-    const purecipher_obj_t cipher_ptr = purecipher_builder_into_cipher(self->builder);
+    purecipher_builder_t *builder;
+    PURECIPHER_BEGIN_CRITICAL_SECTION(self);
+    builder = self->builder;
     self->builder = NULL;
+    PURECIPHER_END_CRITICAL_SECTION();
 
-    PyObject *cipher = PyObject_CallObject((PyObject *) &PureCipher_CipherType, NULL);
-    if (cipher != NULL) {
-        PureCipher_Cipher_set_cipher((PureCipher_CipherObject *) cipher, cipher_ptr);
+    if (builder == NULL) {
+        PureCipher_BuilderObject_check_consumed(self);
+        return NULL;
     }
-    return cipher;
+    return PureCipher_Cipher_wrap(
+        PureCipher_get_state_by_type(Py_TYPE(self)),
+        purecipher_builder_into_cipher(builder)
+    );
 }
 
 const PyDoc_STRVAR(Builder_into_cipher_doc,
@@ -72,10 +73,16 @@ static PyObject *Builder_swap(PureCipher_BuilderObject *self, PyObject *args) {
     if (!PyArg_ParseTuple(args, "cc", &left, &right)) {
         return NULL;
     }
-    if (PureCipher_BuilderObject_check_consumed(self) < 0) {
+    int status;
+    PURECIPHER_BEGIN_CRITICAL_SECTION(self);
+    status = PureCipher_BuilderObject_check_consumed(self);
+    if (status == 0) {
+        purecipher_builder_swap(self->builder, left, right);
+    }
+    PURECIPHER_END_CRITICAL_SECTION();
+    if (status < 0) {
         return NULL;
     }
-    purecipher_builder_swap(self->builder, left, right);
 
     Py_INCREF(self);
     return (PyObject *) self;
@@ -101,10 +108,16 @@ static PyObject *Builder_rotate(PureCipher_BuilderObject *self, PyObject *args)
     if (!PyArg_ParseTuple(args, "cci", &from, &to, &offset)) {
         return NULL;
     }
-    if (PureCipher_BuilderObject_check_consumed(self) < 0) {
+    int status;
+    PURECIPHER_BEGIN_CRITICAL_SECTION(self);
+    status = PureCipher_BuilderObject_check_consumed(self);
+    if (status == 0) {
+        purecipher_builder_rotate(self->builder, from, to, offset);
+    }
+    PURECIPHER_END_CRITICAL_SECTION();
+    if (status < 0) {
         return NULL;
     }
-    purecipher_builder_rotate(self->builder, from, to, offset);
 
     Py_INCREF(self);
     return (PyObject *) self;
@@ -140,23 +153,31 @@ const PyDoc_STRVAR(PureCipher_BuilderObject_doc,
     "applications.");
 
 /*
- * Python type object for PureCipher_BuilderObject instances.
+ * Python type slots for PureCipher_BuilderObject instances.
+ */
+static PyType_Slot Builder_slots[] = {
+    {Py_tp_doc,     (void *) PureCipher_BuilderObject_doc},
+    {Py_tp_new,     Builder_new},
+    {Py_tp_dealloc, Builder_dealloc},
+    {Py_tp_methods, Builder_methods},
+    {0, NULL}  /* Sentinel */
+};
+
+/*
+ * Python type specification for PureCipher_BuilderObject instances.
  */
-PyTypeObject PureCipher_BuilderType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "purecipher.SubstitutionBuilder",
-    .tp_doc = PureCipher_BuilderObject_doc,
-    .tp_basicsize = sizeof(PureCipher_BuilderObject),
-    .tp_itemsize = 0,
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_new = Builder_new,
-    .tp_dealloc = (destructor) Builder_dealloc,
-    .tp_methods = Builder_methods,
+PyType_Spec PureCipher_BuilderSpec = {
+    .name = "purecipher.SubstitutionBuilder",
+    .basicsize = sizeof(PureCipher_BuilderObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = Builder_slots,
 };
 
 int PureCipher_BuilderObject_check_consumed(const PureCipher_BuilderObject *self) {
     if (self->builder == NULL) {
-        PyErr_SetString(PureCipher_BuilderError, "Builder has already been consumed.");
+        PureCipher_ModuleState *state = PureCipher_get_state_by_type(Py_TYPE(self));
+        PyErr_SetString(state->BuilderError, "Builder has already been consumed.");
         return -1;
     }
     return 0;
@@ -7,6 +7,8 @@
 
 #include "purecipher.h"
 
+#include "module.h"
+
 /*
  * Python object wrapping a substitution builder pointer.
  */
@@ -16,18 +18,13 @@ typedef struct {
 } PureCipher_BuilderObject;
 
 /*
- * Python type object singleton for PureCipher_BuilderObjects.
- */
-extern PyTypeObject PureCipher_BuilderType;
-
-/*
- * Python Exception type raised for errors in PureCipher_BuilderObject methods.
+ * Python type specification for PureCipher_BuilderObjects.
  */
-extern PyObject *PureCipher_BuilderError;
+extern PyType_Spec PureCipher_BuilderSpec;
 
 /*
- * Helper function to raise a python exception if the given builder object has
- * already been consumed.
+ * Helper function to raise the module's BuilderError if the given builder
+ * object has already been consumed.
  *
  * This function returns -1 if an exception was raised, 0 otherwise.
  */
@@ -1,11 +1,18 @@
 #include "cipher.h"
 
+#include "stats.h"
+
 /*
  * Destructor for PureCipher_CipherObject.
  */
 static void Cipher_dealloc(PureCipher_CipherObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
     purecipher_free(self->cipher);
-    Py_TYPE(self)->tp_free((PyObject *) self);
+    if (self->shared.obj != NULL) {
+        PyBuffer_Release(&self->shared);
+    }
+    type->tp_free((PyObject *) self);
+    Py_DECREF(type);
 }
 
 /*
@@ -21,22 +28,71 @@ static PyObject *Cipher_new(PyTypeObject *type, PyObject *Py_UNUSED(args), PyObj
 }
 
 /*
- * Encipher the given string with this cipher.
+ * Strings of at most this many bytes are ciphered in a buffer on the stack.
+ */
+#define STACK_STR_LEN 256
+
+/*
+ * Byte ciphering function of the purecipher library.
+ */
+typedef void (*cipher_fn_t)(purecipher_obj_t, uint8_t *, size_t);
+
+/*
+ * Raise a TypeError if a method taking exactly one argument was passed some
+ * other number of arguments.
+ *
+ * This function returns -1 if an exception was raised, 0 otherwise.
+ */
+static int check_one_arg(const char *name, Py_ssize_t nargs) {
+    if (nargs != 1) {
+        PyErr_Format(PyExc_TypeError, "%s() takes exactly one argument (%zd given)", name, nargs);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Cipher a copy of the UTF-8 encoding of the given str object and decode the
+ * result as a new str object.
  */
-static PyObject *Cipher_encipher_str(PureCipher_CipherObject *self, PyObject *args) {
-    char *clear_data;
+static PyObject *Cipher_str(PureCipher_CipherObject *self, PyObject *str, cipher_fn_t cipher_fn) {
+    char stack_buffer[STACK_STR_LEN];
+    Py_ssize_t len;
 
-    if (!PyArg_ParseTuple(args, "s", &clear_data)) {
+    if (!PyUnicode_Check(str)) {
+        PyErr_Format(PyExc_TypeError, "argument must be str, not %.100s", Py_TYPE(str)->tp_name);
+        return NULL;
+    }
+    const char *data = PyUnicode_AsUTF8AndSize(str, &len);
+    if (data == NULL) {
         return NULL;
     }
 
-    char *buffer = malloc(strlen(clear_data));
-    strcpy(buffer, clear_data);
-    purecipher_encipher_str(self->cipher, buffer);
+    char *buffer = stack_buffer;
+    if (len > STACK_STR_LEN) {
+        buffer = PyMem_Malloc((size_t) len);
+        if (buffer == NULL) {
+            return PyErr_NoMemory();
+        }
+    }
+    memcpy(buffer, data, (size_t) len);
+    cipher_fn(self->cipher, (uint8_t *) buffer, (size_t) len);
 
-    PyObject *cipher_text = Py_BuildValue("s", buffer);
-    free(buffer);
-    return cipher_text;
+    PyObject *result = PyUnicode_DecodeUTF8(buffer, len, NULL);
+    if (buffer != stack_buffer) {
+        PyMem_Free(buffer);
+    }
+    return result;
+}
+
+/*
+ * Encipher the given string with this cipher.
+ */
+static PyObject *Cipher_encipher_str(PureCipher_CipherObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    if (check_one_arg("encipher", nargs) < 0) {
+        return NULL;
+    }
+    return Cipher_str(self, args[0], purecipher_encipher_buffer);
 }
 
 const PyDoc_STRVAR(Cipher_encipher_str_doc,
@@ -50,20 +106,11 @@ const PyDoc_STRVAR(Cipher_encipher_str_doc,
 /*
  * Decipher the given string with this cipher.
  */
-static PyObject *Cipher_decipher_str(PureCipher_CipherObject *self, PyObject *args) {
-    char *cipher_data;
-
-    if (!PyArg_ParseTuple(args, "s", &cipher_data)) {
+static PyObject *Cipher_decipher_str(PureCipher_CipherObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    if (check_one_arg("decipher", nargs) < 0) {
         return NULL;
     }
-
-    char *buffer = malloc(strlen(cipher_data));
-    strcpy(buffer, cipher_data);
-    purecipher_decipher_str(self->cipher, buffer);
-
-    PyObject *clear_text = Py_BuildValue("s", buffer);
-    free(buffer);
-    return clear_text;
+    return Cipher_str(self, args[0], purecipher_decipher_buffer);
 }
 
 const PyDoc_STRVAR(Cipher_decipher_str_doc,
@@ -75,21 +122,30 @@ const PyDoc_STRVAR(Cipher_decipher_str_doc,
     "inplace, see Cipher.decipher_buffer().");
 
 /*
- * Encipher the given PyByteArrayObject inplace.
+ * Cipher the given PyByteArrayObject inplace.
  */
-static PyObject *Cipher_encipher_buffer(PureCipher_CipherObject *self, PyObject *args) {
-    PyByteArrayObject *buffer_object;
-
-    if (!PyArg_ParseTuple(args, "Y", &buffer_object)) {
+static PyObject *Cipher_bytearray(PureCipher_CipherObject *self, PyObject *buffer_object, cipher_fn_t cipher_fn) {
+    if (!PyByteArray_Check(buffer_object)) {
+        PyErr_Format(PyExc_TypeError, "argument must be bytearray, not %.100s", Py_TYPE(buffer_object)->tp_name);
         return NULL;
     }
-    uint8_t *data_buffer = (uint8_t *) PyByteArray_AsString((PyObject *) buffer_object);
-    const Py_ssize_t len = PyByteArray_Size((PyObject *) buffer_object);
+    uint8_t *data_buffer = (uint8_t *) PyByteArray_AS_STRING(buffer_object);
+    const Py_ssize_t len = PyByteArray_GET_SIZE(buffer_object);
 
-    purecipher_encipher_buffer(self->cipher, data_buffer, (size_t) len);
+    cipher_fn(self->cipher, data_buffer, (size_t) len);
     Py_RETURN_NONE;
 }
 
+/*
+ * Encipher the given PyByteArrayObject inplace.
+ */
+static PyObject *Cipher_encipher_buffer(PureCipher_CipherObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    if (check_one_arg("encipher_buffer", nargs) < 0) {
+        return NULL;
+    }
+    return Cipher_bytearray(self, args[0], purecipher_encipher_buffer);
+}
+
 const PyDoc_STRVAR(Cipher_encipher_buffer_doc,
     "encipher_buffer(bytearray)"
     "\n\n"
@@ -101,17 +157,11 @@ const PyDoc_STRVAR(Cipher_encipher_buffer_doc,
 /*
  * Decipher the given PyByteArrayObject inplace.
  */
-static PyObject *Cipher_decipher_buffer(PureCipher_CipherObject *self, PyObject *args) {
-    PyByteArrayObject *buffer_object;
-
-    if (!PyArg_ParseTuple(args, "Y", &buffer_object)) {
+static PyObject *Cipher_decipher_buffer(PureCipher_CipherObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    if (check_one_arg("decipher_buffer", nargs) < 0) {
         return NULL;
     }
-    uint8_t *data_buffer = (uint8_t *) PyByteArray_AsString((PyObject *) buffer_object);
-    const Py_ssize_t len = PyByteArray_Size((PyObject *) buffer_object);
-
-    purecipher_decipher_buffer(self->cipher, data_buffer, (size_t) len);
-    Py_RETURN_NONE;
+    return Cipher_bytearray(self, args[0], purecipher_decipher_buffer);
 }
 
 const PyDoc_STRVAR(Cipher_decipher_buffer_doc,
@@ -122,28 +172,952 @@ const PyDoc_STRVAR(Cipher_decipher_buffer_doc,
     "This method only accepts mutable bytearrays. For operating on strings, see\n"
     "Cipher.decipher()");
 
+/*
+ * Signature shared by purecipher_encipher_buffer_crc32c and
+ * purecipher_decipher_buffer_crc32c.
+ */
+typedef uint32_t (*cipher_crc32c_fn_t)(purecipher_obj_t, uint8_t *, size_t, uint32_t, int);
+
+/*
+ * Cipher the given writable buffer inplace while computing its CRC32C.
+ */
+static PyObject *Cipher_buffer_crc32c(
+    PureCipher_CipherObject *self,
+    PyObject *args,
+    PyObject *kwds,
+    const char *format,
+    cipher_crc32c_fn_t cipher_fn
+) {
+    static char *kwlist[] = {"buffer", "crc", "ciphertext", NULL};
+    Py_buffer buffer;
+    unsigned int crc = 0;
+    int ciphertext = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, format, kwlist, &buffer, &crc, &ciphertext)) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    crc = cipher_fn(self->cipher, buffer.buf, (size_t) buffer.len, crc, ciphertext);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&buffer);
+    return PyLong_FromUnsignedLong(crc);
+}
+
+/*
+ * Encipher the given writable buffer inplace while computing its CRC32C.
+ */
+static PyObject *Cipher_encipher_buffer_crc32c(PureCipher_CipherObject *self, PyObject *args, PyObject *kwds) {
+    return Cipher_buffer_crc32c(self, args, kwds, "w*|I$p:encipher_buffer_crc32c", purecipher_encipher_buffer_crc32c);
+}
+
+const PyDoc_STRVAR(Cipher_encipher_buffer_crc32c_doc,
+    "encipher_buffer_crc32c(buffer, crc=0, *, ciphertext=False)"
+    "\n\n"
+    "Encipher the given writable bytes-like object inplace with this cipher,\n"
+    "returning its CRC32C in the same pass over memory. The checksum continues\n"
+    "from crc, as purecipher.crc32c() does, and is of the ciphertext if\n"
+    "ciphertext is true and of the plaintext otherwise.");
+
+/*
+ * Decipher the given writable buffer inplace while computing its CRC32C.
+ */
+static PyObject *Cipher_decipher_buffer_crc32c(PureCipher_CipherObject *self, PyObject *args, PyObject *kwds) {
+    return Cipher_buffer_crc32c(self, args, kwds, "w*|I$p:decipher_buffer_crc32c", purecipher_decipher_buffer_crc32c);
+}
+
+const PyDoc_STRVAR(Cipher_decipher_buffer_crc32c_doc,
+    "decipher_buffer_crc32c(buffer, crc=0, *, ciphertext=False)"
+    "\n\n"
+    "Decipher the given writable bytes-like object inplace with this cipher,\n"
+    "returning its CRC32C in the same pass over memory. The checksum continues\n"
+    "from crc, as purecipher.crc32c() does, and is of the ciphertext if\n"
+    "ciphertext is true and of the plaintext otherwise.");
+
+/*
+ * Encipher the given str or bytes-like object and encode the ciphertext as a
+ * new str object in the given encoding.
+ */
+static PyObject *Cipher_encipher_encode(PureCipher_CipherObject *self, PyObject *args, const char *format, int encoding) {
+    Py_buffer data;
+
+    if (!PyArg_ParseTuple(args, format, &data)) {
+        return NULL;
+    }
+    const size_t length = purecipher_encoded_length(encoding, (size_t) data.len);
+    // The text is written straight into the storage of an ASCII str.
+    PyObject *text = PyUnicode_New((Py_ssize_t) length, 127);
+    if (text != NULL) {
+        char *text_data = (char *) PyUnicode_1BYTE_DATA(text);
+        Py_BEGIN_ALLOW_THREADS
+        purecipher_encipher_encode(self->cipher, encoding, data.buf, (size_t) data.len, text_data, length);
+        Py_END_ALLOW_THREADS
+    }
+    PyBuffer_Release(&data);
+    return text;
+}
+
+/*
+ * Decode the given str or bytes-like object in the given encoding and
+ * decipher the result as a new bytes object.
+ */
+static PyObject *Cipher_decode_decipher(PureCipher_CipherObject *self, PyObject *args, const char *format, int encoding) {
+    Py_buffer text;
+    int64_t length;
+
+    if (!PyArg_ParseTuple(args, format, &text)) {
+        return NULL;
+    }
+    length = purecipher_decoded_length(encoding, text.buf, (size_t) text.len);
+    PyObject *bytes = length < 0 ? NULL : PyBytes_FromStringAndSize(NULL, (Py_ssize_t) length);
+    if (bytes != NULL) {
+        uint8_t *bytes_data = (uint8_t *) PyBytes_AS_STRING(bytes);
+        Py_BEGIN_ALLOW_THREADS
+        length = purecipher_decode_decipher(self->cipher, encoding, text.buf, (size_t) text.len, bytes_data, (size_t) length);
+        Py_END_ALLOW_THREADS
+        if (length < 0) {
+            Py_CLEAR(bytes);
+        }
+    }
+    if (length < 0) {
+        PyErr_SetString(PyExc_ValueError, encoding == PURECIPHER_ENCODING_HEX ? "invalid hex text" : "invalid base64 text");
+    }
+    PyBuffer_Release(&text);
+    return bytes;
+}
+
+/*
+ * Encipher a str or bytes-like object into hex.
+ */
+static PyObject *Cipher_encipher_hex(PureCipher_CipherObject *self, PyObject *args) {
+    return Cipher_encipher_encode(self, args, "s*:encipher_hex", PURECIPHER_ENCODING_HEX);
+}
+
+const PyDoc_STRVAR(Cipher_encipher_hex_doc,
+    "encipher_hex(data)"
+    "\n\n"
+    "Encipher the given str, as UTF-8, or bytes-like object with this cipher and\n"
+    "return the ciphertext as a str of lowercase hexadecimal digits, in a single\n"
+    "pass with the GIL released.");
+
+/*
+ * Encipher a str or bytes-like object into base64.
+ */
+static PyObject *Cipher_encipher_base64(PureCipher_CipherObject *self, PyObject *args) {
+    return Cipher_encipher_encode(self, args, "s*:encipher_base64", PURECIPHER_ENCODING_BASE64);
+}
+
+const PyDoc_STRVAR(Cipher_encipher_base64_doc,
+    "encipher_base64(data)"
+    "\n\n"
+    "Encipher the given str, as UTF-8, or bytes-like object with this cipher and\n"
+    "return the ciphertext as a str of standard, padded base64, in a single pass\n"
+    "with the GIL released.");
+
+/*
+ * Decipher hex text into bytes.
+ */
+static PyObject *Cipher_decipher_hex(PureCipher_CipherObject *self, PyObject *args) {
+    return Cipher_decode_decipher(self, args, "s*:decipher_hex", PURECIPHER_ENCODING_HEX);
+}
+
+const PyDoc_STRVAR(Cipher_decipher_hex_doc,
+    "decipher_hex(text)"
+    "\n\n"
+    "Decode the given str or bytes-like object of hexadecimal digits and\n"
+    "decipher the result with this cipher, returning the plaintext as bytes.\n"
+    "This is the inverse of Cipher.encipher_hex()."
+    "\n\n"
+    "Raises ValueError if the text is not valid hex.");
+
+/*
+ * Decipher base64 text into bytes.
+ */
+static PyObject *Cipher_decipher_base64(PureCipher_CipherObject *self, PyObject *args) {
+    return Cipher_decode_decipher(self, args, "s*:decipher_base64", PURECIPHER_ENCODING_BASE64);
+}
+
+const PyDoc_STRVAR(Cipher_decipher_base64_doc,
+    "decipher_base64(text)"
+    "\n\n"
+    "Decode the given str or bytes-like object of standard, padded base64 and\n"
+    "decipher the result with this cipher, returning the plaintext as bytes.\n"
+    "This is the inverse of Cipher.encipher_base64()."
+    "\n\n"
+    "Raises ValueError if the text is not valid base64.");
+
+/*
+ * Cipher every str or bytes object of the given iterable, returning a list of
+ * new objects of the same types.
+ *
+ * The items are packed into a single buffer, which is ciphered in one call
+ * with the GIL released.
+ */
+static PyObject *Cipher_many(PureCipher_CipherObject *self, PyObject *iterable, cipher_fn_t cipher_fn) {
+    PyObject *result = NULL;
+    Py_ssize_t *offsets = NULL;
+    char *packed = NULL;
+
+    /* A tuple cannot be changed by other threads while its items are read. */
+    PyObject *items = PySequence_Tuple(iterable);
+    if (items == NULL) {
+        return NULL;
+    }
+    const Py_ssize_t count = PyTuple_GET_SIZE(items);
+    PyObject **item_array = &PyTuple_GET_ITEM(items, 0);
+
+    offsets = PyMem_New(Py_ssize_t, (size_t) count + 1);
+    if (offsets == NULL) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    offsets[0] = 0;
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject *item = item_array[i];
+        Py_ssize_t len;
+        if (PyUnicode_Check(item)) {
+            if (PyUnicode_AsUTF8AndSize(item, &len) == NULL) {
+                goto done;
+            }
+        } else if (PyBytes_Check(item)) {
+            len = PyBytes_GET_SIZE(item);
+        } else {
+            PyErr_Format(PyExc_TypeError, "items must be str or bytes, not %.100s", Py_TYPE(item)->tp_name);
+            goto done;
+        }
+        offsets[i + 1] = offsets[i] + len;
+    }
+
+    packed = PyMem_Malloc(offsets[count] > 0 ? (size_t) offsets[count] : 1);
+    if (packed == NULL) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject *item = item_array[i];
+        const char *data = PyUnicode_Check(item) ? PyUnicode_AsUTF8(item) : PyBytes_AS_STRING(item);
+        memcpy(packed + offsets[i], data, (size_t) (offsets[i + 1] - offsets[i]));
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    cipher_fn(self->cipher, (uint8_t *) packed, (size_t) offsets[count]);
+    Py_END_ALLOW_THREADS
+
+    result = PyList_New(count);
+    if (result == NULL) {
+        goto done;
+    }
+    for (Py_ssize_t i = 0; i < count; i++) {
+        const char *data = packed + offsets[i];
+        const Py_ssize_t len = offsets[i + 1] - offsets[i];
+        PyObject *ciphered = PyUnicode_Check(item_array[i])
+            ? PyUnicode_DecodeUTF8(data, len, NULL)
+            : PyBytes_FromStringAndSize(data, len);
+        if (ciphered == NULL) {
+            Py_CLEAR(result);
+            goto done;
+        }
+        PyList_SET_ITEM(result, i, ciphered);
+    }
+
+done:
+    PyMem_Free(packed);
+    PyMem_Free(offsets);
+    Py_DECREF(items);
+    return result;
+}
+
+/*
+ * Encipher every item of the given iterable.
+ */
+static PyObject *Cipher_encipher_many(PureCipher_CipherObject *self, PyObject *iterable) {
+    return Cipher_many(self, iterable, purecipher_encipher_buffer);
+}
+
+const PyDoc_STRVAR(Cipher_encipher_many_doc,
+    "encipher_many(iterable)"
+    "\n\n"
+    "Return a list of the items of the given iterable of str or bytes objects,\n"
+    "each enciphered with this cipher."
+    "\n\n"
+    "The items are ciphered together in a single call that releases the GIL,\n"
+    "which is much faster than calling encipher() on each of many short items.");
+
+/*
+ * Decipher every item of the given iterable.
+ */
+static PyObject *Cipher_decipher_many(PureCipher_CipherObject *self, PyObject *iterable) {
+    return Cipher_many(self, iterable, purecipher_decipher_buffer);
+}
+
+const PyDoc_STRVAR(Cipher_decipher_many_doc,
+    "decipher_many(iterable)"
+    "\n\n"
+    "Return a list of the items of the given iterable of str or bytes objects,\n"
+    "each deciphered with this cipher. See encipher_many().");
+
+/*
+ * Raise a TypeError unless the given buffer holds single-byte integers, such
+ * as a NumPy uint8 array.
+ *
+ * This function returns -1 if an exception was raised, 0 otherwise.
+ */
+static int check_byte_array(const Py_buffer *view, const char *name) {
+    const char *format = view->format;
+    if (format != NULL && format[0] != '\0' && strchr("@=<>!", format[0]) != NULL) {
+        format++;
+    }
+    if (view->itemsize != 1 || (format != NULL && strcmp(format, "B") != 0 && strcmp(format, "b") != 0
+                                && strcmp(format, "c") != 0)) {
+        PyErr_Format(PyExc_TypeError, "%s must be an array of bytes, not of format '%s'",
+                     name, view->format != NULL ? view->format : "B");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Cipher the array described by src into the array of the same shape
+ * described by dst, which may be the same array.
+ *
+ * When both arrays are C-contiguous, the data is ciphered in one call to the
+ * cipher's kernel for buffers. Otherwise, each row is ciphered through a
+ * lookup table built once from the cipher.
+ */
+static void cipher_array(purecipher_obj_t cipher, const Py_buffer *src, const Py_buffer *dst, int decipher) {
+    if (src->len == 0) {
+        return;
+    }
+    if (PyBuffer_IsContiguous(src, 'C') && PyBuffer_IsContiguous(dst, 'C')) {
+        if (dst->buf != src->buf) {
+            memcpy(dst->buf, src->buf, (size_t) src->len);
+        }
+        (decipher ? purecipher_decipher_buffer : purecipher_encipher_buffer)(cipher, dst->buf, (size_t) src->len);
+        return;
+    }
+
+    uint8_t table[256];
+    purecipher_cipher_table(cipher, table);
+    if (decipher) {
+        uint8_t inverse[256];
+        for (int b = 0; b < 256; b++) {
+            inverse[table[b]] = (uint8_t) b;
+        }
+        memcpy(table, inverse, sizeof(table));
+    }
+
+    /* Rows lie along the last dimension; index counts through the others. */
+    const int last = src->ndim - 1;
+    const Py_ssize_t row_len = src->shape[last];
+    const Py_ssize_t src_step = src->strides[last];
+    const Py_ssize_t dst_step = dst->strides[last];
+    Py_ssize_t index[PyBUF_MAX_NDIM] = {0};
+    for (;;) {
+        const uint8_t *src_row = src->buf;
+        uint8_t *dst_row = dst->buf;
+        for (int d = 0; d < last; d++) {
+            src_row += index[d] * src->strides[d];
+            dst_row += index[d] * dst->strides[d];
+        }
+        for (Py_ssize_t i = 0; i < row_len; i++) {
+            dst_row[i * dst_step] = table[src_row[i * src_step]];
+        }
+
+        int d = last - 1;
+        while (d >= 0 && ++index[d] == src->shape[d]) {
+            index[d] = 0;
+            d--;
+        }
+        if (d < 0) {
+            break;
+        }
+    }
+}
+
+/*
+ * Return a new C-contiguous array of bytes with the given buffer's shape, as a
+ * memoryview of a bytearray.
+ */
+static PyObject *new_byte_array(const Py_buffer *like) {
+    PyObject *bytes = PyByteArray_FromStringAndSize(NULL, like->len);
+    if (bytes == NULL) {
+        return NULL;
+    }
+    PyObject *view = PyMemoryView_FromObject(bytes);
+    Py_DECREF(bytes);
+    if (view == NULL || like->ndim == 1) {
+        return view;
+    }
+    PyObject *shape = PyTuple_New(like->ndim);
+    if (shape == NULL) {
+        Py_DECREF(view);
+        return NULL;
+    }
+    for (int d = 0; d < like->ndim; d++) {
+        PyObject *extent = PyLong_FromSsize_t(like->shape[d]);
+        if (extent == NULL) {
+            Py_DECREF(shape);
+            Py_DECREF(view);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(shape, d, extent);
+    }
+    PyObject *array = PyObject_CallMethod(view, "cast", "sN", "B", shape);
+    Py_DECREF(view);
+    return array;
+}
+
+/*
+ * Cipher an array of bytes exporting the buffer protocol into a new array, or
+ * into the given output array.
+ */
+static PyObject *Cipher_array(PureCipher_CipherObject *self, PyObject *args, PyObject *kwds, int decipher) {
+    static char *kwlist[] = {"array", "out", NULL};
+    PyObject *array;
+    PyObject *out = Py_None;
+    Py_buffer src;
+    Py_buffer dst;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O", kwlist, &array, &out)) {
+        return NULL;
+    }
+    if (PyObject_GetBuffer(array, &src, PyBUF_RECORDS_RO) < 0) {
+        return NULL;
+    }
+    if (check_byte_array(&src, "array") < 0) {
+        PyBuffer_Release(&src);
+        return NULL;
+    }
+
+    PyObject *result = out == Py_None ? new_byte_array(&src) : Py_NewRef(out);
+    if (result == NULL) {
+        PyBuffer_Release(&src);
+        return NULL;
+    }
+    if (PyObject_GetBuffer(result, &dst, PyBUF_RECORDS) < 0) {
+        Py_DECREF(result);
+        PyBuffer_Release(&src);
+        return NULL;
+    }
+    if (check_byte_array(&dst, "out") < 0) {
+        goto error;
+    }
+    if (dst.ndim != src.ndim
+        || (src.ndim > 0 && memcmp(dst.shape, src.shape, sizeof(Py_ssize_t) * (size_t) src.ndim) != 0)) {
+        PyErr_SetString(PyExc_ValueError, "out must have the same shape as array");
+        goto error;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    cipher_array(self->cipher, &src, &dst, decipher);
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&dst);
+    PyBuffer_Release(&src);
+    return result;
+
+error:
+    PyBuffer_Release(&dst);
+    PyBuffer_Release(&src);
+    Py_DECREF(result);
+    return NULL;
+}
+
+/*
+ * Encipher an array of bytes.
+ */
+static PyObject *Cipher_encipher_array(PureCipher_CipherObject *self, PyObject *args, PyObject *kwds) {
+    return Cipher_array(self, args, kwds, 0);
+}
+
+const PyDoc_STRVAR(Cipher_encipher_array_doc,
+    "encipher_array(array, out=None)"
+    "\n\n"
+    "Encipher an array of bytes, such as a NumPy uint8 array or an Arrow buffer,\n"
+    "of any shape and strides."
+    "\n\n"
+    "The result is written to out, which must be a writable array of bytes of\n"
+    "the same shape, and may be array itself to encipher it inplace. out must not\n"
+    "otherwise overlap array. If out is None, a new C-contiguous array is\n"
+    "returned as a memoryview of a bytearray, which numpy.asarray() wraps without\n"
+    "copying. Otherwise, out is returned."
+    "\n\n"
+    "Arrays are ciphered with the GIL released, contiguous arrays in a single\n"
+    "call to the cipher's vectorized kernel.");
+
+/*
+ * Decipher an array of bytes.
+ */
+static PyObject *Cipher_decipher_array(PureCipher_CipherObject *self, PyObject *args, PyObject *kwds) {
+    return Cipher_array(self, args, kwds, 1);
+}
+
+const PyDoc_STRVAR(Cipher_decipher_array_doc,
+    "decipher_array(array, out=None)"
+    "\n\n"
+    "Decipher an array of bytes of any shape and strides. See encipher_array().");
+
+/*
+ * Build the cipher equivalent to applying this cipher a number of times.
+ */
+static PyObject *Cipher_pow(PureCipher_CipherObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    if (check_one_arg("pow", nargs) < 0) {
+        return NULL;
+    }
+    const long long exponent = PyLong_AsLongLong(args[0]);
+    if (exponent == -1 && PyErr_Occurred()) {
+        return NULL;
+    }
+    return PureCipher_Cipher_wrap(
+        PureCipher_get_state_by_type(Py_TYPE(self)),
+        purecipher_cipher_pow(self->cipher, (int64_t) exponent)
+    );
+}
+
+const PyDoc_STRVAR(Cipher_pow_doc,
+    "pow(exponent)"
+    "\n\n"
+    "Return a cipher equivalent to applying this cipher exponent times in\n"
+    "succession. Negative exponents apply the inverse of this cipher.");
+
+/*
+ * Build the inverse of this cipher.
+ */
+static PyObject *Cipher_inverse(PureCipher_CipherObject *self, PyObject *Py_UNUSED(args)) {
+    return PureCipher_Cipher_wrap(
+        PureCipher_get_state_by_type(Py_TYPE(self)),
+        purecipher_cipher_inverse(self->cipher)
+    );
+}
+
+const PyDoc_STRVAR(Cipher_inverse_doc,
+    "inverse()"
+    "\n\n"
+    "Return a cipher that enciphers bytes the way this cipher deciphers them.");
+
+/*
+ * Compute the order of this cipher's permutation.
+ */
+static PyObject *Cipher_order(PureCipher_CipherObject *self, PyObject *Py_UNUSED(args)) {
+    return PyLong_FromUnsignedLongLong(purecipher_cipher_order(self->cipher));
+}
+
+const PyDoc_STRVAR(Cipher_order_doc,
+    "order()"
+    "\n\n"
+    "Return the smallest positive number of times this cipher can be applied in\n"
+    "succession to leave every byte unchanged.");
+
+/*
+ * Decompose this cipher's permutation into disjoint cycles.
+ */
+static PyObject *Cipher_cycles(PureCipher_CipherObject *self, PyObject *Py_UNUSED(args)) {
+    uint8_t elements[256];
+    uint16_t lengths[128];
+    const size_t count = purecipher_cipher_cycles(self->cipher, elements, lengths);
+
+    PyObject *cycles = PyList_New((Py_ssize_t) count);
+    if (cycles == NULL) {
+        return NULL;
+    }
+    const char *cycle_start = (const char *) elements;
+    for (size_t i = 0; i < count; i++) {
+        PyObject *cycle = PyBytes_FromStringAndSize(cycle_start, lengths[i]);
+        if (cycle == NULL) {
+            Py_DECREF(cycles);
+            return NULL;
+        }
+        PyList_SET_ITEM(cycles, (Py_ssize_t) i, cycle);
+        cycle_start += lengths[i];
+    }
+    return cycles;
+}
+
+const PyDoc_STRVAR(Cipher_cycles_doc,
+    "cycles()"
+    "\n\n"
+    "Return the disjoint cycles of this cipher's permutation as a list of bytes\n"
+    "objects, omitting bytes that are mapped to themselves."
+    "\n\n"
+    "Each cycle lists bytes in the order in which this cipher maps them.");
+
+/*
+ * Count the plaintext byte values of the given ciphertext without deciphering it.
+ */
+static PyObject *Cipher_plaintext_histogram(PureCipher_CipherObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer data;
+    uint64_t counts[256];
+
+    if (check_one_arg("plaintext_histogram", nargs) < 0) {
+        return NULL;
+    }
+    if (PyObject_GetBuffer(args[0], &data, PyBUF_SIMPLE) < 0) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    purecipher_histogram_plaintext(self->cipher, data.buf, (size_t) data.len, counts);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&data);
+
+    return PureCipher_histogram_to_list(counts);
+}
+
+const PyDoc_STRVAR(Cipher_plaintext_histogram_doc,
+    "plaintext_histogram(data)"
+    "\n\n"
+    "Return a list of 256 integers counting the occurrences of each byte value\n"
+    "in the plaintext of the given enciphered bytes-like object."
+    "\n\n"
+    "The data is neither modified nor deciphered.");
+
+/*
+ * Number of occurrences that find_all() and find_patterns() collect before
+ * allocating room for more.
+ */
+#define FIND_INITIAL_CAPACITY 64
+
+/*
+ * Find the first occurrence of plaintext within ciphertext without deciphering it.
+ */
+static PyObject *Cipher_find(PureCipher_CipherObject *self, PyObject *args) {
+    Py_buffer plaintext;
+    Py_buffer ciphertext;
+    int64_t offset;
+
+    if (!PyArg_ParseTuple(args, "s*y*:find", &plaintext, &ciphertext)) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    offset = purecipher_find(
+        self->cipher, plaintext.buf, (size_t) plaintext.len, ciphertext.buf, (size_t) ciphertext.len
+    );
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&plaintext);
+    PyBuffer_Release(&ciphertext);
+    return PyLong_FromLongLong(offset);
+}
+
+const PyDoc_STRVAR(Cipher_find_doc,
+    "find(plaintext, ciphertext)"
+    "\n\n"
+    "Return the offset of the first occurrence of plaintext, a str or bytes-like\n"
+    "object, within the bytes-like ciphertext enciphered by this cipher, or -1 if\n"
+    "it does not occur. The ciphertext is searched without being deciphered.");
+
+/*
+ * Find every occurrence of plaintext within ciphertext without deciphering it.
+ */
+static PyObject *Cipher_find_all(PureCipher_CipherObject *self, PyObject *args) {
+    Py_buffer plaintext;
+    Py_buffer ciphertext;
+    size_t initial[FIND_INITIAL_CAPACITY];
+    size_t *offsets = initial;
+    size_t count;
+    PyObject *result = NULL;
+
+    if (!PyArg_ParseTuple(args, "s*y*:find_all", &plaintext, &ciphertext)) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    count = purecipher_find_all(
+        self->cipher, plaintext.buf, (size_t) plaintext.len, ciphertext.buf, (size_t) ciphertext.len,
+        offsets, FIND_INITIAL_CAPACITY
+    );
+    Py_END_ALLOW_THREADS
+    if (count > FIND_INITIAL_CAPACITY) {
+        offsets = PyMem_Malloc(count * sizeof(size_t));
+        if (offsets == NULL) {
+            PyErr_NoMemory();
+            goto done;
+        }
+        Py_BEGIN_ALLOW_THREADS
+        purecipher_find_all(
+            self->cipher, plaintext.buf, (size_t) plaintext.len, ciphertext.buf, (size_t) ciphertext.len,
+            offsets, count
+        );
+        Py_END_ALLOW_THREADS
+    }
+
+    result = PyList_New((Py_ssize_t) count);
+    for (size_t i = 0; result != NULL && i < count; ++i) {
+        PyObject *offset = PyLong_FromSize_t(offsets[i]);
+        if (offset == NULL) {
+            Py_CLEAR(result);
+        } else {
+            PyList_SET_ITEM(result, (Py_ssize_t) i, offset);
+        }
+    }
+
+done:
+    if (offsets != initial) {
+        PyMem_Free(offsets);
+    }
+    PyBuffer_Release(&plaintext);
+    PyBuffer_Release(&ciphertext);
+    return result;
+}
+
+const PyDoc_STRVAR(Cipher_find_all_doc,
+    "find_all(plaintext, ciphertext)"
+    "\n\n"
+    "Return a list of the offsets of every occurrence of plaintext, a str or\n"
+    "bytes-like object, within the bytes-like ciphertext enciphered by this\n"
+    "cipher, including occurrences that overlap. The ciphertext is searched\n"
+    "without being deciphered, on all cores if it is large.");
+
+/*
+ * Build a multi-pattern finder for the given sequence of str or bytes-like patterns.
+ *
+ * Returns NULL if an exception was raised.
+ */
+static purecipher_multi_finder_t *new_multi_finder(purecipher_obj_t cipher, PyObject *patterns) {
+    purecipher_multi_finder_t *finder = NULL;
+    PyObject *sequence = PySequence_Fast(patterns, "patterns must be a sequence");
+    if (sequence == NULL) {
+        return NULL;
+    }
+    const Py_ssize_t count = PySequence_Fast_GET_SIZE(sequence);
+    Py_buffer *views = PyMem_Calloc(count > 0 ? (size_t) count : 1, sizeof(Py_buffer));
+    const uint8_t **data = PyMem_Calloc(count > 0 ? (size_t) count : 1, sizeof(uint8_t *));
+    size_t *lengths = PyMem_Calloc(count > 0 ? (size_t) count : 1, sizeof(size_t));
+    Py_ssize_t acquired = 0;
+    if (views == NULL || data == NULL || lengths == NULL) {
+        PyErr_NoMemory();
+        goto done;
+    }
+
+    for (; acquired < count; ++acquired) {
+        PyObject *pattern = PySequence_Fast_GET_ITEM(sequence, acquired);
+        const char *utf8;
+        Py_ssize_t size;
+        if (PyUnicode_Check(pattern)) {
+            utf8 = PyUnicode_AsUTF8AndSize(pattern, &size);
+            if (utf8 == NULL) {
+                goto done;
+            }
+            data[acquired] = (const uint8_t *) utf8;
+            lengths[acquired] = (size_t) size;
+            // The view stays zeroed, so it is not released below.
+            continue;
+        }
+        if (PyObject_GetBuffer(pattern, &views[acquired], PyBUF_SIMPLE) < 0) {
+            goto done;
+        }
+        data[acquired] = views[acquired].buf;
+        lengths[acquired] = (size_t) views[acquired].len;
+    }
+
+    finder = purecipher_multi_finder_new(cipher, data, lengths, (size_t) count);
+    if (finder == NULL) {
+        PyErr_SetString(PyExc_ValueError, "patterns must not be empty");
+    }
+
+done:
+    for (Py_ssize_t i = 0; views != NULL && i < acquired; ++i) {
+        if (views[i].obj != NULL) {
+            PyBuffer_Release(&views[i]);
+        }
+    }
+    PyMem_Free(views);
+    PyMem_Free(data);
+    PyMem_Free(lengths);
+    Py_DECREF(sequence);
+    return finder;
+}
+
+/*
+ * Find every occurrence of several plaintext patterns within ciphertext without deciphering it.
+ */
+static PyObject *Cipher_find_patterns(PureCipher_CipherObject *self, PyObject *args) {
+    PyObject *patterns;
+    Py_buffer ciphertext;
+    purecipher_match_t initial[FIND_INITIAL_CAPACITY];
+    purecipher_match_t *matches = initial;
+    size_t count;
+    PyObject *result = NULL;
+
+    if (!PyArg_ParseTuple(args, "Oy*:find_patterns", &patterns, &ciphertext)) {
+        return NULL;
+    }
+    purecipher_multi_finder_t *finder = new_multi_finder(self->cipher, patterns);
+    if (finder == NULL) {
+        PyBuffer_Release(&ciphertext);
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    count = purecipher_multi_finder_find_all(
+        finder, ciphertext.buf, (size_t) ciphertext.len, matches, FIND_INITIAL_CAPACITY
+    );
+    Py_END_ALLOW_THREADS
+    if (count > FIND_INITIAL_CAPACITY) {
+        matches = PyMem_Malloc(count * sizeof(purecipher_match_t));
+        if (matches == NULL) {
+            PyErr_NoMemory();
+            goto done;
+        }
+        Py_BEGIN_ALLOW_THREADS
+        purecipher_multi_finder_find_all(finder, ciphertext.buf, (size_t) ciphertext.len, matches, count);
+        Py_END_ALLOW_THREADS
+    }
+
+    result = PyList_New((Py_ssize_t) count);
+    for (size_t i = 0; result != NULL && i < count; ++i) {
+        PyObject *match = Py_BuildValue("(nn)", (Py_ssize_t) matches[i].offset, (Py_ssize_t) matches[i].pattern);
+        if (match == NULL) {
+            Py_CLEAR(result);
+        } else {
+            PyList_SET_ITEM(result, (Py_ssize_t) i, match);
+        }
+    }
+
+done:
+    if (matches != initial) {
+        PyMem_Free(matches);
+    }
+    purecipher_multi_finder_free(finder);
+    PyBuffer_Release(&ciphertext);
+    return result;
+}
+
+const PyDoc_STRVAR(Cipher_find_patterns_doc,
+    "find_patterns(patterns, ciphertext)"
+    "\n\n"
+    "Return a list of (offset, index) tuples for every occurrence of the str or\n"
+    "bytes-like objects in the sequence patterns within the bytes-like ciphertext\n"
+    "enciphered by this cipher, ordered by offset and then by index, including\n"
+    "occurrences that overlap. The ciphertext is searched once for all patterns,\n"
+    "without being deciphered, on all cores if it is large."
+    "\n\n"
+    "Raises ValueError if any pattern is empty.");
+
+/*
+ * Return the lookup table of this cipher as a bytes object.
+ */
+static PyObject *Cipher_table(PureCipher_CipherObject *self, PyObject *Py_UNUSED(args)) {
+    uint8_t map[256];
+    purecipher_cipher_table(self->cipher, map);
+    return PyBytes_FromStringAndSize((const char *) map, sizeof(map));
+}
+
+const PyDoc_STRVAR(Cipher_table_doc,
+    "table()"
+    "\n\n"
+    "Return a bytes object of length 256 whose byte at index b is the byte that\n"
+    "b is enciphered to."
+    "\n\n"
+    "These 256 bytes completely describe the cipher, which from_table() rebuilds\n"
+    "from them.");
+
+/*
+ * Support pickling by rebuilding the cipher from its lookup table.
+ */
+static PyObject *Cipher_reduce(PureCipher_CipherObject *self, PyObject *Py_UNUSED(args)) {
+    PyObject *module = PyType_GetModuleByDef(Py_TYPE(self), &PureCipher_Module);
+    if (module == NULL) {
+        return NULL;
+    }
+    PyObject *from_table = PyObject_GetAttrString(module, "from_table");
+    if (from_table == NULL) {
+        return NULL;
+    }
+    PyObject *table = Cipher_table(self, NULL);
+    if (table == NULL) {
+        Py_DECREF(from_table);
+        return NULL;
+    }
+    return Py_BuildValue("(N(N))", from_table, table);
+}
+
+const PyDoc_STRVAR(Cipher_reduce_doc,
+    "__reduce__()"
+    "\n\n"
+    "Pickle this cipher as its 256-byte lookup table. See table().");
+
+/*
+ * Write the lookup tables of this cipher to a writable buffer, in the layout
+ * read by from_shared().
+ */
+static PyObject *Cipher_write_shared(PureCipher_CipherObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer tables;
+
+    if (check_one_arg("write_shared", nargs) < 0) {
+        return NULL;
+    }
+    if (PyObject_GetBuffer(args[0], &tables, PyBUF_WRITABLE) < 0) {
+        return NULL;
+    }
+    if (tables.len != PURECIPHER_SHARED_TABLES_LEN) {
+        PyBuffer_Release(&tables);
+        PyErr_Format(PyExc_ValueError, "buffer must hold exactly %d bytes", PURECIPHER_SHARED_TABLES_LEN);
+        return NULL;
+    }
+    purecipher_shared_write(self->cipher, tables.buf);
+    PyBuffer_Release(&tables);
+    Py_RETURN_NONE;
+}
+
+const PyDoc_STRVAR(Cipher_write_shared_doc,
+    "write_shared(buffer)"
+    "\n\n"
+    "Write the lookup tables of this cipher to the given writable buffer of\n"
+    "exactly SHARED_TABLES_LEN bytes, such as a slice of the buf of a\n"
+    "multiprocessing.shared_memory.SharedMemory, to be used by from_shared().");
+
 static PyMethodDef Cipher_methods[] = {
-    {"encipher",        (PyCFunction) Cipher_encipher_str,    METH_VARARGS, Cipher_encipher_str_doc},
-    {"decipher",        (PyCFunction) Cipher_decipher_str,    METH_VARARGS, Cipher_decipher_str_doc},
-    {"encipher_buffer", (PyCFunction) Cipher_encipher_buffer, METH_VARARGS, Cipher_encipher_buffer_doc},
-    {"decipher_buffer", (PyCFunction) Cipher_decipher_buffer, METH_VARARGS, Cipher_decipher_buffer_doc},
+    {"encipher",            (PyCFunction) Cipher_encipher_str,        METH_FASTCALL, Cipher_encipher_str_doc},
+    {"decipher",            (PyCFunction) Cipher_decipher_str,        METH_FASTCALL, Cipher_decipher_str_doc},
+    {"encipher_buffer",     (PyCFunction) Cipher_encipher_buffer,     METH_FASTCALL, Cipher_encipher_buffer_doc},
+    {"decipher_buffer",     (PyCFunction) Cipher_decipher_buffer,     METH_FASTCALL, Cipher_decipher_buffer_doc},
+    {"encipher_buffer_crc32c", (PyCFunction) Cipher_encipher_buffer_crc32c, METH_VARARGS | METH_KEYWORDS,
+        Cipher_encipher_buffer_crc32c_doc},
+    {"decipher_buffer_crc32c", (PyCFunction) Cipher_decipher_buffer_crc32c, METH_VARARGS | METH_KEYWORDS,
+        Cipher_decipher_buffer_crc32c_doc},
+    {"encipher_hex",        (PyCFunction) Cipher_encipher_hex,        METH_VARARGS,  Cipher_encipher_hex_doc},
+    {"encipher_base64",     (PyCFunction) Cipher_encipher_base64,     METH_VARARGS,  Cipher_encipher_base64_doc},
+    {"decipher_hex",        (PyCFunction) Cipher_decipher_hex,        METH_VARARGS,  Cipher_decipher_hex_doc},
+    {"decipher_base64",     (PyCFunction) Cipher_decipher_base64,     METH_VARARGS,  Cipher_decipher_base64_doc},
+    {"encipher_many",       (PyCFunction) Cipher_encipher_many,       METH_O,        Cipher_encipher_many_doc},
+    {"decipher_many",       (PyCFunction) Cipher_decipher_many,       METH_O,        Cipher_decipher_many_doc},
+    {"encipher_array",      (PyCFunction) Cipher_encipher_array,      METH_VARARGS | METH_KEYWORDS, Cipher_encipher_array_doc},
+    {"decipher_array",      (PyCFunction) Cipher_decipher_array,      METH_VARARGS | METH_KEYWORDS, Cipher_decipher_array_doc},
+    {"plaintext_histogram", (PyCFunction) Cipher_plaintext_histogram, METH_FASTCALL, Cipher_plaintext_histogram_doc},
+    {"pow",                 (PyCFunction) Cipher_pow,                 METH_FASTCALL, Cipher_pow_doc},
+    {"inverse",             (PyCFunction) Cipher_inverse,             METH_NOARGS,   Cipher_inverse_doc},
+    {"order",               (PyCFunction) Cipher_order,               METH_NOARGS,   Cipher_order_doc},
+    {"cycles",              (PyCFunction) Cipher_cycles,              METH_NOARGS,   Cipher_cycles_doc},
+    {"find",                (PyCFunction) Cipher_find,                METH_VARARGS,  Cipher_find_doc},
+    {"find_all",            (PyCFunction) Cipher_find_all,            METH_VARARGS,  Cipher_find_all_doc},
+    {"find_patterns",       (PyCFunction) Cipher_find_patterns,       METH_VARARGS,  Cipher_find_patterns_doc},
+    {"table",               (PyCFunction) Cipher_table,               METH_NOARGS,   Cipher_table_doc},
+    {"write_shared",        (PyCFunction) Cipher_write_shared,        METH_FASTCALL, Cipher_write_shared_doc},
+    {"__reduce__",          (PyCFunction) Cipher_reduce,              METH_NOARGS,   Cipher_reduce_doc},
     {NULL}  /* Sentinel */
 };
 
-PyTypeObject PureCipher_CipherType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "purecipher.Cipher",
-    .tp_doc = "Pure (stateless) cipher.",
-    .tp_basicsize = sizeof(PureCipher_CipherObject),
-    .tp_itemsize = 0,
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_new = Cipher_new,
-    .tp_dealloc = (destructor) Cipher_dealloc,
-    .tp_methods = Cipher_methods,
+static PyType_Slot Cipher_slots[] = {
+    {Py_tp_doc,     "Pure (stateless) cipher."},
+    {Py_tp_new,     Cipher_new},
+    {Py_tp_dealloc, Cipher_dealloc},
+    {Py_tp_methods, Cipher_methods},
+    {0, NULL}  /* Sentinel */
 };
 
-void PureCipher_Cipher_set_cipher(PureCipher_CipherObject *self, const purecipher_obj_t new_cipher) {
-    purecipher_obj_t old = self->cipher;
-    self->cipher = new_cipher;
-    purecipher_free(old);
+PyType_Spec PureCipher_CipherSpec = {
+    .name = "purecipher.Cipher",
+    .basicsize = sizeof(PureCipher_CipherObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = Cipher_slots,
+};
+
+PyObject *PureCipher_Cipher_wrap(PureCipher_ModuleState *state, const purecipher_obj_t cipher_ptr) {
+    PyObject *cipher = PyObject_CallNoArgs((PyObject *) state->CipherType);
+    if (cipher != NULL) {
+        PureCipher_CipherObject *self = (PureCipher_CipherObject *) cipher;
+        purecipher_free(self->cipher);
+        self->cipher = cipher_ptr;
+    } else {
+        purecipher_free(cipher_ptr);
+    }
+    return cipher;
 }
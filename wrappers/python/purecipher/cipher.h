@@ -7,23 +7,32 @@
 
 #include "purecipher.h"
 
+#include "module.h"
+
 /*
  * Python object wrapping a pure cipher object pointer.
+ *
+ * Ciphers built by from_shared() look bytes up in tables they do not own, and
+ * hold the buffer containing those tables until they are destroyed. The
+ * buffer's obj is NULL for every other cipher.
  */
 typedef struct {
     PyObject_HEAD
     purecipher_obj_t cipher;
+    Py_buffer shared;
 } PureCipher_CipherObject;
 
 /*
- * Python type object singleton for PureCipher_CipherObjects.
+ * Python type specification for PureCipher_CipherObjects.
  */
-extern PyTypeObject PureCipher_CipherType;
+extern PyType_Spec PureCipher_CipherSpec;
 
 /*
- * Overwrite the cipher used by the given PureCipher_CipherObject, freeing the
- * previous cipher.
+ * Wrap an owned cipher object pointer in a new PureCipher_CipherObject of the
+ * given module's cipher type.
+ *
+ * The cipher is freed if the object could not be created.
  */
-void PureCipher_Cipher_set_cipher(PureCipher_CipherObject *self, purecipher_obj_t new_cipher);
+PyObject *PureCipher_Cipher_wrap(PureCipher_ModuleState *state, purecipher_obj_t cipher_ptr);
 
 #endif //PURECIPHER_CIPHER_H
@@ -0,0 +1,534 @@
+#include "context.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <poll.h>
+#endif
+
+#include "cipher.h"
+
+/*
+ * Number of completions reaped from the context at a time.
+ */
+#define REAP_BATCH 64
+
+/*
+ * Python objects kept alive while a submission is in flight. The address of
+ * this structure is the submission's user data.
+ */
+typedef struct {
+    Py_buffer view;
+    PyObject *cipher;
+    PyObject *tag;
+} pending_t;
+
+/*
+ * Methods of PureCipher_ContextObject hold a critical section on the context
+ * object while they use its fields, so that its submissions and completions
+ * are accounted consistently when threads share a context on free-threaded
+ * builds. The helpers below expect to be called within that critical section.
+ */
+
+/*
+ * Submit the given buffer to the context, with the given tag to be returned
+ * once it has been ciphered.
+ *
+ * Returns 1 if the submission was accepted, 0 if the context is full, and -1
+ * with an exception set on error.
+ */
+static int Context_submit_pending(
+    PureCipher_ContextObject *self,
+    PyObject *cipher,
+    PyObject *buffer,
+    PyObject *tag,
+    int decipher
+) {
+    if (self->context == NULL) {
+        PyErr_SetString(PyExc_ValueError, "cipher context is closed");
+        return -1;
+    }
+    pending_t *pending = PyMem_Malloc(sizeof(pending_t));
+    if (pending == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    if (PyObject_GetBuffer(buffer, &pending->view, PyBUF_WRITABLE) < 0) {
+        PyMem_Free(pending);
+        return -1;
+    }
+
+    const purecipher_submission_t submission = {
+        ((PureCipher_CipherObject *) cipher)->cipher,
+        pending->view.buf,
+        (size_t) pending->view.len,
+        decipher,
+        (uint64_t) (uintptr_t) pending,
+        NULL,
+    };
+    if (purecipher_context_submit(self->context, &submission, 1) != 1) {
+        PyBuffer_Release(&pending->view);
+        PyMem_Free(pending);
+        return 0;
+    }
+
+    Py_INCREF(cipher);
+    pending->cipher = cipher;
+    Py_INCREF(tag);
+    pending->tag = tag;
+    self->in_flight++;
+    return 1;
+}
+
+/*
+ * Reap every completed submission, releasing its buffer and cipher.
+ *
+ * The tag of each submission is appended to the given list, or discarded if
+ * the list is NULL. Returns -1 if appending to the list failed.
+ */
+static int Context_reap_pending(PureCipher_ContextObject *self, PyObject *tags) {
+    purecipher_completion_t completions[REAP_BATCH];
+    size_t count;
+    int status = 0;
+
+    do {
+        count = purecipher_context_reap(self->context, completions, REAP_BATCH);
+        for (size_t i = 0; i < count; i++) {
+            pending_t *pending = (pending_t *) (uintptr_t) completions[i].user_data;
+            if (tags != NULL && PyList_Append(tags, pending->tag) < 0) {
+                status = -1;
+            }
+            PyBuffer_Release(&pending->view);
+            Py_DECREF(pending->cipher);
+            Py_DECREF(pending->tag);
+            PyMem_Free(pending);
+        }
+        self->in_flight -= (Py_ssize_t) count;
+    } while (count == REAP_BATCH);
+    return status;
+}
+
+/*
+ * Mark the futures in the given list as done.
+ */
+static int set_futures_done(PyObject *futures) {
+    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(futures); i++) {
+        PyObject *future = PyList_GET_ITEM(futures, i);
+        PyObject *done = PyObject_CallMethod(future, "done", NULL);
+        if (done == NULL) {
+            return -1;
+        }
+        const int is_done = PyObject_IsTrue(done);
+        Py_DECREF(done);
+        if (is_done) {
+            continue;
+        }
+        PyObject *result = PyObject_CallMethod(future, "set_result", "O", Py_None);
+        if (result == NULL) {
+            return -1;
+        }
+        Py_DECREF(result);
+    }
+    return 0;
+}
+
+/*
+ * Wait up to a millisecond for completions to be announced on the eventfd of
+ * the context, or sleep for that long on platforms without eventfds.
+ */
+static void Context_wait_briefly(PureCipher_ContextObject *self) {
+#ifdef _WIN32
+    (void) self;
+    Sleep(1);
+#else
+    struct pollfd event = {purecipher_context_eventfd(self->context), POLLIN, 0};
+    poll(&event, 1, 1);
+#endif
+}
+
+/*
+ * Wait for every submission to complete, then free the context.
+ *
+ * If futures is not NULL, the tags of the remaining submissions are appended
+ * to it.
+ */
+static int Context_drain(PureCipher_ContextObject *self, PyObject *futures) {
+    int status = 0;
+    if (self->context == NULL) {
+        return 0;
+    }
+    while (self->in_flight > 0) {
+        if (Context_reap_pending(self, futures) < 0) {
+            status = -1;
+        }
+        if (self->in_flight > 0) {
+            Py_BEGIN_ALLOW_THREADS
+            Context_wait_briefly(self);
+            Py_END_ALLOW_THREADS
+        }
+    }
+    purecipher_context_free(self->context);
+    self->context = NULL;
+    return status;
+}
+
+/*
+ * Destructor for PureCipher_ContextObject.
+ */
+static void Context_dealloc(PureCipher_ContextObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+    Context_drain(self, NULL);
+    Py_XDECREF(self->loop);
+    type->tp_free((PyObject *) self);
+    Py_DECREF(type);
+}
+
+/*
+ * Constructor for PureCipher_ContextObject.
+ */
+static PyObject *Context_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"threads", "entries", NULL};
+    Py_ssize_t threads = 0;
+    Py_ssize_t entries = 1024;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|nn", kwlist, &threads, &entries)) {
+        return NULL;
+    }
+    if (threads < 0 || entries <= 0) {
+        PyErr_SetString(PyExc_ValueError, "threads must be non-negative and entries must be positive");
+        return NULL;
+    }
+
+    PureCipher_ContextObject *self = (PureCipher_ContextObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+    self->context = purecipher_context_new((size_t) threads, (size_t) entries);
+    self->loop = NULL;
+    self->in_flight = 0;
+    return (PyObject *) self;
+}
+
+/*
+ * Return the file descriptor that becomes readable when submissions complete.
+ */
+static PyObject *Context_fileno(PureCipher_ContextObject *self, PyObject *Py_UNUSED(args)) {
+    int closed = 1;
+    int fd = -1;
+    PURECIPHER_BEGIN_CRITICAL_SECTION(self);
+    if (self->context != NULL) {
+        closed = 0;
+        fd = purecipher_context_eventfd(self->context);
+    }
+    PURECIPHER_END_CRITICAL_SECTION();
+
+    if (closed) {
+        PyErr_SetString(PyExc_ValueError, "cipher context is closed");
+        return NULL;
+    }
+    if (fd < 0) {
+        PyErr_SetString(PyExc_NotImplementedError, "eventfds are not supported on this platform");
+        return NULL;
+    }
+    return PyLong_FromLong(fd);
+}
+
+const PyDoc_STRVAR(Context_fileno_doc,
+    "fileno()"
+    "\n\n"
+    "Return a file descriptor that becomes readable when submissions have\n"
+    "completed and can be reaped. The descriptor is reset by reap(). Raises\n"
+    "NotImplementedError on platforms without eventfds.");
+
+/*
+ * Submit a buffer to be ciphered with the given tag.
+ */
+static PyObject *Context_submit(PureCipher_ContextObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"cipher", "buffer", "tag", "decipher", NULL};
+    PyObject *cipher;
+    PyObject *buffer;
+    PyObject *tag;
+    int decipher = 0;
+
+    PureCipher_ModuleState *state = PureCipher_get_state_by_type(Py_TYPE(self));
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!OO|p", kwlist,
+                                     state->CipherType, &cipher, &buffer, &tag, &decipher)) {
+        return NULL;
+    }
+    int accepted;
+    PURECIPHER_BEGIN_CRITICAL_SECTION(self);
+    accepted = Context_submit_pending(self, cipher, buffer, tag, decipher);
+    PURECIPHER_END_CRITICAL_SECTION();
+    if (accepted < 0) {
+        return NULL;
+    }
+    return PyBool_FromLong(accepted);
+}
+
+const PyDoc_STRVAR(Context_submit_doc,
+    "submit(cipher, buffer, tag, decipher=False)"
+    "\n\n"
+    "Submit a writable buffer to be enciphered, or deciphered, inplace by the\n"
+    "context's workers. The buffer must not be accessed until the given tag is\n"
+    "returned by reap(). Return False if the context is full.");
+
+/*
+ * Return a new list of the tags of the submissions that have completed.
+ */
+static PyObject *Context_reap_tags(PureCipher_ContextObject *self) {
+    if (self->context == NULL) {
+        PyErr_SetString(PyExc_ValueError, "cipher context is closed");
+        return NULL;
+    }
+    PyObject *tags = PyList_New(0);
+    if (tags == NULL) {
+        return NULL;
+    }
+    if (Context_reap_pending(self, tags) < 0) {
+        Py_DECREF(tags);
+        return NULL;
+    }
+    return tags;
+}
+
+/*
+ * Return the tags of the submissions that have completed.
+ */
+static PyObject *Context_reap(PureCipher_ContextObject *self, PyObject *Py_UNUSED(args)) {
+    PyObject *tags;
+    PURECIPHER_BEGIN_CRITICAL_SECTION(self);
+    tags = Context_reap_tags(self);
+    PURECIPHER_END_CRITICAL_SECTION();
+    return tags;
+}
+
+const PyDoc_STRVAR(Context_reap_doc,
+    "reap()"
+    "\n\n"
+    "Return a list of the tags of the submissions that have completed since\n"
+    "the last call. This method never blocks.");
+
+/*
+ * Event loop reader callback delivering completions to their futures.
+ */
+static PyObject *Context_complete_futures(PureCipher_ContextObject *self, PyObject *Py_UNUSED(args)) {
+    PyObject *futures = Context_reap(self, NULL);
+    if (futures == NULL) {
+        return NULL;
+    }
+    const int status = set_futures_done(futures);
+    Py_DECREF(futures);
+    if (status < 0) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+/*
+ * Attach the context to the running event loop, then submit a buffer and
+ * return a future for its completion.
+ */
+static PyObject *Context_attach_and_submit(
+    PureCipher_ContextObject *self,
+    PyObject *cipher,
+    PyObject *buffer,
+    int decipher
+) {
+    PyObject *future = NULL;
+
+    if (self->context == NULL) {
+        PyErr_SetString(PyExc_ValueError, "cipher context is closed");
+        return NULL;
+    }
+    if (purecipher_context_eventfd(self->context) < 0) {
+        PyErr_SetString(PyExc_NotImplementedError, "eventfds are not supported on this platform");
+        return NULL;
+    }
+
+    PyObject *asyncio = PyImport_ImportModule("asyncio");
+    if (asyncio == NULL) {
+        return NULL;
+    }
+    PyObject *loop = PyObject_CallMethod(asyncio, "get_running_loop", NULL);
+    Py_DECREF(asyncio);
+    if (loop == NULL) {
+        return NULL;
+    }
+
+    if (self->loop == NULL) {
+        /* Deliver completions from within the event loop. */
+        PyObject *callback = PyObject_GetAttrString((PyObject *) self, "_complete_futures");
+        if (callback == NULL) {
+            goto done;
+        }
+        PyObject *result = PyObject_CallMethod(
+            loop, "add_reader", "iO", purecipher_context_eventfd(self->context), callback
+        );
+        Py_DECREF(callback);
+        if (result == NULL) {
+            goto done;
+        }
+        Py_DECREF(result);
+        Py_INCREF(loop);
+        self->loop = loop;
+    } else if (self->loop != loop) {
+        PyErr_SetString(PyExc_RuntimeError, "cipher context is attached to a different event loop");
+        goto done;
+    }
+
+    future = PyObject_CallMethod(loop, "create_future", NULL);
+    if (future == NULL) {
+        goto done;
+    }
+    const int accepted = Context_submit_pending(self, cipher, buffer, future, decipher);
+    if (accepted <= 0) {
+        if (accepted == 0) {
+            PyErr_SetString(PyExc_BlockingIOError, "cipher context is full");
+        }
+        Py_CLEAR(future);
+    }
+
+done:
+    Py_DECREF(loop);
+    return future;
+}
+
+/*
+ * Submit a buffer and return an asyncio future for its completion.
+ */
+static PyObject *Context_submit_future(PureCipher_ContextObject *self, PyObject *args, int decipher) {
+    PyObject *cipher;
+    PyObject *buffer;
+    PyObject *future;
+
+    PureCipher_ModuleState *state = PureCipher_get_state_by_type(Py_TYPE(self));
+    if (!PyArg_ParseTuple(args, "O!O", state->CipherType, &cipher, &buffer)) {
+        return NULL;
+    }
+    PURECIPHER_BEGIN_CRITICAL_SECTION(self);
+    future = Context_attach_and_submit(self, cipher, buffer, decipher);
+    PURECIPHER_END_CRITICAL_SECTION();
+    return future;
+}
+
+/*
+ * Encipher a buffer asynchronously within the running event loop.
+ */
+static PyObject *Context_encipher(PureCipher_ContextObject *self, PyObject *args) {
+    return Context_submit_future(self, args, 0);
+}
+
+const PyDoc_STRVAR(Context_encipher_doc,
+    "encipher(cipher, buffer)"
+    "\n\n"
+    "Encipher a writable buffer inplace, returning an asyncio future that is\n"
+    "done once the buffer has been enciphered. Must be called from a running\n"
+    "event loop, which is used to deliver the completions of this context.\n"
+    "Raises BlockingIOError if the context is full, and NotImplementedError\n"
+    "on platforms without eventfds.");
+
+/*
+ * Decipher a buffer asynchronously within the running event loop.
+ */
+static PyObject *Context_decipher(PureCipher_ContextObject *self, PyObject *args) {
+    return Context_submit_future(self, args, 1);
+}
+
+const PyDoc_STRVAR(Context_decipher_doc,
+    "decipher(cipher, buffer)"
+    "\n\n"
+    "Decipher a writable buffer inplace, returning an asyncio future that is\n"
+    "done once the buffer has been deciphered. See encipher().");
+
+/*
+ * Detach the context from its event loop, if any, then wait for all
+ * submissions and free the context.
+ *
+ * This function returns -1 if an exception was raised, 0 otherwise.
+ */
+static int Context_detach_and_drain(PureCipher_ContextObject *self) {
+    if (self->context == NULL) {
+        return 0;
+    }
+    if (self->loop != NULL) {
+        PyObject *result = PyObject_CallMethod(
+            self->loop, "remove_reader", "i", purecipher_context_eventfd(self->context)
+        );
+        if (result == NULL) {
+            return -1;
+        }
+        Py_DECREF(result);
+    }
+
+    PyObject *futures = PyList_New(0);
+    if (futures == NULL) {
+        return -1;
+    }
+    int status = Context_drain(self, futures);
+    if (status == 0 && self->loop != NULL) {
+        status = set_futures_done(futures);
+    }
+    Py_DECREF(futures);
+    Py_CLEAR(self->loop);
+    return status;
+}
+
+/*
+ * Wait for all submissions and free the context.
+ */
+static PyObject *Context_close(PureCipher_ContextObject *self, PyObject *Py_UNUSED(args)) {
+    int status;
+    PURECIPHER_BEGIN_CRITICAL_SECTION(self);
+    status = Context_detach_and_drain(self);
+    PURECIPHER_END_CRITICAL_SECTION();
+    if (status < 0) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+const PyDoc_STRVAR(Context_close_doc,
+    "close()"
+    "\n\n"
+    "Wait for every submitted buffer to be ciphered, detach from the event\n"
+    "loop and stop the context's workers. Futures of outstanding submissions\n"
+    "are marked done.");
+
+static PyMethodDef Context_methods[] = {
+    {"fileno",            (PyCFunction) Context_fileno,           METH_NOARGS,                  Context_fileno_doc},
+    {"submit",            (PyCFunction) Context_submit,           METH_VARARGS | METH_KEYWORDS, Context_submit_doc},
+    {"reap",              (PyCFunction) Context_reap,             METH_NOARGS,                  Context_reap_doc},
+    {"encipher",          (PyCFunction) Context_encipher,         METH_VARARGS,                 Context_encipher_doc},
+    {"decipher",          (PyCFunction) Context_decipher,         METH_VARARGS,                 Context_decipher_doc},
+    {"close",             (PyCFunction) Context_close,            METH_NOARGS,                  Context_close_doc},
+    {"_complete_futures", (PyCFunction) Context_complete_futures, METH_NOARGS,                  NULL},
+    {NULL}  /* Sentinel */
+};
+
+const PyDoc_STRVAR(PureCipher_ContextObject_doc,
+    "CipherContext(threads=0, entries=1024)"
+    "\n\n"
+    "Context that ciphers buffers asynchronously on its own worker threads."
+    "\n\n"
+    "Buffers may be submitted with a tag and the tags of completed submissions\n"
+    "reaped once fileno() becomes readable, or, from within an asyncio event\n"
+    "loop, awaited through the futures returned by encipher() and decipher().\n"
+    "At most entries submissions may be in flight at once. If threads is zero,\n"
+    "one worker is started per available core. A context attached to an event\n"
+    "loop must be closed with close().");
+
+static PyType_Slot Context_slots[] = {
+    {Py_tp_doc,     (void *) PureCipher_ContextObject_doc},
+    {Py_tp_new,     Context_new},
+    {Py_tp_dealloc, Context_dealloc},
+    {Py_tp_methods, Context_methods},
+    {0, NULL}  /* Sentinel */
+};
+
+PyType_Spec PureCipher_ContextSpec = {
+    .name = "purecipher.CipherContext",
+    .basicsize = sizeof(PureCipher_ContextObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = Context_slots,
+};
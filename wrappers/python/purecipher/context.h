@@ -0,0 +1,27 @@
+#ifndef PURECIPHER_CONTEXT_H
+#define PURECIPHER_CONTEXT_H
+
+#define PY_SSIZE_T_CLEAN
+
+#include "Python.h"
+
+#include "purecipher.h"
+
+/*
+ * Python object wrapping an asynchronous cipher context.
+ */
+typedef struct {
+    PyObject_HEAD
+    purecipher_context_t *context;
+    /* Event loop whose reader delivers completions to futures, or NULL. */
+    PyObject *loop;
+    /* Number of submissions that have not yet been reaped. */
+    Py_ssize_t in_flight;
+} PureCipher_ContextObject;
+
+/*
+ * Python type specification for PureCipher_ContextObjects.
+ */
+extern PyType_Spec PureCipher_ContextSpec;
+
+#endif //PURECIPHER_CONTEXT_H
@@ -0,0 +1,56 @@
+#ifndef PURECIPHER_MODULE_H
+#define PURECIPHER_MODULE_H
+
+#define PY_SSIZE_T_CLEAN
+
+#include "Python.h"
+
+/*
+ * Per-module state of the purecipher extension module.
+ *
+ * Every type and exception object belongs to one instance of the module, so
+ * that each interpreter which imports purecipher has its own.
+ */
+typedef struct {
+    PyTypeObject *CipherType;
+    PyTypeObject *BuilderType;
+    PyTypeObject *PeriodicType;
+    PyTypeObject *ContextType;
+    PyTypeObject *SelectorType;
+    PyTypeObject *WideBuilderType;
+    PyTypeObject *WideCipherType;
+    PyTypeObject *ModelType;
+    PyTypeObject *OrderType;
+    PyTypeObject *OrderKeyType;
+    PyObject *BuilderError;
+} PureCipher_ModuleState;
+
+/*
+ * Definition of the purecipher extension module.
+ */
+extern struct PyModuleDef PureCipher_Module;
+
+/*
+ * Return the state of the given purecipher module object.
+ */
+PureCipher_ModuleState *PureCipher_get_state(PyObject *module);
+
+/*
+ * Return the state of the purecipher module that defined the given type, or
+ * one of its bases.
+ */
+PureCipher_ModuleState *PureCipher_get_state_by_type(PyTypeObject *type);
+
+/*
+ * Critical sections serialize access to mutable objects on free-threaded
+ * builds of Python 3.13 and later, and compile to nothing otherwise.
+ */
+#if PY_VERSION_HEX >= 0x030D0000
+#define PURECIPHER_BEGIN_CRITICAL_SECTION(op) Py_BEGIN_CRITICAL_SECTION(op)
+#define PURECIPHER_END_CRITICAL_SECTION() Py_END_CRITICAL_SECTION()
+#else
+#define PURECIPHER_BEGIN_CRITICAL_SECTION(op) {
+#define PURECIPHER_END_CRITICAL_SECTION() }
+#endif
+
+#endif //PURECIPHER_MODULE_H
@@ -0,0 +1,308 @@
+#include "order.h"
+
+#include "cipher.h"
+#include "module.h"
+
+/*
+ * Destructor for PureCipher_OrderObject.
+ */
+static void Order_dealloc(PureCipher_OrderObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+    purecipher_order_free(self->order);
+    type->tp_free((PyObject *) self);
+    Py_DECREF(type);
+}
+
+/*
+ * Constructor for PureCipher_OrderObject.
+ */
+static PyObject *Order_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"cipher", NULL};
+    PureCipher_ModuleState *state = PureCipher_get_state_by_type(type);
+    PyObject *cipher;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!", kwlist, state->CipherType, &cipher)) {
+        return NULL;
+    }
+    PureCipher_OrderObject *self = (PureCipher_OrderObject *) type->tp_alloc(type, 0);
+    if (self != NULL) {
+        self->order = purecipher_order_new(((PureCipher_CipherObject *) cipher)->cipher);
+    }
+    return (PyObject *) self;
+}
+
+/*
+ * Wrap the given ciphertext in a key compared in this order.
+ */
+static PyObject *Order_call(PureCipher_OrderObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"ciphertext", NULL};
+    PureCipher_ModuleState *state = PureCipher_get_state_by_type(Py_TYPE(self));
+    PyObject *ciphertext;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O", kwlist, &ciphertext)) {
+        return NULL;
+    }
+    // Keys are compared many times over, so any bytes-like object is copied
+    // once here rather than have its buffer requested on every comparison.
+    ciphertext = PyBytes_CheckExact(ciphertext) ? Py_NewRef(ciphertext) : PyBytes_FromObject(ciphertext);
+    if (ciphertext == NULL) {
+        return NULL;
+    }
+    PureCipher_OrderKeyObject *key = PyObject_New(PureCipher_OrderKeyObject, state->OrderKeyType);
+    if (key == NULL) {
+        Py_DECREF(ciphertext);
+        return NULL;
+    }
+    key->order = (PureCipher_OrderObject *) Py_NewRef(self);
+    key->ciphertext = ciphertext;
+    return (PyObject *) key;
+}
+
+/*
+ * Compare the two given ciphertexts in this order.
+ */
+static PyObject *Order_compare(PureCipher_OrderObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer left;
+    Py_buffer right;
+    int result;
+
+    if (nargs != 2) {
+        PyErr_Format(PyExc_TypeError, "compare() takes exactly two arguments (%zd given)", nargs);
+        return NULL;
+    }
+    if (PyObject_GetBuffer(args[0], &left, PyBUF_SIMPLE) < 0) {
+        return NULL;
+    }
+    if (PyObject_GetBuffer(args[1], &right, PyBUF_SIMPLE) < 0) {
+        PyBuffer_Release(&left);
+        return NULL;
+    }
+    result = purecipher_order_compare(self->order, left.buf, (size_t) left.len, right.buf, (size_t) right.len);
+    PyBuffer_Release(&left);
+    PyBuffer_Release(&right);
+    return PyLong_FromLong(result);
+}
+
+const PyDoc_STRVAR(Order_compare_doc,
+    "compare(left, right)"
+    "\n\n"
+    "Compare two bytes-like objects of ciphertext in the lexicographic order of\n"
+    "their plaintext, returning -1, 0 or 1 if the plaintext of left is less than,\n"
+    "equal to or greater than that of right.");
+
+/*
+ * Compute the sorted order of the items of the given sequence, as returned by
+ * PySequence_Fast.
+ *
+ * Returns an array of indices to be freed with PyMem_Free, or NULL if an
+ * exception was raised.
+ */
+static size_t *argsort_items(PureCipher_OrderObject *self, PyObject *items) {
+    const Py_ssize_t count = PySequence_Fast_GET_SIZE(items);
+    Py_buffer *views = PyMem_New(Py_buffer, (size_t) count);
+    const uint8_t **keys = PyMem_New(const uint8_t *, (size_t) count);
+    size_t *lengths = PyMem_New(size_t, (size_t) count);
+    size_t *indices = PyMem_New(size_t, (size_t) count + 1);
+    Py_ssize_t acquired = 0;
+
+    if (views == NULL || keys == NULL || lengths == NULL || indices == NULL) {
+        PyErr_NoMemory();
+        goto fail;
+    }
+    for (; acquired < count; acquired++) {
+        if (PyObject_GetBuffer(PySequence_Fast_GET_ITEM(items, acquired), &views[acquired], PyBUF_SIMPLE) < 0) {
+            goto fail;
+        }
+        keys[acquired] = views[acquired].buf;
+        lengths[acquired] = (size_t) views[acquired].len;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    purecipher_order_argsort(self->order, keys, lengths, (size_t) count, indices);
+    Py_END_ALLOW_THREADS
+    goto done;
+
+fail:
+    PyMem_Free(indices);
+    indices = NULL;
+done:
+    for (Py_ssize_t i = 0; i < acquired; i++) {
+        PyBuffer_Release(&views[i]);
+    }
+    PyMem_Free(views);
+    PyMem_Free(keys);
+    PyMem_Free(lengths);
+    return indices;
+}
+
+/*
+ * Return the sorted order of the given iterable of ciphertexts.
+ */
+static PyObject *Order_argsort(PureCipher_OrderObject *self, PyObject *iterable) {
+    PyObject *items = PySequence_Fast(iterable, "argsort() argument must be iterable");
+    if (items == NULL) {
+        return NULL;
+    }
+    const Py_ssize_t count = PySequence_Fast_GET_SIZE(items);
+    size_t *indices = argsort_items(self, items);
+    Py_DECREF(items);
+    if (indices == NULL) {
+        return NULL;
+    }
+    PyObject *result = PyList_New(count);
+    for (Py_ssize_t i = 0; result != NULL && i < count; i++) {
+        PyObject *index = PyLong_FromSize_t(indices[i]);
+        if (index == NULL) {
+            Py_CLEAR(result);
+            break;
+        }
+        PyList_SET_ITEM(result, i, index);
+    }
+    PyMem_Free(indices);
+    return result;
+}
+
+const PyDoc_STRVAR(Order_argsort_doc,
+    "argsort(ciphertexts)"
+    "\n\n"
+    "Return a list of the indices of the given iterable of bytes-like objects\n"
+    "in the order that sorts them by their plaintext. Equal ciphertexts keep\n"
+    "their relative order.");
+
+/*
+ * Sort the given list of ciphertexts inplace.
+ */
+static PyObject *Order_sort(PureCipher_OrderObject *self, PyObject *list) {
+    if (!PyList_Check(list)) {
+        PyErr_Format(PyExc_TypeError, "sort() argument must be a list, not %.200s", Py_TYPE(list)->tp_name);
+        return NULL;
+    }
+    // Sort a copy, so that the list may be changed by other threads while the
+    // GIL is released.
+    PyObject *items = PySequence_List(list);
+    if (items == NULL) {
+        return NULL;
+    }
+    const Py_ssize_t count = PyList_GET_SIZE(items);
+    size_t *indices = argsort_items(self, items);
+    PyObject *sorted = indices == NULL ? NULL : PyList_New(count);
+    int status = -1;
+    if (sorted != NULL) {
+        for (Py_ssize_t i = 0; i < count; i++) {
+            PyList_SET_ITEM(sorted, i, Py_NewRef(PyList_GET_ITEM(items, (Py_ssize_t) indices[i])));
+        }
+        status = PyList_SetSlice(list, 0, PY_SSIZE_T_MAX, sorted);
+        Py_DECREF(sorted);
+    }
+    PyMem_Free(indices);
+    Py_DECREF(items);
+    if (status < 0) {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+const PyDoc_STRVAR(Order_sort_doc,
+    "sort(ciphertexts)"
+    "\n\n"
+    "Sort the given list of bytes-like objects inplace by their plaintext.\n"
+    "Equal ciphertexts keep their relative order."
+    "\n\n"
+    "This is considerably faster than list.sort(key=order), as the ciphertexts\n"
+    "are sorted by radix with the GIL released.");
+
+static PyMethodDef Order_methods[] = {
+    {"compare", (PyCFunction) Order_compare, METH_FASTCALL, Order_compare_doc},
+    {"argsort", (PyCFunction) Order_argsort, METH_O, Order_argsort_doc},
+    {"sort", (PyCFunction) Order_sort, METH_O, Order_sort_doc},
+    {NULL}  /* Sentinel */
+};
+
+const PyDoc_STRVAR(PureCipher_OrderObject_doc,
+    "PlaintextOrder(cipher)"
+    "\n\n"
+    "The order of ciphertext enciphered by the given cipher by its plaintext."
+    "\n\n"
+    "Ciphertexts are compared and sorted without being deciphered. Calling an\n"
+    "order on a ciphertext returns a key that compares in this order, so an\n"
+    "order may be passed as the key function of sorted, min, max or bisect.");
+
+/*
+ * Python type slots for PureCipher_OrderObject instances.
+ */
+static PyType_Slot Order_slots[] = {
+    {Py_tp_doc,     (void *) PureCipher_OrderObject_doc},
+    {Py_tp_new,     Order_new},
+    {Py_tp_dealloc, Order_dealloc},
+    {Py_tp_call,    Order_call},
+    {Py_tp_methods, Order_methods},
+    {0, NULL}  /* Sentinel */
+};
+
+/*
+ * Python type specification for PureCipher_OrderObject instances.
+ */
+PyType_Spec PureCipher_OrderSpec = {
+    .name = "purecipher.PlaintextOrder",
+    .basicsize = sizeof(PureCipher_OrderObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = Order_slots,
+};
+
+/*
+ * Destructor for PureCipher_OrderKeyObject.
+ */
+static void OrderKey_dealloc(PureCipher_OrderKeyObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+    Py_DECREF(self->order);
+    Py_DECREF(self->ciphertext);
+    PyObject_Free(self);
+    Py_DECREF(type);
+}
+
+/*
+ * Compare two keys of the same order.
+ */
+static PyObject *OrderKey_richcompare(PureCipher_OrderKeyObject *self, PyObject *other, int op) {
+    if (Py_TYPE(other) != Py_TYPE(self)) {
+        Py_RETURN_NOTIMPLEMENTED;
+    }
+    PureCipher_OrderKeyObject *other_key = (PureCipher_OrderKeyObject *) other;
+    if (other_key->order != self->order) {
+        PyErr_SetString(PyExc_TypeError, "cannot compare keys of different plaintext orders");
+        return NULL;
+    }
+    const int result = purecipher_order_compare(
+        self->order->order,
+        (const uint8_t *) PyBytes_AS_STRING(self->ciphertext),
+        (size_t) PyBytes_GET_SIZE(self->ciphertext),
+        (const uint8_t *) PyBytes_AS_STRING(other_key->ciphertext),
+        (size_t) PyBytes_GET_SIZE(other_key->ciphertext)
+    );
+    Py_RETURN_RICHCOMPARE(result, 0, op);
+}
+
+const PyDoc_STRVAR(PureCipher_OrderKeyObject_doc,
+    "Ciphertext that compares with keys of the same PlaintextOrder by its\n"
+    "plaintext, as returned by calling the order.");
+
+/*
+ * Python type slots for PureCipher_OrderKeyObject instances.
+ */
+static PyType_Slot OrderKey_slots[] = {
+    {Py_tp_doc,         (void *) PureCipher_OrderKeyObject_doc},
+    {Py_tp_dealloc,     OrderKey_dealloc},
+    {Py_tp_richcompare, OrderKey_richcompare},
+    {0, NULL}  /* Sentinel */
+};
+
+/*
+ * Python type specification for PureCipher_OrderKeyObject instances.
+ */
+PyType_Spec PureCipher_OrderKeySpec = {
+    .name = "purecipher.PlaintextKey",
+    .basicsize = sizeof(PureCipher_OrderKeyObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE | Py_TPFLAGS_DISALLOW_INSTANTIATION,
+    .slots = OrderKey_slots,
+};
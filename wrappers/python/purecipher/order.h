@@ -0,0 +1,38 @@
+#ifndef PURECIPHER_ORDER_H
+#define PURECIPHER_ORDER_H
+
+#define PY_SSIZE_T_CLEAN
+
+#include "Python.h"
+
+#include "purecipher.h"
+
+/*
+ * Python object wrapping a plaintext order pointer.
+ */
+typedef struct {
+    PyObject_HEAD
+    purecipher_order_t *order;
+} PureCipher_OrderObject;
+
+/*
+ * Python object pairing a ciphertext with the order it is compared in, as
+ * returned when calling a PureCipher_OrderObject.
+ */
+typedef struct {
+    PyObject_HEAD
+    PureCipher_OrderObject *order;
+    PyObject *ciphertext;
+} PureCipher_OrderKeyObject;
+
+/*
+ * Python type specification for PureCipher_OrderObjects.
+ */
+extern PyType_Spec PureCipher_OrderSpec;
+
+/*
+ * Python type specification for PureCipher_OrderKeyObjects.
+ */
+extern PyType_Spec PureCipher_OrderKeySpec;
+
+#endif //PURECIPHER_ORDER_H
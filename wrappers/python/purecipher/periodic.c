@@ -0,0 +1,177 @@
+#include "periodic.h"
+
+#include "cipher.h"
+
+/*
+ * Destructor for PureCipher_PeriodicObject.
+ */
+static void Periodic_dealloc(PureCipher_PeriodicObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+    purecipher_periodic_free(self->periodic);
+    type->tp_free((PyObject *) self);
+    Py_DECREF(type);
+}
+
+/*
+ * Build a periodic cipher from a sequence of PureCipher_CipherObjects.
+ */
+static purecipher_periodic_t *periodic_from_ciphers(PureCipher_ModuleState *state, PyObject *cipher_seq) {
+    purecipher_periodic_t *periodic = NULL;
+
+    cipher_seq = PySequence_Fast(cipher_seq, "key must be a bytes-like object or a sequence of ciphers");
+    if (cipher_seq == NULL) {
+        return NULL;
+    }
+    const Py_ssize_t period = PySequence_Fast_GET_SIZE(cipher_seq);
+    purecipher_obj_t *ciphers = PyMem_New(purecipher_obj_t, (size_t) period);
+    if (ciphers == NULL) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (Py_ssize_t i = 0; i < period; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(cipher_seq, i);
+        if (!PyObject_TypeCheck(item, state->CipherType)) {
+            PyErr_SetString(PyExc_TypeError, "key must be a bytes-like object or a sequence of ciphers");
+            goto done;
+        }
+        ciphers[i] = ((PureCipher_CipherObject *) item)->cipher;
+    }
+    periodic = purecipher_periodic_new(ciphers, (size_t) period);
+
+done:
+    PyMem_Free(ciphers);
+    Py_DECREF(cipher_seq);
+    return periodic;
+}
+
+/*
+ * Constructor for PureCipher_PeriodicObject.
+ */
+static PyObject *Periodic_new(PyTypeObject *type, PyObject *args, PyObject *Py_UNUSED(kwds)) {
+    PyObject *key;
+    purecipher_periodic_t *periodic;
+
+    if (!PyArg_ParseTuple(args, "O", &key)) {
+        return NULL;
+    }
+
+    if (PyObject_CheckBuffer(key)) {
+        Py_buffer shifts;
+        if (PyObject_GetBuffer(key, &shifts, PyBUF_SIMPLE) < 0) {
+            return NULL;
+        }
+        periodic = purecipher_periodic_new_shifts(shifts.buf, (size_t) shifts.len);
+        PyBuffer_Release(&shifts);
+    } else {
+        periodic = periodic_from_ciphers(PureCipher_get_state_by_type(type), key);
+        if (periodic == NULL && PyErr_Occurred()) {
+            return NULL;
+        }
+    }
+    if (periodic == NULL) {
+        PyErr_SetString(PyExc_ValueError, "key must not be empty");
+        return NULL;
+    }
+
+    PureCipher_PeriodicObject *self = (PureCipher_PeriodicObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        purecipher_periodic_free(periodic);
+        return NULL;
+    }
+    self->periodic = periodic;
+    return (PyObject *) self;
+}
+
+/*
+ * Return the period of this cipher.
+ */
+static PyObject *Periodic_period(PureCipher_PeriodicObject *self, PyObject *Py_UNUSED(args)) {
+    return PyLong_FromSize_t(purecipher_periodic_period(self->periodic));
+}
+
+const PyDoc_STRVAR(Periodic_period_doc,
+    "period()"
+    "\n\n"
+    "Return the number of positions after which this cipher's substitutions repeat.");
+
+/*
+ * Encipher the given PyByteArrayObject inplace.
+ */
+static PyObject *Periodic_encipher_buffer(PureCipher_PeriodicObject *self, PyObject *args) {
+    PyByteArrayObject *buffer_object;
+    unsigned long long offset = 0;
+
+    if (!PyArg_ParseTuple(args, "Y|K", &buffer_object, &offset)) {
+        return NULL;
+    }
+    uint8_t *data_buffer = (uint8_t *) PyByteArray_AsString((PyObject *) buffer_object);
+    const Py_ssize_t len = PyByteArray_Size((PyObject *) buffer_object);
+
+    purecipher_periodic_encipher(self->periodic, data_buffer, (size_t) len, (uint64_t) offset);
+    Py_RETURN_NONE;
+}
+
+const PyDoc_STRVAR(Periodic_encipher_buffer_doc,
+    "encipher_buffer(bytearray, offset=0)"
+    "\n\n"
+    "Encipher the given mutable bytearray inplace with this cipher, where offset\n"
+    "is the stream position of the first byte of the bytearray.");
+
+/*
+ * Decipher the given PyByteArrayObject inplace.
+ */
+static PyObject *Periodic_decipher_buffer(PureCipher_PeriodicObject *self, PyObject *args) {
+    PyByteArrayObject *buffer_object;
+    unsigned long long offset = 0;
+
+    if (!PyArg_ParseTuple(args, "Y|K", &buffer_object, &offset)) {
+        return NULL;
+    }
+    uint8_t *data_buffer = (uint8_t *) PyByteArray_AsString((PyObject *) buffer_object);
+    const Py_ssize_t len = PyByteArray_Size((PyObject *) buffer_object);
+
+    purecipher_periodic_decipher(self->periodic, data_buffer, (size_t) len, (uint64_t) offset);
+    Py_RETURN_NONE;
+}
+
+const PyDoc_STRVAR(Periodic_decipher_buffer_doc,
+    "decipher_buffer(bytearray, offset=0)"
+    "\n\n"
+    "Decipher the given mutable bytearray inplace with this cipher, where offset\n"
+    "is the stream position of the first byte of the bytearray.");
+
+static PyMethodDef Periodic_methods[] = {
+    {"period",          (PyCFunction) Periodic_period,          METH_NOARGS,  Periodic_period_doc},
+    {"encipher_buffer", (PyCFunction) Periodic_encipher_buffer, METH_VARARGS, Periodic_encipher_buffer_doc},
+    {"decipher_buffer", (PyCFunction) Periodic_decipher_buffer, METH_VARARGS, Periodic_decipher_buffer_doc},
+    {NULL}  /* Sentinel */
+};
+
+const PyDoc_STRVAR(PureCipher_PeriodicObject_doc,
+    "PeriodicCipher(key)"
+    "\n\n"
+    "Polyalphabetic cipher that selects a substitution by stream position."
+    "\n\n"
+    "If key is a bytes-like object, the cipher adds key[i % len(key)] modulo 256\n"
+    "to the byte at stream position i, as in a byte-wise Vigenere cipher. If key\n"
+    "is a sequence of ciphers, the byte at stream position i is ciphered with\n"
+    "key[i % len(key)]."
+    "\n\n"
+    "Ciphering is stateless: each call is given the stream position of its first\n"
+    "byte, so chunks of a stream can be ciphered independently.");
+
+static PyType_Slot Periodic_slots[] = {
+    {Py_tp_doc,     (void *) PureCipher_PeriodicObject_doc},
+    {Py_tp_new,     Periodic_new},
+    {Py_tp_dealloc, Periodic_dealloc},
+    {Py_tp_methods, Periodic_methods},
+    {0, NULL}  /* Sentinel */
+};
+
+PyType_Spec PureCipher_PeriodicSpec = {
+    .name = "purecipher.PeriodicCipher",
+    .basicsize = sizeof(PureCipher_PeriodicObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = Periodic_slots,
+};
@@ -0,0 +1,23 @@
+#ifndef PURECIPHER_PERIODIC_H
+#define PURECIPHER_PERIODIC_H
+
+#define PY_SSIZE_T_CLEAN
+
+#include "Python.h"
+
+#include "purecipher.h"
+
+/*
+ * Python object wrapping a periodic cipher pointer.
+ */
+typedef struct {
+    PyObject_HEAD
+    purecipher_periodic_t *periodic;
+} PureCipher_PeriodicObject;
+
+/*
+ * Python type specification for PureCipher_PeriodicObjects.
+ */
+extern PyType_Spec PureCipher_PeriodicSpec;
+
+#endif //PURECIPHER_PERIODIC_H
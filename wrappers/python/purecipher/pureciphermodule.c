@@ -2,16 +2,20 @@
 
 #include "builder.h"
 #include "cipher.h"
+#include "context.h"
+#include "module.h"
+#include "order.h"
+#include "periodic.h"
+#include "selector.h"
+#include "solver.h"
+#include "stats.h"
+#include "wide.h"
 
 /*
  * Build an owned PureCipher_CipherObject for caesar cipher encoding.
  */
-static PyObject *make_cipher_caesar(PyObject *Py_UNUSED(self), PyObject *Py_UNUSED(args)) {
-    PyObject *cipher = PyObject_CallObject((PyObject *) &PureCipher_CipherType, NULL);
-    if (cipher != NULL) {
-        PureCipher_Cipher_set_cipher((PureCipher_CipherObject *) cipher, purecipher_cipher_caesar());
-    }
-    return cipher;
+static PyObject *make_cipher_caesar(PyObject *self, PyObject *Py_UNUSED(args)) {
+    return PureCipher_Cipher_wrap(PureCipher_get_state(self), purecipher_cipher_caesar());
 }
 
 const PyDoc_STRVAR(make_cipher_caesar_doc,
@@ -20,12 +24,8 @@ const PyDoc_STRVAR(make_cipher_caesar_doc,
 /*
  * Build an owned PureCipher_CipherObject for rot13 encoding.
  */
-static PyObject *make_cipher_rot13(PyObject *Py_UNUSED(self), PyObject *Py_UNUSED(args)) {
-    PyObject *cipher = PyObject_CallObject((PyObject *) &PureCipher_CipherType, NULL);
-    if (cipher != NULL) {
-        PureCipher_Cipher_set_cipher((PureCipher_CipherObject *) cipher, purecipher_cipher_rot13());
-    }
-    return cipher;
+static PyObject *make_cipher_rot13(PyObject *self, PyObject *Py_UNUSED(args)) {
+    return PureCipher_Cipher_wrap(PureCipher_get_state(self), purecipher_cipher_rot13());
 }
 
 const PyDoc_STRVAR(make_cipher_rot13_doc,
@@ -34,17 +34,361 @@ const PyDoc_STRVAR(make_cipher_rot13_doc,
 /*
  * Build an owned PureCipher_CipherObject for "leet speak" encoding.
  */
-static PyObject *make_cipher_leet(PyObject *Py_UNUSED(self), PyObject *Py_UNUSED(args)) {
-    PyObject *cipher = PyObject_CallObject((PyObject *) &PureCipher_CipherType, NULL);
-    if (cipher != NULL) {
-        PureCipher_Cipher_set_cipher((PureCipher_CipherObject *) cipher, purecipher_cipher_leet());
-    }
-    return cipher;
+static PyObject *make_cipher_leet(PyObject *self, PyObject *Py_UNUSED(args)) {
+    return PureCipher_Cipher_wrap(PureCipher_get_state(self), purecipher_cipher_leet());
 }
 
 const PyDoc_STRVAR(make_cipher_leet_doc,
     "leet()\n\nReturn a rough pure cipher for stereotypical \"leet\" speak.");
 
+/*
+ * Build an owned PureCipher_CipherObject for an affine cipher over GF(2).
+ */
+static PyObject *make_cipher_affine(PyObject *self, PyObject *args) {
+    Py_buffer rows;
+    unsigned char constant = 0;
+    if (!PyArg_ParseTuple(args, "y*|b", &rows, &constant)) {
+        return NULL;
+    }
+    if (rows.len != 8) {
+        PyBuffer_Release(&rows);
+        PyErr_SetString(PyExc_ValueError, "rows must hold exactly 8 bytes");
+        return NULL;
+    }
+    const purecipher_obj_t cipher_ptr = purecipher_cipher_affine((const uint8_t *) rows.buf, constant);
+    PyBuffer_Release(&rows);
+    if (cipher_ptr._data == NULL) {
+        PyErr_SetString(PyExc_ValueError, "rows must form an invertible matrix");
+        return NULL;
+    }
+    return PureCipher_Cipher_wrap(PureCipher_get_state(self), cipher_ptr);
+}
+
+const PyDoc_STRVAR(make_cipher_affine_doc,
+    "affine(rows, constant=0)"
+    "\n\n"
+    "Return a pure cipher that enciphers each byte x as Ax + constant over GF(2),\n"
+    "where bit k of rows[i] is the entry of the 8x8 bit matrix A in row i and\n"
+    "column k. rows is a bytes-like object of length 8."
+    "\n\n"
+    "Raises ValueError if A is not invertible.");
+
+/*
+ * Build an owned PureCipher_CipherObject from a 256-byte lookup table.
+ */
+static PyObject *make_cipher_from_table(PyObject *self, PyObject *args) {
+    Py_buffer map;
+    if (!PyArg_ParseTuple(args, "y*", &map)) {
+        return NULL;
+    }
+    if (map.len != 256) {
+        PyBuffer_Release(&map);
+        PyErr_SetString(PyExc_ValueError, "table must hold exactly 256 bytes");
+        return NULL;
+    }
+    const purecipher_obj_t cipher_ptr = purecipher_cipher_from_table((const uint8_t *) map.buf);
+    PyBuffer_Release(&map);
+    if (cipher_ptr._data == NULL) {
+        PyErr_SetString(PyExc_ValueError, "table must be a permutation of all 256 bytes");
+        return NULL;
+    }
+    return PureCipher_Cipher_wrap(PureCipher_get_state(self), cipher_ptr);
+}
+
+const PyDoc_STRVAR(make_cipher_from_table_doc,
+    "from_table(table)"
+    "\n\n"
+    "Return a pure cipher that enciphers each byte b as table[b], where table is\n"
+    "a bytes-like object of length 256, as returned by Cipher.table(). The table\n"
+    "is copied."
+    "\n\n"
+    "Raises ValueError if table is not a permutation of all 256 bytes.");
+
+/*
+ * Build a PureCipher_CipherObject that ciphers through lookup tables in a
+ * buffer it does not copy, such as shared memory.
+ */
+static PyObject *make_cipher_shared(PyObject *self, PyObject *args) {
+    Py_buffer tables;
+    if (!PyArg_ParseTuple(args, "y*", &tables)) {
+        return NULL;
+    }
+    if (tables.len != PURECIPHER_SHARED_TABLES_LEN) {
+        PyBuffer_Release(&tables);
+        PyErr_Format(PyExc_ValueError, "tables must hold exactly %d bytes", PURECIPHER_SHARED_TABLES_LEN);
+        return NULL;
+    }
+    const purecipher_obj_t cipher_ptr = purecipher_cipher_shared((const uint8_t *) tables.buf);
+    if (cipher_ptr._data == NULL) {
+        PyBuffer_Release(&tables);
+        PyErr_SetString(PyExc_ValueError, "tables were not written by Cipher.write_shared()");
+        return NULL;
+    }
+    PyObject *cipher = PureCipher_Cipher_wrap(PureCipher_get_state(self), cipher_ptr);
+    if (cipher == NULL) {
+        PyBuffer_Release(&tables);
+        return NULL;
+    }
+    /* The cipher holds the buffer, and so keeps its memory mapped, until it is destroyed. */
+    ((PureCipher_CipherObject *) cipher)->shared = tables;
+    return cipher;
+}
+
+const PyDoc_STRVAR(make_cipher_shared_doc,
+    "from_shared(buffer)"
+    "\n\n"
+    "Return a pure cipher that looks bytes up in the tables written to the given\n"
+    "buffer by Cipher.write_shared(), without copying them."
+    "\n\n"
+    "When buffer is a slice of the buf of a multiprocessing.shared_memory.\n"
+    "SharedMemory, the ciphers built from it in any number of processes share\n"
+    "one physical copy of the tables. The cipher holds the buffer until it is\n"
+    "destroyed, so the shared memory cannot be closed while the cipher lives.\n"
+    "The tables must not be modified while any cipher uses them."
+    "\n\n"
+    "Raises ValueError if buffer does not hold exactly SHARED_TABLES_LEN bytes of\n"
+    "valid tables.");
+
+/*
+ * Shared implementation of the module-level batch ciphering functions.
+ *
+ * Parses a sequence of ciphers, a bytearray arena and a sequence of offsets,
+ * validates them, and passes them to the given purecipher batch function.
+ */
+static PyObject *cipher_batch(PyObject *module, PyObject *args, void (*batch_fn)(const purecipher_obj_t *, uint8_t *, const size_t *, size_t)) {
+    PyObject *cipher_seq;
+    PyByteArrayObject *arena_object;
+    PyObject *offset_seq;
+    PyObject *result = NULL;
+    purecipher_obj_t *ciphers = NULL;
+    size_t *offsets = NULL;
+
+    if (!PyArg_ParseTuple(args, "OYO", &cipher_seq, &arena_object, &offset_seq)) {
+        return NULL;
+    }
+    cipher_seq = PySequence_Fast(cipher_seq, "ciphers must be a sequence");
+    if (cipher_seq == NULL) {
+        return NULL;
+    }
+    offset_seq = PySequence_Fast(offset_seq, "offsets must be a sequence");
+    if (offset_seq == NULL) {
+        Py_DECREF(cipher_seq);
+        return NULL;
+    }
+
+    const Py_ssize_t count = PySequence_Fast_GET_SIZE(cipher_seq);
+    const size_t arena_len = (size_t) PyByteArray_Size((PyObject *) arena_object);
+    if (PySequence_Fast_GET_SIZE(offset_seq) != count + 1) {
+        PyErr_SetString(PyExc_ValueError, "offsets must contain exactly one more entry than ciphers");
+        goto done;
+    }
+
+    ciphers = PyMem_New(purecipher_obj_t, (size_t) count);
+    offsets = PyMem_New(size_t, (size_t) count + 1);
+    if (ciphers == NULL || offsets == NULL) {
+        PyErr_NoMemory();
+        goto done;
+    }
+
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(cipher_seq, i);
+        if (!PyObject_TypeCheck(item, PureCipher_get_state(module)->CipherType)) {
+            PyErr_SetString(PyExc_TypeError, "ciphers must only contain purecipher.Cipher objects");
+            goto done;
+        }
+        ciphers[i] = ((PureCipher_CipherObject *) item)->cipher;
+    }
+    for (Py_ssize_t i = 0; i <= count; i++) {
+        offsets[i] = PyLong_AsSize_t(PySequence_Fast_GET_ITEM(offset_seq, i));
+        if (PyErr_Occurred()) {
+            goto done;
+        }
+        if ((i > 0 && offsets[i] < offsets[i - 1]) || offsets[i] > arena_len) {
+            PyErr_SetString(PyExc_ValueError, "offsets must be ascending and within the buffer");
+            goto done;
+        }
+    }
+
+    batch_fn(ciphers, (uint8_t *) PyByteArray_AsString((PyObject *) arena_object), offsets, (size_t) count);
+    result = Py_None;
+    Py_INCREF(result);
+
+done:
+    PyMem_Free(ciphers);
+    PyMem_Free(offsets);
+    Py_DECREF(cipher_seq);
+    Py_DECREF(offset_seq);
+    return result;
+}
+
+/*
+ * Encipher a batch of records in a bytearray, each with its own cipher.
+ */
+static PyObject *encipher_batch(PyObject *self, PyObject *args) {
+    return cipher_batch(self, args, purecipher_encipher_batch);
+}
+
+const PyDoc_STRVAR(encipher_batch_doc,
+    "encipher_batch(ciphers, bytearray, offsets)"
+    "\n\n"
+    "Encipher a batch of records stored in a single bytearray inplace, each with\n"
+    "its own cipher."
+    "\n\n"
+    "Record i spans bytearray[offsets[i]:offsets[i + 1]] and is enciphered with\n"
+    "ciphers[i], so offsets must contain one more entry than ciphers. Records\n"
+    "sharing a cipher are processed together.");
+
+/*
+ * Decipher a batch of records in a bytearray, each with its own cipher.
+ */
+static PyObject *decipher_batch(PyObject *self, PyObject *args) {
+    return cipher_batch(self, args, purecipher_decipher_batch);
+}
+
+const PyDoc_STRVAR(decipher_batch_doc,
+    "decipher_batch(ciphers, bytearray, offsets)"
+    "\n\n"
+    "Decipher a batch of records stored in a single bytearray inplace, each with\n"
+    "its own cipher."
+    "\n\n"
+    "See encipher_batch() for a description of the arguments.");
+
+/*
+ * Count the occurrences of each byte value in a bytes-like object.
+ */
+static PyObject *histogram(PyObject *Py_UNUSED(self), PyObject *args) {
+    Py_buffer data;
+    uint64_t counts[256];
+
+    if (!PyArg_ParseTuple(args, "y*", &data)) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    purecipher_histogram(data.buf, (size_t) data.len, counts);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&data);
+
+    return PureCipher_histogram_to_list(counts);
+}
+
+const PyDoc_STRVAR(histogram_doc,
+    "histogram(data)"
+    "\n\n"
+    "Return a list of 256 integers counting the occurrences of each byte value\n"
+    "in the given bytes-like object.");
+
+/*
+ * Compute the CRC32C of a bytes-like object.
+ */
+static PyObject *crc32c(PyObject *Py_UNUSED(self), PyObject *args) {
+    Py_buffer data;
+    unsigned int crc = 0;
+
+    if (!PyArg_ParseTuple(args, "y*|I", &data, &crc)) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    crc = purecipher_crc32c(crc, data.buf, (size_t) data.len);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&data);
+
+    return PyLong_FromUnsignedLong(crc);
+}
+
+const PyDoc_STRVAR(crc32c_doc,
+    "crc32c(data, crc=0)"
+    "\n\n"
+    "Return the CRC32C (Castagnoli) checksum of the given bytes-like object,\n"
+    "continuing from the checksum crc of the data that preceded it, like\n"
+    "zlib.crc32().");
+
+/*
+ * Combine the CRC32Cs of two consecutive runs of bytes.
+ */
+static PyObject *crc32c_combine(PyObject *Py_UNUSED(self), PyObject *args) {
+    unsigned int crc1;
+    unsigned int crc2;
+    unsigned long long length2;
+
+    if (!PyArg_ParseTuple(args, "IIK", &crc1, &crc2, &length2)) {
+        return NULL;
+    }
+    return PyLong_FromUnsignedLong(purecipher_crc32c_combine(crc1, crc2, length2));
+}
+
+const PyDoc_STRVAR(crc32c_combine_doc,
+    "crc32c_combine(crc1, crc2, length2)"
+    "\n\n"
+    "Combine the CRC32C crc1 of some data with the CRC32C crc2 of the length2\n"
+    "bytes that follow it into the CRC32C of both, so that chunks of data may be\n"
+    "checksummed separately, such as by different processes.");
+
+/*
+ * Compute the Shannon entropy of a sequence of byte counts.
+ */
+static PyObject *entropy(PyObject *Py_UNUSED(self), PyObject *args) {
+    PyObject *count_seq;
+    uint64_t counts[256];
+
+    if (!PyArg_ParseTuple(args, "O", &count_seq)) {
+        return NULL;
+    }
+    if (PureCipher_histogram_from_sequence(count_seq, counts) < 0) {
+        return NULL;
+    }
+    return PyFloat_FromDouble(purecipher_histogram_entropy(counts));
+}
+
+const PyDoc_STRVAR(entropy_doc,
+    "entropy(counts)"
+    "\n\n"
+    "Return the Shannon entropy, in bits per byte, of the given sequence of 256\n"
+    "byte counts, as returned by histogram().");
+
+/*
+ * Compute the chi-square statistic of byte counts against a reference distribution.
+ */
+static PyObject *chi_square(PyObject *Py_UNUSED(self), PyObject *args) {
+    PyObject *count_seq;
+    PyObject *expected_seq;
+    uint64_t counts[256];
+    double expected[256];
+
+    if (!PyArg_ParseTuple(args, "OO", &count_seq, &expected_seq)) {
+        return NULL;
+    }
+    if (PureCipher_histogram_from_sequence(count_seq, counts) < 0) {
+        return NULL;
+    }
+    expected_seq = PySequence_Fast(expected_seq, "expected must be a sequence");
+    if (expected_seq == NULL) {
+        return NULL;
+    }
+    if (PySequence_Fast_GET_SIZE(expected_seq) != 256) {
+        PyErr_SetString(PyExc_ValueError, "expected must contain exactly 256 entries");
+        Py_DECREF(expected_seq);
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < 256; i++) {
+        expected[i] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(expected_seq, i));
+        if (PyErr_Occurred()) {
+            Py_DECREF(expected_seq);
+            return NULL;
+        }
+    }
+    Py_DECREF(expected_seq);
+    return PyFloat_FromDouble(purecipher_histogram_chi_square(counts, expected));
+}
+
+const PyDoc_STRVAR(chi_square_doc,
+    "chi_square(counts, expected)"
+    "\n\n"
+    "Return Pearson's chi-square statistic of the given 256 byte counts against\n"
+    "a reference distribution."
+    "\n\n"
+    "The expected sequence holds the relative frequency of each of the 256 byte\n"
+    "values and is normalized before use.");
+
 /* Module docstring. */
 const PyDoc_STRVAR(PureCipher_Docstring, "Python bindings to the Rust purecipher crate.");
 
@@ -53,53 +397,183 @@ static PyMethodDef PureCipher_Methods[] = {
     {"caesar", make_cipher_caesar, METH_NOARGS, make_cipher_caesar_doc},
     {"rot13",  make_cipher_rot13,  METH_NOARGS, make_cipher_rot13_doc},
     {"leet",   make_cipher_leet,   METH_NOARGS, make_cipher_leet_doc},
+    {"affine", make_cipher_affine, METH_VARARGS, make_cipher_affine_doc},
+    {"from_table",  make_cipher_from_table, METH_VARARGS, make_cipher_from_table_doc},
+    {"from_shared", make_cipher_shared,     METH_VARARGS, make_cipher_shared_doc},
+    {"encipher_batch", encipher_batch, METH_VARARGS, encipher_batch_doc},
+    {"decipher_batch", decipher_batch, METH_VARARGS, decipher_batch_doc},
+    {"histogram",      histogram,      METH_VARARGS, histogram_doc},
+    {"entropy",        entropy,        METH_VARARGS, entropy_doc},
+    {"chi_square",     chi_square,     METH_VARARGS, chi_square_doc},
+    {"crc32c",         crc32c,         METH_VARARGS, crc32c_doc},
+    {"crc32c_combine", crc32c_combine, METH_VARARGS, crc32c_combine_doc},
     {NULL, NULL, 0, NULL},  /* Sentinel */
 };
 
-/* Module definition. */
-static struct PyModuleDef PureCipher_Module = {
-    PyModuleDef_HEAD_INIT,
-    "purecipher",
-    PureCipher_Docstring,
-    -1, /* keep state in global variables. */
-    PureCipher_Methods,
-};
+PureCipher_ModuleState *PureCipher_get_state(PyObject *module) {
+    return (PureCipher_ModuleState *) PyModule_GetState(module);
+}
 
-PyMODINIT_FUNC
-PyInit_purecipher(void) {
-    PyObject *module;
+PureCipher_ModuleState *PureCipher_get_state_by_type(PyTypeObject *type) {
+    return PureCipher_get_state(PyType_GetModuleByDef(type, &PureCipher_Module));
+}
 
-    /* Finalize type objects. */
-    if (PyType_Ready(&PureCipher_CipherType) < 0) {
+/*
+ * Create a type from the given specification, owned by the given module, and
+ * add it to the module under its unqualified name.
+ *
+ * Returns a new reference to the type, or NULL if an exception was raised.
+ */
+static PyTypeObject *add_type(PyObject *module, PyType_Spec *spec) {
+    PyObject *type = PyType_FromModuleAndSpec(module, spec, NULL);
+    if (type == NULL) {
         return NULL;
     }
-    if (PyType_Ready(&PureCipher_BuilderType) < 0) {
+    if (PyModule_AddType(module, (PyTypeObject *) type) < 0) {
+        Py_DECREF(type);
         return NULL;
     }
+    return (PyTypeObject *) type;
+}
 
-    /* Create the module. */
-    module = PyModule_Create(&PureCipher_Module);
-    if (module == NULL) {
-        return NULL;
+/*
+ * Populate a new instance of the module with its types and exception.
+ */
+static int PureCipher_exec(PyObject *module) {
+    PureCipher_ModuleState *state = PureCipher_get_state(module);
+
+    state->CipherType = add_type(module, &PureCipher_CipherSpec);
+    if (state->CipherType == NULL) {
+        return -1;
+    }
+    state->BuilderType = add_type(module, &PureCipher_BuilderSpec);
+    if (state->BuilderType == NULL) {
+        return -1;
+    }
+    state->PeriodicType = add_type(module, &PureCipher_PeriodicSpec);
+    if (state->PeriodicType == NULL) {
+        return -1;
+    }
+    state->ContextType = add_type(module, &PureCipher_ContextSpec);
+    if (state->ContextType == NULL) {
+        return -1;
+    }
+    state->SelectorType = add_type(module, &PureCipher_SelectorSpec);
+    if (state->SelectorType == NULL) {
+        return -1;
+    }
+    state->WideBuilderType = add_type(module, &PureCipher_WideBuilderSpec);
+    if (state->WideBuilderType == NULL) {
+        return -1;
+    }
+    state->WideCipherType = add_type(module, &PureCipher_WideCipherSpec);
+    if (state->WideCipherType == NULL) {
+        return -1;
+    }
+    state->ModelType = add_type(module, &PureCipher_ModelSpec);
+    if (state->ModelType == NULL) {
+        return -1;
+    }
+    state->OrderType = add_type(module, &PureCipher_OrderSpec);
+    if (state->OrderType == NULL) {
+        return -1;
+    }
+    state->OrderKeyType = add_type(module, &PureCipher_OrderKeySpec);
+    if (state->OrderKeyType == NULL) {
+        return -1;
+    }
+
+    if (PyModule_AddIntConstant(module, "SHARED_TABLES_LEN", PURECIPHER_SHARED_TABLES_LEN) < 0) {
+        return -1;
     }
 
     /* Exception type initialization */
-    PureCipher_BuilderError = PyErr_NewExceptionWithDoc(
+    state->BuilderError = PyErr_NewExceptionWithDoc(
         "purecipher.BuilderError",
         PyDoc_STR("Python Exception type raised for errors in SubstitutionBuilder instances."),
         NULL,
         NULL
     );
+    if (state->BuilderError == NULL) {
+        return -1;
+    }
+    return PyModule_AddObjectRef(module, "BuilderError", state->BuilderError);
+}
+
+/*
+ * Visit the objects referenced by the module state.
+ */
+static int PureCipher_traverse(PyObject *module, visitproc visit, void *arg) {
+    PureCipher_ModuleState *state = PureCipher_get_state(module);
+    Py_VISIT(state->CipherType);
+    Py_VISIT(state->BuilderType);
+    Py_VISIT(state->PeriodicType);
+    Py_VISIT(state->ContextType);
+    Py_VISIT(state->SelectorType);
+    Py_VISIT(state->WideBuilderType);
+    Py_VISIT(state->WideCipherType);
+    Py_VISIT(state->ModelType);
+    Py_VISIT(state->OrderType);
+    Py_VISIT(state->OrderKeyType);
+    Py_VISIT(state->BuilderError);
+    return 0;
+}
+
+/*
+ * Release the objects referenced by the module state.
+ */
+static int PureCipher_clear(PyObject *module) {
+    PureCipher_ModuleState *state = PureCipher_get_state(module);
+    Py_CLEAR(state->CipherType);
+    Py_CLEAR(state->BuilderType);
+    Py_CLEAR(state->PeriodicType);
+    Py_CLEAR(state->ContextType);
+    Py_CLEAR(state->SelectorType);
+    Py_CLEAR(state->WideBuilderType);
+    Py_CLEAR(state->WideCipherType);
+    Py_CLEAR(state->ModelType);
+    Py_CLEAR(state->OrderType);
+    Py_CLEAR(state->OrderKeyType);
+    Py_CLEAR(state->BuilderError);
+    return 0;
+}
 
-    /*  Add objects to module */
-    Py_INCREF(&PureCipher_CipherType);
-    PyModule_AddObject(module, "Cipher", (PyObject *) &PureCipher_CipherType);
+static void PureCipher_free(void *module) {
+    PureCipher_clear((PyObject *) module);
+}
 
-    Py_INCREF(&PureCipher_BuilderType);
-    PyModule_AddObject(module, "SubstitutionBuilder", (PyObject *) &PureCipher_BuilderType);
+/*
+ * Module slots.
+ *
+ * All state lives in the module object and the native library is reentrant,
+ * so the module may be imported by interpreters with their own GIL and, on
+ * free-threaded builds, run without the GIL.
+ */
+static PyModuleDef_Slot PureCipher_Slots[] = {
+    {Py_mod_exec, PureCipher_exec},
+#if PY_VERSION_HEX >= 0x030C0000
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+    {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+    {0, NULL},  /* Sentinel */
+};
 
-    Py_INCREF(PureCipher_BuilderError);
-    PyModule_AddObject(module, "BuilderError", PureCipher_BuilderError);
+/* Module definition. */
+struct PyModuleDef PureCipher_Module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "purecipher",
+    .m_doc = PureCipher_Docstring,
+    .m_size = sizeof(PureCipher_ModuleState),
+    .m_methods = PureCipher_Methods,
+    .m_slots = PureCipher_Slots,
+    .m_traverse = PureCipher_traverse,
+    .m_clear = PureCipher_clear,
+    .m_free = PureCipher_free,
+};
 
-    return module;
+PyMODINIT_FUNC
+PyInit_purecipher(void) {
+    return PyModuleDef_Init(&PureCipher_Module);
 }
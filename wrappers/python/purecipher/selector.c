@@ -0,0 +1,191 @@
+#include "selector.h"
+
+#include "cipher.h"
+
+/*
+ * Destructor for PureCipher_SelectorObject.
+ */
+static void Selector_dealloc(PureCipher_SelectorObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+    purecipher_selector_free(self->selector);
+    type->tp_free((PyObject *) self);
+    Py_DECREF(type);
+}
+
+/*
+ * Select the keys in the given iterable of str or bytes objects.
+ *
+ * Returns -1 if an exception was raised, 0 otherwise.
+ */
+static int select_keys(purecipher_selector_t *selector, PyObject *keys) {
+    PyObject *iterator = PyObject_GetIter(keys);
+    if (iterator == NULL) {
+        return -1;
+    }
+    PyObject *key;
+    while ((key = PyIter_Next(iterator)) != NULL) {
+        const char *key_data = NULL;
+        if (PyUnicode_Check(key)) {
+            key_data = PyUnicode_AsUTF8(key);
+        } else if (PyBytes_Check(key)) {
+            key_data = PyBytes_AsString(key);
+        } else {
+            PyErr_SetString(PyExc_TypeError, "keys must be str or bytes objects");
+        }
+        if (key_data != NULL) {
+            purecipher_selector_key(selector, key_data);
+        }
+        Py_DECREF(key);
+        if (key_data == NULL) {
+            Py_DECREF(iterator);
+            return -1;
+        }
+    }
+    Py_DECREF(iterator);
+    return PyErr_Occurred() ? -1 : 0;
+}
+
+/*
+ * Select the columns in the given iterable of ints.
+ *
+ * Returns -1 if an exception was raised, 0 otherwise.
+ */
+static int select_columns(purecipher_selector_t *selector, PyObject *columns) {
+    PyObject *iterator = PyObject_GetIter(columns);
+    if (iterator == NULL) {
+        return -1;
+    }
+    PyObject *column;
+    while ((column = PyIter_Next(iterator)) != NULL) {
+        const size_t index = PyLong_AsSize_t(column);
+        Py_DECREF(column);
+        if (index == (size_t) -1 && PyErr_Occurred()) {
+            Py_DECREF(iterator);
+            return -1;
+        }
+        purecipher_selector_column(selector, index);
+    }
+    Py_DECREF(iterator);
+    return PyErr_Occurred() ? -1 : 0;
+}
+
+/*
+ * Constructor for PureCipher_SelectorObject.
+ */
+static PyObject *Selector_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"delimiter", "columns", "keys", "quote", NULL};
+    char delimiter;
+    PyObject *columns = NULL;
+    PyObject *keys = NULL;
+    PyObject *quote = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "c|OOO", kwlist, &delimiter, &columns, &keys, &quote)) {
+        return NULL;
+    }
+    if (quote != Py_None && (!PyBytes_Check(quote) || PyBytes_Size(quote) != 1)) {
+        PyErr_SetString(PyExc_TypeError, "quote must be a bytes object of length 1 or None");
+        return NULL;
+    }
+
+    PureCipher_SelectorObject *self = (PureCipher_SelectorObject *) type->tp_alloc(type, 0);
+    if (self == NULL) {
+        return NULL;
+    }
+    self->selector = purecipher_selector_new((uint8_t) delimiter);
+    if (quote != Py_None) {
+        purecipher_selector_quote(self->selector, (uint8_t) PyBytes_AsString(quote)[0]);
+    }
+    if ((columns != NULL && select_columns(self->selector, columns) < 0)
+        || (keys != NULL && select_keys(self->selector, keys) < 0)) {
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject *) self;
+}
+
+/*
+ * Applies the given selector function to a cipher and writable buffer.
+ */
+static PyObject *Selector_cipher_buffer(
+    PureCipher_SelectorObject *self,
+    PyObject *args,
+    void (*selector_fn)(const purecipher_selector_t *, purecipher_obj_t, uint8_t *, size_t)
+) {
+    PureCipher_ModuleState *state = PureCipher_get_state_by_type(Py_TYPE(self));
+    PureCipher_CipherObject *cipher;
+    Py_buffer view;
+    if (!PyArg_ParseTuple(args, "O!w*", state->CipherType, &cipher, &view)) {
+        return NULL;
+    }
+    selector_fn(self->selector, cipher->cipher, (uint8_t *) view.buf, (size_t) view.len);
+    PyBuffer_Release(&view);
+    Py_RETURN_NONE;
+}
+
+/*
+ * Encipher the selected fields of a writable buffer inplace.
+ */
+static PyObject *Selector_encipher(PureCipher_SelectorObject *self, PyObject *args) {
+    return Selector_cipher_buffer(self, args, purecipher_selector_encipher);
+}
+
+const PyDoc_STRVAR(Selector_encipher_doc,
+    "encipher(cipher, buffer)"
+    "\n\n"
+    "Encipher the selected fields of the delimited text records in the given\n"
+    "writable buffer, such as a bytearray, inplace with the given cipher.");
+
+/*
+ * Decipher the selected fields of a writable buffer inplace.
+ */
+static PyObject *Selector_decipher(PureCipher_SelectorObject *self, PyObject *args) {
+    return Selector_cipher_buffer(self, args, purecipher_selector_decipher);
+}
+
+const PyDoc_STRVAR(Selector_decipher_doc,
+    "decipher(cipher, buffer)"
+    "\n\n"
+    "Decipher the selected fields of the delimited text records in the given\n"
+    "writable buffer, such as a bytearray, inplace with the given cipher.");
+
+static PyMethodDef Selector_methods[] = {
+    {"encipher", (PyCFunction) Selector_encipher, METH_VARARGS, Selector_encipher_doc},
+    {"decipher", (PyCFunction) Selector_decipher, METH_VARARGS, Selector_decipher_doc},
+    {NULL}  /* Sentinel */
+};
+
+const PyDoc_STRVAR(PureCipher_SelectorObject_doc,
+    "FieldSelector(delimiter, columns=(), keys=(), quote=None)"
+    "\n\n"
+    "Selection of fields within delimited text records, such as CSV rows or\n"
+    "key=value log lines, to be ciphered in place."
+    "\n\n"
+    "Records are separated by newlines and fields by delimiter, a bytes object of\n"
+    "length 1. The fields in the given zero-based columns are selected, as are the\n"
+    "values of fields of the form key=value for the given str or bytes keys. If\n"
+    "quote is given, delimiters and newlines between quotes do not separate fields."
+    "\n\n"
+    "Text can only be deciphered by a selector if the cipher maps delimiter, quote\n"
+    "and newline bytes to themselves and no other byte onto them.");
+
+/*
+ * Python type slots for PureCipher_SelectorObject instances.
+ */
+static PyType_Slot Selector_slots[] = {
+    {Py_tp_doc,     (void *) PureCipher_SelectorObject_doc},
+    {Py_tp_new,     Selector_new},
+    {Py_tp_dealloc, Selector_dealloc},
+    {Py_tp_methods, Selector_methods},
+    {0, NULL}  /* Sentinel */
+};
+
+/*
+ * Python type specification for PureCipher_SelectorObject instances.
+ */
+PyType_Spec PureCipher_SelectorSpec = {
+    .name = "purecipher.FieldSelector",
+    .basicsize = sizeof(PureCipher_SelectorObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = Selector_slots,
+};
@@ -0,0 +1,23 @@
+#ifndef PURECIPHER_SELECTOR_H
+#define PURECIPHER_SELECTOR_H
+
+#define PY_SSIZE_T_CLEAN
+
+#include "Python.h"
+
+#include "purecipher.h"
+
+/*
+ * Python object wrapping a field selector pointer.
+ */
+typedef struct {
+    PyObject_HEAD
+    purecipher_selector_t *selector;
+} PureCipher_SelectorObject;
+
+/*
+ * Python type specification for PureCipher_SelectorObjects.
+ */
+extern PyType_Spec PureCipher_SelectorSpec;
+
+#endif //PURECIPHER_SELECTOR_H
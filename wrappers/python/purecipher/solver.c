@@ -0,0 +1,207 @@
+#include "solver.h"
+
+#include "cipher.h"
+#include "module.h"
+
+/*
+ * Destructor for PureCipher_ModelObject.
+ */
+static void Model_dealloc(PureCipher_ModelObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+    purecipher_model_free(self->model);
+    type->tp_free((PyObject *) self);
+    Py_DECREF(type);
+}
+
+/*
+ * Constructor for PureCipher_ModelObject.
+ */
+static PyObject *Model_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"corpus", NULL};
+    Py_buffer corpus;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*", kwlist, &corpus)) {
+        return NULL;
+    }
+    PureCipher_ModelObject *self = (PureCipher_ModelObject *) type->tp_alloc(type, 0);
+    if (self != NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        self->model = purecipher_model_new(corpus.buf, (size_t) corpus.len);
+        Py_END_ALLOW_THREADS
+    }
+    PyBuffer_Release(&corpus);
+    return (PyObject *) self;
+}
+
+/*
+ * Score the given text under this model.
+ */
+static PyObject *Model_score(PureCipher_ModelObject *self, PyObject *const *args, Py_ssize_t nargs) {
+    Py_buffer text;
+    double score;
+
+    if (nargs != 1) {
+        PyErr_Format(PyExc_TypeError, "score() takes exactly one argument (%zd given)", nargs);
+        return NULL;
+    }
+    if (PyObject_GetBuffer(args[0], &text, PyBUF_SIMPLE) < 0) {
+        return NULL;
+    }
+    score = purecipher_model_score(self->model, text.buf, (size_t) text.len);
+    PyBuffer_Release(&text);
+    return PyFloat_FromDouble(score);
+}
+
+const PyDoc_STRVAR(Model_score_doc,
+    "score(text)"
+    "\n\n"
+    "Return the mean log frequency of the bigrams of the given bytes-like object\n"
+    "under this model. Higher scores indicate text that is more like the corpus.");
+
+/*
+ * Add the given iterable of (offset, plaintext) pairs to a solver as cribs.
+ *
+ * Returns -1 if an exception was raised, 0 otherwise.
+ */
+static int add_cribs(purecipher_solver_t *solver, PyObject *cribs) {
+    PyObject *iterator = PyObject_GetIter(cribs);
+    if (iterator == NULL) {
+        return -1;
+    }
+    PyObject *crib;
+    while ((crib = PyIter_Next(iterator)) != NULL) {
+        Py_ssize_t offset;
+        Py_buffer plaintext;
+        const int parsed = PyTuple_Check(crib) && PyArg_ParseTuple(crib, "ny*", &offset, &plaintext);
+        Py_DECREF(crib);
+        if (!parsed || offset < 0) {
+            if (parsed) {
+                PyBuffer_Release(&plaintext);
+            }
+            PyErr_Clear();
+            PyErr_SetString(PyExc_TypeError, "cribs must be (offset, plaintext) pairs with a non-negative offset");
+            Py_DECREF(iterator);
+            return -1;
+        }
+        purecipher_solver_add_crib(solver, (size_t) offset, plaintext.buf, (size_t) plaintext.len);
+        PyBuffer_Release(&plaintext);
+    }
+    Py_DECREF(iterator);
+    return PyErr_Occurred() ? -1 : 0;
+}
+
+/*
+ * Recover the substitution cipher of the given ciphertext.
+ */
+static PyObject *Model_solve(PureCipher_ModelObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"ciphertext", "cribs", "threads", "time_limit", "max_restarts", "seed", NULL};
+    Py_buffer ciphertext;
+    PyObject *cribs = NULL;
+    Py_ssize_t threads = 0;
+    PyObject *time_limit = Py_None;
+    unsigned long long max_restarts = 64;
+    unsigned long long seed = 0;
+    double limit = 0.0;
+
+    if (!PyArg_ParseTupleAndKeywords(
+        args, kwds, "y*|$OnOKK", kwlist,
+        &ciphertext, &cribs, &threads, &time_limit, &max_restarts, &seed
+    )) {
+        return NULL;
+    }
+    if (time_limit != Py_None) {
+        limit = PyFloat_AsDouble(time_limit);
+        if (limit == -1.0 && PyErr_Occurred()) {
+            PyBuffer_Release(&ciphertext);
+            return NULL;
+        }
+    }
+    if (threads < 0 || limit < 0.0) {
+        PyErr_SetString(PyExc_ValueError, "threads and time_limit must be non-negative");
+        PyBuffer_Release(&ciphertext);
+        return NULL;
+    }
+
+    purecipher_solver_t *solver = purecipher_solver_new(self->model);
+    purecipher_solver_set_threads(solver, (size_t) threads);
+    purecipher_solver_set_max_restarts(solver, max_restarts);
+    purecipher_solver_set_seed(solver, seed);
+    if (time_limit != Py_None) {
+        purecipher_solver_set_time_limit(solver, (uint64_t) (limit * 1000.0));
+    }
+    if (cribs != NULL && add_cribs(solver, cribs) < 0) {
+        purecipher_solver_free(solver);
+        PyBuffer_Release(&ciphertext);
+        return NULL;
+    }
+
+    purecipher_obj_t cipher;
+    double score = 0.0;
+    Py_BEGIN_ALLOW_THREADS
+    cipher = purecipher_solver_solve(solver, ciphertext.buf, (size_t) ciphertext.len, &score);
+    Py_END_ALLOW_THREADS
+    purecipher_solver_free(solver);
+    PyBuffer_Release(&ciphertext);
+
+    if (cipher._data == NULL) {
+        PyErr_SetString(PyExc_ValueError, "cribs do not fit the ciphertext");
+        return NULL;
+    }
+    PyObject *cipher_object = PureCipher_Cipher_wrap(PureCipher_get_state_by_type(Py_TYPE(self)), cipher);
+    if (cipher_object == NULL) {
+        return NULL;
+    }
+    return Py_BuildValue("(Nd)", cipher_object, score);
+}
+
+const PyDoc_STRVAR(Model_solve_doc,
+    "solve(ciphertext, *, cribs=(), threads=0, time_limit=None, max_restarts=64, seed=0)"
+    "\n\n"
+    "Recover the substitution cipher that most likely enciphered the given\n"
+    "bytes-like object, returning a tuple of the cipher and the score of the\n"
+    "recovered plaintext."
+    "\n\n"
+    "The solver hill climbs on the bigram statistics of this model, restarting\n"
+    "max_restarts times in total from perturbed keys on threads threads, one per\n"
+    "core if zero, and stops early once time_limit seconds have elapsed. cribs is\n"
+    "an iterable of (offset, plaintext) pairs of known plaintext, which is held\n"
+    "fixed. The GIL is released while solving."
+    "\n\n"
+    "Raises ValueError if a crib extends past the end of the ciphertext or\n"
+    "contradicts another crib.");
+
+static PyMethodDef Model_methods[] = {
+    {"score", (PyCFunction) Model_score, METH_FASTCALL, Model_score_doc},
+    {"solve", (PyCFunction) Model_solve, METH_VARARGS | METH_KEYWORDS, Model_solve_doc},
+    {NULL}  /* Sentinel */
+};
+
+const PyDoc_STRVAR(PureCipher_ModelObject_doc,
+    "NgramModel(corpus)"
+    "\n\n"
+    "Bigram statistics of the given bytes-like corpus of plaintext, used to\n"
+    "recover substitution ciphers from ciphertext of the same kind of text."
+    "\n\n"
+    "The larger the corpus, the better the model.");
+
+/*
+ * Python type slots for PureCipher_ModelObject instances.
+ */
+static PyType_Slot Model_slots[] = {
+    {Py_tp_doc,     (void *) PureCipher_ModelObject_doc},
+    {Py_tp_new,     Model_new},
+    {Py_tp_dealloc, Model_dealloc},
+    {Py_tp_methods, Model_methods},
+    {0, NULL}  /* Sentinel */
+};
+
+/*
+ * Python type specification for PureCipher_ModelObject instances.
+ */
+PyType_Spec PureCipher_ModelSpec = {
+    .name = "purecipher.NgramModel",
+    .basicsize = sizeof(PureCipher_ModelObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = Model_slots,
+};
@@ -0,0 +1,23 @@
+#ifndef PURECIPHER_SOLVER_H
+#define PURECIPHER_SOLVER_H
+
+#define PY_SSIZE_T_CLEAN
+
+#include "Python.h"
+
+#include "purecipher.h"
+
+/*
+ * Python object wrapping an n-gram model pointer.
+ */
+typedef struct {
+    PyObject_HEAD
+    purecipher_model_t *model;
+} PureCipher_ModelObject;
+
+/*
+ * Python type specification for PureCipher_ModelObjects.
+ */
+extern PyType_Spec PureCipher_ModelSpec;
+
+#endif //PURECIPHER_SOLVER_H
@@ -0,0 +1,38 @@
+#include "stats.h"
+
+PyObject *PureCipher_histogram_to_list(const uint64_t counts[256]) {
+    PyObject *list = PyList_New(256);
+    if (list == NULL) {
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < 256; i++) {
+        PyObject *count = PyLong_FromUnsignedLongLong(counts[i]);
+        if (count == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, count);
+    }
+    return list;
+}
+
+int PureCipher_histogram_from_sequence(PyObject *sequence, uint64_t counts[256]) {
+    PyObject *fast = PySequence_Fast(sequence, "counts must be a sequence");
+    if (fast == NULL) {
+        return -1;
+    }
+    if (PySequence_Fast_GET_SIZE(fast) != 256) {
+        PyErr_SetString(PyExc_ValueError, "counts must contain exactly 256 entries");
+        Py_DECREF(fast);
+        return -1;
+    }
+    for (Py_ssize_t i = 0; i < 256; i++) {
+        counts[i] = PyLong_AsUnsignedLongLong(PySequence_Fast_GET_ITEM(fast, i));
+        if (PyErr_Occurred()) {
+            Py_DECREF(fast);
+            return -1;
+        }
+    }
+    Py_DECREF(fast);
+    return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef PURECIPHER_STATS_H
+#define PURECIPHER_STATS_H
+
+#define PY_SSIZE_T_CLEAN
+
+#include "Python.h"
+
+#include "stdint.h"
+
+/*
+ * Build a Python list of 256 integers from the given byte counts.
+ */
+PyObject *PureCipher_histogram_to_list(const uint64_t counts[256]);
+
+/*
+ * Read 256 byte counts from the given Python sequence of integers.
+ *
+ * This function returns -1 if an exception was raised, 0 otherwise.
+ */
+int PureCipher_histogram_from_sequence(PyObject *sequence, uint64_t counts[256]);
+
+#endif //PURECIPHER_STATS_H
@@ -0,0 +1,281 @@
+#include "wide.h"
+
+#include "builder.h"
+
+/*
+ * Destructor for PureCipher_WideBuilderObject.
+ */
+static void WideBuilder_dealloc(PureCipher_WideBuilderObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+    if (self->builder != NULL) {
+        purecipher_wide_builder_discard(self->builder);
+    }
+    type->tp_free((PyObject *) self);
+    Py_DECREF(type);
+}
+
+/*
+ * Constructor for PureCipher_WideBuilderObject.
+ */
+static PyObject *WideBuilder_new(PyTypeObject *type, PyObject *Py_UNUSED(args), PyObject *Py_UNUSED(kwds)) {
+    PureCipher_WideBuilderObject *self;
+    self = (PureCipher_WideBuilderObject *) type->tp_alloc(type, 0);
+    if (self != NULL) {
+        self->builder = purecipher_wide_builder_new();
+    }
+    return (PyObject *) self;
+}
+
+/*
+ * Raises a BuilderError if the given builder object has already been consumed.
+ *
+ * This function returns -1 if an exception was raised, 0 otherwise.
+ */
+static int WideBuilder_check_consumed(const PureCipher_WideBuilderObject *self) {
+    if (self->builder == NULL) {
+        PureCipher_ModuleState *state = PureCipher_get_state_by_type(Py_TYPE(self));
+        PyErr_SetString(state->BuilderError, "Builder has already been consumed.");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Checks if the given builder object has been consumed.
+ */
+static PyObject *WideBuilder_is_consumed(PureCipher_WideBuilderObject *self, PyObject *Py_UNUSED(args)) {
+    int consumed;
+    PURECIPHER_BEGIN_CRITICAL_SECTION(self);
+    consumed = self->builder == NULL;
+    PURECIPHER_END_CRITICAL_SECTION();
+    return PyBool_FromLong(consumed);
+}
+
+const PyDoc_STRVAR(WideBuilder_is_consumed_doc,
+    "Return True if this builder has been consumed, False otherwise.");
+
+/*
+ * Convert a 16-bit substitution builder into a cipher object.
+ */
+static PyObject *WideBuilder_into_cipher(PureCipher_WideBuilderObject *self, PyObject *Py_UNUSED(args)) {
+    purecipher_wide_builder_t *builder;
+    PURECIPHER_BEGIN_CRITICAL_SECTION(self);
+    builder = self->builder;
+    self->builder = NULL;
+    PURECIPHER_END_CRITICAL_SECTION();
+
+    if (builder == NULL) {
+        WideBuilder_check_consumed(self);
+        return NULL;
+    }
+    purecipher_wide_t *cipher_ptr = purecipher_wide_builder_into_cipher(builder);
+
+    PureCipher_ModuleState *state = PureCipher_get_state_by_type(Py_TYPE(self));
+    PureCipher_WideCipherObject *cipher;
+    cipher = PyObject_New(PureCipher_WideCipherObject, state->WideCipherType);
+    if (cipher == NULL) {
+        purecipher_wide_free(cipher_ptr);
+        return NULL;
+    }
+    cipher->cipher = cipher_ptr;
+    return (PyObject *) cipher;
+}
+
+const PyDoc_STRVAR(WideBuilder_into_cipher_doc,
+    "Convert this builder into a WideCipher object.\n\n"
+    "This method will consume this builder. Further configuration will not be possible.");
+
+/*
+ * Swap two tokens in the cipher mapping that this builder will produce.
+ */
+static PyObject *WideBuilder_swap(PureCipher_WideBuilderObject *self, PyObject *args) {
+    unsigned short left;
+    unsigned short right;
+    if (!PyArg_ParseTuple(args, "HH", &left, &right)) {
+        return NULL;
+    }
+    int status;
+    PURECIPHER_BEGIN_CRITICAL_SECTION(self);
+    status = WideBuilder_check_consumed(self);
+    if (status == 0) {
+        purecipher_wide_builder_swap(self->builder, left, right);
+    }
+    PURECIPHER_END_CRITICAL_SECTION();
+    if (status < 0) {
+        return NULL;
+    }
+
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+const PyDoc_STRVAR(WideBuilder_swap_doc,
+    "swap(left, right)"
+    "\n\n"
+    "Swap the two given 16-bit tokens, given as ints, in the cipher mapping\n"
+    "that this builder will produce.");
+
+/*
+ * Rotates each token in the given inclusive range by the given offset in the
+ * cipher mapping that this builder will produce.
+ */
+static PyObject *WideBuilder_rotate(PureCipher_WideBuilderObject *self, PyObject *args) {
+    unsigned short from;
+    unsigned short to;
+    int32_t offset;
+    if (!PyArg_ParseTuple(args, "HHi", &from, &to, &offset)) {
+        return NULL;
+    }
+    if (to < from) {
+        PyErr_SetString(PyExc_ValueError, "The end of the range must not precede its start.");
+        return NULL;
+    }
+    int status;
+    PURECIPHER_BEGIN_CRITICAL_SECTION(self);
+    status = WideBuilder_check_consumed(self);
+    if (status == 0) {
+        purecipher_wide_builder_rotate(self->builder, from, to, offset);
+    }
+    PURECIPHER_END_CRITICAL_SECTION();
+    if (status < 0) {
+        return NULL;
+    }
+
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+const PyDoc_STRVAR(WideBuilder_rotate_doc,
+    "rotate(from, to, offset)"
+    "\n\n"
+    "Rotates each 16-bit token in the given inclusive range, given as ints, by\n"
+    "the given offset in the cipher mapping that this builder will produce.");
+
+/*
+ * PureCipher_WideBuilderObject method description tables.
+ */
+static PyMethodDef WideBuilder_methods[] = {
+    {"is_consumed", (PyCFunction) WideBuilder_is_consumed, METH_NOARGS,  WideBuilder_is_consumed_doc},
+    {"into_cipher", (PyCFunction) WideBuilder_into_cipher, METH_NOARGS,  WideBuilder_into_cipher_doc},
+    {"swap",        (PyCFunction) WideBuilder_swap,        METH_VARARGS, WideBuilder_swap_doc},
+    {"rotate",      (PyCFunction) WideBuilder_rotate,      METH_VARARGS, WideBuilder_rotate_doc},
+    {NULL}  /* Sentinel */
+};
+
+const PyDoc_STRVAR(PureCipher_WideBuilderObject_doc,
+    "Helper object to build substitution ciphers over 16-bit tokens."
+    "\n\n"
+    "Like SubstitutionBuilder, this object is single use: one builder can only\n"
+    "produce one cipher.");
+
+/*
+ * Python type slots for PureCipher_WideBuilderObject instances.
+ */
+static PyType_Slot WideBuilder_slots[] = {
+    {Py_tp_doc,     (void *) PureCipher_WideBuilderObject_doc},
+    {Py_tp_new,     WideBuilder_new},
+    {Py_tp_dealloc, WideBuilder_dealloc},
+    {Py_tp_methods, WideBuilder_methods},
+    {0, NULL}  /* Sentinel */
+};
+
+/*
+ * Python type specification for PureCipher_WideBuilderObject instances.
+ */
+PyType_Spec PureCipher_WideBuilderSpec = {
+    .name = "purecipher.WideSubstitutionBuilder",
+    .basicsize = sizeof(PureCipher_WideBuilderObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = WideBuilder_slots,
+};
+
+/*
+ * Destructor for PureCipher_WideCipherObject.
+ */
+static void WideCipher_dealloc(PureCipher_WideCipherObject *self) {
+    PyTypeObject *type = Py_TYPE(self);
+    purecipher_wide_free(self->cipher);
+    type->tp_free((PyObject *) self);
+    Py_DECREF(type);
+}
+
+/*
+ * Applies the given 16-bit cipher function to a writable buffer inplace.
+ */
+static PyObject *WideCipher_cipher_buffer(
+    PureCipher_WideCipherObject *self,
+    PyObject *args,
+    void (*cipher_fn)(const purecipher_wide_t *, uint16_t *, size_t)
+) {
+    Py_buffer view;
+    if (!PyArg_ParseTuple(args, "w*", &view)) {
+        return NULL;
+    }
+    if (view.len % sizeof(uint16_t) != 0) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "Buffer must hold a whole number of 16-bit tokens.");
+        return NULL;
+    }
+    cipher_fn(self->cipher, (uint16_t *) view.buf, (size_t) view.len / sizeof(uint16_t));
+    PyBuffer_Release(&view);
+    Py_RETURN_NONE;
+}
+
+/*
+ * Encipher the given writable buffer of 16-bit tokens inplace.
+ */
+static PyObject *WideCipher_encipher_buffer(PureCipher_WideCipherObject *self, PyObject *args) {
+    return WideCipher_cipher_buffer(self, args, purecipher_wide_encipher);
+}
+
+const PyDoc_STRVAR(WideCipher_encipher_buffer_doc,
+    "encipher_buffer(buffer)"
+    "\n\n"
+    "Encipher the given writable buffer of native-endian 16-bit tokens inplace,\n"
+    "such as an array('H') or a bytearray of UTF-16 code units.");
+
+/*
+ * Decipher the given writable buffer of 16-bit tokens inplace.
+ */
+static PyObject *WideCipher_decipher_buffer(PureCipher_WideCipherObject *self, PyObject *args) {
+    return WideCipher_cipher_buffer(self, args, purecipher_wide_decipher);
+}
+
+const PyDoc_STRVAR(WideCipher_decipher_buffer_doc,
+    "decipher_buffer(buffer)"
+    "\n\n"
+    "Decipher the given writable buffer of native-endian 16-bit tokens inplace,\n"
+    "such as an array('H') or a bytearray of UTF-16 code units.");
+
+static PyMethodDef WideCipher_methods[] = {
+    {"encipher_buffer", (PyCFunction) WideCipher_encipher_buffer, METH_VARARGS, WideCipher_encipher_buffer_doc},
+    {"decipher_buffer", (PyCFunction) WideCipher_decipher_buffer, METH_VARARGS, WideCipher_decipher_buffer_doc},
+    {NULL}  /* Sentinel */
+};
+
+const PyDoc_STRVAR(PureCipher_WideCipherObject_doc,
+    "Substitution cipher over 16-bit tokens, such as UTF-16 code units."
+    "\n\n"
+    "Instances are created with WideSubstitutionBuilder.into_cipher.");
+
+/*
+ * Python type slots for PureCipher_WideCipherObject instances.
+ */
+static PyType_Slot WideCipher_slots[] = {
+    {Py_tp_doc,     (void *) PureCipher_WideCipherObject_doc},
+    {Py_tp_dealloc, WideCipher_dealloc},
+    {Py_tp_methods, WideCipher_methods},
+    {0, NULL}  /* Sentinel */
+};
+
+/*
+ * Python type specification for PureCipher_WideCipherObject instances.
+ */
+PyType_Spec PureCipher_WideCipherSpec = {
+    .name = "purecipher.WideCipher",
+    .basicsize = sizeof(PureCipher_WideCipherObject),
+    .itemsize = 0,
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE | Py_TPFLAGS_DISALLOW_INSTANTIATION,
+    .slots = WideCipher_slots,
+};
@@ -0,0 +1,38 @@
+#ifndef PURECIPHER_WIDE_H
+#define PURECIPHER_WIDE_H
+
+#define PY_SSIZE_T_CLEAN
+
+#include "Python.h"
+
+#include "purecipher.h"
+
+#include "module.h"
+
+/*
+ * Python object wrapping a 16-bit substitution builder pointer.
+ */
+typedef struct {
+    PyObject_HEAD
+    purecipher_wide_builder_t *builder;
+} PureCipher_WideBuilderObject;
+
+/*
+ * Python object wrapping a 16-bit substitution cipher pointer.
+ */
+typedef struct {
+    PyObject_HEAD
+    purecipher_wide_t *cipher;
+} PureCipher_WideCipherObject;
+
+/*
+ * Python type specification for PureCipher_WideBuilderObjects.
+ */
+extern PyType_Spec PureCipher_WideBuilderSpec;
+
+/*
+ * Python type specification for PureCipher_WideCipherObjects.
+ */
+extern PyType_Spec PureCipher_WideCipherSpec;
+
+#endif //PURECIPHER_WIDE_H
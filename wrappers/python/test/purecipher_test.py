@@ -1,8 +1,43 @@
+import array
+import asyncio
+import base64
+import bisect
+import importlib.util
+import multiprocessing
+import pickle
+import select
+import sys
+import threading
 import unittest
+from multiprocessing import shared_memory
+
+try:
+    import _interpreters as interpreters
+except ImportError:
+    try:
+        import _xxsubinterpreters as interpreters
+    except ImportError:
+        interpreters = None
 
 import purecipher
 
 
+def encipher_with(cipher, message):
+    """Encipher a message in a pool worker, to which the cipher was pickled."""
+    return cipher.encipher(message)
+
+
+def encipher_shared(name, message):
+    """Encipher a message in a pool worker with the cipher in the named shared memory."""
+    shm = shared_memory.SharedMemory(name)
+    cipher = purecipher.from_shared(shm.buf[:purecipher.SHARED_TABLES_LEN])
+    try:
+        return cipher.encipher(message)
+    finally:
+        del cipher
+        shm.close()
+
+
 class CipherTest(unittest.TestCase):
 
     def test_cipher_caesar(self):
@@ -28,6 +63,21 @@ class CipherTest(unittest.TestCase):
         self.assertEqual('Pur3 c!ph3rs @r3 1h3 BE5Ti', cipher_text)
         self.assertEqual(message, cipher.decipher(cipher_text))
 
+    def test_cipher_affine(self):
+        # Flipping bit 5 toggles the case of ASCII letters.
+        cipher = purecipher.affine(bytes([1 << i for i in range(8)]), 0x20)
+
+        buffer = bytearray(b'NorwegianBlue' * 8)
+        cipher.encipher_buffer(buffer)
+        self.assertEqual(bytearray(b'nORWEGIANbLUE' * 8), buffer)
+        cipher.decipher_buffer(buffer)
+        self.assertEqual(bytearray(b'NorwegianBlue' * 8), buffer)
+
+        with self.assertRaises(ValueError):
+            purecipher.affine(bytes(8))
+        with self.assertRaises(ValueError):
+            purecipher.affine(b'\x01')
+
     def test_encipher_str_matches_buffer(self):
         # Depends on SubstitutionBuilder being implemented correctly
         cipher = purecipher.SubstitutionBuilder() \
@@ -42,6 +92,495 @@ class CipherTest(unittest.TestCase):
             cipher.encipher_buffer(buffer)
             self.assertEqual(cipher.encipher(buffer_s), buffer.decode())
 
+    def test_cipher_long_str(self):
+        cipher = purecipher.rot13()
+        message = 'We attack at dawn. ' * 1000
+        cipher_text = cipher.encipher(message)
+        self.assertEqual('Jr nggnpx ng qnja. ' * 1000, cipher_text)
+        self.assertEqual(message, cipher.decipher(cipher_text))
+
+    def test_cipher_many(self):
+        cipher = purecipher.rot13()
+        messages = ['We attack', b'at dawn', '', b'', 'Norwegian Blue' * 40]
+
+        cipher_texts = cipher.encipher_many(messages)
+        self.assertEqual(['Jr nggnpx', b'ng qnja', '', b'', 'Abejrtvna Oyhr' * 40], cipher_texts)
+        self.assertEqual(messages, cipher.decipher_many(iter(cipher_texts)))
+        self.assertEqual([], cipher.encipher_many(()))
+
+        with self.assertRaises(TypeError):
+            cipher.encipher_many(['abc', 1])
+        with self.assertRaises(TypeError):
+            cipher.encipher_many(None)
+
+    def test_cipher_argument_count(self):
+        cipher = purecipher.rot13()
+        with self.assertRaises(TypeError):
+            cipher.encipher()
+        with self.assertRaises(TypeError):
+            cipher.encipher('a', 'b')
+        with self.assertRaises(TypeError):
+            cipher.encipher(b'abc')
+        with self.assertRaises(TypeError):
+            cipher.encipher_buffer(b'abc')
+        with self.assertRaises(TypeError):
+            cipher.pow('2')
+
+    def test_cipher_batch(self):
+        caesar = purecipher.caesar()
+        rot13 = purecipher.rot13()
+        ciphers = [rot13, caesar, rot13]
+        offsets = [0, 6, 12, 18]
+        buffer = bytearray(b'attackattackattack')
+
+        purecipher.encipher_batch(ciphers, buffer, offsets)
+        self.assertEqual(bytearray(b'nggnpxdwwdfnnggnpx'), buffer)
+
+        purecipher.decipher_batch(ciphers, buffer, offsets)
+        self.assertEqual(bytearray(b'attackattackattack'), buffer)
+
+    def test_cipher_batch_invalid_offsets(self):
+        cipher = purecipher.rot13()
+        buffer = bytearray(b'attack')
+
+        with self.assertRaises(ValueError):
+            purecipher.encipher_batch([cipher], buffer, [0])
+        with self.assertRaises(ValueError):
+            purecipher.encipher_batch([cipher, cipher], buffer, [0, 4, 2])
+        with self.assertRaises(ValueError):
+            purecipher.encipher_batch([cipher], buffer, [0, 7])
+        self.assertEqual(bytearray(b'attack'), buffer)
+
+    def test_histogram(self):
+        cipher = purecipher.caesar()
+        cipher_text = b'Zh dwwdfn dw gdzq.'
+
+        counts = purecipher.histogram(cipher_text)
+        self.assertEqual(256, len(counts))
+        self.assertEqual(4, counts[ord('d')])
+        self.assertEqual(len(cipher_text), sum(counts))
+
+        plain_counts = cipher.plaintext_histogram(cipher_text)
+        self.assertEqual(4, plain_counts[ord('a')])
+        self.assertEqual(1, plain_counts[ord('d')])
+        self.assertEqual(purecipher.histogram(b'We attack at dawn.'), plain_counts)
+
+    def test_histogram_statistics(self):
+        counts = purecipher.histogram(bytes(range(256)))
+        self.assertEqual(8.0, purecipher.entropy(counts))
+        self.assertEqual(0.0, purecipher.chi_square(counts, [1.0] * 256))
+
+        expected = [0.0] * 256
+        expected[ord('a')] = 0.5
+        expected[ord('b')] = 0.5
+        self.assertEqual(2.0, purecipher.chi_square(purecipher.histogram(b'aa'), expected))
+
+        with self.assertRaises(ValueError):
+            purecipher.entropy([1, 2, 3])
+
+    def test_cipher_algebra(self):
+        cipher = purecipher.caesar()
+
+        self.assertEqual('Ck gzzgiq gz jgct.', cipher.pow(2).encipher('We attack at dawn.'))
+        self.assertEqual('Tb xqqxzh xq axtk.', cipher.pow(-1).encipher('We attack at dawn.'))
+        self.assertEqual('We attack at dawn.', cipher.inverse().encipher('Zh dwwdfn dw gdzq.'))
+        self.assertEqual('We attack at dawn.', cipher.pow(26).encipher('We attack at dawn.'))
+        self.assertEqual(26, cipher.order())
+
+        cycles = purecipher.rot13().cycles()
+        self.assertEqual(26, len(cycles))
+        self.assertEqual(b'AN', cycles[0])
+
+    def test_cipher_array(self):
+        cipher = purecipher.caesar()
+
+        result = cipher.encipher_array(bytearray(b'abc xyz'))
+        self.assertIsInstance(result, memoryview)
+        self.assertEqual(b'def abc', bytes(result))
+        self.assertEqual(b'abc xyz', bytes(cipher.decipher_array(result)))
+
+        grid = memoryview(bytearray(b'abcdef')).cast('B', (2, 3))
+        self.assertEqual([[ord('d'), ord('e'), ord('f')], [ord('g'), ord('h'), ord('i')]],
+                         cipher.encipher_array(grid).tolist())
+
+        out = array.array('B', bytes(3))
+        self.assertIs(out, cipher.encipher_array(array.array('B', b'cat'), out=out))
+        self.assertEqual(b'fdw', out.tobytes())
+
+    def test_cipher_array_strided(self):
+        cipher = purecipher.rot13()
+
+        data = bytearray(b'a-b-c-')
+        self.assertEqual(b'nop', bytes(cipher.encipher_array(memoryview(data)[::2])))
+        self.assertEqual(b'-p-o-n', bytes(cipher.encipher_array(memoryview(data)[::-1])))
+
+        view = memoryview(data)[::2]
+        cipher.encipher_array(view, out=view)
+        self.assertEqual(b'n-o-p-', data)
+
+        out = bytearray(b'......')
+        cipher.decipher_array(bytearray(b'nop'), out=memoryview(out)[1::2])
+        self.assertEqual(b'.a.b.c', out)
+
+    def test_cipher_array_invalid(self):
+        cipher = purecipher.caesar()
+
+        with self.assertRaises(TypeError):
+            cipher.encipher_array(array.array('H', [1, 2]))
+        with self.assertRaises(TypeError):
+            cipher.encipher_array(b'abc', out=array.array('i', [0, 0, 0]))
+        with self.assertRaises(ValueError):
+            cipher.encipher_array(b'abc', out=bytearray(4))
+        with self.assertRaises(BufferError):
+            cipher.encipher_array(b'abc', out=b'xyz')
+
+    def test_cipher_find(self):
+        cipher = purecipher.caesar()
+        log = bytearray(b'ok\nERROR disk\nWARN disk\nERROR net' + b'\nERROR again' * 100)
+        cipher.encipher_buffer(log)
+
+        self.assertEqual(3, cipher.find('ERROR', log))
+        self.assertEqual(-1, cipher.find(b'FATAL', log))
+        self.assertEqual([9, 19], cipher.find_all('disk', log))
+        self.assertEqual(102, len(cipher.find_all('ERROR', log)))
+
+        matches = cipher.find_patterns(['WARN', b'net', 'again'], log)
+        self.assertEqual([(14, 0), (30, 1), (40, 2)], matches[:3])
+        self.assertEqual(102, len(matches))
+        with self.assertRaises(ValueError):
+            cipher.find_patterns(['WARN', ''], log)
+
+    def test_crc32c(self):
+        self.assertEqual(0xe3069283, purecipher.crc32c(b'123456789'))
+        self.assertEqual(0xe3069283, purecipher.crc32c(b'56789', purecipher.crc32c(b'1234')))
+        self.assertEqual(0xe3069283, purecipher.crc32c_combine(
+            purecipher.crc32c(b'1234'), purecipher.crc32c(b'56789'), 5))
+
+        cipher = purecipher.leet()
+        message = b'Pure ciphers are the BEST!' * 1000
+        buffer = bytearray(message)
+        plaintext_crc = purecipher.crc32c(message)
+        self.assertEqual(plaintext_crc, cipher.encipher_buffer_crc32c(buffer))
+        ciphertext = bytes(buffer)
+        self.assertEqual(purecipher.crc32c(ciphertext, 7),
+                         cipher.decipher_buffer_crc32c(memoryview(buffer), 7, ciphertext=True))
+        self.assertEqual(message, buffer)
+        self.assertEqual(plaintext_crc, cipher.encipher_buffer_crc32c(buffer, ciphertext=False))
+        with self.assertRaises(TypeError):
+            cipher.encipher_buffer_crc32c(message)
+
+    def test_cipher_encode(self):
+        cipher = purecipher.caesar()
+        self.assertEqual('44777764666e2064772067647a71', cipher.encipher_hex('Attack at dawn'))
+        self.assertEqual('RHd3ZGZuIGR3IGdkenE=', cipher.encipher_base64(b'Attack at dawn'))
+        self.assertEqual(b'Attack at dawn', cipher.decipher_hex('44777764666E2064772067647A71'))
+        self.assertEqual(b'Attack at dawn', cipher.decipher_base64(b'RHd3ZGZuIGR3IGdkenE='))
+
+        leet = purecipher.leet()
+        data = bytes(range(256)) * 40
+        ciphertext = bytearray(data)
+        leet.encipher_buffer(ciphertext)
+        self.assertEqual(base64.b64encode(ciphertext).decode(), leet.encipher_base64(data))
+        self.assertEqual(ciphertext.hex(), leet.encipher_hex(memoryview(data)))
+        self.assertEqual(data, leet.decipher_base64(leet.encipher_base64(data)))
+        self.assertEqual('', leet.encipher_base64(b''))
+
+        for text in ['RHd3*GZu', 'RHd', 'RHd3ZGZuIGR3IGdkenE=====']:
+            with self.assertRaises(ValueError):
+                cipher.decipher_base64(text)
+        with self.assertRaises(ValueError):
+            cipher.decipher_hex('4')
+
+    def test_plaintext_order(self):
+        cipher = purecipher.caesar()
+        words = [b'pear', b'apple', b'melon', b'apple', b'fig', b'peach', b'']
+        keys = [bytes(cipher.encipher(word.decode()), 'ascii') for word in words]
+        order = purecipher.PlaintextOrder(cipher)
+
+        self.assertEqual(-1, order.compare(keys[1], keys[0]))
+        self.assertEqual(0, order.compare(keys[1], bytearray(keys[3])))
+        self.assertEqual([6, 1, 3, 4, 2, 5, 0], order.argsort(keys))
+
+        by_key = sorted(keys, key=order)
+        order.sort(keys)
+        self.assertEqual(by_key, keys)
+        self.assertEqual(sorted(words), [bytes(cipher.decipher(key.decode()), 'ascii') for key in keys])
+
+        self.assertEqual(3, bisect.bisect_left(keys, order(keys[3]), key=order))
+        with self.assertRaises(TypeError):
+            order(keys[0]) < purecipher.PlaintextOrder(cipher)(keys[1])
+        with self.assertRaises(TypeError):
+            order.sort(tuple(keys))
+
+    def test_cipher_pickle(self):
+        cipher = purecipher.leet()
+        table = cipher.table()
+        self.assertEqual(256, len(table))
+        self.assertEqual(ord('3'), table[ord('e')])
+        self.assertEqual(table, purecipher.from_table(table).table())
+
+        restored = pickle.loads(pickle.dumps(cipher))
+        self.assertEqual('Pur3 c!ph3rs @r3 1h3 BE5Ti', restored.encipher('Pure ciphers are the BEST!'))
+
+        with multiprocessing.get_context('fork').Pool(2) as pool:
+            results = pool.starmap(encipher_with, [(cipher, 'leet'), (purecipher.rot13(), 'leet')])
+        self.assertEqual(['l331', 'yrrg'], results)
+
+        with self.assertRaises(ValueError):
+            purecipher.from_table(bytes(256))
+        with self.assertRaises(ValueError):
+            purecipher.from_table(table[:255])
+
+    def test_cipher_shared_memory(self):
+        shm = shared_memory.SharedMemory(create=True, size=purecipher.SHARED_TABLES_LEN)
+        try:
+            tables = shm.buf[:purecipher.SHARED_TABLES_LEN]
+            purecipher.caesar().write_shared(tables)
+            cipher = purecipher.from_shared(tables)
+            self.assertEqual('Zh dwwdfn dw gdzq.', cipher.encipher('We attack at dawn.'))
+            self.assertEqual('We attack at dawn.', cipher.decipher('Zh dwwdfn dw gdzq.'))
+
+            with multiprocessing.get_context('fork').Pool(2) as pool:
+                results = pool.starmap(encipher_shared, [(shm.name, 'abc'), (shm.name, 'xyz')])
+            self.assertEqual(['def', 'abc'], results)
+
+            self.assertEqual(cipher.table(), pickle.loads(pickle.dumps(cipher)).table())
+            del cipher
+            tables.release()
+        finally:
+            shm.close()
+            shm.unlink()
+
+        with self.assertRaises(ValueError):
+            purecipher.from_shared(bytes(purecipher.SHARED_TABLES_LEN))
+        with self.assertRaises(ValueError):
+            purecipher.caesar().write_shared(bytearray(256))
+
+
+class PeriodicCipherTest(unittest.TestCase):
+
+    def test_periodic_shifts(self):
+        cipher = purecipher.PeriodicCipher(b'\x00\x01\x02')
+        self.assertEqual(3, cipher.period())
+
+        buffer = bytearray(b'aaaaaaaa')
+        # Encipher the stream as two independent chunks.
+        tail = buffer[5:]
+        cipher.encipher_buffer(tail, 5)
+        head = buffer[:5]
+        cipher.encipher_buffer(head)
+        self.assertEqual(bytearray(b'abcabcab'), head + tail)
+
+        cipher.decipher_buffer(tail, 5)
+        self.assertEqual(bytearray(b'aaa'), tail)
+
+    def test_periodic_ciphers(self):
+        cipher = purecipher.PeriodicCipher([purecipher.Cipher(), purecipher.rot13()])
+        self.assertEqual(2, cipher.period())
+
+        buffer = bytearray(b'aaaa')
+        cipher.encipher_buffer(buffer, 1)
+        self.assertEqual(bytearray(b'nana'), buffer)
+
+    def test_periodic_invalid_key(self):
+        with self.assertRaises(ValueError):
+            purecipher.PeriodicCipher(b'')
+        with self.assertRaises(ValueError):
+            purecipher.PeriodicCipher([])
+        with self.assertRaises(TypeError):
+            purecipher.PeriodicCipher([1, 2])
+
+
+class FieldSelectorTest(unittest.TestCase):
+
+    def test_selector_columns(self):
+        selector = purecipher.FieldSelector(b',', columns=[1, 3], quote=b'"')
+        rot13 = purecipher.rot13()
+
+        buffer = bytearray(b'id,name,city,note\n7,"Smith, John",Oslo,"ok"\n')
+        selector.encipher(rot13, buffer)
+        self.assertEqual(bytearray(b'id,anzr,city,abgr\n7,"Fzvgu, Wbua",Oslo,"bx"\n'), buffer)
+
+        selector.decipher(rot13, buffer)
+        self.assertEqual(bytearray(b'id,name,city,note\n7,"Smith, John",Oslo,"ok"\n'), buffer)
+
+    def test_selector_keys(self):
+        selector = purecipher.FieldSelector(b' ', keys=['user', b'host'])
+        buffer = bytearray(b'user=alice host=db op=read')
+        selector.encipher(purecipher.rot13(), buffer)
+        self.assertEqual(bytearray(b'user=nyvpr host=qo op=read'), buffer)
+
+    def test_selector_invalid_arguments(self):
+        with self.assertRaises(TypeError):
+            purecipher.FieldSelector(b',', keys=[1])
+        with self.assertRaises(TypeError):
+            purecipher.FieldSelector(b',', quote='"')
+        with self.assertRaises(TypeError):
+            purecipher.FieldSelector(b',').encipher(purecipher.rot13(), b'read-only')
+
+
+class WideCipherTest(unittest.TestCase):
+
+    def test_wide_rotate(self):
+        # Shift hiragana one ahead.
+        builder = purecipher.WideSubstitutionBuilder()
+        cipher = builder.rotate(0x3041, 0x3096, 1).into_cipher()
+        self.assertTrue(builder.is_consumed())
+
+        buffer = array.array('H', map(ord, 'こんにちは, こんにちは!'))
+        cipher.encipher_buffer(buffer)
+        self.assertEqual('ごゔぬぢば, ごゔぬぢば!', ''.join(map(chr, buffer)))
+
+        cipher.decipher_buffer(buffer)
+        self.assertEqual('こんにちは, こんにちは!', ''.join(map(chr, buffer)))
+
+    def test_wide_swap(self):
+        cipher = purecipher.WideSubstitutionBuilder().swap(0, 0xffff).into_cipher()
+        buffer = array.array('H', [0, 1, 0xffff])
+        cipher.encipher_buffer(buffer)
+        self.assertEqual([0xffff, 1, 0], buffer.tolist())
+
+    def test_wide_invalid_buffer(self):
+        cipher = purecipher.WideSubstitutionBuilder().into_cipher()
+        with self.assertRaises(ValueError):
+            cipher.encipher_buffer(bytearray(3))
+        with self.assertRaises(TypeError):
+            cipher.encipher_buffer(b'ab')
+
+
+class NgramModelTest(unittest.TestCase):
+    PLAINTEXT = b'the quick brown fox jumps over the lazy dog.'
+
+    def setUp(self):
+        self.model = purecipher.NgramModel(b'the quick brown fox jumps over the lazy dog. ' * 100)
+
+    def test_model_score(self):
+        self.assertGreater(self.model.score(b'the dog'), self.model.score(b'xqz jvk'))
+
+    def test_model_solve(self):
+        ciphertext = bytearray(self.PLAINTEXT)
+        purecipher.caesar().encipher_buffer(ciphertext)
+        cipher, score = self.model.solve(ciphertext, cribs=[(4, b'quick brown')], threads=2, time_limit=5.0)
+        cipher.decipher_buffer(ciphertext)
+        # Other plaintext may score as well under a corpus of one sentence,
+        # but none better.
+        self.assertEqual(b'quick brown', ciphertext[4:15])
+        self.assertGreater(score, self.model.score(self.PLAINTEXT) - 1e-3)
+        self.assertAlmostEqual(self.model.score(ciphertext), score, places=3)
+
+    def test_model_solve_invalid_cribs(self):
+        ciphertext = bytearray(self.PLAINTEXT)
+        purecipher.caesar().encipher_buffer(ciphertext)
+        with self.assertRaises(ValueError):
+            self.model.solve(ciphertext, cribs=[(40, b'foxes')])
+        with self.assertRaises(TypeError):
+            self.model.solve(ciphertext, cribs=[b'quick'])
+
+
+class CipherContextTest(unittest.TestCase):
+
+    @unittest.skipUnless(sys.platform.startswith('linux'), 'eventfds are not supported')
+    def test_context_submit_reap(self):
+        context = purecipher.CipherContext(threads=2, entries=2)
+        cipher = purecipher.rot13()
+        buffers = [bytearray(b'abc') for _ in range(3)]
+
+        self.assertTrue(context.submit(cipher, buffers[0], 'first'))
+        self.assertTrue(context.submit(cipher, buffers[1], 'second'))
+        self.assertFalse(context.submit(cipher, buffers[2], 'third'))
+
+        tags = []
+        while len(tags) < 2:
+            select.select([context.fileno()], [], [], 1.0)
+            tags.extend(context.reap())
+        self.assertEqual(['first', 'second'], sorted(tags))
+        self.assertEqual([bytearray(b'nop')] * 2, buffers[:2])
+        context.close()
+
+    @unittest.skipUnless(sys.platform.startswith('linux'), 'eventfds are not supported')
+    def test_context_asyncio(self):
+        cipher = purecipher.caesar()
+
+        async def cipher_messages():
+            context = purecipher.CipherContext()
+            messages = [bytearray(b'We attack at dawn.') for _ in range(10)]
+            await asyncio.gather(*(context.encipher(cipher, m) for m in messages))
+            await context.decipher(cipher, messages[0])
+            context.close()
+            return messages
+
+        messages = asyncio.run(cipher_messages())
+        self.assertEqual(bytearray(b'We attack at dawn.'), messages[0])
+        self.assertEqual(bytearray(b'Zh dwwdfn dw gdzq.'), messages[9])
+
+    def test_context_without_eventfd(self):
+        context = purecipher.CipherContext()
+        buffer = bytearray(b'abc')
+        self.assertTrue(context.submit(purecipher.rot13(), buffer, 'tag'))
+        if not sys.platform.startswith('linux'):
+            with self.assertRaises(NotImplementedError):
+                context.fileno()
+        context.close()
+        self.assertEqual(bytearray(b'nop'), buffer)
+        with self.assertRaises(ValueError):
+            context.fileno()
+
+
+class ModuleStateTest(unittest.TestCase):
+
+    def load_module(self):
+        spec = importlib.util.find_spec('purecipher')
+        module = importlib.util.module_from_spec(spec)
+        spec.loader.exec_module(module)
+        return module
+
+    def test_module_instances_are_isolated(self):
+        other = self.load_module()
+        self.assertIsNot(purecipher, other)
+        self.assertIsNot(purecipher.Cipher, other.Cipher)
+        self.assertIsNot(purecipher.BuilderError, other.BuilderError)
+
+        buffer = bytearray(b'abc')
+        other.rot13().encipher_buffer(buffer)
+        self.assertEqual(bytearray(b'nop'), buffer)
+        self.assertIsInstance(other.SubstitutionBuilder().into_cipher(), other.Cipher)
+
+        builder = other.SubstitutionBuilder()
+        builder.into_cipher()
+        with self.assertRaises(other.BuilderError):
+            builder.swap(b'a', b'b')
+
+    def test_types_are_immutable(self):
+        with self.assertRaises(TypeError):
+            purecipher.Cipher.encipher = None
+        with self.assertRaises(TypeError):
+            purecipher.WideCipher()
+
+    @unittest.skipIf(interpreters is None, 'subinterpreters are not available')
+    def test_import_in_subinterpreter(self):
+        interp = interpreters.create()
+        try:
+            interpreters.run_string(interp, (
+                "import purecipher\n"
+                "assert purecipher.rot13().encipher('abc') == 'nop'\n"
+            ))
+        finally:
+            interpreters.destroy(interp)
+
+    def test_concurrent_ciphering(self):
+        cipher = purecipher.rot13()
+        buffers = [bytearray(b'abcdefghijklm' * 1000) for _ in range(8)]
+
+        def work(buffer):
+            for _ in range(100):
+                cipher.encipher_buffer(buffer)
+
+        threads = [threading.Thread(target=work, args=(b,)) for b in buffers]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        self.assertTrue(all(b == bytearray(b'abcdefghijklm' * 1000) for b in buffers))
 
 
 class BuilderTest(unittest.TestCase):